@@ -0,0 +1,104 @@
+#include "bench.h"
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <sys/stat.h>
+
+namespace {
+
+uint64_t allocations = 0;
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [--filter <substring>] [--min-time <seconds>] [--data-dir <dir>]" << std::endl;
+    std::cerr << "Synthetic inputs are generated into the data directory (default build/bench_data)." << std::endl;
+}
+
+} // namespace
+
+// Count every allocation made through the global operator new
+void* operator new(std::size_t size) {
+    allocations++;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+uint64_t allocationCount() {
+    return allocations;
+}
+
+void Bench::report(const std::string& name, uint64_t ops, double nsPerOp, double allocsPerOp, int reps) const {
+    std::printf("%-52s %10llu ops %12.1f ns/op %10.3f allocs/op  (%d reps)\n", name.c_str(),
+                static_cast<unsigned long long>(ops), nsPerOp, allocsPerOp, reps);
+    std::fflush(stdout);
+}
+
+int main(int argc, char* argv[]) {
+    double minTimeSec = 0.5;
+    std::string filter;
+    SyntheticMarketConfig market;
+    market.outputDir = "build/bench_data";
+    market.exchange = "BENCH";
+    market.symbols = 5;
+    market.eventsPerSymbol = 200000;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            printUsage(argv[0]);
+            return 0;
+        }
+        if (i + 1 >= argc) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        if (arg == "--filter") filter = argv[++i];
+        else if (arg == "--min-time") minTimeSec = std::atof(argv[++i]);
+        else if (arg == "--data-dir") market.outputDir = argv[++i];
+        else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    try {
+        mkdir(market.outputDir.c_str(), 0755);
+        for (uint32_t symbol = 0; symbol < market.symbols; ++symbol) {
+            generateSymbol(market, symbol);
+        }
+
+        Bench bench(minTimeSec, filter, market);
+        benchQueueBook(bench);
+        benchSimulator(bench);
+        benchStrategies(bench);
+        benchCorrelationLoad(bench);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,85 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include "tools/synthetic_market.h"
+
+// Number of global operator new calls so far in this process
+uint64_t allocationCount();
+
+// Keep a value alive so the compiler cannot drop the work producing it
+template <typename T>
+inline void doNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Microbenchmark runner. Each benchmark times a body that performs a known
+// number of operations; the body is repeated (after an untimed setup) until
+// the minimum run time has passed, and the fastest repetition is reported as
+// ns/op together with the global allocations per op.
+class Bench {
+public:
+    Bench(double minTimeSec, const std::string& filter, const SyntheticMarketConfig& market)
+        : minTimeSec_(minTimeSec), filter_(filter), market_(market) {}
+
+    // Synthetic market data shared by the benchmarks, already generated
+    const SyntheticMarketConfig& market() const { return market_; }
+    const std::string& dataDir() const { return market_.outputDir; }
+
+    bool enabled(const std::string& name) const {
+        return filter_.empty() || name.find(filter_) != std::string::npos;
+    }
+
+    template <typename Setup, typename Body>
+    void run(const std::string& name, uint64_t ops, Setup&& setup, Body&& body) {
+        if (!enabled(name) || ops == 0) {
+            return;
+        }
+
+        double bestNs = 0;
+        uint64_t bestAllocs = 0;
+        double totalSec = 0;
+        int reps = 0;
+        while (reps < MIN_REPS || (totalSec < minTimeSec_ && reps < MAX_REPS)) {
+            setup();
+            uint64_t allocsBefore = allocationCount();
+            auto start = std::chrono::steady_clock::now();
+            body();
+            auto end = std::chrono::steady_clock::now();
+            uint64_t allocs = allocationCount() - allocsBefore;
+
+            double ns = std::chrono::duration<double, std::nano>(end - start).count();
+            bestNs = reps == 0 ? ns : std::min(bestNs, ns);
+            bestAllocs = reps == 0 ? allocs : std::min(bestAllocs, allocs);
+            totalSec += ns / 1e9;
+            reps++;
+        }
+        report(name, ops, bestNs / ops, static_cast<double>(bestAllocs) / ops, reps);
+    }
+
+    template <typename Body>
+    void run(const std::string& name, uint64_t ops, Body&& body) {
+        run(name, ops, [] {}, body);
+    }
+
+private:
+    static constexpr int MIN_REPS = 3;
+    static constexpr int MAX_REPS = 10000;
+
+    void report(const std::string& name, uint64_t ops, double nsPerOp, double allocsPerOp, int reps) const;
+
+    double minTimeSec_;
+    std::string filter_;
+    SyntheticMarketConfig market_;
+};
+
+// Benchmark groups, one per file
+void benchQueueBook(Bench& bench);
+void benchSimulator(Bench& bench);
+void benchStrategies(Bench& bench);
+void benchCorrelationLoad(Bench& bench);
+
+#endif
@@ -0,0 +1,65 @@
+#include "bench.h"
+#include <cstdio>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include "strategies/correlation_table.h"
+
+namespace {
+
+constexpr uint32_t CSV_SYMBOLS = 1000;          // every pair: ~500k rows
+constexpr size_t TOP_N = 5;
+
+// Correlation CSV with a row for every pair of CSV_SYMBOLS symbols
+uint64_t writeCorrelationCsv(const std::string& path) {
+    std::FILE* file = std::fopen(path.c_str(), "w");
+    if (file == nullptr) {
+        throw std::runtime_error("Failed to write " + path);
+    }
+
+    std::mt19937_64 rng(1);
+    std::uniform_real_distribution<double> correlation(-1.0, 1.0);
+    uint64_t pairs = 0;
+    std::fprintf(file, "symbol1,symbol2,overall_correlation\n");
+    for (uint32_t a = 0; a < CSV_SYMBOLS; ++a) {
+        for (uint32_t b = a + 1; b < CSV_SYMBOLS; ++b) {
+            std::fprintf(file, "%s,%s,%.6f\n", SyntheticMarketConfig::symbolName(a).c_str(),
+                         SyntheticMarketConfig::symbolName(b).c_str(), correlation(rng));
+            pairs++;
+        }
+    }
+    std::fclose(file);
+    return pairs;
+}
+
+} // namespace
+
+void benchCorrelationLoad(Bench& bench) {
+    if (!bench.enabled("correlation_csv")) {
+        return;
+    }
+
+    const std::string csvPath = bench.dataDir() + "/correlation_bench.csv";
+    const std::string cachePath = csvPath + ".top" + std::to_string(TOP_N) + ".cache";
+    const uint64_t pairs = writeCorrelationCsv(csvPath);
+
+    // Parsing the CSV, which also writes the cache
+    bench.run("correlation_csv/load_parse (per pair)", pairs,
+              [&] { std::remove(cachePath.c_str()); },
+              [&] {
+                  CorrelationTable table;
+                  if (!table.load(csvPath, TOP_N) || table.fromCache()) {
+                      throw std::runtime_error("Correlation CSV was not parsed: " + csvPath);
+                  }
+                  doNotOptimize(table.symbolCount());
+              });
+
+    // Loading the cache the parse left behind
+    bench.run("correlation_csv/load_cached (per pair)", pairs, [&] {
+        CorrelationTable table;
+        if (!table.load(csvPath, TOP_N) || !table.fromCache()) {
+            throw std::runtime_error("Correlation cache was not used: " + cachePath);
+        }
+        doNotOptimize(table.symbolCount());
+    });
+}
@@ -0,0 +1,241 @@
+#include "bench.h"
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include "engine/event_tape.h"
+#include "engine/prefetching_decoder.h"
+#include "engine/queue_book.h"
+
+namespace {
+
+constexpr int64_t TICK = 10000000;              // $0.01
+constexpr int64_t MID = 100000000000LL;         // $100
+constexpr int LEVELS_PER_SIDE = 20;
+constexpr int RESTING_ORDERS = 1000;            // book every benchmark starts from
+constexpr int EVENTS = 10000;                   // events applied per repetition
+
+struct EncodedEvent {
+    book_event_hdr_t header;
+    char payload[32];
+};
+
+template <typename Payload>
+EncodedEvent encode(book_event_type_e::Enum type, uint64_t seqNo, const Payload& payload) {
+    EncodedEvent event;
+    event.header = book_event_hdr_t{34200000000000ULL + seqNo * 1000, seqNo, type};
+    std::memcpy(event.payload, &payload, sizeof(Payload));
+    return event;
+}
+
+// Resting orders: ids 1..count, behind the touch on alternating sides
+int64_t restingPrice(uint64_t orderId, bool& isBid) {
+    isBid = orderId % 2 == 0;
+    int64_t depth = 1 + static_cast<int64_t>(orderId / 2 % LEVELS_PER_SIDE);
+    return isBid ? MID - depth * TICK : MID + depth * TICK;
+}
+
+std::vector<EncodedEvent> addEvents(uint64_t firstId, int count) {
+    std::vector<EncodedEvent> events;
+    for (uint64_t id = firstId; id < firstId + count; ++id) {
+        bool isBid;
+        int64_t price = restingPrice(id, isBid);
+        events.push_back(encode(book_event_type_e::add_order, id, add_order_t{price, id, 500, isBid}));
+    }
+    return events;
+}
+
+// Write events as a book events file
+void writeTape(const std::string& path, const std::vector<EncodedEvent>& events) {
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        throw std::runtime_error("Failed to write " + path);
+    }
+    book_events_file_hdr_t header;
+    std::memset(&header, 0, sizeof(header));
+    header.number_of_events = static_cast<uint32_t>(events.size());
+    std::fwrite(&header, sizeof(header), 1, file);
+    for (const auto& event : events) {
+        std::fwrite(&event.header, sizeof(event.header), 1, file);
+        std::fwrite(event.payload, EventTape::payloadSize(event.header.type), 1, file);
+    }
+    std::fclose(file);
+}
+
+void applyEvents(QueueBook& book, const std::vector<EncodedEvent>& events) {
+    book_fill_snapshot_t fill;
+    bool hasFill;
+    for (const auto& event : events) {
+        if (book.apply(event.header, event.payload, fill, hasFill)) {
+            book.updateTopLevels();
+        }
+    }
+}
+
+// Churn on a book far larger than the caches, replayed through the
+// prefetching decoder at several look-ahead distances (0: no prefetching)
+void benchPrefetch(Bench& bench) {
+    const size_t LIVE_ORDERS = size_t(1) << 20;
+    const size_t CHURN_EVENTS = size_t(1) << 20;
+    const int LEVELS = 200;
+    std::mt19937_64 rng(7);
+
+    // Random ids, so lookups land anywhere in the index
+    std::vector<EncodedEvent> base;
+    std::vector<uint64_t> live;
+    uint64_t seq = 1;
+    auto addRandom = [&](std::vector<EncodedEvent>& events) {
+        uint64_t id = rng();
+        bool isBid = id % 2 == 0;
+        int64_t depth = 1 + static_cast<int64_t>(rng() % LEVELS);
+        int64_t price = isBid ? MID - depth * TICK : MID + depth * TICK;
+        events.push_back(encode(book_event_type_e::add_order, seq++, add_order_t{price, id, 500, isBid}));
+        return id;
+    };
+    for (size_t i = 0; i < LIVE_ORDERS; ++i) {
+        live.push_back(addRandom(base));
+    }
+
+    // Deletes and amends of random live orders, each delete followed by an
+    // add that keeps the book's size
+    std::vector<EncodedEvent> churn;
+    while (churn.size() < CHURN_EVENTS) {
+        size_t pick = rng() % live.size();
+        if (rng() % 3 == 0) {
+            churn.push_back(encode(book_event_type_e::amend_order, seq++, amend_order_t{live[pick], 300}));
+        } else {
+            churn.push_back(encode(book_event_type_e::delete_order, seq++, delete_order_t{live[pick]}));
+            live[pick] = addRandom(churn);
+        }
+    }
+    const std::string tapePath = bench.dataDir() + "/prefetch_bench.book_events.bin";
+    writeTape(tapePath, churn);
+
+    QueueBook book;
+    EventTape tape;
+    for (size_t lookahead : {0, 2, 4, 8, 16, 32, 64}) {
+        bench.run("queue_book/prefetch (lookahead " + std::to_string(lookahead) + ")", churn.size(),
+                  [&] {
+                      book.clear();
+                      applyEvents(book, base);
+                      tape.open(tapePath);
+                  },
+                  [&] {
+                      PrefetchingDecoder decoder(tape, book, lookahead);
+                      book_event_hdr_t header;
+                      const char* payload;
+                      book_fill_snapshot_t fill;
+                      bool hasFill;
+                      while (decoder.next(header, payload)) {
+                          if (book.apply(header, payload, fill, hasFill)) {
+                              book.updateTopLevels();
+                          }
+                      }
+                      doNotOptimize(book.top());
+                  });
+    }
+}
+
+} // namespace
+
+void benchQueueBook(Bench& bench) {
+    const std::vector<EncodedEvent> base = addEvents(1, RESTING_ORDERS);
+
+    // Orders the event benchmarks act on, added on top of the base book, in
+    // shuffled order so removals do not walk the queues front to back
+    const uint64_t firstTarget = RESTING_ORDERS + 1;
+    const std::vector<EncodedEvent> targets = addEvents(firstTarget, EVENTS);
+    std::vector<uint64_t> targetIds;
+    for (uint64_t id = firstTarget; id < firstTarget + EVENTS; ++id) {
+        targetIds.push_back(id);
+    }
+    std::shuffle(targetIds.begin(), targetIds.end(), std::mt19937_64(1));
+
+    auto perTarget = [&](auto makeEvent) {
+        std::vector<EncodedEvent> events;
+        for (int i = 0; i < EVENTS; ++i) {
+            events.push_back(makeEvent(targetIds[i], firstTarget + EVENTS + i));
+        }
+        return events;
+    };
+    using E = book_event_type_e::Enum;
+    const std::vector<EncodedEvent> deletes = perTarget([](uint64_t id, uint64_t seq) {
+        return encode(E::delete_order, seq, delete_order_t{id});
+    });
+    const std::vector<EncodedEvent> replaces = perTarget([](uint64_t id, uint64_t seq) {
+        bool isBid;
+        int64_t price = restingPrice(id + 2, isBid);
+        return encode(E::replace_order, seq, replace_order_t{price, id, seq, 300});
+    });
+    const std::vector<EncodedEvent> amends = perTarget([](uint64_t id, uint64_t seq) {
+        return encode(E::amend_order, seq, amend_order_t{id, 700});
+    });
+    const std::vector<EncodedEvent> reduces = perTarget([](uint64_t id, uint64_t seq) {
+        return encode(E::reduce_order, seq, reduce_order_t{id, 200});
+    });
+    const std::vector<EncodedEvent> executes = perTarget([](uint64_t id, uint64_t seq) {
+        return encode(E::execute_order, seq, execute_order_t{id, 500, seq});
+    });
+    const std::vector<EncodedEvent> executesAtPrice = perTarget([](uint64_t id, uint64_t seq) {
+        bool isBid;
+        int64_t price = restingPrice(id, isBid);
+        return encode(E::execute_order_at_price, seq, execute_order_at_price_t{id, 500, seq, price});
+    });
+    std::vector<EncodedEvent> clear(1);
+    clear[0].header = book_event_hdr_t{34200000000000ULL, 1, E::clear_book};
+
+    QueueBook book;
+    auto fromBase = [&] {
+        book.clear();
+        applyEvents(book, base);
+    };
+    auto fromTargets = [&] {
+        fromBase();
+        applyEvents(book, targets);
+    };
+
+    bench.run("queue_book/add_order", EVENTS, fromBase, [&] { applyEvents(book, targets); });
+    bench.run("queue_book/delete_order", EVENTS, fromTargets, [&] { applyEvents(book, deletes); });
+    bench.run("queue_book/replace_order", EVENTS, fromTargets, [&] { applyEvents(book, replaces); });
+    bench.run("queue_book/amend_order", EVENTS, fromTargets, [&] { applyEvents(book, amends); });
+    bench.run("queue_book/reduce_order", EVENTS, fromTargets, [&] { applyEvents(book, reduces); });
+    bench.run("queue_book/execute_order", EVENTS, fromTargets, [&] { applyEvents(book, executes); });
+    bench.run("queue_book/execute_order_at_price", EVENTS, fromTargets, [&] { applyEvents(book, executesAtPrice); });
+    bench.run("queue_book/clear_book", 1, fromTargets, [&] { applyEvents(book, clear); });
+
+    bench.run("queue_book/updateTopLevels", EVENTS, fromBase, [&] {
+        for (int i = 0; i < EVENTS; ++i) {
+            book.updateTopLevels();
+            doNotOptimize(book.top());
+        }
+    });
+
+    // The generated event mix, read from its tape as the simulator would
+    EventTape tape;
+    std::string tapePath = bench.market().filePath("book_events", 0);
+    if (!tape.open(tapePath)) {
+        throw std::runtime_error("Failed to open " + tapePath);
+    }
+    bench.run("queue_book/synthetic_mix", tape.header().number_of_events,
+              [&] {
+                  tape.open(tapePath);
+                  book.clear();
+              },
+              [&] {
+                  book_event_hdr_t header;
+                  const char* payload;
+                  book_fill_snapshot_t fill;
+                  bool hasFill;
+                  while (tape.next(header, payload)) {
+                      if (book.apply(header, payload, fill, hasFill)) {
+                          book.updateTopLevels();
+                      }
+                  }
+                  doNotOptimize(book.top());
+              });
+
+    if (bench.enabled("queue_book/prefetch")) {
+        benchPrefetch(bench);
+    }
+}
@@ -0,0 +1,128 @@
+#include "bench.h"
+#include <cstring>
+#include <memory>
+#include <string>
+#include "fill_simulator.h"
+#include "strategies/basic_strategy.h"
+
+// Access to the simulator internals the benchmarks time directly
+struct FillSimulatorBench {
+    using Simulator = FillSimulatorT<BasicStrategy>;
+    using OrderInfo = Simulator::OrderInfo;
+    using OrderRecord = ::OrderRecord;
+
+    static void setBookTop(Simulator& simulator, const book_top_t& bookTop) {
+        simulator.marketState_.lastBookTop = bookTop;
+    }
+
+    static void addRestingOrder(Simulator& simulator, const OrderInfo& order) {
+        simulator.activeOrders_[order.orderId] = order;
+    }
+
+    static void checkRestingOrders(Simulator& simulator, const book_top_t& bookTop) {
+        simulator.checkRestingOrders(bookTop);
+    }
+
+    static void fillAgainstBook(Simulator& simulator, uint64_t orderId, const book_top_t& bookTop) {
+        simulator.fillAgainstBook(orderId, bookTop, bookTop.ts);
+    }
+
+    // Start the output over so repeated runs do not grow the file
+    static void rewindOutput(Simulator& simulator) {
+        simulator.outputFile_.seekp(0);
+    }
+
+    static void writeOrderRecord(Simulator& simulator, const OrderRecord& record) {
+        simulator.writeOrderRecord(record);
+    }
+};
+
+namespace {
+
+constexpr int64_t TICK = 10000000;              // $0.01
+constexpr int64_t MID = 100000000000LL;         // $100
+
+book_top_t benchTop() {
+    book_top_t top;
+    std::memset(&top, 0, sizeof(top));
+    top.top_level = book_top_level_t{MID - TICK, MID + TICK, 500, 500};
+    top.second_level = book_top_level_t{MID - 2 * TICK, MID + 2 * TICK, 500, 500};
+    top.third_level = book_top_level_t{MID - 3 * TICK, MID + 3 * TICK, 500, 500};
+    return top;
+}
+
+} // namespace
+
+void benchSimulator(Bench& bench) {
+    using Simulator = FillSimulatorBench::Simulator;
+    const std::string outputPath = bench.dataDir() + "/simulator_bench.out";
+    const book_top_t top = benchTop();
+
+    // The resting-order fill check over N orders none of which fill, as run
+    // for every book top that reaches the strategy
+    for (int restingOrders : {16, 256, 4096}) {
+        Simulator simulator(outputPath);
+        FillSimulatorBench::setBookTop(simulator, top);
+        for (int i = 0; i < restingOrders; ++i) {
+            FillSimulatorBench::OrderInfo order;
+            order.orderId = i + 1;
+            order.isBid = i % 2 == 0;
+            order.price = order.isBid ? MID - (2 + i % 50) * TICK : MID + (2 + i % 50) * TICK;
+            order.quantity = 100;
+            FillSimulatorBench::addRestingOrder(simulator, order);
+        }
+
+        const int scans = 1 + 100000 / restingOrders;
+        bench.run("simulator/wouldOrderBeFilled (" + std::to_string(restingOrders) + " resting)",
+                  static_cast<uint64_t>(scans) * restingOrders, [&] {
+            for (int i = 0; i < scans; ++i) {
+                FillSimulatorBench::checkRestingOrders(simulator, top);
+            }
+        });
+    }
+
+    // A crossing order filled across the three levels of the top. The
+    // orders are placed in the untimed setup, so the walk itself should
+    // show no allocations; each order leaves the map filled.
+    {
+        Simulator simulator(outputPath);
+        simulator.setStrategy(std::make_shared<BasicStrategy>());
+        FillSimulatorBench::setBookTop(simulator, top);
+        const int orders = 20000;
+        auto placeOrders = [&] {
+            FillSimulatorBench::rewindOutput(simulator);
+            for (int i = 0; i < orders; ++i) {
+                FillSimulatorBench::OrderInfo order;
+                order.orderId = i + 1;
+                order.isBid = true;
+                order.price = MID + 3 * TICK;
+                order.quantity = 1200;
+                FillSimulatorBench::addRestingOrder(simulator, order);
+            }
+        };
+        bench.run("simulator/fillAgainstBook (3 levels)", orders, placeOrders, [&] {
+            for (int i = 0; i < orders; ++i) {
+                FillSimulatorBench::fillAgainstBook(simulator, i + 1, top);
+            }
+        });
+    }
+
+    // Order records streamed to the output file
+    {
+        Simulator simulator(outputPath);
+        FillSimulatorBench::OrderRecord record;
+        record.event_type = 1;
+        record.symbol_id = 1;
+        record.price = MID;
+        record.quantity = 100;
+        const int records = 100000;
+        auto rewind = [&] { FillSimulatorBench::rewindOutput(simulator); };
+        bench.run("simulator/writeOrderRecord", records, rewind, [&] {
+            for (int i = 0; i < records; ++i) {
+                record.timestamp = i;
+                record.order_id = i;
+                FillSimulatorBench::writeOrderRecord(simulator, record);
+            }
+        });
+    }
+}
@@ -0,0 +1,114 @@
+#include "bench.h"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include "engine/mapped_file.h"
+#include "engine/timer_wheel.h"
+#include "strategies/basic_strategy.h"
+#include "strategies/correlation_strategy.h"
+#include "strategies/theo_strategy.h"
+#include "strategies/theo_sweep_strategy.h"
+
+namespace {
+
+// Silence std::cout while strategies print their setup
+class QuietStdout {
+public:
+    QuietStdout() : saved_(std::cout.rdbuf(nullptr)) {}
+    ~QuietStdout() {
+        std::cout.rdbuf(saved_);
+        std::cout.clear();
+    }
+
+private:
+    std::streambuf* saved_;
+};
+
+std::vector<book_top_t> readTops(const std::string& path) {
+    MappedFile file;
+    if (!file.open(path) || file.size() < sizeof(book_tops_file_hdr_t)) {
+        throw std::runtime_error("Failed to open book tops file: " + path);
+    }
+    size_t count = (file.size() - sizeof(book_tops_file_hdr_t)) / sizeof(book_top_t);
+    std::vector<book_top_t> tops(count);
+    std::memcpy(tops.data(), file.data() + sizeof(book_tops_file_hdr_t), count * sizeof(book_top_t));
+    return tops;
+}
+
+// Correlations of the first generated symbol to all the others, and the
+// stock_locate mapping of every generated symbol
+void writeCorrelationInputs(const SyntheticMarketConfig& market, const std::string& csvPath,
+                            const std::string& mapPath) {
+    std::ofstream csv(csvPath);
+    csv << "symbol1,symbol2,overall_correlation\n";
+    for (uint32_t symbol = 1; symbol < market.symbols; ++symbol) {
+        csv << SyntheticMarketConfig::symbolName(0) << "," << SyntheticMarketConfig::symbolName(symbol) << ","
+            << (symbol % 2 ? 0.8 : -0.4) / symbol << "\n";
+    }
+
+    std::ofstream map(mapPath);
+    map << "stock_locate,symbol\n";
+    for (uint32_t symbol = 0; symbol < market.symbols; ++symbol) {
+        map << symbol + 1 << "," << SyntheticMarketConfig::symbolName(symbol) << "\n";
+    }
+    if (!csv || !map) {
+        throw std::runtime_error("Failed to write correlation inputs to " + market.outputDir);
+    }
+}
+
+// Time onBookTopUpdate over every top of the first generated symbol, on a
+// freshly made strategy each repetition
+template <typename StrategyT, typename Make>
+void benchStrategy(Bench& bench, const std::string& name, const std::vector<book_top_t>& tops, Make make) {
+    // Strategies log their setup and some of their quotes; none of it is
+    // printed while benchmarking
+    QuietStdout quiet;
+    std::shared_ptr<StrategyT> strategy;
+    std::unique_ptr<TimerWheel> timers;
+
+    auto setup = [&] {
+        strategy.reset();
+        timers = std::make_unique<TimerWheel>();
+        strategy = make();
+        strategy->setTimerService(timers.get());
+        strategy->setSymbolId(1);
+    };
+
+    bench.run("strategy/" + name + "/onBookTopUpdate", tops.size(), setup, [&] {
+        for (const auto& top : tops) {
+            std::vector<OrderAction> actions = strategy->onBookTopUpdate(top);
+            doNotOptimize(actions.size());
+        }
+    });
+}
+
+} // namespace
+
+void benchStrategies(Bench& bench) {
+    const SyntheticMarketConfig& market = bench.market();
+    const std::string topsPath = market.filePath("book_tops", 0);
+    const std::vector<book_top_t> tops = readTops(topsPath);
+
+    benchStrategy<BasicStrategy>(bench, "basic", tops, [] {
+        return std::make_shared<BasicStrategy>();
+    });
+
+    benchStrategy<TheoStrategy>(bench, "theo", tops, [] {
+        return std::make_shared<TheoStrategy>(0.1, 0.05, 0.7, 0.05, 0);
+    });
+
+    benchStrategy<TheoSweepLane>(bench, "theo_sweep_lane", tops, [] {
+        auto core = std::make_shared<TheoSweepCore>(std::vector<double>{0.1}, std::vector<double>{0.05});
+        return std::make_shared<TheoSweepLane>(core, 0);
+    });
+
+    const std::string csvPath = market.outputDir + "/strategy_bench_correlations.csv";
+    const std::string mapPath = market.outputDir + "/strategy_bench_symbols.csv";
+    writeCorrelationInputs(market, csvPath, mapPath);
+    benchStrategy<CorrelationStrategy>(bench, "correlation", tops, [&] {
+        return std::make_shared<CorrelationStrategy>(csvPath, mapPath, 0.1, 0.05, 0.5, topsPath);
+    });
+}
@@ -0,0 +1,111 @@
+#include "depth_history.h"
+#include <stdexcept>
+
+void DepthHistory::reset(size_t capacity) {
+    if (capacity >= NONE / 2) {
+        throw std::length_error("Depth history capacity too large");
+    }
+
+    // An index at most half full keeps the probe sequences short
+    size_t buckets = 2;
+    shift_ = 63;
+    while (buckets < 2 * capacity) {
+        buckets <<= 1;
+        shift_--;
+    }
+
+    slots_.assign(capacity, Slot{});
+    slots_.shrink_to_fit();
+    index_.assign(capacity > 0 ? buckets : 0, NONE);
+    index_.shrink_to_fit();
+    size_ = 0;
+    newest_ = NONE;
+    oldest_ = NONE;
+}
+
+void DepthHistory::record(bool isBid, int64_t priceNanos, uint32_t qty, uint64_t ts) {
+    if (slots_.empty()) {
+        return;
+    }
+
+    size_t position = probe(isBid, priceNanos);
+    uint32_t slot = index_[position];
+    if (slot != NONE) {
+        unlink(slot);
+    } else {
+        if (size_ < slots_.size()) {
+            slot = static_cast<uint32_t>(size_++);
+        } else {
+            // Reuse the slot of the oldest level
+            slot = oldest_;
+            const Level& evicted = slots_[slot].level;
+            eraseIndex(probe(evicted.isBid, evicted.priceNanos));
+            unlink(slot);
+            position = probe(isBid, priceNanos);
+        }
+        index_[position] = slot;
+    }
+
+    slots_[slot].level = Level{priceNanos, ts, qty, isBid};
+    linkNewest(slot);
+}
+
+const DepthHistory::Level* DepthHistory::find(bool isBid, int64_t priceNanos) const {
+    if (slots_.empty()) {
+        return nullptr;
+    }
+    uint32_t slot = index_[probe(isBid, priceNanos)];
+    return slot != NONE ? &slots_[slot].level : nullptr;
+}
+
+size_t DepthHistory::probe(bool isBid, int64_t priceNanos) const {
+    const size_t mask = index_.size() - 1;
+    for (size_t position = home(isBid, priceNanos);; position = (position + 1) & mask) {
+        uint32_t slot = index_[position];
+        if (slot == NONE ||
+            (slots_[slot].level.priceNanos == priceNanos && slots_[slot].level.isBid == isBid)) {
+            return position;
+        }
+    }
+}
+
+void DepthHistory::unlink(uint32_t slot) {
+    Slot& entry = slots_[slot];
+    if (entry.newer != NONE) {
+        slots_[entry.newer].older = entry.older;
+    } else {
+        newest_ = entry.older;
+    }
+    if (entry.older != NONE) {
+        slots_[entry.older].newer = entry.newer;
+    } else {
+        oldest_ = entry.newer;
+    }
+}
+
+void DepthHistory::linkNewest(uint32_t slot) {
+    slots_[slot].newer = NONE;
+    slots_[slot].older = newest_;
+    if (newest_ != NONE) {
+        slots_[newest_].newer = slot;
+    } else {
+        oldest_ = slot;
+    }
+    newest_ = slot;
+}
+
+void DepthHistory::eraseIndex(size_t position) {
+    const size_t mask = index_.size() - 1;
+    size_t hole = position;
+    for (size_t next = (hole + 1) & mask; index_[next] != NONE; next = (next + 1) & mask) {
+        // An entry can fill the hole unless its home lies between the hole
+        // and where it sits
+        const Level& level = slots_[index_[next]].level;
+        size_t from = home(level.isBid, level.priceNanos);
+        if (((next - from) & mask) >= ((next - hole) & mask)) {
+            index_[hole] = index_[next];
+            hole = next;
+        }
+    }
+    index_[hole] = NONE;
+}
@@ -0,0 +1,79 @@
+#ifndef DEPTH_HISTORY_H
+#define DEPTH_HISTORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// The last quantity seen at up to capacity() prices of a book, for
+// strategies that look at recent depth beyond the current top. A price not
+// yet held, recorded while the history is full, evicts the price updated
+// longest ago. Storage is sized by reset() alone: recording and lookups are
+// O(1) and allocate nothing.
+class DepthHistory {
+public:
+    struct Level {
+        int64_t priceNanos;
+        uint64_t ts;        // book top the quantity was last seen in
+        uint32_t qty;
+        bool isBid;
+    };
+
+    DepthHistory() = default;
+
+    // Forget everything and hold up to capacity prices; 0 holds none
+    void reset(size_t capacity);
+
+    void record(bool isBid, int64_t priceNanos, uint32_t qty, uint64_t ts);
+
+    // Level last seen at a price of a side; nullptr if it is not held
+    const Level* find(bool isBid, int64_t priceNanos) const;
+
+    // Call f(level) for the levels held, the most recently updated first
+    template <typename F>
+    void forEachRecent(F&& f) const {
+        for (uint32_t slot = newest_; slot != NONE; slot = slots_[slot].older) {
+            f(slots_[slot].level);
+        }
+    }
+
+    size_t capacity() const { return slots_.size(); }
+    size_t size() const { return size_; }
+    size_t memoryBytes() const {
+        return slots_.capacity() * sizeof(Slot) + index_.capacity() * sizeof(uint32_t);
+    }
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    // Levels are chained from the newest update to the oldest
+    struct Slot {
+        Level level;
+        uint32_t newer;
+        uint32_t older;
+    };
+
+    size_t home(bool isBid, int64_t priceNanos) const {
+        uint64_t key = (static_cast<uint64_t>(priceNanos) << 1) | (isBid ? 1 : 0);
+        return static_cast<size_t>((key * 0x9e3779b97f4a7c15ULL) >> shift_);
+    }
+
+    // Position in index_ of a level's slot, or of the empty entry that ends
+    // its probe sequence
+    size_t probe(bool isBid, int64_t priceNanos) const;
+
+    void unlink(uint32_t slot);
+    void linkNewest(uint32_t slot);
+
+    // Remove an index entry, shifting back the entries probed past it
+    void eraseIndex(size_t position);
+
+    std::vector<Slot> slots_;
+    std::vector<uint32_t> index_;   // open addressing with linear probing; slots or NONE
+    unsigned shift_ = 63;
+    size_t size_ = 0;
+    uint32_t newest_ = NONE;
+    uint32_t oldest_ = NONE;
+};
+
+#endif
@@ -0,0 +1,67 @@
+#include "event_tape.h"
+#include <cstring>
+
+bool EventTape::open(const std::string& path) {
+    offset_ = 0;
+    released_ = 0;
+    if (!file_.open(path) || file_.size() < sizeof(book_events_file_hdr_t)) {
+        file_.close();
+        return false;
+    }
+
+    std::memcpy(&header_, file_.data(), sizeof(book_events_file_hdr_t));
+    offset_ = sizeof(book_events_file_hdr_t);
+    return true;
+}
+
+bool EventTape::atEnd() const {
+    return file_.size() - offset_ < sizeof(book_event_hdr_t);
+}
+
+uint64_t EventTape::peekTs() const {
+    uint64_t ts;
+    std::memcpy(&ts, file_.data() + offset_, sizeof(ts));
+    return ts;
+}
+
+bool EventTape::next(book_event_hdr_t& eventHeader, const char*& payload) {
+    if (atEnd()) {
+        return false;
+    }
+
+    std::memcpy(&eventHeader, file_.data() + offset_, sizeof(book_event_hdr_t));
+    size_t size = payloadSize(eventHeader.type);
+    size_t remaining = file_.size() - offset_ - sizeof(book_event_hdr_t);
+    if (size > remaining) {
+        // Truncated or unknown: nothing after this point can be framed
+        offset_ = file_.size();
+        return false;
+    }
+
+    payload = file_.data() + offset_ + sizeof(book_event_hdr_t);
+    offset_ += sizeof(book_event_hdr_t) + size;
+
+    // Drop what was read in RELEASE_BYTES steps, keeping the last
+    // RELEASE_BYTES for payloads a reader still holds
+    if (offset_ - released_ >= 2 * RELEASE_BYTES) {
+        file_.release(released_, offset_ - RELEASE_BYTES - released_);
+        released_ = offset_ - RELEASE_BYTES;
+    }
+    return true;
+}
+
+size_t EventTape::payloadSize(book_event_type_e::Enum type) {
+    switch (type) {
+        case book_event_type_e::add_order: return sizeof(add_order_t);
+        case book_event_type_e::delete_order: return sizeof(delete_order_t);
+        case book_event_type_e::replace_order: return sizeof(replace_order_t);
+        case book_event_type_e::amend_order: return sizeof(amend_order_t);
+        case book_event_type_e::reduce_order: return sizeof(reduce_order_t);
+        case book_event_type_e::execute_order: return sizeof(execute_order_t);
+        case book_event_type_e::execute_order_at_price: return sizeof(execute_order_at_price_t);
+        case book_event_type_e::clear_book: return 0;
+        case book_event_type_e::session_event: return sizeof(session_event_t);
+        case book_event_type_e::hidden_trade: return sizeof(hidden_trade_t);
+        default: return SIZE_MAX;
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef EVENT_TAPE_H
+#define EVENT_TAPE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include "../types/market_data_types.h"
+#include "mapped_file.h"
+
+// Cursor over a mapped book events file. Events are decoded in place; the
+// payload pointer returned by next() stays valid while the tape is open.
+// Pages more than RELEASE_BYTES behind the cursor are dropped from memory
+// as it moves on, so a replay holds a bounded part of the file however
+// large it is; a dropped page is read back from the file if touched again.
+class EventTape {
+public:
+    // Returns false if the file cannot be mapped or has no complete header
+    bool open(const std::string& path);
+
+    const book_events_file_hdr_t& header() const { return header_; }
+
+    // True once every complete event has been read
+    bool atEnd() const;
+
+    // Timestamp of the next event; only valid when !atEnd()
+    uint64_t peekTs() const;
+
+    // Bytes of the file read so far, header included
+    uint64_t bytesRead() const { return offset_; }
+
+    // Read the next event. Returns false at the end of the tape or if the
+    // next event is truncated or of an unknown type.
+    bool next(book_event_hdr_t& eventHeader, const char*& payload);
+
+    // Payload size of an event type, 0 for clear_book and SIZE_MAX for
+    // unknown types
+    static size_t payloadSize(book_event_type_e::Enum type);
+
+private:
+    static constexpr size_t RELEASE_BYTES = 1 << 20;
+
+    MappedFile file_;
+    book_events_file_hdr_t header_{};
+    size_t offset_ = 0;
+    size_t released_ = 0;     // bytes before this are dropped
+};
+
+#endif
@@ -0,0 +1,360 @@
+#include "latency_model.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+// Inverse of the standard normal CDF (Acklam's rational approximation,
+// relative error below 1.2e-9)
+double inverseNormalCdf(double p) {
+    static const double a[] = {-3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02,
+                               1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00};
+    static const double b[] = {-5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02,
+                               6.680131188771972e+01, -1.328068155288572e+01};
+    static const double c[] = {-7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00,
+                               -2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00};
+    static const double d[] = {7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00,
+                               3.754408661907416e+00};
+    const double low = 0.02425;
+
+    if (p < low) {
+        double q = std::sqrt(-2 * std::log(p));
+        return (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+               ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
+    }
+    if (p > 1 - low) {
+        double q = std::sqrt(-2 * std::log(1 - p));
+        return -(((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+               ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
+    }
+    double q = p - 0.5;
+    double r = q * q;
+    return (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q /
+           (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1);
+}
+
+std::string trim(const std::string& text) {
+    size_t begin = text.find_first_not_of(" \t\r");
+    if (begin == std::string::npos) {
+        return std::string();
+    }
+    return text.substr(begin, text.find_last_not_of(" \t\r") - begin + 1);
+}
+
+// HH:MM, HH:MM:SS[.fraction] or plain ns, to ns since midnight
+bool parseTimeOfDay(const std::string& text, uint64_t& ns) {
+    if (text.empty() || !std::isdigit(static_cast<unsigned char>(text[0]))) {
+        return false;
+    }
+    if (text.find(':') == std::string::npos) {
+        char* end = nullptr;
+        unsigned long long value = std::strtoull(text.c_str(), &end, 10);
+        ns = value;
+        return *end == '\0';
+    }
+
+    unsigned hours = 0, minutes = 0, seconds = 0;
+    size_t pos = 0;
+    auto field = [&](unsigned& value, unsigned limit) {
+        size_t start = pos;
+        while (pos < text.size() && std::isdigit(static_cast<unsigned char>(text[pos])) && pos - start < 2) {
+            value = value * 10 + (text[pos++] - '0');
+        }
+        return pos > start && value < limit;
+    };
+    if (!field(hours, 24) || pos >= text.size() || text[pos++] != ':' || !field(minutes, 60)) {
+        return false;
+    }
+    uint64_t fractionNs = 0;
+    if (pos < text.size()) {
+        if (text[pos++] != ':' || !field(seconds, 60)) {
+            return false;
+        }
+        if (pos < text.size()) {
+            if (text[pos++] != '.' || pos == text.size()) {
+                return false;
+            }
+            uint64_t scale = 100000000;
+            for (; pos < text.size(); ++pos, scale /= 10) {
+                if (!std::isdigit(static_cast<unsigned char>(text[pos])) || scale == 0) {
+                    return false;
+                }
+                fractionNs += (text[pos] - '0') * scale;
+            }
+        }
+    }
+    ns = ((hours * 60ULL + minutes) * 60 + seconds) * 1000000000ULL + fractionNs;
+    return true;
+}
+
+} // namespace
+
+// Recursive descent over a spec string, into weighted bins
+class LatencyDistribution::Parser {
+public:
+    explicit Parser(const std::string& spec) : text_(spec) {}
+
+    std::vector<WeightedBin> parse() {
+        std::vector<WeightedBin> bins = component();
+        skipSpace();
+        if (pos_ != text_.size()) {
+            fail("unexpected '" + text_.substr(pos_) + "'");
+        }
+        return bins;
+    }
+
+private:
+    std::vector<WeightedBin> component() {
+        std::string name = word();
+        expect('(');
+        std::vector<WeightedBin> bins;
+        if (name == "fixed") {
+            bins.push_back({nanos(), 0, 1.0});
+        } else if (name == "lognormal") {
+            double median = number();
+            expect(',');
+            double sigma = number();
+            if (!(median > 0) || !(sigma >= 0)) {
+                fail("lognormal needs a positive median and a sigma of at least 0");
+            }
+            bins = lognormalBins(median, sigma);
+        } else if (name == "histogram") {
+            do {
+                uint64_t low = nanos();
+                uint64_t high = accept('-') ? nanos() : low;
+                expect(':');
+                double weight = number();
+                if (high < low || !(weight >= 0)) {
+                    fail("histogram bins need low <= high and a weight of at least 0");
+                }
+                bins.push_back({low, high - low, weight});
+            } while (accept(','));
+        } else if (name == "mixture") {
+            do {
+                double weight = number();
+                expect('*');
+                std::vector<WeightedBin> part = component();
+                double total = 0;
+                for (const WeightedBin& bin : part) {
+                    total += bin.weight;
+                }
+                if (!(weight >= 0) || !(total > 0)) {
+                    fail("mixture weights must be at least 0");
+                }
+                for (WeightedBin& bin : part) {
+                    bin.weight *= weight / total;
+                    bins.push_back(bin);
+                }
+            } while (accept(','));
+        } else {
+            fail("unknown distribution '" + name + "'");
+        }
+        expect(')');
+        return bins;
+    }
+
+    // Bins of equal probability between quantiles, the outer two ending
+    // where the tails are cut
+    static std::vector<WeightedBin> lognormalBins(double median, double sigma) {
+        const size_t count = LOGNORMAL_BINS;
+        const double tail = 1.0 / (64 * count);
+        auto quantile = [&](size_t i) {
+            double p = i == 0 ? tail : i == count ? 1 - tail : static_cast<double>(i) / count;
+            return std::llround(median * std::exp(sigma * inverseNormalCdf(p)));
+        };
+
+        std::vector<WeightedBin> bins;
+        long long low = quantile(0);
+        for (size_t i = 0; i < count; ++i) {
+            long long high = quantile(i + 1);
+            double weight = (i == 0 || i == count - 1) ? 1.0 / count - tail : 1.0 / count;
+            bins.push_back({static_cast<uint64_t>(low), static_cast<uint64_t>(high - low), weight});
+            low = high;
+        }
+        return bins;
+    }
+
+    void skipSpace() {
+        while (pos_ < text_.size() && std::isspace(static_cast<unsigned char>(text_[pos_]))) {
+            pos_++;
+        }
+    }
+
+    bool accept(char c) {
+        skipSpace();
+        if (pos_ < text_.size() && text_[pos_] == c) {
+            pos_++;
+            return true;
+        }
+        return false;
+    }
+
+    void expect(char c) {
+        if (!accept(c)) {
+            fail(std::string("expected '") + c + "' at offset " + std::to_string(pos_));
+        }
+    }
+
+    std::string word() {
+        skipSpace();
+        size_t start = pos_;
+        while (pos_ < text_.size() && (std::isalpha(static_cast<unsigned char>(text_[pos_])) || text_[pos_] == '_')) {
+            pos_++;
+        }
+        if (pos_ == start) {
+            fail("expected a distribution name at offset " + std::to_string(pos_));
+        }
+        return text_.substr(start, pos_ - start);
+    }
+
+    double number() {
+        skipSpace();
+        const char* start = text_.c_str() + pos_;
+        char* end = nullptr;
+        double value = std::strtod(start, &end);
+        if (end == start || !std::isfinite(value)) {
+            fail("expected a number at offset " + std::to_string(pos_));
+        }
+        pos_ += end - start;
+        return value;
+    }
+
+    uint64_t nanos() {
+        double value = number();
+        if (value < 0 || value >= 1.8e19) {
+            fail("latencies must be between 0 and 1.8e19 ns");
+        }
+        return static_cast<uint64_t>(std::llround(value));
+    }
+
+    [[noreturn]] void fail(const std::string& message) const {
+        throw std::runtime_error("Invalid latency model '" + text_ + "': " + message);
+    }
+
+    const std::string& text_;
+    size_t pos_ = 0;
+};
+
+LatencyDistribution::LatencyDistribution(uint64_t fixedNs)
+    : LatencyDistribution({{fixedNs, 0, 1.0}}, "fixed(" + std::to_string(fixedNs) + ")") {}
+
+LatencyDistribution LatencyDistribution::parse(const std::string& spec) {
+    return LatencyDistribution(Parser(spec).parse(), spec);
+}
+
+LatencyDistribution::LatencyDistribution(std::vector<WeightedBin> bins, std::string spec)
+    : meanNs_(0), spec_(std::move(spec)) {
+    double total = 0;
+    for (const WeightedBin& bin : bins) {
+        total += bin.weight;
+    }
+    if (!(total > 0)) {
+        throw std::runtime_error("Invalid latency model '" + spec_ + "': the weights add up to 0");
+    }
+
+    // Vose's alias method: a bin under its share keeps a part of its slot and
+    // hands the rest to a bin over it
+    const size_t count = bins.size();
+    std::vector<double> share(count);
+    std::vector<uint32_t> small;
+    std::vector<uint32_t> large;
+    bins_.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        share[i] = bins[i].weight * count / total;
+        (share[i] < 1 ? small : large).push_back(static_cast<uint32_t>(i));
+        bins_[i] = Bin{bins[i].lowNs, bins[i].widthNs, uint64_t(1) << 32, static_cast<uint32_t>(i)};
+        meanNs_ += bins[i].weight / total * (bins[i].lowNs + bins[i].widthNs / 2.0);
+    }
+    while (!small.empty() && !large.empty()) {
+        uint32_t under = small.back();
+        small.pop_back();
+        uint32_t over = large.back();
+        bins_[under].keepBelow = static_cast<uint64_t>(std::llround(std::ldexp(share[under], 32)));
+        bins_[under].alias = over;
+        share[over] -= 1 - share[under];
+        if (share[over] < 1) {
+            large.pop_back();
+            small.push_back(over);
+        }
+    }
+}
+
+void loadLatencyProfile(const std::string& path, LatencyModel& model) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Cannot open latency profile " + path);
+    }
+
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        std::string where = path + ":" + std::to_string(lineNumber) + ": ";
+        if (trim(line).empty() || trim(line)[0] == '#') {
+            continue;
+        }
+
+        // The spec has commas of its own, so only the first two split
+        size_t first = line.find(',');
+        size_t second = first == std::string::npos ? first : line.find(',', first + 1);
+        if (second == std::string::npos) {
+            throw std::runtime_error(where + "expected start, leg, spec");
+        }
+        std::string start = trim(line.substr(0, first));
+        std::string legName = trim(line.substr(first + 1, second - first - 1));
+
+        LatencyPeriod period{0, LatencyDistribution()};
+        if (!parseTimeOfDay(start, period.startNs)) {
+            throw std::runtime_error(where + "invalid start '" + start + "'");
+        }
+        LatencyLeg* leg = legName == "md"      ? &model.marketData
+                          : legName == "order" ? &model.orderEntry
+                          : legName == "fill"  ? &model.fillNotification
+                                               : nullptr;
+        if (leg == nullptr) {
+            throw std::runtime_error(where + "unknown leg '" + legName + "' (md, order or fill)");
+        }
+        try {
+            period.distribution = LatencyDistribution::parse(trim(line.substr(second + 1)));
+        } catch (const std::exception& e) {
+            throw std::runtime_error(where + e.what());
+        }
+
+        auto at = std::lower_bound(leg->periods.begin(), leg->periods.end(), period.startNs,
+                                   [](const LatencyPeriod& p, uint64_t ns) { return p.startNs < ns; });
+        if (at != leg->periods.end() && at->startNs == period.startNs) {
+            throw std::runtime_error(where + "a " + legName + " period already starts at " + start);
+        }
+        leg->periods.insert(at, std::move(period));
+    }
+}
+
+LatencySampler::LatencySampler(const LatencyLeg& leg, uint64_t seed, uint64_t stream, bool inOrder)
+    : fixedNs_(0), rng_(seed, stream), leg_(&leg), inOrder_(inOrder) {
+    use(leg.base);
+    if (!leg.periods.empty()) {
+        periodEndNs_ = leg.periods.front().startNs;
+    }
+}
+
+void LatencySampler::enterPeriod(uint64_t ts) {
+    const std::vector<LatencyPeriod>& periods = leg_->periods;
+    while (nextPeriod_ < periods.size() && ts >= periods[nextPeriod_].startNs) {
+        nextPeriod_++;
+    }
+    while (nextPeriod_ > 0 && ts < periods[nextPeriod_ - 1].startNs) {
+        nextPeriod_--;
+    }
+    use(nextPeriod_ == 0 ? leg_->base : periods[nextPeriod_ - 1].distribution);
+    periodStartNs_ = nextPeriod_ == 0 ? 0 : periods[nextPeriod_ - 1].startNs;
+    periodEndNs_ = nextPeriod_ < periods.size() ? periods[nextPeriod_].startNs : UINT64_MAX;
+}
+
+void LatencySampler::use(const LatencyDistribution& distribution) {
+    distribution_ = distribution.isFixed() ? nullptr : &distribution;
+    fixedNs_ = distribution.isFixed() ? distribution.fixedNs() : 0;
+}
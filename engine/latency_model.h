@@ -0,0 +1,174 @@
+#ifndef LATENCY_MODEL_H
+#define LATENCY_MODEL_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Counter-based random numbers: draw n of a stream is a pure function of the
+// key and n, so a stream is reproducible from its seed alone, whatever else
+// the process runs alongside it.
+class CounterRng {
+public:
+    CounterRng() = default;
+    CounterRng(uint64_t seed, uint64_t stream) : key_(mix(seed ^ mix(stream + GOLDEN))) {}
+
+    uint64_t next() { return mix(key_ + ++counter_ * GOLDEN); }
+
+private:
+    static constexpr uint64_t GOLDEN = 0x9e3779b97f4a7c15ULL;
+
+    // SplitMix64 finalizer
+    static uint64_t mix(uint64_t x) {
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    uint64_t key_ = 0;
+    uint64_t counter_ = 0;
+};
+
+// Latency distribution of one leg, compiled to an alias table over bins of
+// nanoseconds. A draw picks a bin from 64 random bits in O(1) (Walker's
+// alias method) and a latency uniformly inside it.
+//
+// Built from a spec string:
+//   fixed(10000)
+//   lognormal(8000, 0.5)                    median ns, sigma of the log
+//   histogram(5000-8000:60, 8000-20000:35, 90000:5)
+//                                           ns range (or single ns) : weight
+//   mixture(0.95*lognormal(8000, 0.3), 0.05*histogram(50000-200000:1))
+// A lognormal is tabulated as LOGNORMAL_BINS bins of equal probability, its
+// tails cut beyond 1 / (64 * LOGNORMAL_BINS) on either side.
+class LatencyDistribution {
+public:
+    static constexpr size_t LOGNORMAL_BINS = 1024;
+
+    LatencyDistribution() : LatencyDistribution(0) {}
+    explicit LatencyDistribution(uint64_t fixedNs);
+
+    // Throws std::runtime_error for a spec that does not parse
+    static LatencyDistribution parse(const std::string& spec);
+
+    bool isFixed() const { return bins_.size() == 1 && bins_[0].widthNs == 0; }
+    uint64_t fixedNs() const { return bins_[0].lowNs; }
+    double meanNs() const { return meanNs_; }
+    const std::string& spec() const { return spec_; }
+
+    uint64_t sample(uint64_t random) const {
+        // The high half of random * bins picks the bin, the low half is the
+        // fraction left over, for the alias coin and the place in the bin
+        unsigned __int128 scaled = static_cast<unsigned __int128>(random) * bins_.size();
+        const Bin& picked = bins_[static_cast<size_t>(scaled >> 64)];
+        uint64_t fraction = static_cast<uint64_t>(scaled);
+        const Bin& bin = (fraction >> 32) < picked.keepBelow ? picked : bins_[picked.alias];
+        return bin.lowNs + static_cast<uint64_t>((static_cast<unsigned __int128>(bin.widthNs) *
+                                                  static_cast<uint32_t>(fraction)) >> 32);
+    }
+
+private:
+    struct Bin {
+        uint64_t lowNs;
+        uint64_t widthNs;
+        uint64_t keepBelow;     // of 2^32: keep the bin below this, else take the alias
+        uint32_t alias;
+    };
+
+    struct WeightedBin {
+        uint64_t lowNs;
+        uint64_t widthNs;
+        double weight;
+    };
+
+    class Parser;
+
+    LatencyDistribution(std::vector<WeightedBin> bins, std::string spec);
+
+    std::vector<Bin> bins_;
+    double meanNs_;
+    std::string spec_;
+};
+
+// A distribution taking over at a time of day (ns since midnight, the
+// clock of the tapes)
+struct LatencyPeriod {
+    uint64_t startNs;
+    LatencyDistribution distribution;
+};
+
+// Latency of one leg over the day: base until the first period starts, then
+// each period's distribution until the next one starts
+struct LatencyLeg {
+    LatencyDistribution base;
+    std::vector<LatencyPeriod> periods;     // by start, no two alike
+};
+
+// Latency distributions of the three legs of a run
+struct LatencyModel {
+    LatencyLeg marketData;          // exchange event to strategy
+    LatencyLeg orderEntry;          // strategy to exchange
+    LatencyLeg fillNotification;    // exchange fill to strategy
+    uint64_t seed = 1;
+};
+
+// Add the periods of a latency profile file to a model. Each line is
+//   start, leg, spec
+// with start a time of day (HH:MM, HH:MM:SS[.fraction] or ns since
+// midnight), leg one of md, order and fill, and spec a distribution as
+// LatencyDistribution::parse() takes it. Blank lines and lines starting
+// with # are skipped. Throws std::runtime_error naming the line at fault.
+void loadLatencyProfile(const std::string& path, LatencyModel& model);
+
+// Draws the latencies of one leg for one simulation. A fixed leg adds its
+// constant; a stochastic one draws from its own counter stream. An in-order
+// leg (a market data feed) never delivers before what it delivered last, so
+// the times it hands out do not go backwards.
+//
+// The period in force is cached with the times it spans; only a send time
+// outside them moves it, stepping to the neighbouring periods, so a replay
+// clock moving forward costs one comparison per draw and a step per
+// boundary crossed.
+class LatencySampler {
+public:
+    static constexpr uint64_t MARKET_DATA_STREAM = 0;
+    static constexpr uint64_t ORDER_ENTRY_STREAM = 1;
+    static constexpr uint64_t FILL_NOTIFICATION_STREAM = 2;
+
+    explicit LatencySampler(uint64_t fixedNs = 0) : fixedNs_(fixedNs) {}
+    LatencySampler(const LatencyLeg& leg, uint64_t seed, uint64_t stream, bool inOrder);
+
+    // Time at which something sent at ts arrives
+    uint64_t delay(uint64_t ts) {
+        if (ts < periodStartNs_ || ts >= periodEndNs_) {
+            enterPeriod(ts);
+        }
+        if (distribution_ == nullptr) {
+            return ts + fixedNs_;
+        }
+        uint64_t arrival = ts + distribution_->sample(rng_.next());
+        if (inOrder_) {
+            arrival = arrival < lastArrival_ ? lastArrival_ : arrival;
+            lastArrival_ = arrival;
+        }
+        return arrival;
+    }
+
+    double meanNs() const { return distribution_ ? distribution_->meanNs() : static_cast<double>(fixedNs_); }
+
+private:
+    void enterPeriod(uint64_t ts);
+    void use(const LatencyDistribution& distribution);
+
+    const LatencyDistribution* distribution_ = nullptr;
+    uint64_t fixedNs_;
+    CounterRng rng_;
+    const LatencyLeg* leg_ = nullptr;
+    size_t nextPeriod_ = 0;         // first period starting after the one in force
+    uint64_t periodStartNs_ = 0;
+    uint64_t periodEndNs_ = UINT64_MAX;
+    bool inOrder_ = false;
+    uint64_t lastArrival_ = 0;
+};
+
+#endif
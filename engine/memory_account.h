@@ -0,0 +1,92 @@
+#ifndef MEMORY_ACCOUNT_H
+#define MEMORY_ACCOUNT_H
+
+#include <cstddef>
+#include <memory>
+
+// Heap bytes held by one subsystem, with the high-water mark. Containers that
+// allocate through a CountingAllocator keep it exact; other subsystems are
+// sampled with their own size estimate at intervals during a run.
+class MemoryAccount {
+public:
+    void add(size_t bytes) {
+        bytes_ += bytes;
+        if (bytes_ > peak_) {
+            peak_ = bytes_;
+        }
+    }
+    void release(size_t bytes) { bytes_ -= bytes; }
+
+    // Record a sampled size
+    void sample(size_t bytes) {
+        bytes_ = bytes;
+        if (bytes_ > peak_) {
+            peak_ = bytes_;
+        }
+    }
+
+    size_t bytes() const { return bytes_; }
+    size_t peak() const { return peak_; }
+
+private:
+    size_t bytes_ = 0;
+    size_t peak_ = 0;
+};
+
+// std::allocator that charges every allocation to a MemoryAccount. Rebound
+// copies (list and tree nodes, hash buckets) charge the same account.
+template <typename T>
+class CountingAllocator {
+public:
+    using value_type = T;
+
+    explicit CountingAllocator(MemoryAccount* account = nullptr) noexcept : account_(account) {}
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U>& other) noexcept : account_(other.account()) {}
+
+    T* allocate(size_t n) {
+        T* p = std::allocator<T>().allocate(n);
+        if (account_) {
+            account_->add(n * sizeof(T));
+        }
+        return p;
+    }
+
+    void deallocate(T* p, size_t n) noexcept {
+        if (account_) {
+            account_->release(n * sizeof(T));
+        }
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    MemoryAccount* account() const noexcept { return account_; }
+
+    template <typename U>
+    bool operator==(const CountingAllocator<U>& other) const noexcept { return account_ == other.account(); }
+    template <typename U>
+    bool operator!=(const CountingAllocator<U>& other) const noexcept { return account_ != other.account(); }
+
+private:
+    MemoryAccount* account_;
+};
+
+// Estimated heap bytes of standard containers that do not use a counting
+// allocator: a tree node is the element plus colour and three links, a hash
+// node the element plus its link and cached hash, plus the bucket array
+template <typename Tree>
+size_t treeMemoryBytes(const Tree& tree) {
+    return tree.size() * (sizeof(typename Tree::value_type) + 4 * sizeof(void*));
+}
+
+template <typename HashTable>
+size_t hashTableMemoryBytes(const HashTable& table) {
+    return table.size() * (sizeof(typename HashTable::value_type) + 2 * sizeof(void*)) +
+           table.bucket_count() * sizeof(void*);
+}
+
+template <typename Vector>
+size_t vectorMemoryBytes(const Vector& vector) {
+    return vector.capacity() * sizeof(typename Vector::value_type);
+}
+
+#endif
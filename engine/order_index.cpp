@@ -0,0 +1,54 @@
+#include "order_index.h"
+
+void OrderIndex::set(uint64_t id, handle_t handle) {
+    if (2 * (size_ + 1) > entries_.size()) {
+        grow();
+    }
+    Entry& entry = entries_[probe(id)];
+    if (entry.handle == NO_HANDLE) {
+        entry.id = id;
+        size_++;
+    }
+    entry.handle = handle;
+}
+
+void OrderIndex::erase(iterator it) {
+    const size_t mask = entries_.size() - 1;
+    size_t hole = static_cast<size_t>(it - entries_.data());
+    for (size_t next = (hole + 1) & mask; entries_[next].handle != NO_HANDLE; next = (next + 1) & mask) {
+        // An entry can fill the hole unless its home lies between the hole
+        // and where it sits
+        size_t from = home(entries_[next].id);
+        if (((next - from) & mask) >= ((next - hole) & mask)) {
+            entries_[hole] = entries_[next];
+            hole = next;
+        }
+    }
+    entries_[hole].handle = NO_HANDLE;
+    size_--;
+}
+
+void OrderIndex::clear() {
+    for (Entry& entry : entries_) {
+        entry.handle = NO_HANDLE;
+    }
+    size_ = 0;
+}
+
+void OrderIndex::grow() {
+    std::vector<Entry, allocator_type> old(entries_.get_allocator());
+    old.swap(entries_);
+
+    size_t count = old.empty() ? MIN_ENTRIES : 2 * old.size();
+    shift_ = 64;
+    for (size_t n = count; n > 1; n >>= 1) {
+        shift_--;
+    }
+    entries_.assign(count, Entry{0, NO_HANDLE});
+
+    for (const Entry& entry : old) {
+        if (entry.handle != NO_HANDLE) {
+            entries_[probe(entry.id)] = entry;
+        }
+    }
+}
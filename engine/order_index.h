@@ -0,0 +1,80 @@
+#ifndef ORDER_INDEX_H
+#define ORDER_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "memory_account.h"
+
+// Exchange order id to a 32-bit handle, in one flat table with linear
+// probing. Where an id's entry sits follows from the id and the table size
+// alone, so a replay can prefetch it events ahead of the lookup. The table
+// stays at least half empty to keep probes short, and an erase shifts the
+// entries probed past it back instead of leaving a tombstone.
+class OrderIndex {
+public:
+    using handle_t = uint32_t;
+    static constexpr handle_t NO_HANDLE = UINT32_MAX;   // marks an empty entry
+
+    struct Entry {
+        uint64_t id;
+        handle_t handle;
+    };
+
+    // Entries move on insert and erase: an iterator is only good until the
+    // next change to the index
+    using iterator = Entry*;
+    using allocator_type = CountingAllocator<Entry>;
+
+    explicit OrderIndex(const allocator_type& allocator) : entries_(allocator) {}
+
+    iterator find(uint64_t id) {
+        if (size_ == 0) {
+            return end();
+        }
+        Entry& entry = entries_[probe(id)];
+        return entry.handle != NO_HANDLE ? &entry : end();
+    }
+    iterator end() { return nullptr; }
+
+    // Handle of id, NO_HANDLE if it is not indexed
+    handle_t lookup(uint64_t id) const { return size_ == 0 ? NO_HANDLE : entries_[probe(id)].handle; }
+
+    // Map id to handle, replacing any handle it had
+    void set(uint64_t id, handle_t handle);
+
+    void erase(iterator it);
+    void clear();
+
+    size_t size() const { return size_; }
+
+    // Start loading the entry id would be found at
+    void prefetch(uint64_t id) const {
+        if (!entries_.empty()) {
+            __builtin_prefetch(&entries_[home(id)]);
+        }
+    }
+
+private:
+    static constexpr size_t MIN_ENTRIES = 16;
+
+    size_t home(uint64_t id) const { return static_cast<size_t>((id * 0x9e3779b97f4a7c15ULL) >> shift_); }
+
+    // Position of id's entry, or of the empty entry that ends its probe
+    size_t probe(uint64_t id) const {
+        const size_t mask = entries_.size() - 1;
+        size_t position = home(id);
+        while (entries_[position].handle != NO_HANDLE && entries_[position].id != id) {
+            position = (position + 1) & mask;
+        }
+        return position;
+    }
+
+    void grow();
+
+    std::vector<Entry, allocator_type> entries_;
+    unsigned shift_ = 63;
+    size_t size_ = 0;
+};
+
+#endif
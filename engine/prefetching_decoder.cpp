@@ -0,0 +1,26 @@
+#include "prefetching_decoder.h"
+
+PrefetchingDecoder::PrefetchingDecoder(EventTape& tape, const QueueBook& book, size_t lookahead)
+    : tape_(tape), book_(book), lookahead_(lookahead), orderDistance_(lookahead / 2) {
+    if (lookahead_ == 0) {
+        return;
+    }
+    size_t size = 1;
+    while (size < lookahead_ + 1) {
+        size <<= 1;
+    }
+    window_.resize(size);
+    mask_ = size - 1;
+}
+
+void PrefetchingDecoder::fill() {
+    while (count_ <= lookahead_) {
+        Decoded& decoded = window_[(head_ + count_) & mask_];
+        if (!tape_.next(decoded.header, decoded.payload)) {
+            tapeDone_ = true;
+            return;
+        }
+        book_.prefetchIndex(decoded.header, decoded.payload);
+        count_++;
+    }
+}
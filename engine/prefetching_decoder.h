@@ -0,0 +1,71 @@
+#ifndef PREFETCHING_DECODER_H
+#define PREFETCHING_DECODER_H
+
+#include <cstddef>
+#include <vector>
+#include "event_tape.h"
+#include "queue_book.h"
+
+// Reads book events off a tape a window of lookahead events ahead of the
+// event it hands out, so the book's cache misses overlap with the events
+// applied before them. An event entering the window has the book prefetch
+// its order id's index entry; half a window later, with that entry likely
+// cached, the order slot it points to. Events still come out in tape order,
+// one at a time, for the caller to apply.
+//
+// The prefetches read the book as it is when they are issued; an event in
+// between that changes what a later one touches only wastes a prefetch.
+class PrefetchingDecoder {
+public:
+    // Tuned with the queue_book/prefetch benchmarks: 2 to 16 do about
+    // equally well, further ahead the window outruns the cache
+    static constexpr size_t DEFAULT_LOOKAHEAD = 8;
+
+    // The tape and the book must outlive the decoder; lookahead 0 reads
+    // straight off the tape without prefetching
+    PrefetchingDecoder(EventTape& tape, const QueueBook& book, size_t lookahead = DEFAULT_LOOKAHEAD);
+
+    // Next event in tape order; false once the tape is exhausted, or at a
+    // truncated or unknown event, as EventTape::next()
+    bool next(book_event_hdr_t& eventHeader, const char*& payload) {
+        if (lookahead_ == 0) {
+            return tape_.next(eventHeader, payload);
+        }
+        if (!tapeDone_) {
+            fill();
+        }
+        if (count_ == 0) {
+            return false;
+        }
+        if (count_ > orderDistance_) {
+            const Decoded& ahead = window_[(head_ + orderDistance_) & mask_];
+            book_.prefetchOrder(ahead.header, ahead.payload);
+        }
+        eventHeader = window_[head_].header;
+        payload = window_[head_].payload;
+        head_ = (head_ + 1) & mask_;
+        count_--;
+        return true;
+    }
+
+private:
+    struct Decoded {
+        book_event_hdr_t header;
+        const char* payload;
+    };
+
+    // Decode until the window holds the next event and lookahead more
+    void fill();
+
+    EventTape& tape_;
+    const QueueBook& book_;
+    size_t lookahead_;
+    size_t orderDistance_;
+    std::vector<Decoded> window_;   // ring of a power of two events
+    size_t mask_ = 0;
+    size_t head_ = 0;
+    size_t count_ = 0;
+    bool tapeDone_ = false;
+};
+
+#endif
@@ -0,0 +1,58 @@
+#include "price_grid.h"
+#include <algorithm>
+#include <numeric>
+
+PriceGrid::PriceGrid(int64_t tickNanos)
+    : tickNanos_(tickNanos > 0 ? tickNanos : 1), inverseTick_(1.0 / tickNanos_), tickKnown_(tickNanos > 0) {}
+
+int64_t PriceGrid::refine(int64_t nanos, tick_price_t minTicks, tick_price_t maxTicks) {
+    // The first price becomes the reference
+    if (lowNanos_ > highNanos_) {
+        baseNanos_ = nanos;
+        setRange();
+        return 1;
+    }
+
+    __int128 offset = static_cast<__int128>(nanos) - baseNanos_;
+    __int128 distance = offset < 0 ? -offset : offset;
+    if (distance == 0) {
+        return 1;
+    }
+    if (distance > INT64_MAX) {
+        return 0;
+    }
+
+    // Until the tick is known only the reference price is in use
+    int64_t tick = tickKnown_ ? std::gcd(tickNanos_, static_cast<int64_t>(distance))
+                              : static_cast<int64_t>(distance);
+    int64_t factor = tickKnown_ ? tickNanos_ / tick : 1;
+
+    auto fits = [](__int128 ticks) { return ticks > INT32_MIN && ticks <= INT32_MAX; };
+    if (!fits(offset / tick) || !fits(static_cast<__int128>(minTicks) * factor) ||
+        !fits(static_cast<__int128>(maxTicks) * factor)) {
+        return 0;
+    }
+
+    tickNanos_ = tick;
+    inverseTick_ = 1.0 / tick;
+    tickKnown_ = true;
+    setRange();
+    return factor;
+}
+
+void PriceGrid::setRange() {
+    if (!tickKnown_) {
+        lowNanos_ = baseNanos_;
+        highNanos_ = baseNanos_;
+        return;
+    }
+
+    __int128 low = static_cast<__int128>(baseNanos_) + static_cast<__int128>(INT32_MIN + 1) * tickNanos_;
+    __int128 high = static_cast<__int128>(baseNanos_) + static_cast<__int128>(INT32_MAX) * tickNanos_;
+
+    // Keep nanos - reference representable for toTicks()
+    low = std::max(low, static_cast<__int128>(INT64_MIN) + std::max<int64_t>(baseNanos_, 0));
+    high = std::min(high, static_cast<__int128>(INT64_MAX) + std::min<int64_t>(baseNanos_, 0));
+    lowNanos_ = static_cast<int64_t>(low);
+    highNanos_ = static_cast<int64_t>(high);
+}
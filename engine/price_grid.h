@@ -0,0 +1,58 @@
+#ifndef PRICE_GRID_H
+#define PRICE_GRID_H
+
+#include <cstdint>
+
+// Compact price of the book engine: ticks from the grid's reference price
+using tick_price_t = int32_t;
+
+// Maps a symbol's nanos prices onto 32-bit tick offsets from a reference
+// price, the first price seen.
+//
+// The tick size is configured, or inferred (tickNanos 0) as the greatest
+// common divisor of the offsets seen so far. A price the grid does not cover,
+// off its ticks or beyond the 32-bit range, is offered to refine(), which
+// narrows the tick to take it in when the ticks already in use still fit
+// after re-keying. Prices that cannot be covered stay in nanos with the
+// caller. INT32_MIN is never a grid price, so callers may use it as a marker.
+class PriceGrid {
+public:
+    explicit PriceGrid(int64_t tickNanos = 0);
+
+    // Ticks of nanos; false if the grid does not cover it
+    bool toTicks(int64_t nanos, tick_price_t& ticks) const {
+        if (nanos < lowNanos_ || nanos > highNanos_) {
+            return false;
+        }
+        // Rounded multiply by the reciprocal instead of a 64-bit divide; the
+        // quotient is exact for any offset on the grid, which the check proves
+        int64_t offset = nanos - baseNanos_;
+        double estimate = static_cast<double>(offset) * inverseTick_;
+        int64_t quotient = static_cast<int64_t>(estimate < 0 ? estimate - 0.5 : estimate + 0.5);
+        ticks = static_cast<tick_price_t>(quotient);
+        return quotient * tickNanos_ == offset;
+    }
+
+    int64_t toNanos(tick_price_t ticks) const { return baseNanos_ + static_cast<int64_t>(ticks) * tickNanos_; }
+
+    // Take nanos into the grid, given the lowest and highest ticks in use.
+    // Returns the factor every tick in use must be multiplied by (1 when they
+    // keep their value), or 0 if no grid covers nanos along with them.
+    int64_t refine(int64_t nanos, tick_price_t minTicks, tick_price_t maxTicks);
+
+    // 0 until inferred
+    int64_t tickNanos() const { return tickKnown_ ? tickNanos_ : 0; }
+    int64_t referenceNanos() const { return baseNanos_; }
+
+private:
+    void setRange();
+
+    int64_t tickNanos_;
+    double inverseTick_;
+    int64_t baseNanos_ = 0;
+    int64_t lowNanos_ = 1;      // covers nothing until the first price
+    int64_t highNanos_ = 0;
+    bool tickKnown_;
+};
+
+#endif
@@ -0,0 +1,118 @@
+#include "progress_meter.h"
+#include <sys/stat.h>
+#include <unistd.h>
+
+ProgressMeter::~ProgressMeter() {
+    if (statsFile_ != nullptr) {
+        std::fclose(statsFile_);
+    }
+}
+
+void ProgressMeter::start(const ProgressOptions& options, const std::string& label, uint64_t totalBytes,
+                          uint64_t firstMarketTs) {
+    enabled_ = options.intervalMs > 0;
+    terminal_ = isatty(STDERR_FILENO) != 0;
+    sinceCheck_ = 0;
+    label_ = label;
+    totalBytes_ = totalBytes;
+    interval_ = std::chrono::milliseconds(options.intervalMs);
+    startTime_ = Clock::now();
+    nextUpdate_ = startTime_ + interval_;
+    lastTime_ = startTime_;
+    lastEvents_ = 0;
+    firstMarketTs_ = firstMarketTs;
+
+    if (statsFile_ != nullptr) {
+        std::fclose(statsFile_);
+        statsFile_ = nullptr;
+    }
+    if (enabled_ && !options.statsFilePath.empty()) {
+        statsFile_ = std::fopen(options.statsFilePath.c_str(), "a");
+        if (statsFile_ == nullptr) {
+            std::fprintf(stderr, "Warning: cannot open progress stats file %s\n", options.statsFilePath.c_str());
+        }
+    }
+}
+
+bool ProgressMeter::clockDue() {
+    return Clock::now() >= nextUpdate_;
+}
+
+void ProgressMeter::update(const ProgressSample& sample) {
+    render(sample, false);
+    nextUpdate_ = Clock::now() + interval_;
+}
+
+void ProgressMeter::finish(const ProgressSample& sample) {
+    if (enabled_) {
+        render(sample, true);
+    }
+    enabled_ = false;
+}
+
+void ProgressMeter::render(const ProgressSample& sample, bool final) {
+    Clock::time_point now = Clock::now();
+    double elapsedSec = std::chrono::duration<double>(now - startTime_).count();
+    double sinceLastSec = std::chrono::duration<double>(now - lastTime_).count();
+
+    // Rate over the last interval; the whole run for the final line
+    double eventsPerSec = final ? (elapsedSec > 0 ? sample.events / elapsedSec : 0)
+                                : (sinceLastSec > 0 ? (sample.events - lastEvents_) / sinceLastSec : 0);
+    double marketSec = sample.marketTs > firstMarketTs_ ? (sample.marketTs - firstMarketTs_) / 1e9 : 0;
+    double marketPerWall = elapsedSec > 0 ? marketSec / elapsedSec : 0;
+    double fraction = totalBytes_ > 0 ? static_cast<double>(sample.bytesRead) / totalBytes_ : 0;
+    if (fraction > 1) {
+        fraction = 1;
+    }
+    double etaSec = fraction > 0 ? elapsedSec * (1 - fraction) / fraction : 0;
+
+    lastTime_ = now;
+    lastEvents_ = sample.events;
+
+    char book[64] = "";
+    if (sample.bookLevels > 0 || sample.bookOrders > 0) {
+        std::snprintf(book, sizeof(book), " | book %zu lv %zu ord", sample.bookLevels, sample.bookOrders);
+    }
+    char line[256];
+    std::snprintf(line, sizeof(line),
+                  "[%s] %5.1f%% %.2fM events %.2fM ev/s market %.1fx %s %um%02us%s | fills %llu/%llu pos %lld",
+                  label_.c_str(), fraction * 100, sample.events / 1e6, eventsPerSec / 1e6, marketPerWall,
+                  final ? "took" : "ETA", static_cast<unsigned>((final ? elapsedSec : etaSec) / 60),
+                  static_cast<unsigned>(final ? elapsedSec : etaSec) % 60, book,
+                  static_cast<unsigned long long>(sample.ordersFilled),
+                  static_cast<unsigned long long>(sample.ordersPlaced), static_cast<long long>(sample.position));
+
+    if (terminal_) {
+        std::fprintf(stderr, "\r%s\033[K%s", line, final ? "\n" : "");
+    } else {
+        std::fprintf(stderr, "%s\n", line);
+    }
+    std::fflush(stderr);
+
+    if (statsFile_ != nullptr) {
+        std::fprintf(statsFile_,
+                     "{\"label\": \"%s\", \"final\": %s, \"wall_sec\": %.3f, \"events\": %llu, "
+                     "\"events_per_sec\": %.0f, \"market_ts\": %llu, \"market_per_wall\": %.2f, "
+                     "\"fraction\": %.4f, \"eta_sec\": %.1f, \"book_levels\": %zu, \"book_orders\": %zu, "
+                     "\"orders_placed\": %llu, \"orders_filled\": %llu, \"position\": %lld}\n",
+                     label_.c_str(), final ? "true" : "false", elapsedSec,
+                     static_cast<unsigned long long>(sample.events), eventsPerSec,
+                     static_cast<unsigned long long>(sample.marketTs), marketPerWall, fraction, etaSec,
+                     sample.bookLevels, sample.bookOrders, static_cast<unsigned long long>(sample.ordersPlaced),
+                     static_cast<unsigned long long>(sample.ordersFilled), static_cast<long long>(sample.position));
+        std::fflush(statsFile_);
+    }
+}
+
+uint64_t inputFileSize(const std::string& path) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 ? static_cast<uint64_t>(info.st_size) : 0;
+}
+
+uint64_t inputBytesRead(std::istream& in, uint64_t fileSize) {
+    if (!in.good()) {
+        return fileSize;
+    }
+    std::streampos offset = in.tellg();
+    return offset < 0 ? fileSize : static_cast<uint64_t>(offset);
+}
@@ -0,0 +1,90 @@
+#ifndef PROGRESS_METER_H
+#define PROGRESS_METER_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <istream>
+#include <string>
+
+// How a run reports its progress
+struct ProgressOptions {
+    uint64_t intervalMs = 1000;     // 0 turns progress off
+    std::string statsFilePath;      // JSON line per update; empty for none
+};
+
+// State of a run at a progress update
+struct ProgressSample {
+    uint64_t events = 0;
+    uint64_t marketTs = 0;          // ns since midnight of the last event
+    uint64_t bytesRead = 0;         // input consumed, for the ETA
+    size_t bookLevels = 0;          // queue mode only
+    size_t bookOrders = 0;
+    uint64_t ordersPlaced = 0;
+    uint64_t ordersFilled = 0;
+    int64_t position = 0;
+};
+
+// Throughput meter of a replay loop.
+//
+// The loop calls due() once per event; it reads the clock only every
+// CHECK_EVENTS events and returns true once per interval, when the loop
+// hands a sample to update(). An update renders events/sec, the ratio of
+// market time to wall time, the ETA from the input read so far and the book
+// and order counts, as one status line rewritten in place on a terminal
+// (stderr) or a plain line otherwise, and as a JSON line in the stats file.
+class ProgressMeter {
+public:
+    static constexpr uint32_t CHECK_EVENTS = 1024;
+
+    ProgressMeter() = default;
+    ~ProgressMeter();
+
+    ProgressMeter(const ProgressMeter&) = delete;
+    ProgressMeter& operator=(const ProgressMeter&) = delete;
+
+    // Start timing a run over totalBytes of input whose first event is at
+    // firstMarketTs
+    void start(const ProgressOptions& options, const std::string& label, uint64_t totalBytes,
+               uint64_t firstMarketTs);
+
+    bool due() {
+        if (++sinceCheck_ < CHECK_EVENTS) {
+            return false;
+        }
+        sinceCheck_ = 0;
+        return enabled_ && clockDue();
+    }
+
+    void update(const ProgressSample& sample);
+
+    // Final update, ending the status line
+    void finish(const ProgressSample& sample);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    bool clockDue();
+    void render(const ProgressSample& sample, bool final);
+
+    bool enabled_ = false;
+    bool terminal_ = false;
+    uint32_t sinceCheck_ = 0;
+    std::string label_;
+    uint64_t totalBytes_ = 0;
+    Clock::duration interval_{};
+    Clock::time_point startTime_;
+    Clock::time_point nextUpdate_;
+    Clock::time_point lastTime_;
+    uint64_t lastEvents_ = 0;
+    uint64_t firstMarketTs_ = 0;
+    FILE* statsFile_ = nullptr;
+};
+
+// Size of an input file, 0 if it cannot be read
+uint64_t inputFileSize(const std::string& path);
+
+// Bytes of a file stream read so far; a stream at its end has read it all
+uint64_t inputBytesRead(std::istream& in, uint64_t fileSize);
+
+#endif
@@ -0,0 +1,556 @@
+#include "queue_book.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+QueueBook::QueueBook(int64_t tickNanos)
+    : grid_(tickNanos),
+      bidBook_(book_side_t::allocator_type(&levelMemory_)),
+      askBook_(book_side_t::allocator_type(&levelMemory_)),
+      wideBids_(wide_side_t::allocator_type(&levelMemory_)),
+      wideAsks_(wide_side_t::allocator_type(&levelMemory_)),
+      orders_(decltype(orders_)::allocator_type(&orderSlotMemory_)),
+      freeOrders_(NO_ORDER),
+      handles_(OrderIndex::allocator_type(&orderMapMemory_)),
+      widePrices_(wide_price_map_t::allocator_type(&orderMapMemory_)) {
+    std::memset(&currentTop_, 0, sizeof(currentTop_));
+    updateTopLevels();
+}
+
+void QueueBook::clear() {
+    bidBook_.clear();
+    askBook_.clear();
+    wideBids_.clear();
+    wideAsks_.clear();
+    orders_.clear();
+    freeOrders_ = NO_ORDER;
+    handles_.clear();
+    widePrices_.clear();
+}
+
+bool QueueBook::apply(const book_event_hdr_t& eventHeader, const char* payload,
+                      book_fill_snapshot_t& fill, bool& hasFill) {
+    // Update timestamp in the current top
+    currentTop_.ts = eventHeader.ts;
+    currentTop_.seqno = eventHeader.seq_no;
+    hasFill = false;
+
+    switch (eventHeader.type) {
+        case book_event_type_e::add_order: {
+            add_order_t addOrder;
+            std::memcpy(&addOrder, payload, sizeof(add_order_t));
+            return this->addOrder(addOrder.order_id, addOrder.price, addOrder.qty, addOrder.is_bid, eventHeader.ts);
+        }
+
+        case book_event_type_e::delete_order: {
+            delete_order_t deleteOrder;
+            std::memcpy(&deleteOrder, payload, sizeof(delete_order_t));
+
+            auto idIt = handles_.find(deleteOrder.order_id);
+            if (idIt == handles_.end()) {
+                return false;
+            }
+            return this->deleteOrder(idIt);
+        }
+
+        case book_event_type_e::replace_order: {
+            replace_order_t replaceOrder;
+            std::memcpy(&replaceOrder, payload, sizeof(replace_order_t));
+
+            // First, delete the original order; the new one takes its side
+            bool topChanged = false;
+            bool isBid = replaceOrder.price > 0;
+            auto idIt = handles_.find(replaceOrder.orig_order_id);
+            if (idIt != handles_.end()) {
+                isBid = orders_[idIt->handle].is_bid;
+                topChanged = deleteOrder(idIt);
+            }
+
+            // Add the new order
+            if (addOrder(replaceOrder.new_order_id, replaceOrder.price, replaceOrder.qty, isBid, eventHeader.ts)) {
+                topChanged = true;
+            }
+            return topChanged;
+        }
+
+        case book_event_type_e::amend_order: {
+            amend_order_t amendOrder;
+            std::memcpy(&amendOrder, payload, sizeof(amend_order_t));
+
+            auto idIt = handles_.find(amendOrder.order_id);
+            if (idIt == handles_.end()) {
+                return false;
+            }
+            return withLevel(idIt, [&](auto&, auto levelIt) {
+                order_t& order = orders_[idIt->handle];
+
+                // Calculate the delta in qty
+                qty_t oldQty = order.qty;
+                qty_t qtyDelta = amendOrder.new_qty - oldQty;
+
+                // Update the order quantity
+                order.qty = amendOrder.new_qty;
+                order.timestamp = eventHeader.ts;
+
+                // Update the level quantity
+                levelIt->second.qty += qtyDelta;
+
+                // Check if this affects top of book
+                return isAtTop(levelPrice(*levelIt), order.is_bid);
+            });
+        }
+
+        case book_event_type_e::reduce_order: {
+            reduce_order_t reduceOrder;
+            std::memcpy(&reduceOrder, payload, sizeof(reduce_order_t));
+
+            auto idIt = handles_.find(reduceOrder.order_id);
+            if (idIt == handles_.end()) {
+                return false;
+            }
+            return withLevel(idIt, [&](auto& book, auto levelIt) {
+                orders_[idIt->handle].timestamp = eventHeader.ts;
+                return this->reduceOrder(idIt, book, levelIt, reduceOrder.cxled_qty);
+            });
+        }
+
+        case book_event_type_e::execute_order: {
+            execute_order_t executeOrder;
+            std::memcpy(&executeOrder, payload, sizeof(execute_order_t));
+
+            auto idIt = handles_.find(executeOrder.order_id);
+            if (idIt == handles_.end()) {
+                return false;
+            }
+            return withLevel(idIt, [&](auto& book, auto levelIt) {
+                int64_t price = levelPrice(*levelIt);
+                fillFor(orders_[idIt->handle], price, levelIt->second, eventHeader, price,
+                        executeOrder.traded_qty, executeOrder.execution_id, fill);
+                hasFill = true;
+                return reduceOrder(idIt, book, levelIt, executeOrder.traded_qty);
+            });
+        }
+
+        case book_event_type_e::execute_order_at_price: {
+            execute_order_at_price_t executeOrder;
+            std::memcpy(&executeOrder, payload, sizeof(execute_order_at_price_t));
+
+            auto idIt = handles_.find(executeOrder.order_id);
+            if (idIt == handles_.end()) {
+                return false;
+            }
+            return withLevel(idIt, [&](auto& book, auto levelIt) {
+                // The fill is reported at the execution price
+                fillFor(orders_[idIt->handle], levelPrice(*levelIt), levelIt->second, eventHeader,
+                        executeOrder.execution_price, executeOrder.traded_qty, executeOrder.execution_id, fill);
+                hasFill = true;
+                return reduceOrder(idIt, book, levelIt, executeOrder.traded_qty);
+            });
+        }
+
+        case book_event_type_e::clear_book:
+            clear();
+            return true;
+
+        default:
+            // Session events, hidden trades and anything else leave the book as is
+            return false;
+    }
+}
+
+bool QueueBook::eventOrderId(const book_event_hdr_t& eventHeader, const char* payload, uint64_t& orderId) {
+    // Every payload that names an order starts with its id, except a
+    // replace, which starts with the new price and looks up the original id
+    switch (eventHeader.type) {
+        case book_event_type_e::add_order:
+            std::memcpy(&orderId, payload + offsetof(add_order_t, order_id), sizeof(orderId));
+            return true;
+        case book_event_type_e::replace_order:
+            std::memcpy(&orderId, payload + offsetof(replace_order_t, orig_order_id), sizeof(orderId));
+            return true;
+        case book_event_type_e::delete_order:
+        case book_event_type_e::amend_order:
+        case book_event_type_e::reduce_order:
+        case book_event_type_e::execute_order:
+        case book_event_type_e::execute_order_at_price:
+            std::memcpy(&orderId, payload, sizeof(orderId));
+            return true;
+        default:
+            return false;
+    }
+}
+
+void QueueBook::prefetchIndex(const book_event_hdr_t& eventHeader, const char* payload) const {
+    uint64_t orderId;
+    if (eventOrderId(eventHeader, payload, orderId)) {
+        handles_.prefetch(orderId);
+    }
+    // A replace also adds its new id
+    if (eventHeader.type == book_event_type_e::replace_order) {
+        std::memcpy(&orderId, payload + offsetof(replace_order_t, new_order_id), sizeof(orderId));
+        handles_.prefetch(orderId);
+    }
+}
+
+void QueueBook::prefetchOrder(const book_event_hdr_t& eventHeader, const char* payload) const {
+    // An add finds nothing to load
+    uint64_t orderId;
+    if (eventHeader.type == book_event_type_e::add_order || !eventOrderId(eventHeader, payload, orderId)) {
+        return;
+    }
+    order_handle_t handle = handles_.lookup(orderId);
+    if (handle < orders_.size()) {
+        __builtin_prefetch(orders_.data() + handle);
+    }
+}
+
+template <typename F>
+bool QueueBook::withLevel(OrderIndex::iterator idIt, F&& f) {
+    const order_t& order = orders_[idIt->handle];
+    if (order.price != WIDE_PRICE) {
+        book_side_t& book = side(order.is_bid);
+        auto levelIt = book.find(order.price);
+        return levelIt != book.end() && f(book, levelIt);
+    }
+    wide_side_t& book = wideSide(order.is_bid);
+    auto levelIt = book.find(widePrices_.at(idIt->handle));
+    return levelIt != book.end() && f(book, levelIt);
+}
+
+bool QueueBook::addOrder(uint64_t orderId, int64_t price, qty_t qty, bool isBid, uint64_t ts) {
+    // A price that already has a wide level keeps it
+    tick_price_t ticks;
+    if ((!wideSide(isBid).empty() && wideSide(isBid).count(price)) ||
+        (!grid_.toTicks(price, ticks) && !(refineGrid(price) && grid_.toTicks(price, ticks)))) {
+        return addWideOrder(orderId, price, qty, isBid, ts);
+    }
+
+    // Add order to appropriate book side, creating the level if needed
+    book_side_t& book = side(isBid);
+    level_t& level = book.try_emplace(ticks, level_t{0, 0, NO_ORDER, NO_ORDER}).first->second;
+    handles_.set(orderId, queueOrder(level, orderId, ticks, qty, isBid, ts));
+
+    // Check if top of book changed
+    if (isBid) {
+        return (wideBids_.empty() || price >= wideBids_.rbegin()->first) && ticks >= bidBook_.rbegin()->first;
+    }
+    return (wideAsks_.empty() || price <= wideAsks_.begin()->first) && ticks <= askBook_.begin()->first;
+}
+
+bool QueueBook::addWideOrder(uint64_t orderId, int64_t price, qty_t qty, bool isBid, uint64_t ts) {
+    wide_side_t& book = wideSide(isBid);
+    level_t& level = book.try_emplace(price, level_t{0, 0, NO_ORDER, NO_ORDER}).first->second;
+    order_handle_t handle = queueOrder(level, orderId, WIDE_PRICE, qty, isBid, ts);
+    handles_.set(orderId, handle);
+    widePrices_[handle] = price;
+
+    int64_t best;
+    bestLevel(isBid, best);
+    return isBid ? price >= best : price <= best;
+}
+
+QueueBook::order_handle_t QueueBook::queueOrder(level_t& level, uint64_t orderId, tick_price_t price, qty_t qty,
+                                                bool isBid, uint64_t ts) {
+    // Recycle a free slot, or grow the array
+    order_handle_t handle = freeOrders_;
+    if (handle != NO_ORDER) {
+        freeOrders_ = orders_[handle].next;
+    } else {
+        handle = static_cast<order_handle_t>(orders_.size());
+        orders_.emplace_back();
+    }
+
+    orders_[handle] = order_t{orderId, ts, qty, price, level.tail, NO_ORDER, isBid};
+    if (level.tail != NO_ORDER) {
+        orders_[level.tail].next = handle;
+    } else {
+        level.head = handle;
+    }
+    level.tail = handle;
+    level.qty += qty;
+    level.orderCount++;
+    return handle;
+}
+
+void QueueBook::unlinkOrder(level_t& level, order_handle_t handle) {
+    order_t& order = orders_[handle];
+    if (order.prev != NO_ORDER) {
+        orders_[order.prev].next = order.next;
+    } else {
+        level.head = order.next;
+    }
+    if (order.next != NO_ORDER) {
+        orders_[order.next].prev = order.prev;
+    } else {
+        level.tail = order.prev;
+    }
+    level.orderCount--;
+
+    order.next = freeOrders_;
+    freeOrders_ = handle;
+}
+
+void QueueBook::forgetOrder(OrderIndex::iterator idIt) {
+    if (orders_[idIt->handle].price == WIDE_PRICE) {
+        widePrices_.erase(idIt->handle);
+    }
+    handles_.erase(idIt);
+}
+
+template <typename Side>
+void QueueBook::eraseLevel(Side& book, typename Side::iterator levelIt) {
+    // Orders amended down to nothing can outlive their level's quantity
+    level_t& level = levelIt->second;
+    while (level.head != NO_ORDER) {
+        order_handle_t handle = level.head;
+        auto idIt = handles_.find(orders_[handle].order_id);
+        if (idIt != handles_.end() && idIt->handle == handle) {
+            forgetOrder(idIt);
+        }
+        unlinkOrder(level, handle);
+    }
+    book.erase(levelIt);
+}
+
+bool QueueBook::deleteOrder(OrderIndex::iterator idIt) {
+    bool topChanged = false;
+    bool found = withLevel(idIt, [&](auto& book, auto levelIt) {
+        topChanged = removeFromLevel(idIt, book, levelIt);
+        return true;
+    });
+
+    // Remove from order map
+    if (!found) {
+        forgetOrder(idIt);
+    }
+    return topChanged;
+}
+
+template <typename Side>
+bool QueueBook::removeFromLevel(OrderIndex::iterator idIt, Side& book, typename Side::iterator levelIt) {
+    order_handle_t handle = idIt->handle;
+    bool isBid = orders_[handle].is_bid;
+
+    // Update the quantity at this price level
+    levelIt->second.qty -= orders_[handle].qty;
+
+    // Check if we need to update top of book
+    bool topChanged = isAtTop(levelPrice(*levelIt), isBid);
+
+    // Remove the order from the queue
+    forgetOrder(idIt);
+    unlinkOrder(levelIt->second, handle);
+
+    // If level is now empty, remove it
+    if (levelIt->second.qty == 0) {
+        eraseLevel(book, levelIt);
+    }
+    return topChanged;
+}
+
+template <typename Side>
+bool QueueBook::reduceOrder(OrderIndex::iterator idIt, Side& book, typename Side::iterator levelIt,
+                            qty_t qty) {
+    order_handle_t handle = idIt->handle;
+    order_t& order = orders_[handle];
+
+    // Update the order and level quantities
+    order.qty -= qty;
+    levelIt->second.qty -= qty;
+
+    if (order.qty != 0) {
+        return false;
+    }
+
+    // Fully cancelled or executed: remove the order
+    bool isBid = order.is_bid;
+    int64_t price = levelPrice(*levelIt);
+    forgetOrder(idIt);
+    unlinkOrder(levelIt->second, handle);
+
+    // If level is now empty, remove it
+    if (levelIt->second.qty == 0) {
+        eraseLevel(book, levelIt);
+    }
+
+    // Check if top of book changed
+    return isAtTop(price, isBid);
+}
+
+bool QueueBook::refineGrid(int64_t price) {
+    // Lowest and highest ticks in use on either side
+    tick_price_t minTicks = 0;
+    tick_price_t maxTicks = 0;
+    bool any = false;
+    for (const book_side_t* book : {&bidBook_, &askBook_}) {
+        if (book->empty()) {
+            continue;
+        }
+        minTicks = any ? std::min(minTicks, book->begin()->first) : book->begin()->first;
+        maxTicks = any ? std::max(maxTicks, book->rbegin()->first) : book->rbegin()->first;
+        any = true;
+    }
+
+    int64_t factor = grid_.refine(price, minTicks, maxTicks);
+    if (factor == 0) {
+        return false;
+    }
+    if (factor == 1) {
+        return true;
+    }
+
+    // Finer tick: scale every key in place, keeping the level nodes, and the
+    // price of every order queued at them
+    for (book_side_t* book : {&bidBook_, &askBook_}) {
+        book_side_t rekeyed{book_side_t::allocator_type(&levelMemory_)};
+        while (!book->empty()) {
+            auto node = book->extract(book->begin());
+            node.key() = static_cast<tick_price_t>(node.key() * factor);
+            for (order_handle_t handle = node.mapped().head; handle != NO_ORDER; handle = orders_[handle].next) {
+                orders_[handle].price = node.key();
+            }
+            rekeyed.insert(rekeyed.end(), std::move(node));
+        }
+        book->swap(rekeyed);
+    }
+    return true;
+}
+
+const QueueBook::level_t* QueueBook::bestLevel(bool isBid, int64_t& price) const {
+    if (isBid) {
+        bool compact = !bidBook_.empty();
+        bool wide = !wideBids_.empty();
+        if (compact && (!wide || levelPrice(*bidBook_.rbegin()) > wideBids_.rbegin()->first)) {
+            price = levelPrice(*bidBook_.rbegin());
+            return &bidBook_.rbegin()->second;
+        }
+        price = wide ? wideBids_.rbegin()->first : 0;
+        return wide ? &wideBids_.rbegin()->second : nullptr;
+    }
+    bool compact = !askBook_.empty();
+    bool wide = !wideAsks_.empty();
+    if (compact && (!wide || levelPrice(*askBook_.begin()) < wideAsks_.begin()->first)) {
+        price = levelPrice(*askBook_.begin());
+        return &askBook_.begin()->second;
+    }
+    price = wide ? wideAsks_.begin()->first : INT64_MAX;
+    return wide ? &wideAsks_.begin()->second : nullptr;
+}
+
+void QueueBook::fillFor(const order_t& order, int64_t restingPrice, const level_t& level,
+                        const book_event_hdr_t& eventHeader, int64_t tradePrice, qty_t tradedQty,
+                        uint64_t executionId, book_fill_snapshot_t& fill) const {
+    fill.ts = eventHeader.ts;
+    fill.seq_no = eventHeader.seq_no;
+    fill.resting_order_id = order.order_id;
+    fill.was_hidden = false;
+    fill.trade_price = tradePrice;
+    fill.trade_qty = tradedQty;
+    fill.execution_id = executionId;
+    fill.resting_original_qty = order.qty;
+    fill.resting_order_remaining_qty = order.qty - tradedQty;
+    fill.resting_order_last_update_ts = order.timestamp;
+    fill.resting_side_is_bid = order.is_bid;
+    fill.resting_side_price = restingPrice;
+    fill.resting_side_qty = level.qty;
+    fill.resting_side_number_of_orders = level.orderCount;
+
+    // Set opposing side info
+    int64_t opposingPrice;
+    const level_t* opposing = bestLevel(!order.is_bid, opposingPrice);
+    fill.opposing_side_price = opposingPrice;
+    fill.opposing_side_qty = opposing ? opposing->qty : 0;
+}
+
+template <typename BidIt, typename AskIt>
+void QueueBook::publishLevels(book_top_level_t* const (&levels)[3], BidIt bidIt, BidIt bidEnd,
+                              AskIt askIt, AskIt askEnd) const {
+    // Bid side, best first
+    for (book_top_level_t* level : levels) {
+        if (bidIt != bidEnd) {
+            level->bid_nanos = levelPrice(*bidIt);
+            level->bid_qty = bidIt->second.qty;
+            ++bidIt;
+        } else {
+            level->bid_nanos = 0;
+            level->bid_qty = 0;
+        }
+    }
+
+    // Ask side, best first
+    for (book_top_level_t* level : levels) {
+        if (askIt != askEnd) {
+            level->ask_nanos = levelPrice(*askIt);
+            level->ask_qty = askIt->second.qty;
+            ++askIt;
+        } else {
+            level->ask_nanos = INT64_MAX;
+            level->ask_qty = 0;
+        }
+    }
+}
+
+void QueueBook::publishMergedLevels(book_top_level_t* const (&levels)[3]) const {
+    // Bid side, best first, merging in any wide levels
+    auto bidIt = bidBook_.rbegin();
+    auto wideBidIt = wideBids_.rbegin();
+    for (book_top_level_t* level : levels) {
+        bool wide = wideBidIt != wideBids_.rend();
+        if (bidIt != bidBook_.rend() && (!wide || levelPrice(*bidIt) > wideBidIt->first)) {
+            level->bid_nanos = levelPrice(*bidIt);
+            level->bid_qty = bidIt->second.qty;
+            ++bidIt;
+        } else if (wide) {
+            level->bid_nanos = wideBidIt->first;
+            level->bid_qty = wideBidIt->second.qty;
+            ++wideBidIt;
+        } else {
+            level->bid_nanos = 0;
+            level->bid_qty = 0;
+        }
+    }
+
+    // Ask side, best first
+    auto askIt = askBook_.begin();
+    auto wideAskIt = wideAsks_.begin();
+    for (book_top_level_t* level : levels) {
+        bool wide = wideAskIt != wideAsks_.end();
+        if (askIt != askBook_.end() && (!wide || levelPrice(*askIt) < wideAskIt->first)) {
+            level->ask_nanos = levelPrice(*askIt);
+            level->ask_qty = askIt->second.qty;
+            ++askIt;
+        } else if (wide) {
+            level->ask_nanos = wideAskIt->first;
+            level->ask_qty = wideAskIt->second.qty;
+            ++wideAskIt;
+        } else {
+            level->ask_nanos = INT64_MAX;
+            level->ask_qty = 0;
+        }
+    }
+}
+
+void QueueBook::updateTopLevels() {
+    book_top_level_t* levels[3] = {&currentTop_.top_level, &currentTop_.second_level, &currentTop_.third_level};
+
+    if (wideBids_.empty() && wideAsks_.empty()) {
+        publishLevels(levels, bidBook_.rbegin(), bidBook_.rend(), askBook_.begin(), askBook_.end());
+    } else {
+        publishMergedLevels(levels);
+    }
+
+    const int64_t MAX_REASONABLE_PRICE = 10000LL * 1000000000LL; // $10,000 in nanos
+
+    // Validate bid prices
+    if (currentTop_.top_level.bid_nanos > MAX_REASONABLE_PRICE) {
+        currentTop_.top_level.bid_nanos = 0;
+        currentTop_.top_level.bid_qty = 0;
+    }
+
+    // Validate ask prices
+    if (currentTop_.top_level.ask_nanos > MAX_REASONABLE_PRICE &&
+        currentTop_.top_level.ask_nanos != INT64_MAX) {
+        currentTop_.top_level.ask_nanos = INT64_MAX;
+        currentTop_.top_level.ask_qty = 0;
+    }
+}
@@ -0,0 +1,235 @@
+#ifndef QUEUE_BOOK_H
+#define QUEUE_BOOK_H
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include "memory_account.h"
+#include "order_index.h"
+#include "price_grid.h"
+#include "../types/market_data_types.h"
+
+// Order-by-order book of the queue simulation, rebuilt from book events.
+//
+// Every resting order keeps its place in a FIFO queue at its price level.
+// An exchange order id is resolved once per event to a dense 32-bit handle,
+// the order's slot in a flat array; the queues link slots by handle, and
+// handles of removed orders are recycled. A replay that reads ahead can
+// prefetch an event's index entry and then its order slot before applying
+// it.
+// apply() reports whether the event may have moved the top of book; the
+// caller then refreshes the published top with updateTopLevels(). Until it
+// does, top() keeps the levels of the last refresh, which is also what the
+// next event's top-change check compares against.
+//
+// Levels and orders hold 32-bit tick prices on the book's PriceGrid; prices
+// cross into nanos only at apply(), updateTopLevels() and the fills. The rare
+// price no 32-bit grid can hold alongside the book keeps a level of its own
+// in a side map keyed by nanos.
+class QueueBook {
+public:
+    // tickNanos 0 infers the tick size from the prices in the events
+    explicit QueueBook(int64_t tickNanos = 0);
+    
+    // Containers charge the book's own memory accounts
+    QueueBook(const QueueBook&) = delete;
+    QueueBook& operator=(const QueueBook&) = delete;
+
+    // Apply one event; payload points at its record as laid out in the book
+    // events file. Executions of a resting order are described in fill, with
+    // hasFill set. Returns true if the top of book may have changed.
+    bool apply(const book_event_hdr_t& eventHeader, const char* payload,
+               book_fill_snapshot_t& fill, bool& hasFill);
+
+    // Start loading what apply() will look up for an event: its order id's
+    // index entry, and, once that entry is likely cached, the order slot it
+    // points to. Hints only; the book is left as is.
+    void prefetchIndex(const book_event_hdr_t& eventHeader, const char* payload) const;
+    void prefetchOrder(const book_event_hdr_t& eventHeader, const char* payload) const;
+
+    // Publish the top three levels of each side into top(). Empty levels are
+    // 0 on the bid side and INT64_MAX on the ask side.
+    void updateTopLevels();
+
+    // Top of book stamped with the last applied event
+    const book_top_t& top() const { return currentTop_; }
+
+    // Call f(priceNanos, qty) for the levels of a side, best first, until it
+    // returns false. Walks the book in place, so the book must not change
+    // until the walk is over.
+    template <typename F>
+    void forEachLevel(bool isBid, F&& f) const;
+
+    size_t bidLevelCount() const { return bidBook_.size(); }
+    size_t askLevelCount() const { return askBook_.size(); }
+    size_t orderCount() const { return handles_.size(); }
+
+    // Heap held by the price levels, the orders queued at them and the
+    // order id index, counted by their allocators
+    const MemoryAccount& levelMemory() const { return levelMemory_; }
+    const MemoryAccount& orderSlotMemory() const { return orderSlotMemory_; }
+    const MemoryAccount& orderMapMemory() const { return orderMapMemory_; }
+    size_t memoryBytes() const {
+        return levelMemory_.bytes() + orderSlotMemory_.bytes() + orderMapMemory_.bytes();
+    }
+
+    void clear();
+
+private:
+    using qty_t = uint32_t;
+
+    // Dense handle of a live order: its slot in orders_
+    using order_handle_t = OrderIndex::handle_t;
+    static constexpr order_handle_t NO_ORDER = OrderIndex::NO_HANDLE;
+
+    // Marks an order whose level is in the wide side; its price is in widePrices_
+    static constexpr tick_price_t WIDE_PRICE = INT32_MIN;
+
+    // Order slot; the orders of a level form a FIFO linked through prev/next.
+    // Free slots are chained through next.
+    struct order_t {
+        uint64_t order_id;
+        uint64_t timestamp;
+        qty_t qty;
+        tick_price_t price;
+        order_handle_t prev;
+        order_handle_t next;
+        bool is_bid;
+    };
+
+    struct level_t {
+        qty_t qty;
+        uint32_t orderCount;
+        order_handle_t head;
+        order_handle_t tail;
+    };
+
+    using book_side_t = std::map<tick_price_t, level_t, std::less<tick_price_t>,
+                                 CountingAllocator<std::pair<const tick_price_t, level_t>>>;
+
+    // Levels at prices off the grid, by nanos
+    using wide_side_t = std::map<int64_t, level_t, std::less<int64_t>,
+                                 CountingAllocator<std::pair<const int64_t, level_t>>>;
+
+    using wide_price_map_t = std::unordered_map<order_handle_t, int64_t, std::hash<order_handle_t>,
+                                                std::equal_to<order_handle_t>,
+                                                CountingAllocator<std::pair<const order_handle_t, int64_t>>>;
+
+    // Order id an event looks up or adds; false for events without one
+    static bool eventOrderId(const book_event_hdr_t& eventHeader, const char* payload, uint64_t& orderId);
+
+    // Queue a new order at the back of its level
+    bool addOrder(uint64_t orderId, int64_t price, qty_t qty, bool isBid, uint64_t ts);
+    bool addWideOrder(uint64_t orderId, int64_t price, qty_t qty, bool isBid, uint64_t ts);
+
+    // Give orderId a slot at the back of level
+    order_handle_t queueOrder(level_t& level, uint64_t orderId, tick_price_t price, qty_t qty, bool isBid,
+                              uint64_t ts);
+
+    // Call f(book, levelIt) with the level of an order, on whichever side map
+    // holds it; false if the level is missing
+    template <typename F>
+    bool withLevel(OrderIndex::iterator idIt, F&& f);
+
+    // Take an order out of the book entirely
+    bool deleteOrder(OrderIndex::iterator idIt);
+    template <typename Side>
+    bool removeFromLevel(OrderIndex::iterator idIt, Side& book, typename Side::iterator levelIt);
+
+    // Take qty off an order that is cancelled or executed, removing it once
+    // nothing is left
+    template <typename Side>
+    bool reduceOrder(OrderIndex::iterator idIt, Side& book, typename Side::iterator levelIt, qty_t qty);
+
+    // Unlink an order from its level's FIFO and recycle its handle
+    void unlinkOrder(level_t& level, order_handle_t handle);
+
+    // Drop an order that has left its level from the id map
+    void forgetOrder(OrderIndex::iterator idIt);
+
+    // Remove an emptied level, recycling any zero-quantity orders left on it
+    template <typename Side>
+    void eraseLevel(Side& book, typename Side::iterator levelIt);
+
+    // Describe an execution of qty from a resting order at restingPrice
+    void fillFor(const order_t& order, int64_t restingPrice, const level_t& level,
+                 const book_event_hdr_t& eventHeader, int64_t tradePrice, qty_t tradedQty,
+                 uint64_t executionId, book_fill_snapshot_t& fill) const;
+
+    // Widen the grid to cover price, re-keying the book; false if it cannot
+    bool refineGrid(int64_t price);
+
+    // Write the top three levels of each side into levels, from the grid
+    // levels alone or merged with the wide ones
+    template <typename BidIt, typename AskIt>
+    void publishLevels(book_top_level_t* const (&levels)[3], BidIt bidIt, BidIt bidEnd,
+                       AskIt askIt, AskIt askEnd) const;
+    void publishMergedLevels(book_top_level_t* const (&levels)[3]) const;
+
+    // Levels of one side from both maps in price order, better(a, b) when
+    // price a comes first
+    template <typename It, typename WideIt, typename Better, typename F>
+    void walkLevels(It it, It end, WideIt wideIt, WideIt wideEnd, Better better, F& f) const;
+
+    // Best level of a side across both maps; nullptr with 0 / INT64_MAX when
+    // the side is empty
+    const level_t* bestLevel(bool isBid, int64_t& price) const;
+
+    int64_t levelPrice(const book_side_t::value_type& level) const { return grid_.toNanos(level.first); }
+    int64_t levelPrice(const wide_side_t::value_type& level) const { return level.first; }
+
+    bool isAtTop(int64_t price, bool isBid) const {
+        return isBid ? price == currentTop_.top_level.bid_nanos : price == currentTop_.top_level.ask_nanos;
+    }
+
+    book_side_t& side(bool isBid) { return isBid ? bidBook_ : askBook_; }
+    wide_side_t& wideSide(bool isBid) { return isBid ? wideBids_ : wideAsks_; }
+
+    // Declared ahead of the containers that charge them
+    MemoryAccount levelMemory_;
+    MemoryAccount orderSlotMemory_;
+    MemoryAccount orderMapMemory_;
+
+    PriceGrid grid_;
+    book_side_t bidBook_;
+    book_side_t askBook_;
+    wide_side_t wideBids_;
+    wide_side_t wideAsks_;
+    std::vector<order_t, CountingAllocator<order_t>> orders_;
+    order_handle_t freeOrders_;
+    OrderIndex handles_;            // exchange order id to handle: the only hashed lookup, once per event
+    wide_price_map_t widePrices_;
+    book_top_t currentTop_;
+};
+
+template <typename F>
+void QueueBook::forEachLevel(bool isBid, F&& f) const {
+    if (isBid) {
+        walkLevels(bidBook_.rbegin(), bidBook_.rend(), wideBids_.rbegin(), wideBids_.rend(),
+                   std::greater<int64_t>(), f);
+    } else {
+        walkLevels(askBook_.begin(), askBook_.end(), wideAsks_.begin(), wideAsks_.end(), std::less<int64_t>(), f);
+    }
+}
+
+template <typename It, typename WideIt, typename Better, typename F>
+void QueueBook::walkLevels(It it, It end, WideIt wideIt, WideIt wideEnd, Better better, F& f) const {
+    while (it != end || wideIt != wideEnd) {
+        if (it != end && (wideIt == wideEnd || better(levelPrice(*it), wideIt->first))) {
+            if (!f(levelPrice(*it), it->second.qty)) {
+                return;
+            }
+            ++it;
+        } else {
+            if (!f(wideIt->first, wideIt->second.qty)) {
+                return;
+            }
+            ++wideIt;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,301 @@
+#include "reference_book.h"
+#include <cstring>
+#include <iterator>
+
+ReferenceBook::ReferenceBook() {
+    std::memset(&currentTop_, 0, sizeof(currentTop_));
+    updateTopLevels();
+}
+
+void ReferenceBook::clear() {
+    bidBook_.clear();
+    askBook_.clear();
+    orderMap_.clear();
+}
+
+bool ReferenceBook::apply(const book_event_hdr_t& eventHeader, const char* payload,
+                          book_fill_snapshot_t& fill, bool& hasFill) {
+    // Update timestamp in the current top
+    currentTop_.ts = eventHeader.ts;
+    currentTop_.seqno = eventHeader.seq_no;
+    hasFill = false;
+
+    switch (eventHeader.type) {
+        case book_event_type_e::add_order: {
+            add_order_t addOrder;
+            std::memcpy(&addOrder, payload, sizeof(add_order_t));
+            return this->addOrder(addOrder.order_id, addOrder.price, addOrder.qty, addOrder.is_bid, eventHeader.ts);
+        }
+
+        case book_event_type_e::delete_order: {
+            delete_order_t deleteOrder;
+            std::memcpy(&deleteOrder, payload, sizeof(delete_order_t));
+
+            auto orderIt = orderMap_.find(deleteOrder.order_id);
+            if (orderIt == orderMap_.end()) {
+                return false;
+            }
+            return this->deleteOrder(orderIt);
+        }
+
+        case book_event_type_e::replace_order: {
+            replace_order_t replaceOrder;
+            std::memcpy(&replaceOrder, payload, sizeof(replace_order_t));
+
+            // First, delete the original order; the new one takes its side
+            bool topChanged = false;
+            bool isBid = replaceOrder.price > 0;
+            auto orderIt = orderMap_.find(replaceOrder.orig_order_id);
+            if (orderIt != orderMap_.end()) {
+                isBid = orderIt->second.is_bid;
+                topChanged = deleteOrder(orderIt);
+            }
+
+            // Add the new order
+            if (addOrder(replaceOrder.new_order_id, replaceOrder.price, replaceOrder.qty, isBid, eventHeader.ts)) {
+                topChanged = true;
+            }
+            return topChanged;
+        }
+
+        case book_event_type_e::amend_order: {
+            amend_order_t amendOrder;
+            std::memcpy(&amendOrder, payload, sizeof(amend_order_t));
+
+            auto orderIt = orderMap_.find(amendOrder.order_id);
+            if (orderIt == orderMap_.end()) {
+                return false;
+            }
+            const order_ref_t& ref = orderIt->second;
+            book_side_t& book = side(ref.is_bid);
+            auto levelIt = book.find(ref.price);
+            if (levelIt == book.end()) {
+                return false;
+            }
+
+            // Calculate the delta in qty
+            qty_t oldQty = ref.order_it->qty;
+            qty_t qtyDelta = amendOrder.new_qty - oldQty;
+
+            // Update the order quantity
+            ref.order_it->qty = amendOrder.new_qty;
+            ref.order_it->timestamp = eventHeader.ts;
+
+            // Update the level quantity
+            levelIt->second.first += qtyDelta;
+
+            // Check if this affects top of book
+            return isAtTop(ref);
+        }
+
+        case book_event_type_e::reduce_order: {
+            reduce_order_t reduceOrder;
+            std::memcpy(&reduceOrder, payload, sizeof(reduce_order_t));
+
+            auto orderIt = orderMap_.find(reduceOrder.order_id);
+            if (orderIt == orderMap_.end()) {
+                return false;
+            }
+            book_side_t& book = side(orderIt->second.is_bid);
+            auto levelIt = book.find(orderIt->second.price);
+            if (levelIt == book.end()) {
+                return false;
+            }
+
+            orderIt->second.order_it->timestamp = eventHeader.ts;
+            return this->reduceOrder(orderIt, levelIt, reduceOrder.cxled_qty);
+        }
+
+        case book_event_type_e::execute_order: {
+            execute_order_t executeOrder;
+            std::memcpy(&executeOrder, payload, sizeof(execute_order_t));
+
+            auto orderIt = orderMap_.find(executeOrder.order_id);
+            if (orderIt == orderMap_.end()) {
+                return false;
+            }
+            book_side_t& book = side(orderIt->second.is_bid);
+            auto levelIt = book.find(orderIt->second.price);
+            if (levelIt == book.end()) {
+                return false;
+            }
+
+            fillFor(orderIt->second, levelIt->second, eventHeader, orderIt->second.price,
+                    executeOrder.traded_qty, executeOrder.execution_id, fill);
+            hasFill = true;
+            return reduceOrder(orderIt, levelIt, executeOrder.traded_qty);
+        }
+
+        case book_event_type_e::execute_order_at_price: {
+            execute_order_at_price_t executeOrder;
+            std::memcpy(&executeOrder, payload, sizeof(execute_order_at_price_t));
+
+            auto orderIt = orderMap_.find(executeOrder.order_id);
+            if (orderIt == orderMap_.end()) {
+                return false;
+            }
+            book_side_t& book = side(orderIt->second.is_bid);
+            auto levelIt = book.find(orderIt->second.price);
+            if (levelIt == book.end()) {
+                return false;
+            }
+
+            // The fill is reported at the execution price
+            fillFor(orderIt->second, levelIt->second, eventHeader, executeOrder.execution_price,
+                    executeOrder.traded_qty, executeOrder.execution_id, fill);
+            hasFill = true;
+            return reduceOrder(orderIt, levelIt, executeOrder.traded_qty);
+        }
+
+        case book_event_type_e::clear_book:
+            clear();
+            return true;
+
+        default:
+            // Session events, hidden trades and anything else leave the book as is
+            return false;
+    }
+}
+
+bool ReferenceBook::addOrder(uint64_t orderId, price_t price, qty_t qty, bool isBid, uint64_t ts) {
+    // Add order to appropriate book side, creating the level if needed
+    book_side_t& book = side(isBid);
+    auto& level = book[price];
+    level.first += qty;
+    level.second.push_back({orderId, qty, ts});
+
+    // Store reference to the order
+    orderMap_[orderId] = order_ref_t{price, isBid, std::prev(level.second.end())};
+
+    // Check if top of book changed
+    if (isBid) {
+        return price >= bidBook_.rbegin()->first;
+    }
+    return price <= askBook_.begin()->first;
+}
+
+bool ReferenceBook::deleteOrder(order_map_t::iterator orderIt) {
+    const order_ref_t ref = orderIt->second;
+    book_side_t& book = side(ref.is_bid);
+    auto levelIt = book.find(ref.price);
+
+    bool topChanged = false;
+    if (levelIt != book.end()) {
+        // Update the quantity at this price level
+        levelIt->second.first -= ref.order_it->qty;
+
+        // Check if we need to update top of book
+        topChanged = isAtTop(ref);
+
+        // Remove the order from the queue
+        levelIt->second.second.erase(ref.order_it);
+
+        // If level is now empty, remove it
+        if (levelIt->second.first == 0) {
+            book.erase(levelIt);
+        }
+    }
+
+    // Remove from order map
+    orderMap_.erase(orderIt);
+    return topChanged;
+}
+
+bool ReferenceBook::reduceOrder(order_map_t::iterator orderIt, book_side_t::iterator levelIt, qty_t qty) {
+    const order_ref_t ref = orderIt->second;
+
+    // Update the order and level quantities
+    ref.order_it->qty -= qty;
+    levelIt->second.first -= qty;
+
+    if (ref.order_it->qty != 0) {
+        return false;
+    }
+
+    // Fully cancelled or executed: remove the order
+    levelIt->second.second.erase(ref.order_it);
+    orderMap_.erase(orderIt);
+
+    // If level is now empty, remove it
+    if (levelIt->second.first == 0) {
+        side(ref.is_bid).erase(levelIt);
+    }
+
+    // Check if top of book changed
+    return isAtTop(ref);
+}
+
+void ReferenceBook::fillFor(const order_ref_t& ref, const level_t& level, const book_event_hdr_t& eventHeader,
+                            int64_t tradePrice, qty_t tradedQty, uint64_t executionId,
+                            book_fill_snapshot_t& fill) const {
+    const order_t& order = *ref.order_it;
+
+    fill.ts = eventHeader.ts;
+    fill.seq_no = eventHeader.seq_no;
+    fill.resting_order_id = order.order_id;
+    fill.was_hidden = false;
+    fill.trade_price = tradePrice;
+    fill.trade_qty = tradedQty;
+    fill.execution_id = executionId;
+    fill.resting_original_qty = order.qty;
+    fill.resting_order_remaining_qty = order.qty - tradedQty;
+    fill.resting_order_last_update_ts = order.timestamp;
+    fill.resting_side_is_bid = ref.is_bid;
+    fill.resting_side_price = ref.price;
+    fill.resting_side_qty = level.first;
+    fill.resting_side_number_of_orders = static_cast<uint32_t>(level.second.size());
+
+    // Set opposing side info
+    if (ref.is_bid) {
+        fill.opposing_side_price = askBook_.empty() ? INT64_MAX : askBook_.begin()->first;
+        fill.opposing_side_qty = askBook_.empty() ? 0 : askBook_.begin()->second.first;
+    } else {
+        fill.opposing_side_price = bidBook_.empty() ? 0 : bidBook_.rbegin()->first;
+        fill.opposing_side_qty = bidBook_.empty() ? 0 : bidBook_.rbegin()->second.first;
+    }
+}
+
+void ReferenceBook::updateTopLevels() {
+    book_top_level_t* levels[3] = {&currentTop_.top_level, &currentTop_.second_level, &currentTop_.third_level};
+
+    // Bid side, best first
+    auto bidIt = bidBook_.rbegin();
+    for (book_top_level_t* level : levels) {
+        if (bidIt != bidBook_.rend()) {
+            level->bid_nanos = bidIt->first;
+            level->bid_qty = bidIt->second.first;
+            ++bidIt;
+        } else {
+            level->bid_nanos = 0;
+            level->bid_qty = 0;
+        }
+    }
+
+    // Ask side, best first
+    auto askIt = askBook_.begin();
+    for (book_top_level_t* level : levels) {
+        if (askIt != askBook_.end()) {
+            level->ask_nanos = askIt->first;
+            level->ask_qty = askIt->second.first;
+            ++askIt;
+        } else {
+            level->ask_nanos = INT64_MAX;
+            level->ask_qty = 0;
+        }
+    }
+
+    const int64_t MAX_REASONABLE_PRICE = 10000LL * 1000000000LL; // $10,000 in nanos
+
+    // Validate bid prices
+    if (currentTop_.top_level.bid_nanos > MAX_REASONABLE_PRICE) {
+        currentTop_.top_level.bid_nanos = 0;
+        currentTop_.top_level.bid_qty = 0;
+    }
+
+    // Validate ask prices
+    if (currentTop_.top_level.ask_nanos > MAX_REASONABLE_PRICE &&
+        currentTop_.top_level.ask_nanos != INT64_MAX) {
+        currentTop_.top_level.ask_nanos = INT64_MAX;
+        currentTop_.top_level.ask_qty = 0;
+    }
+}
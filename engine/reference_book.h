@@ -0,0 +1,114 @@
+#ifndef REFERENCE_BOOK_H
+#define REFERENCE_BOOK_H
+
+#include <cstdint>
+#include <cstddef>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include "../types/market_data_types.h"
+
+// Order book of the reference engine (--verify): the queue simulation's
+// original book, kept as it was before QueueBook's optimizations. Levels are
+// maps keyed by price in nanos, every level keeps a std::list FIFO of its
+// orders and orders are found through an unordered_map of list iterators.
+//
+// apply(), updateTopLevels(), top() and forEachLevel() behave as QueueBook's;
+// tests/queue_book_test checks the two against each other event by event.
+class ReferenceBook {
+public:
+    ReferenceBook();
+
+    // Apply one event; payload points at its record as laid out in the book
+    // events file. Executions of a resting order are described in fill, with
+    // hasFill set. Returns true if the top of book may have changed.
+    bool apply(const book_event_hdr_t& eventHeader, const char* payload,
+               book_fill_snapshot_t& fill, bool& hasFill);
+
+    // Publish the top three levels of each side into top(). Empty levels are
+    // 0 on the bid side and INT64_MAX on the ask side.
+    void updateTopLevels();
+
+    // Top of book stamped with the last applied event
+    const book_top_t& top() const { return currentTop_; }
+
+    // Call f(priceNanos, qty) for the levels of a side, best first, until it
+    // returns false
+    template <typename F>
+    void forEachLevel(bool isBid, F&& f) const;
+
+    size_t bidLevelCount() const { return bidBook_.size(); }
+    size_t askLevelCount() const { return askBook_.size(); }
+    size_t orderCount() const { return orderMap_.size(); }
+
+    void clear();
+
+private:
+    using price_t = int64_t;
+    using qty_t = uint32_t;
+
+    struct order_t {
+        uint64_t order_id;
+        qty_t qty;
+        uint64_t timestamp;
+    };
+
+    // Using a list for the queue of orders at each price level
+    using order_queue_t = std::list<order_t>;
+    using level_t = std::pair<qty_t, order_queue_t>;
+    using book_side_t = std::map<price_t, level_t>;
+
+    // Order reference to quickly locate orders in the book
+    struct order_ref_t {
+        price_t price;
+        bool is_bid;
+        order_queue_t::iterator order_it;
+    };
+
+    using order_map_t = std::unordered_map<uint64_t, order_ref_t>;
+
+    // Queue a new order at the back of its level
+    bool addOrder(uint64_t orderId, price_t price, qty_t qty, bool isBid, uint64_t ts);
+
+    // Take an order out of the book entirely
+    bool deleteOrder(order_map_t::iterator orderIt);
+
+    // Take qty off an order that is cancelled or executed, removing it once
+    // nothing is left
+    bool reduceOrder(order_map_t::iterator orderIt, book_side_t::iterator levelIt, qty_t qty);
+
+    // Describe an execution of qty from a resting order
+    void fillFor(const order_ref_t& ref, const level_t& level, const book_event_hdr_t& eventHeader,
+                 int64_t tradePrice, qty_t tradedQty, uint64_t executionId, book_fill_snapshot_t& fill) const;
+
+    bool isAtTop(const order_ref_t& ref) const {
+        return ref.is_bid ? ref.price == currentTop_.top_level.bid_nanos
+                          : ref.price == currentTop_.top_level.ask_nanos;
+    }
+
+    book_side_t& side(bool isBid) { return isBid ? bidBook_ : askBook_; }
+
+    book_side_t bidBook_;
+    book_side_t askBook_;
+    order_map_t orderMap_;
+    book_top_t currentTop_;
+};
+
+template <typename F>
+void ReferenceBook::forEachLevel(bool isBid, F&& f) const {
+    if (isBid) {
+        for (auto it = bidBook_.rbegin(); it != bidBook_.rend(); ++it) {
+            if (!f(it->first, it->second.first)) {
+                return;
+            }
+        }
+    } else {
+        for (auto it = askBook_.begin(); it != askBook_.end(); ++it) {
+            if (!f(it->first, it->second.first)) {
+                return;
+            }
+        }
+    }
+}
+
+#endif
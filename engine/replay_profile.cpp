@@ -0,0 +1,39 @@
+#include "replay_profile.h"
+#include <algorithm>
+#include <cmath>
+
+void ReplayProfile::begin() {
+    blockEvents_ = 0;
+    blockStart_ = std::chrono::steady_clock::now();
+}
+
+void ReplayProfile::end() {
+    if (blockEvents_ > 0) {
+        closeBlock();
+    }
+}
+
+void ReplayProfile::closeBlock() {
+    auto now = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(now - blockStart_).count();
+
+    elapsedNs_ += ns;
+    events_ += blockEvents_;
+    blockNsPerEvent_.push_back(ns / blockEvents_);
+
+    blockEvents_ = 0;
+    blockStart_ = now;
+}
+
+double ReplayProfile::nsPerEventQuantile(double q) const {
+    if (blockNsPerEvent_.empty()) {
+        return 0;
+    }
+
+    // Nearest rank
+    std::vector<double> sorted = blockNsPerEvent_;
+    size_t rank = static_cast<size_t>(std::ceil(std::clamp(q, 0.0, 1.0) * sorted.size()));
+    size_t index = rank > 0 ? rank - 1 : 0;
+    std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+    return sorted[index];
+}
@@ -0,0 +1,44 @@
+#ifndef REPLAY_PROFILE_H
+#define REPLAY_PROFILE_H
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// Wall-clock profile of a replay loop.
+//
+// The loop calls begin() before its first event, onEvent() after every input
+// event and end() when it is done; several begin/end spans (e.g. the lanes
+// of a sweep replayed one after the other) add up. The clock is read once
+// per block of BLOCK_EVENTS events, so the per-event quantiles are those of
+// block averages and profiling costs one clock read per block.
+class ReplayProfile {
+public:
+    static constexpr uint32_t BLOCK_EVENTS = 256;
+
+    void begin();
+    void onEvent() {
+        if (++blockEvents_ == BLOCK_EVENTS) {
+            closeBlock();
+        }
+    }
+    void end();
+
+    uint64_t events() const { return events_; }
+    double elapsedSec() const { return elapsedNs_ / 1e9; }
+    double eventsPerSec() const { return elapsedNs_ > 0 ? events_ / (elapsedNs_ / 1e9) : 0; }
+
+    // ns/event at quantile q in [0, 1] over the timed blocks
+    double nsPerEventQuantile(double q) const;
+
+private:
+    void closeBlock();
+
+    std::chrono::steady_clock::time_point blockStart_;
+    uint32_t blockEvents_ = 0;
+    uint64_t events_ = 0;
+    double elapsedNs_ = 0;
+    std::vector<double> blockNsPerEvent_;
+};
+
+#endif
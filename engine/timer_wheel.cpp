@@ -0,0 +1,198 @@
+#include "timer_wheel.h"
+#include <algorithm>
+
+TimerWheel::TimerWheel(uint64_t tickNs)
+    : tickNs_(tickNs > 0 ? tickNs : 1),
+      currentTick_(0),
+      pending_(0),
+      freeHead_(NIL) {
+    std::fill(std::begin(heads_), std::end(heads_), NIL);
+    std::fill(std::begin(levelCounts_), std::end(levelCounts_), 0);
+    std::fill(&occupied_[0][0], &occupied_[0][0] + LEVELS * WORDS, 0);
+}
+
+uint64_t TimerWheel::scheduleTimer(uint64_t deadlineNs, uint64_t token) {
+    if (freeHead_ == NIL) {
+        // Grow the node pool; nodes are addressed by index so nothing moves
+        size_t oldSize = nodes_.size();
+        size_t newSize = std::max<size_t>(64, oldSize * 2);
+        nodes_.resize(newSize);
+        for (size_t i = oldSize; i < newSize; ++i) {
+            nodes_[i].generation = 1;
+            nodes_[i].list = NIL;
+            nodes_[i].next = (i + 1 < newSize) ? static_cast<uint32_t>(i + 1) : NIL;
+        }
+        freeHead_ = static_cast<uint32_t>(oldSize);
+    }
+
+    uint32_t node = freeHead_;
+    freeHead_ = nodes_[node].next;
+
+    Node& timer = nodes_[node];
+    timer.deadlineNs = deadlineNs;
+    timer.expiryTick = deadlineNs / tickNs_ + (deadlineNs % tickNs_ != 0 ? 1 : 0);
+    timer.token = token;
+
+    // Ticks up to currentTick_ have been processed; a due timer goes into the
+    // next slot and fires on the next advance
+    timer.expiryTick = std::max(timer.expiryTick, currentTick_ + 1);
+    place(node);
+    pending_++;
+
+    return (static_cast<uint64_t>(timer.generation) << 32) | (node + 1);
+}
+
+bool TimerWheel::cancelTimer(uint64_t timerId) {
+    uint64_t index = timerId & 0xFFFFFFFFULL;
+    if (index == 0 || index > nodes_.size()) {
+        return false;
+    }
+
+    uint32_t node = static_cast<uint32_t>(index - 1);
+    if (nodes_[node].generation != static_cast<uint32_t>(timerId >> 32) || nodes_[node].list == NIL) {
+        return false;
+    }
+
+    unlink(node);
+    release(node);
+    return true;
+}
+
+uint64_t TimerWheel::nextDeadline() const {
+    uint64_t earliest = UINT64_MAX;
+    if (pending_ == 0) {
+        return earliest;
+    }
+
+    // A wheel's slots cover consecutive stretches of ticks starting after the
+    // current one, so its earliest timer is on its first occupied slot. The
+    // wheels overlap in time, so each one is looked at. Timers parked in the
+    // outermost wheel's farthest slot break its order, so all of its
+    // occupied slots are.
+    for (uint32_t level = 0; level < LEVELS; ++level) {
+        if (levelCounts_[level] == 0) {
+            continue;
+        }
+        uint32_t first = 0;
+        uint32_t last = SLOTS - 1;
+        if (level + 1 < LEVELS) {
+            uint32_t current = static_cast<uint32_t>((currentTick_ >> (LEVEL_BITS * level)) & (SLOTS - 1));
+            first = last = firstOccupied(level, (current + 1) & (SLOTS - 1));
+        }
+        for (uint32_t slot = first; slot <= last; ++slot) {
+            for (uint32_t node = heads_[level * SLOTS + slot]; node != NIL; node = nodes_[node].next) {
+                earliest = std::min(earliest, nodes_[node].deadlineNs);
+            }
+        }
+    }
+    return earliest;
+}
+
+uint32_t TimerWheel::firstOccupied(uint32_t level, uint32_t slot) const {
+    const uint64_t* words = occupied_[level];
+    uint32_t word = slot / 64;
+    uint64_t bits = words[word] & (~0ULL << (slot % 64));
+    for (uint32_t i = 0; i <= WORDS; ++i) {
+        if (bits != 0) {
+            return word * 64 + static_cast<uint32_t>(__builtin_ctzll(bits));
+        }
+        word = (word + 1) % WORDS;
+        bits = words[word];
+    }
+    return NIL;
+}
+
+void TimerWheel::place(uint32_t node) {
+    uint64_t expiry = nodes_[node].expiryTick;
+    uint64_t delta = expiry - currentTick_;
+
+    uint32_t level = 0;
+    while (level + 1 < LEVELS && delta >= (1ULL << (LEVEL_BITS * (level + 1)))) {
+        level++;
+    }
+
+    // Beyond the outermost wheel: park in its farthest slot and re-place on cascade
+    if (delta >= (1ULL << (LEVEL_BITS * LEVELS))) {
+        expiry = currentTick_ + (1ULL << (LEVEL_BITS * LEVELS)) - 1;
+    }
+
+    uint32_t slot = static_cast<uint32_t>((expiry >> (LEVEL_BITS * level)) & (SLOTS - 1));
+    link(node, level * SLOTS + slot);
+}
+
+void TimerWheel::link(uint32_t node, uint32_t list) {
+    Node& timer = nodes_[node];
+    timer.list = list;
+    timer.prev = NIL;
+    timer.next = heads_[list];
+    if (heads_[list] != NIL) {
+        nodes_[heads_[list]].prev = node;
+    }
+    heads_[list] = node;
+    levelCounts_[list / SLOTS]++;
+    occupied_[list / SLOTS][(list % SLOTS) / 64] |= 1ULL << (list % 64);
+}
+
+void TimerWheel::unlink(uint32_t node) {
+    Node& timer = nodes_[node];
+    if (timer.prev != NIL) {
+        nodes_[timer.prev].next = timer.next;
+    } else {
+        heads_[timer.list] = timer.next;
+        if (timer.next == NIL) {
+            occupied_[timer.list / SLOTS][(timer.list % SLOTS) / 64] &= ~(1ULL << (timer.list % 64));
+        }
+    }
+    if (timer.next != NIL) {
+        nodes_[timer.next].prev = timer.prev;
+    }
+    levelCounts_[timer.list / SLOTS]--;
+    timer.list = NIL;
+}
+
+void TimerWheel::release(uint32_t node) {
+    // Bump the generation so stale handles to this node are rejected
+    nodes_[node].generation++;
+    nodes_[node].next = freeHead_;
+    freeHead_ = node;
+    pending_--;
+}
+
+void TimerWheel::cascade(uint32_t level) {
+    uint32_t slot = static_cast<uint32_t>((currentTick_ >> (LEVEL_BITS * level)) & (SLOTS - 1));
+    uint32_t list = level * SLOTS + slot;
+    while (heads_[list] != NIL) {
+        uint32_t node = heads_[list];
+        unlink(node);
+        place(node);
+    }
+}
+
+uint32_t TimerWheel::stepTick() {
+    ++currentTick_;
+
+    // Cascade the coarser wheels whose slot boundary was just reached
+    for (uint32_t level = LEVELS - 1; level >= 1; --level) {
+        if ((currentTick_ & ((1ULL << (LEVEL_BITS * level)) - 1)) == 0) {
+            cascade(level);
+        }
+    }
+
+    return static_cast<uint32_t>(currentTick_ & (SLOTS - 1));
+}
+
+uint64_t TimerWheel::skipTarget(uint64_t targetTick) const {
+    uint32_t level = 0;
+    while (level < LEVELS && levelCounts_[level] == 0) {
+        level++;
+    }
+    if (level == 0) {
+        return currentTick_;
+    }
+
+    // With the finer wheels empty, nothing happens before the next boundary
+    // of the lowest occupied wheel, where it cascades
+    uint32_t shift = LEVEL_BITS * std::min(level, LEVELS - 1);
+    uint64_t nextBoundary = ((currentTick_ >> shift) + 1) << shift;
+    return std::min(nextBoundary - 1, targetTick);
+}
@@ -0,0 +1,141 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "../strategies/strategy.h"
+
+// Hierarchical timing wheel driven by the replay clock.
+//
+// Deadlines are quantised to ticks of tickNs and kept in LEVELS wheels of
+// SLOTS slots each; timers far in the future sit in coarser wheels and are
+// cascaded down as the clock reaches them. Timers are pooled nodes on
+// intrusive slot lists, so schedule and cancel are O(1), and advancing the
+// clock skips empty stretches instead of stepping through every tick.
+class TimerWheel : public TimerService {
+public:
+    explicit TimerWheel(uint64_t tickNs = 1000000);
+
+    uint64_t scheduleTimer(uint64_t deadlineNs, uint64_t token) override;
+    bool cancelTimer(uint64_t timerId) override;
+
+    // Advance the clock to nowNs and call onExpired(token) for every timer
+    // whose deadline is <= nowNs. Timers may be scheduled or cancelled from
+    // inside the callback.
+    template <typename Callback>
+    void advance(uint64_t nowNs, Callback&& onExpired);
+
+    size_t pending() const { return pending_; }
+    size_t memoryBytes() const { return nodes_.capacity() * sizeof(Node); }
+    
+    // Earliest pending deadline, UINT64_MAX when nothing is scheduled. Looks
+    // only at the first occupied slot of each wheel.
+    uint64_t nextDeadline() const;
+
+private:
+    static constexpr uint32_t LEVEL_BITS = 8;
+    static constexpr uint32_t SLOTS = 1u << LEVEL_BITS;
+    static constexpr uint32_t LEVELS = 4;
+    static constexpr uint32_t NIL = UINT32_MAX;
+    static constexpr uint32_t WORDS = SLOTS / 64;
+
+    struct Node {
+        uint64_t deadlineNs;
+        uint64_t expiryTick;
+        uint64_t token;
+        uint32_t generation;
+        uint32_t list;      // level * SLOTS + slot, NIL when not scheduled
+        uint32_t prev;
+        uint32_t next;      // also links the free list
+    };
+
+    void place(uint32_t node);
+    void link(uint32_t node, uint32_t list);
+    void unlink(uint32_t node);
+    void release(uint32_t node);
+    void cascade(uint32_t level);
+
+    // Move currentTick_ forward by one tick and return the level-0 list due
+    uint32_t stepTick();
+
+    // Largest tick that can be skipped to without passing a scheduled slot
+    uint64_t skipTarget(uint64_t targetTick) const;
+
+    // First occupied slot of level at or after slot, in wheel order; NIL if
+    // the level is empty
+    uint32_t firstOccupied(uint32_t level, uint32_t slot) const;
+
+    // Fire the timers on list whose deadline is <= nowNs
+    template <typename Callback>
+    void fireDue(uint32_t list, uint64_t nowNs, Callback& onExpired);
+
+    uint64_t tickNs_;
+    uint64_t currentTick_;
+    size_t pending_;
+    uint32_t freeHead_;
+    std::vector<Node> nodes_;
+    uint32_t heads_[LEVELS * SLOTS];
+    size_t levelCounts_[LEVELS];
+    uint64_t occupied_[LEVELS][WORDS];  // one bit per non-empty slot
+};
+
+template <typename Callback>
+void TimerWheel::advance(uint64_t nowNs, Callback&& onExpired) {
+    uint64_t targetTick = nowNs / tickNs_;
+
+    while (currentTick_ < targetTick) {
+        if (pending_ == 0) {
+            currentTick_ = targetTick;
+            break;
+        }
+
+        // Jump over ticks whose level-0 slots cannot hold anything
+        currentTick_ = skipTarget(targetTick);
+        if (currentTick_ >= targetTick) {
+            break;
+        }
+
+        uint32_t list = stepTick();
+        while (heads_[list] != NIL) {
+            uint32_t node = heads_[list];
+            uint64_t token = nodes_[node].token;
+            unlink(node);
+            release(node);
+            onExpired(token);
+        }
+    }
+
+    // Deadlines inside the next, partially elapsed tick fire as soon as the
+    // clock passes them rather than at the tick boundary. When that tick
+    // starts a slot of a coarser wheel, its timers are still in that slot:
+    // the wheel only cascades once the tick is reached.
+    uint64_t partialTick = currentTick_ + 1;
+    for (uint32_t level = 0; level < LEVELS; ++level) {
+        uint32_t shift = LEVEL_BITS * level;
+        if (level > 0 && (partialTick & ((1ULL << shift) - 1)) != 0) {
+            break;
+        }
+        fireDue(level * SLOTS + static_cast<uint32_t>((partialTick >> shift) & (SLOTS - 1)),
+                nowNs, onExpired);
+    }
+}
+
+template <typename Callback>
+void TimerWheel::fireDue(uint32_t list, uint64_t nowNs, Callback& onExpired) {
+    uint32_t node = heads_[list];
+    while (node != NIL) {
+        uint32_t next = nodes_[node].next;
+        if (nodes_[node].deadlineNs <= nowNs) {
+            uint64_t token = nodes_[node].token;
+            unlink(node);
+            release(node);
+            onExpired(token);
+            // The callback may have changed this list; restart from its head
+            next = heads_[list];
+        }
+        node = next;
+    }
+}
+
+#endif
@@ -3,16 +3,31 @@
 #include <fstream>
 #include <chrono>
 #include <algorithm>
+#include <iomanip>
+#include <sys/resource.h>
+#include "strategies/basic_strategy.h"
+#include "strategies/theo_strategy.h"
+#include "strategies/correlation_strategy.h"
+#include "strategies/theo_sweep_strategy.h"
+#include "engine/event_tape.h"
+#include "engine/prefetching_decoder.h"
+#include "engine/queue_book.h"
 
-FillSimulator::FillSimulator(const std::string& outputFilePath,
-                             uint64_t strategyMdLatencyNs,
-                             uint64_t exchangeLatencyNs,
-                             bool useQueueSimulation)
+template <typename StrategyT>
+FillSimulatorT<StrategyT>::FillSimulatorT(const std::string& outputFilePath,
+                                          uint64_t strategyMdLatencyNs,
+                                          uint64_t exchangeLatencyNs,
+                                          bool useQueueSimulation)
     : marketState_(),
+      topVersion_(0),
       strategy_(nullptr),
+      eventIndex_(0),
+      lastProcessedTopTs_(0),
+      activeOrders_(typename ActiveOrderMap::allocator_type(&memory_.activeOrders)),
       position_(0),
       cashFlow_(0),
       outputFilePath_(outputFilePath),
+      outputBuffer_(OUTPUT_BUFFER_BYTES),
       outputFile_(),
       totalOrdersPlaced_(0),
       totalOrdersFilled_(0),
@@ -22,43 +37,88 @@ FillSimulator::FillSimulator(const std::string& outputFilePath,
       totalSellProceeds_(0),
       strategyMdLatencyNs_(strategyMdLatencyNs),
       exchangeLatencyNs_(exchangeLatencyNs),
+      mdLatency_(strategyMdLatencyNs),
+      orderLatency_(exchangeLatencyNs),
+      fillLatency_(exchangeLatencyNs),
+      lastFillLatencyNs_(0),
+      liveBook_(nullptr),
       useQueueSimulation_(useQueueSimulation) {
     
+    marketState_.depth.bidCount = 0;
+    marketState_.depth.askCount = 0;
     marketState_.lastValidMidPrice = 0;
     
-    // Open output file
+    // Open output file, records going out in OUTPUT_BUFFER_BYTES writes
+    outputFile_.rdbuf()->pubsetbuf(outputBuffer_.data(), outputBuffer_.size());
     outputFile_.open(outputFilePath_, std::ios::binary | std::ios::trunc);
     if (!outputFile_.is_open()) {
         throw std::runtime_error("Failed to open output file: " + outputFilePath_);
     }
 }
 
-FillSimulator::~FillSimulator() {
+template <typename StrategyT>
+FillSimulatorT<StrategyT>::~FillSimulatorT() {
     if (outputFile_.is_open()) {
         outputFile_.close();
     }
 }
 
 // Set the strategy to use for processing book tops and fills
-void FillSimulator::setStrategy(std::shared_ptr<Strategy> strategy) {
+template <typename StrategyT>
+void FillSimulatorT<StrategyT>::setStrategy(std::shared_ptr<StrategyT> strategy) {
     strategy_ = strategy;
+    strategy_->setTimerService(&timers_);
+    strategy_->setDepthHistory(marketState_.depthHistory.capacity() > 0 ? &marketState_.depthHistory : nullptr);
+}
+
+template <typename StrategyT>
+void FillSimulatorT<StrategyT>::setLatencyModel(const LatencyModel* model) {
+    if (model == nullptr) {
+        mdLatency_ = LatencySampler(strategyMdLatencyNs_);
+        orderLatency_ = LatencySampler(exchangeLatencyNs_);
+        fillLatency_ = LatencySampler(exchangeLatencyNs_);
+        return;
+    }
+    // Strategies rely on market data times never going backwards; orders
+    // and notifications are stamped, not queued, so their draws stand alone
+    mdLatency_ = LatencySampler(model->marketData, model->seed, LatencySampler::MARKET_DATA_STREAM, true);
+    orderLatency_ = LatencySampler(model->orderEntry, model->seed, LatencySampler::ORDER_ENTRY_STREAM, false);
+    fillLatency_ = LatencySampler(model->fillNotification, model->seed, LatencySampler::FILL_NOTIFICATION_STREAM,
+                                  false);
+}
+
+template <typename StrategyT>
+void FillSimulatorT<StrategyT>::setDepthHistory(size_t prices) {
+    marketState_.depthHistory.reset(prices);
+    if (strategy_) {
+        strategy_->setDepthHistory(prices > 0 ? &marketState_.depthHistory : nullptr);
+    }
 }
 
 // Helper methods to apply latency
-uint64_t FillSimulator::applyMdLatency(uint64_t timestamp) const {
-    return timestamp + strategyMdLatencyNs_;
+template <typename StrategyT>
+uint64_t FillSimulatorT<StrategyT>::applyMdLatency(uint64_t timestamp) {
+    return mdLatency_.delay(timestamp);
+}
+
+template <typename StrategyT>
+uint64_t FillSimulatorT<StrategyT>::applyOrderLatency(uint64_t timestamp) {
+    return orderLatency_.delay(timestamp);
 }
 
-uint64_t FillSimulator::applyExchangeLatency(uint64_t timestamp) const {
-    return timestamp + exchangeLatencyNs_;
+template <typename StrategyT>
+uint64_t FillSimulatorT<StrategyT>::applyFillLatency(uint64_t timestamp) {
+    uint64_t notificationTime = fillLatency_.delay(timestamp);
+    lastFillLatencyNs_ = notificationTime - timestamp;
+    return notificationTime;
 }
 
 // Process a book top update
-void FillSimulator::processBookTop(const book_top_t& bookTop) {
-    static uint64_t lastProcessedTime = 0;
+template <typename StrategyT>
+void FillSimulatorT<StrategyT>::processBookTop(const book_top_t& bookTop) {
     static const uint64_t MIN_PROCESSING_INTERVAL = 100000;
     
-    if (lastProcessedTime > 0 && (bookTop.ts - lastProcessedTime) < MIN_PROCESSING_INTERVAL) {
+    if (lastProcessedTopTs_ > 0 && (bookTop.ts - lastProcessedTopTs_) < MIN_PROCESSING_INTERVAL) {
         return;
     }
     
@@ -74,68 +134,164 @@ void FillSimulator::processBookTop(const book_top_t& bookTop) {
         return;
     }
     
-    lastProcessedTime = bookTop.ts;
-    marketState_.lastBookTop = bookTop;
-    
-    int64_t midPrice = (bookTop.top_level.bid_nanos + bookTop.top_level.ask_nanos) / 2;
-    marketState_.lastValidMidPrice = midPrice;
-            
-    // Update bid levels
-    marketState_.bidLevels[bookTop.top_level.bid_nanos] = bookTop.top_level.bid_qty;
-    marketState_.bidLevels[bookTop.second_level.bid_nanos] = bookTop.second_level.bid_qty;
-    marketState_.bidLevels[bookTop.third_level.bid_nanos] = bookTop.third_level.bid_qty;
-    
-    // Update ask levels
-    marketState_.askLevels[bookTop.top_level.ask_nanos] = bookTop.top_level.ask_qty;
-    marketState_.askLevels[bookTop.second_level.ask_nanos] = bookTop.second_level.ask_qty;
-    marketState_.askLevels[bookTop.third_level.ask_nanos] = bookTop.third_level.ask_qty;
+    lastProcessedTopTs_ = bookTop.ts;
     
     // Create a copy of bookTop with adjusted timestamp
     book_top_t delayedBookTop = bookTop;
     delayedBookTop.ts = applyMdLatency(bookTop.ts);
 
-    latencyStats_.totalMdEvents++;
-    latencyStats_.totalMdToStrategyLatencyNs += strategyMdLatencyNs_;
+    // Batching strategies get the top later, together with its neighbours.
+    // Not in a queue run: an order crossing at a top walks the live book,
+    // which would have moved on by the time the batch is delivered.
+    if (strategy_->batchesBookTops() && liveBook_ == nullptr) {
+        pendingTops_.push_back(delayedBookTop);
+        pendingMarketTs_.push_back(bookTop.ts);
+        pendingEventIndices_.push_back(eventIndex_);
+        if (pendingTops_.size() >= MAX_PENDING_TOPS) {
+            flushBookTops();
+        }
+        return;
+    }
+
+    applyBookTop(bookTop, delayedBookTop.ts - bookTop.ts);
+
+    // Expired strategy timers fire before the strategy sees the new top
+    fireTimers(delayedBookTop.ts, bookTop);
 
     auto actions = strategy_->onBookTopUpdate(delayedBookTop);
+    dispatchActions(actions, delayedBookTop.ts, bookTop);
+
+    checkRestingOrders(bookTop);
+}
+
+// Hand buffered book tops to a batching strategy. Tops go to the strategy
+// in runs between order-relevant moments: a run never extends past a top at
+// which a timer is due or a resting order would fill, and the strategy ends
+// it at the first top that produces actions. Everything the simulator does
+// per top therefore happens in the same order as without batching.
+template <typename StrategyT>
+void FillSimulatorT<StrategyT>::flushBookTops() {
+    // Records are reported against the event each top came from
+    const uint64_t currentEventIndex = eventIndex_;
     
-    // Process each action
-    for (const auto& action : actions) {
-        // Apply exchange latency to the action
-        uint64_t exchangeReceiveTime = applyExchangeLatency(delayedBookTop.ts);
-        OrderAction delayedAction = action;
+    size_t next = 0;
+    while (next < pendingTops_.size()) {
+        book_top_t firstTop = pendingTops_[next];
+        firstTop.ts = pendingMarketTs_[next];
+        eventIndex_ = pendingEventIndices_[next];
         
-        if (delayedAction.sent_ts == 0) {
-            delayedAction.sent_ts = delayedBookTop.ts;
+        applyBookTop(firstTop, pendingTops_[next].ts - firstTop.ts);
+        fireTimers(pendingTops_[next].ts, firstTop);
+        
+        // Resting orders and timers only change through strategy actions, so
+        // these bounds hold until the end of the run
+        int64_t highestBid = 0;
+        int64_t lowestAsk = INT64_MAX;
+        for (const auto& entry : activeOrders_) {
+            const OrderInfo& order = entry.second;
+            if (order.price <= 0 || order.quantity == order.filledQuantity) {
+                continue;
+            }
+            if (order.isBid) {
+                highestBid = std::max(highestBid, order.price);
+            } else {
+                lowestAsk = std::min(lowestAsk, order.price);
+            }
         }
-        delayedAction.md_ts = exchangeReceiveTime;
+        uint64_t nextDeadline = timers_.nextDeadline();
+        
+        auto fillsAt = [&](const book_top_t& top) {
+            int64_t bestBid = top.top_level.bid_nanos;
+            int64_t bestAsk = top.top_level.ask_nanos;
+            return (bestAsk > 0 && bestAsk != INT64_MAX && highestBid >= bestAsk) ||
+                   (bestBid > 0 && bestBid != INT64_MAX && lowestAsk <= bestBid);
+        };
+        
+        size_t end = next + 1;
+        if (!fillsAt(firstTop)) {
+            while (end < pendingTops_.size() &&
+                   pendingTops_[end].ts < nextDeadline && !fillsAt(pendingTops_[end])) {
+                end++;
+            }
+        }
+        
+        batchActions_.clear();
+        size_t consumed = strategy_->onBookTopBatch(
+            Span<const book_top_t>(pendingTops_.data() + next, end - next), batchActions_);
+        consumed = std::min(std::max<size_t>(consumed, 1), end - next);
+        
+        book_top_t lastTop = firstTop;
+        for (size_t i = next + 1; i < next + consumed; ++i) {
+            lastTop = pendingTops_[i];
+            lastTop.ts = pendingMarketTs_[i];
+            applyBookTop(lastTop, pendingTops_[i].ts - lastTop.ts);
+        }
+        
+        eventIndex_ = pendingEventIndices_[next + consumed - 1];
+        dispatchActions(batchActions_, pendingTops_[next + consumed - 1].ts, lastTop);
+        checkRestingOrders(lastTop);
         
-        latencyStats_.totalStrategyToExchangeLatencyNs += exchangeLatencyNs_;
+        next += consumed;
+    }
+    pendingTops_.clear();
+    pendingMarketTs_.clear();
+    pendingEventIndices_.clear();
+    eventIndex_ = currentEventIndex;
+}
 
-        processAction(delayedAction, bookTop);
+// Record a book top that reaches the strategy in the market state
+template <typename StrategyT>
+void FillSimulatorT<StrategyT>::applyBookTop(const book_top_t& bookTop, uint64_t mdLatencyNs) {
+    marketState_.lastBookTop = bookTop;
+    topVersion_++;
+    
+    int64_t midPrice = (bookTop.top_level.bid_nanos + bookTop.top_level.ask_nanos) / 2;
+    marketState_.lastValidMidPrice = midPrice;
+            
+    // Replace the depth view, and keep its levels in the history if the
+    // run has one
+    DepthView& depth = marketState_.depth;
+    depth.bidCount = 0;
+    depth.askCount = 0;
+    for (const book_top_level_t* level : {&bookTop.top_level, &bookTop.second_level, &bookTop.third_level}) {
+        if (level->bid_nanos > 0 && level->bid_nanos != INT64_MAX) {
+            depth.bids[depth.bidCount++] = {level->bid_nanos, level->bid_qty};
+        }
+        if (level->ask_nanos > 0 && level->ask_nanos != INT64_MAX) {
+            depth.asks[depth.askCount++] = {level->ask_nanos, level->ask_qty};
+        }
     }
+    if (marketState_.depthHistory.capacity() > 0) {
+        for (uint32_t i = 0; i < depth.bidCount; ++i) {
+            marketState_.depthHistory.record(true, depth.bids[i].priceNanos, depth.bids[i].qty, bookTop.ts);
+        }
+        for (uint32_t i = 0; i < depth.askCount; ++i) {
+            marketState_.depthHistory.record(false, depth.asks[i].priceNanos, depth.asks[i].qty, bookTop.ts);
+        }
+    }
+
+    latencyStats_.totalMdEvents++;
+    latencyStats_.totalMdToStrategyLatencyNs += mdLatencyNs;
+}
 
-    // Check if any existing orders would now be filled with the new market prices
+// Check if any existing orders would now be filled with the new market prices
+template <typename StrategyT>
+void FillSimulatorT<StrategyT>::checkRestingOrders(const book_top_t& bookTop) {
     for (auto it = activeOrders_.begin(); it != activeOrders_.end();) {
         OrderInfo& order = it->second;
         
-        if (wouldOrderBeFilled(order.orderId, order.isBid, order.price, order.quantity - order.filledQuantity)) {
-            int64_t fillPrice;
-            if (order.isBid) {
-                fillPrice = bookTop.top_level.ask_nanos;
-            } else {
-                fillPrice = bookTop.top_level.bid_nanos;
-            }
-            
-            uint32_t remainingQty = order.quantity - order.filledQuantity;
+        // An order takes the liquidity of a top once; what it left rests
+        // until the book moves
+        if (order.walkedTop != topVersion_ &&
+            wouldOrderBeFilled(order.orderId, order.isBid, order.price, order.quantity - order.filledQuantity)) {
             uint64_t orderId = order.orderId;
             
             auto nextIt = std::next(it);
             
             // Apply additional latency for the fill notification
-            uint64_t fillNotificationTime = applyExchangeLatency(order.md_ts);
+            uint64_t fillNotificationTime = applyFillLatency(order.md_ts);
             
-            processFill(orderId, fillPrice, remainingQty, order.isBid, fillNotificationTime);
+            fillAgainstBook(orderId, bookTop, fillNotificationTime);
             
             if (activeOrders_.find(orderId) == activeOrders_.end()) {
                 it = nextIt;
@@ -148,36 +304,110 @@ void FillSimulator::processBookTop(const book_top_t& bookTop) {
     }
 }
 
-// Process a book fill event
-void FillSimulator::processBookFill(const book_fill_snapshot_t& fill) {    
-    // Add MD latency to the fill timestamp
-    book_fill_snapshot_t delayedFill = fill;
-    delayedFill.ts = applyMdLatency(fill.ts);
+// Fill a crossing order against the opposite side of the book, level by
+// level from the best price out to its limit, each level at its own price
+// and for no more than it shows. The queue simulation walks its live book
+// in place when that book is at the top traded on; otherwise, and in tops
+// mode, the depth is the three levels of the top. What the levels within
+// the limit cannot fill rests. The strategy hears of every level's fill as
+// it happens and may cancel or replace the order on the way, which ends
+// the walk.
+template <typename StrategyT>
+void FillSimulatorT<StrategyT>::fillAgainstBook(uint64_t orderId, const book_top_t& bookTop,
+                                                uint64_t fillNotificationTime) {
+    auto orderIt = activeOrders_.find(orderId);
+    if (orderIt == activeOrders_.end()) {
+        return;
+    }
+    orderIt->second.walkedTop = topVersion_;
+    const bool isBid = orderIt->second.isBid;
+    const int64_t limit = orderIt->second.price;
+    const uint32_t quantity = orderIt->second.quantity;
 
-    latencyStats_.totalMdEvents++;
-    latencyStats_.totalMdToStrategyLatencyNs += strategyMdLatencyNs_;
-    
-    auto actions = strategy_->onFill(delayedFill);
-    
-    // Process any actions returned by the strategy
+    // Fill what the level offers; false once the order is done or changed
+    // or the level is past its limit
+    int64_t lastPrice = isBid ? 0 : INT64_MAX;
+    auto takeLevel = [&](int64_t price, uint32_t levelQty) {
+        if (price <= 0 || price == INT64_MAX || (isBid ? price > limit : price < limit) ||
+            (isBid ? price <= lastPrice : price >= lastPrice)) {
+            return false;
+        }
+        lastPrice = price;
+        auto it = activeOrders_.find(orderId);
+        if (it == activeOrders_.end() || it->second.price != limit || it->second.quantity != quantity ||
+            it->second.filledQuantity >= quantity) {
+            return false;
+        }
+        if (levelQty > 0) {
+            processFill(orderId, price, std::min(levelQty, quantity - it->second.filledQuantity), isBid,
+                        fillNotificationTime);
+        }
+        return true;
+    };
+
+    if (liveBook_ != nullptr && bookTop.seqno == liveBook_->top().seqno) {
+        liveBook_->forEachLevel(!isBid, takeLevel);
+        return;
+    }
+    for (const book_top_level_t* level : {&bookTop.top_level, &bookTop.second_level, &bookTop.third_level}) {
+        if (!(isBid ? takeLevel(level->ask_nanos, level->ask_qty) : takeLevel(level->bid_nanos, level->bid_qty))) {
+            return;
+        }
+    }
+}
+
+// Send strategy actions to the exchange, stamped with the strategy time
+// they were generated at
+template <typename StrategyT>
+void FillSimulatorT<StrategyT>::dispatchActions(const std::vector<OrderAction>& actions,
+                                                uint64_t strategyTs, const book_top_t& bookTop) {
     for (const auto& action : actions) {
-        // Apply exchange latency
-        uint64_t exchangeReceiveTime = applyExchangeLatency(delayedFill.ts);
-        
+        // Apply exchange latency to the action
+        uint64_t exchangeReceiveTime = applyOrderLatency(strategyTs);
         OrderAction delayedAction = action;
+        
         if (delayedAction.sent_ts == 0) {
-            delayedAction.sent_ts = delayedFill.ts;
+            delayedAction.sent_ts = strategyTs;
         }
         delayedAction.md_ts = exchangeReceiveTime;
         
-        latencyStats_.totalStrategyToExchangeLatencyNs += exchangeLatencyNs_;
+        latencyStats_.totalStrategyToExchangeLatencyNs += exchangeReceiveTime - strategyTs;
 
-        processAction(delayedAction, marketState_.lastBookTop);
+        processAction(delayedAction, bookTop);
+    }
+}
+
+// Process a book fill event
+template <typename StrategyT>
+void FillSimulatorT<StrategyT>::processBookFill(const book_fill_snapshot_t& fill) {    
+    // Buffered tops come first
+    if (!pendingTops_.empty()) {
+        flushBookTops();
     }
+    
+    // Add MD latency to the fill timestamp
+    book_fill_snapshot_t delayedFill = fill;
+    delayedFill.ts = applyMdLatency(fill.ts);
+
+    latencyStats_.totalMdEvents++;
+    latencyStats_.totalMdToStrategyLatencyNs += delayedFill.ts - fill.ts;
+    
+    auto actions = strategy_->onFill(delayedFill);
+    dispatchActions(actions, delayedFill.ts, marketState_.lastBookTop);
+}
+
+// Deliver strategy timers that expired by the given strategy time
+template <typename StrategyT>
+void FillSimulatorT<StrategyT>::fireTimers(uint64_t strategyTs, const book_top_t& bookTop) {
+    timers_.advance(strategyTs, [&](uint64_t token) {
+        auto actions = strategy_->onTimer(token, strategyTs);
+        dispatchActions(actions, strategyTs, bookTop);
+    });
 }
 
 // Check if an order would be filled based on current market state
-bool FillSimulator::wouldOrderBeFilled(uint64_t /* orderId */, bool isBid, int64_t price, uint32_t quantity) {
+template <typename StrategyT>
+bool FillSimulatorT<StrategyT>::wouldOrderBeFilled(uint64_t /* orderId */, bool isBid, int64_t price, uint32_t quantity) {
     // Validate inputs
     if (price <= 0 || quantity == 0) {
         return false;
@@ -204,7 +434,8 @@ bool FillSimulator::wouldOrderBeFilled(uint64_t /* orderId */, bool isBid, int64
 }
 
 // Process a fill event, updating position and cash flow
-void FillSimulator::processFill(uint64_t orderId, int64_t fillPrice, uint32_t fillQty, bool isBid, 
+template <typename StrategyT>
+void FillSimulatorT<StrategyT>::processFill(uint64_t orderId, int64_t fillPrice, uint32_t fillQty, bool isBid, 
                                 uint64_t fillNotificationTime) {
     // Check if the order exists
     auto orderIt = activeOrders_.find(orderId);
@@ -220,11 +451,11 @@ void FillSimulator::processFill(uint64_t orderId, int64_t fillPrice, uint32_t fi
     }
     
     if (fillNotificationTime == 0) {
-        fillNotificationTime = applyExchangeLatency(marketState_.lastBookTop.ts);
+        fillNotificationTime = applyFillLatency(marketState_.lastBookTop.ts);
     }
 
     if (fillNotificationTime > 0) {
-        latencyStats_.totalExchangeToNotificationLatencyNs += exchangeLatencyNs_;
+        latencyStats_.totalExchangeToNotificationLatencyNs += lastFillLatencyNs_;
     }
     
     // Copy needed values before potentially erasing the order
@@ -276,27 +507,15 @@ void FillSimulator::processFill(uint64_t orderId, int64_t fillPrice, uint32_t fi
     auto actions = strategy_->onOrderFilled(orderId, fillPrice, fillQty, isBid);
     
     // Process any additional actions from the strategy
-    for (const auto& action : actions) {
-        // Apply exchange latency
-        uint64_t exchangeReceiveTime = applyExchangeLatency(fillNotificationTime);
-        
-        OrderAction delayedAction = action;
-        if (delayedAction.sent_ts == 0) {
-            delayedAction.sent_ts = fillNotificationTime;
-        }
-        delayedAction.md_ts = exchangeReceiveTime;
-        
-        latencyStats_.totalStrategyToExchangeLatencyNs += exchangeLatencyNs_;
-
-        processAction(delayedAction, notificationBookTop);
-    }
+    dispatchActions(actions, fillNotificationTime, notificationBookTop);
 }
 
 // Process a single order action
-void FillSimulator::processAction(const OrderAction& action, const book_top_t& bookTop) {
+template <typename StrategyT>
+void FillSimulatorT<StrategyT>::processAction(const OrderAction& action, const book_top_t& bookTop) {
     if (action.type == OrderAction::Type::ADD || action.type == OrderAction::Type::REPLACE) {
         if (wouldOrderBeFilled(action.orderId, action.isBid, action.price, action.quantity)) {
-            latencyStats_.totalExchangeToNotificationLatencyNs += exchangeLatencyNs_;
+            latencyStats_.totalExchangeToNotificationLatencyNs += static_cast<uint64_t>(fillLatency_.meanNs());
         }
     }
     
@@ -348,17 +567,10 @@ void FillSimulator::processAction(const OrderAction& action, const book_top_t& b
                     cancelRecord.is_bid = action.isBid;
                     writeOrderRecord(cancelRecord);
                 } else {
-                    // For normal orders, process the fill as usual
-                    int64_t fillPrice;
-                    if (action.isBid) {
-                        fillPrice = bookTop.top_level.ask_nanos;
-                    } else {
-                        fillPrice = bookTop.top_level.bid_nanos;
-                    }
-                    
-                    uint64_t fillNotificationTime = applyExchangeLatency(action.md_ts);
+                    // For normal orders, take the liquidity up to the limit
+                    uint64_t fillNotificationTime = applyFillLatency(action.md_ts);
 
-                    processFill(action.orderId, fillPrice, action.quantity, action.isBid, fillNotificationTime);
+                    fillAgainstBook(action.orderId, bookTop, fillNotificationTime);
                 }
             }
             break;
@@ -445,17 +657,10 @@ void FillSimulator::processAction(const OrderAction& action, const book_top_t& b
                         postOnlyCancelRecord.is_bid = it->second.isBid;
                         writeOrderRecord(postOnlyCancelRecord);
                     } else {
-                        // For normal orders, process the fill as usual
-                        int64_t fillPrice;
-                        if (it->second.isBid) {
-                            fillPrice = bookTop.top_level.ask_nanos;
-                        } else {
-                            fillPrice = bookTop.top_level.bid_nanos;
-                        }
+                        // For normal orders, take the liquidity up to the limit
+                        uint64_t fillNotificationTime = applyFillLatency(action.md_ts);
                         
-                        uint64_t fillNotificationTime = applyExchangeLatency(action.md_ts);
-                        
-                        processFill(action.orderId, fillPrice, action.quantity, it->second.isBid, fillNotificationTime);
+                        fillAgainstBook(action.orderId, bookTop, fillNotificationTime);
                     }
                 }
             }
@@ -465,7 +670,8 @@ void FillSimulator::processAction(const OrderAction& action, const book_top_t& b
 }
 
 // Run the simulation with data from the specified files
-void FillSimulator::runSimulation(const std::string& topsFilePath, const std::string& fillsFilePath) {
+template <typename StrategyT>
+void FillSimulatorT<StrategyT>::runSimulation(const std::string& topsFilePath, const std::string& fillsFilePath) {
     // Open files
     std::ifstream topsFile(topsFilePath, std::ios::binary);
     std::ifstream fillsFile(fillsFilePath, std::ios::binary);
@@ -497,7 +703,16 @@ void FillSimulator::runSimulation(const std::string& topsFilePath, const std::st
     uint64_t processedTops = 0;
     uint64_t processedFills = 0;
     
+    uint64_t topsSize = inputFileSize(topsFilePath);
+    uint64_t fillsSize = inputFileSize(fillsFilePath);
+    ProgressMeter meter;
+    meter.start(progress_, strategyName(), topsSize + fillsSize,
+                hasMoreFills && (!hasMoreTops || bookFill.ts < bookTop.ts) ? bookFill.ts : bookTop.ts);
+    
+    if (replayProfile_) replayProfile_->begin();
+    
     while (hasMoreTops || hasMoreFills) {
+        eventIndex_ = processedTops + processedFills;
         if (!hasMoreFills || (hasMoreTops && bookTop.ts <= bookFill.ts)) {
             // Process book top
             processBookTop(bookTop);
@@ -516,23 +731,23 @@ void FillSimulator::runSimulation(const std::string& topsFilePath, const std::st
             hasMoreFills = fillsFile.gcount() == sizeof(book_fill_snapshot_t);
         }
         
-        // Print progress
-        if ((processedTops + processedFills) % 100000 == 0) {
-            std::cout << "Processed " << processedTops << " tops and " 
-                      << processedFills << " fills..." << std::endl;
-            std::cout << "Current fills: " << totalOrdersFilled_ << " of " 
-                      << totalOrdersPlaced_ << " orders" << std::endl;
-            
-            // Print current position and P&L
-            int64_t midPrice = (marketState_.lastBookTop.top_level.bid_nanos + 
-                               marketState_.lastBookTop.top_level.ask_nanos) / 2;
-            
-            int64_t positionValue = position_ * midPrice;
-            std::cout << "Current position: " << position_ << " shares, value: $" 
-                      << static_cast<double>(positionValue) / 1e9 << std::endl;
+        if (replayProfile_) replayProfile_->onEvent();
+        
+        if (meter.due()) {
+            flushBookTops();
+            sampleMemory(nullptr);
+            meter.update(progressSample(processedTops + processedFills,
+                                        inputBytesRead(topsFile, topsSize) + inputBytesRead(fillsFile, fillsSize),
+                                        nullptr));
         }
     }
     
+    flushBookTops();
+    sampleMemory(nullptr);
+    meter.finish(progressSample(processedTops + processedFills, topsSize + fillsSize, nullptr));
+    
+    if (replayProfile_) replayProfile_->end();
+    
     std::cout << "Simulation complete. Processed " << processedTops << " tops and " 
               << processedFills << " fills." << std::endl;
               
@@ -541,537 +756,175 @@ void FillSimulator::runSimulation(const std::string& topsFilePath, const std::st
     fillsFile.close();
 }
 
-void FillSimulator::runQueueSimulation(const std::string& bookEventsFilePath) {
-    // Open the book events file
-    std::ifstream bookEventsFile(bookEventsFilePath, std::ios::binary);
-    if (!bookEventsFile.is_open()) {
+template <typename StrategyT>
+void FillSimulatorT<StrategyT>::runQueueSimulation(const std::string& bookEventsFilePath) {
+    // Map the book events file; events are decoded in place
+    EventTape tape;
+    if (!tape.open(bookEventsFilePath)) {
         throw std::runtime_error("Failed to open book events file: " + bookEventsFilePath);
     }
     
-    // Read the header
-    book_events_file_hdr_t header;
-    bookEventsFile.read(reinterpret_cast<char*>(&header), sizeof(book_events_file_hdr_t));
-    
     // Set symbol ID in strategy
-    strategy_->setSymbolId(header.symbol_idx);
+    strategy_->setSymbolId(tape.header().symbol_idx);
     
-    // Initialize order book data structures
-    book_side_t bid_book;
-    book_side_t ask_book;
+    // Order book rebuilt from the events
+    QueueBook book(tickNanos_);
+    liveBook_ = &book;
     
-    // Map to quickly find orders
-    std::unordered_map<uint64_t, order_ref_t> order_map;
+    // Events are read ahead of the one applied, for the book to prefetch
+    // what they will touch
+    PrefetchingDecoder decoder(tape, book);
     
     // Process book events
     book_event_hdr_t eventHeader;
+    const char* payload;
+    book_fill_snapshot_t fill;
+    bool hasFill;
     uint64_t processedEvents = 0;
     
-    // Variables to track the current best bid/ask
-    book_top_t currentTop;
-    currentTop.ts = 0;
-    currentTop.seqno = 0;
-    currentTop.top_level.bid_nanos = 0;
-    currentTop.top_level.ask_nanos = INT64_MAX;
-    currentTop.top_level.bid_qty = 0;
-    currentTop.top_level.ask_qty = 0;
+    std::cout << "Starting queue simulation, processing book events from " << bookEventsFilePath << std::endl;
     
-    auto updateTopLevels = [&]() {
-        // Update best bid
-        if (!bid_book.empty()) {
-            auto bestBidIt = bid_book.rbegin();
-            currentTop.top_level.bid_nanos = bestBidIt->first;
-            currentTop.top_level.bid_qty = bestBidIt->second.first;
-            
-            // Try to populate second and third levels if they exist
-            auto secondBidIt = std::next(bestBidIt);
-            if (secondBidIt != bid_book.rend()) {
-                currentTop.second_level.bid_nanos = secondBidIt->first;
-                currentTop.second_level.bid_qty = secondBidIt->second.first;
-                
-                auto thirdBidIt = std::next(secondBidIt);
-                if (thirdBidIt != bid_book.rend()) {
-                    currentTop.third_level.bid_nanos = thirdBidIt->first;
-                    currentTop.third_level.bid_qty = thirdBidIt->second.first;
-                } else {
-                    currentTop.third_level.bid_nanos = 0;
-                    currentTop.third_level.bid_qty = 0;
-                }
-            } else {
-                currentTop.second_level.bid_nanos = 0;
-                currentTop.second_level.bid_qty = 0;
-                currentTop.third_level.bid_nanos = 0;
-                currentTop.third_level.bid_qty = 0;
-            }
-        } else {
-            currentTop.top_level.bid_nanos = 0;
-            currentTop.top_level.bid_qty = 0;
-            currentTop.second_level.bid_nanos = 0;
-            currentTop.second_level.bid_qty = 0;
-            currentTop.third_level.bid_nanos = 0;
-            currentTop.third_level.bid_qty = 0;
-        }
-        
-        // Update best ask
-        if (!ask_book.empty()) {
-            auto bestAskIt = ask_book.begin();
-            currentTop.top_level.ask_nanos = bestAskIt->first;
-            currentTop.top_level.ask_qty = bestAskIt->second.first;
-            
-            // Try to populate second and third levels if they exist
-            auto secondAskIt = std::next(bestAskIt);
-            if (secondAskIt != ask_book.end()) {
-                currentTop.second_level.ask_nanos = secondAskIt->first;
-                currentTop.second_level.ask_qty = secondAskIt->second.first;
-                
-                auto thirdAskIt = std::next(secondAskIt);
-                if (thirdAskIt != ask_book.end()) {
-                    currentTop.third_level.ask_nanos = thirdAskIt->first;
-                    currentTop.third_level.ask_qty = thirdAskIt->second.first;
-                } else {
-                    currentTop.third_level.ask_nanos = INT64_MAX;
-                    currentTop.third_level.ask_qty = 0;
-                }
-            } else {
-                currentTop.second_level.ask_nanos = INT64_MAX;
-                currentTop.second_level.ask_qty = 0;
-                currentTop.third_level.ask_nanos = INT64_MAX;
-                currentTop.third_level.ask_qty = 0;
-            }
-        } else {
-            currentTop.top_level.ask_nanos = INT64_MAX;
-            currentTop.top_level.ask_qty = 0;
-            currentTop.second_level.ask_nanos = INT64_MAX;
-            currentTop.second_level.ask_qty = 0;
-            currentTop.third_level.ask_nanos = INT64_MAX;
-            currentTop.third_level.ask_qty = 0;
-        }
-
-        const int64_t MAX_REASONABLE_PRICE = 10000LL * 1000000000LL; // $10,000 in nanos
+    // The first event's time for the market-time rate
+    uint64_t eventsSize = inputFileSize(bookEventsFilePath);
+    ProgressMeter meter;
+    meter.start(progress_, strategyName(), eventsSize, tape.atEnd() ? 0 : tape.peekTs());
     
-        // Validate bid prices
-        if (currentTop.top_level.bid_nanos > MAX_REASONABLE_PRICE) {
-            currentTop.top_level.bid_nanos = 0;
-            currentTop.top_level.bid_qty = 0;
-        }
-        
-        // Validate ask prices
-        if (currentTop.top_level.ask_nanos > MAX_REASONABLE_PRICE && 
-            currentTop.top_level.ask_nanos != INT64_MAX) {
-            currentTop.top_level.ask_nanos = INT64_MAX;
-            currentTop.top_level.ask_qty = 0;
-        }
-    };
-
-    std::cout << "Starting queue simulation, processing book events from " << bookEventsFilePath << std::endl;
+    if (replayProfile_) replayProfile_->begin();
     
-    while (bookEventsFile.read(reinterpret_cast<char*>(&eventHeader), sizeof(book_event_hdr_t))) {
-        // Update timestamp in the current top
-        currentTop.ts = eventHeader.ts;
-        currentTop.seqno = eventHeader.seq_no;
+    while (decoder.next(eventHeader, payload)) {
+        eventIndex_ = processedEvents;
+        bool topChanged = book.apply(eventHeader, payload, fill, hasFill);
         
-        bool topChanged = false;
-        
-        switch (eventHeader.type) {
-            case book_event_type_e::add_order: {
-                add_order_t addOrder;
-                bookEventsFile.read(reinterpret_cast<char*>(&addOrder), sizeof(add_order_t));
-                
-                // Add order to appropriate book side
-                book_side_t& book = addOrder.is_bid ? bid_book : ask_book;
-                price_t price = addOrder.price;
-                
-                // Create new level if it doesn't exist
-                if (book.find(price) == book.end()) {
-                    book[price] = std::make_pair(0, order_queue_t());
-                }
-                
-                // Add order to queue and update total quantity
-                auto& level = book[price];
-                level.first += addOrder.qty;
-                level.second.push_back({addOrder.order_id, addOrder.qty, eventHeader.ts});
-                
-                // Store reference to the order
-                order_ref_t ref = {
-                    price,
-                    addOrder.is_bid,
-                    std::prev(level.second.end())
-                };
-                order_map[addOrder.order_id] = ref;
-                
-                // Check if top of book changed
-                if (addOrder.is_bid && (bid_book.empty() || price >= bid_book.rbegin()->first)) {
-                    topChanged = true;
-                } else if (!addOrder.is_bid && (ask_book.empty() || price <= ask_book.begin()->first)) {
-                    topChanged = true;
-                }
-                break;
-            }
-            
-            case book_event_type_e::delete_order: {
-                delete_order_t deleteOrder;
-                bookEventsFile.read(reinterpret_cast<char*>(&deleteOrder), sizeof(delete_order_t));
-                
-                auto orderIt = order_map.find(deleteOrder.order_id);
-                if (orderIt != order_map.end()) {
-                    const auto& ref = orderIt->second;
-                    book_side_t& book = ref.is_bid ? bid_book : ask_book;
-                    auto levelIt = book.find(ref.price);
-                    
-                    if (levelIt != book.end()) {
-                        // Update the quantity at this price level
-                        levelIt->second.first -= ref.order_it->qty;
-                        
-                        // Check if we need to update top of book
-                        if ((ref.is_bid && ref.price == currentTop.top_level.bid_nanos) ||
-                            (!ref.is_bid && ref.price == currentTop.top_level.ask_nanos)) {
-                            topChanged = true;
-                        }
-                        
-                        // Remove the order from the queue
-                        levelIt->second.second.erase(ref.order_it);
-                        
-                        // If level is now empty, remove it
-                        if (levelIt->second.first == 0) {
-                            book.erase(levelIt);
-                        }
-                    }
-                    
-                    // Remove from order map
-                    order_map.erase(orderIt);
-                }
-                break;
-            }
-            
-            case book_event_type_e::replace_order: {
-                replace_order_t replaceOrder;
-                bookEventsFile.read(reinterpret_cast<char*>(&replaceOrder), sizeof(replace_order_t));
-                
-                // First, delete the original order
-                auto orderIt = order_map.find(replaceOrder.orig_order_id);
-                if (orderIt != order_map.end()) {
-                    const auto& ref = orderIt->second;
-                    book_side_t& book = ref.is_bid ? bid_book : ask_book;
-                    auto levelIt = book.find(ref.price);
-                    
-                    if (levelIt != book.end()) {
-                        // Update the quantity at this price level
-                        levelIt->second.first -= ref.order_it->qty;
-                        
-                        // Check if we need to update top of book
-                        if ((ref.is_bid && ref.price == currentTop.top_level.bid_nanos) ||
-                            (!ref.is_bid && ref.price == currentTop.top_level.ask_nanos)) {
-                            topChanged = true;
-                        }
-                        
-                        // Remove the order from the queue
-                        levelIt->second.second.erase(ref.order_it);
-                        
-                        // If level is now empty, remove it
-                        if (levelIt->second.first == 0) {
-                            book.erase(levelIt);
-                        }
-                    }
-                    
-                    // Remove from order map
-                    order_map.erase(orderIt);
-                }
-                
-                // Add the new order
-                bool isBid = (orderIt != order_map.end()) ? orderIt->second.is_bid : 
-                             (replaceOrder.price > 0);
-                
-                book_side_t& book = isBid ? bid_book : ask_book;
-                price_t price = replaceOrder.price;
-                
-                // Create new level if it doesn't exist
-                if (book.find(price) == book.end()) {
-                    book[price] = std::make_pair(0, order_queue_t());
-                }
-                
-                // Add order to queue and update total quantity
-                auto& level = book[price];
-                level.first += replaceOrder.qty;
-                level.second.push_back({replaceOrder.new_order_id, replaceOrder.qty, eventHeader.ts});
-                
-                // Store reference to the order
-                order_ref_t ref = {
-                    price,
-                    isBid,
-                    std::prev(level.second.end())
-                };
-                order_map[replaceOrder.new_order_id] = ref;
-                
-                // Check if top of book changed
-                if (isBid && (bid_book.empty() || price >= bid_book.rbegin()->first)) {
-                    topChanged = true;
-                } else if (!isBid && (ask_book.empty() || price <= ask_book.begin()->first)) {
-                    topChanged = true;
-                }
-                break;
-            }
-            
-            case book_event_type_e::amend_order: {
-                amend_order_t amendOrder;
-                bookEventsFile.read(reinterpret_cast<char*>(&amendOrder), sizeof(amend_order_t));
-                
-                auto orderIt = order_map.find(amendOrder.order_id);
-                if (orderIt != order_map.end()) {
-                    const auto& ref = orderIt->second;
-                    book_side_t& book = ref.is_bid ? bid_book : ask_book;
-                    auto levelIt = book.find(ref.price);
-                    
-                    if (levelIt != book.end()) {
-                        // Calculate the delta in qty
-                        uint32_t oldQty = ref.order_it->qty;
-                        uint32_t qtyDelta = amendOrder.new_qty - oldQty;
-                        
-                        // Update the order quantity
-                        ref.order_it->qty = amendOrder.new_qty;
-                        ref.order_it->timestamp = eventHeader.ts;
-                        
-                        // Update the level quantity
-                        levelIt->second.first += qtyDelta;
-                        
-                        // Check if this affects top of book
-                        if ((ref.is_bid && ref.price == currentTop.top_level.bid_nanos) ||
-                            (!ref.is_bid && ref.price == currentTop.top_level.ask_nanos)) {
-                            topChanged = true;
-                        }
-                    }
-                }
-                break;
-            }
-            
-            case book_event_type_e::reduce_order: {
-                reduce_order_t reduceOrder;
-                bookEventsFile.read(reinterpret_cast<char*>(&reduceOrder), sizeof(reduce_order_t));
-                
-                auto orderIt = order_map.find(reduceOrder.order_id);
-                if (orderIt != order_map.end()) {
-                    const auto& ref = orderIt->second;
-                    book_side_t& book = ref.is_bid ? bid_book : ask_book;
-                    auto levelIt = book.find(ref.price);
-                    
-                    if (levelIt != book.end()) {
-                        // Update the order quantity
-                        ref.order_it->qty -= reduceOrder.cxled_qty;
-                        ref.order_it->timestamp = eventHeader.ts;
-                        
-                        // Update the level quantity
-                        levelIt->second.first -= reduceOrder.cxled_qty;
-                        
-                        // If order is fully canceled, remove it
-                        if (ref.order_it->qty == 0) {
-                            levelIt->second.second.erase(ref.order_it);
-                            order_map.erase(orderIt);
-                            
-                            // If level is now empty, remove it
-                            if (levelIt->second.first == 0) {
-                                book.erase(levelIt);
-                            }
-                            
-                            // Check if top of book changed
-                            if ((ref.is_bid && ref.price == currentTop.top_level.bid_nanos) ||
-                                (!ref.is_bid && ref.price == currentTop.top_level.ask_nanos)) {
-                                topChanged = true;
-                            }
-                        }
-                    }
-                }
-                break;
-            }
-
-            case book_event_type_e::execute_order: {
-                execute_order_t executeOrder;
-                bookEventsFile.read(reinterpret_cast<char*>(&executeOrder), sizeof(execute_order_t));
-                
-                auto orderIt = order_map.find(executeOrder.order_id);
-                if (orderIt != order_map.end()) {
-                    const auto& ref = orderIt->second;
-                    book_side_t& book = ref.is_bid ? bid_book : ask_book;
-                    auto levelIt = book.find(ref.price);
-                    
-                    if (levelIt != book.end()) {
-                        // Get the order
-                        auto& order = *(ref.order_it);
-                        
-                        // Create a fill notification
-                        book_fill_snapshot_t fill;
-                        fill.ts = eventHeader.ts;
-                        fill.seq_no = eventHeader.seq_no;
-                        fill.resting_order_id = executeOrder.order_id;
-                        fill.was_hidden = false;
-                        fill.trade_price = ref.price;
-                        fill.trade_qty = executeOrder.traded_qty;
-                        fill.execution_id = executeOrder.execution_id;
-                        fill.resting_original_qty = order.qty;
-                        fill.resting_order_remaining_qty = order.qty - executeOrder.traded_qty;
-                        fill.resting_order_last_update_ts = order.timestamp;
-                        fill.resting_side_is_bid = ref.is_bid;
-                        fill.resting_side_price = ref.price;
-                        fill.resting_side_qty = levelIt->second.first;
-                        
-                        // Set opposing side info
-                        if (ref.is_bid) {
-                            fill.opposing_side_price = ask_book.empty() ? INT64_MAX : ask_book.begin()->first;
-                            fill.opposing_side_qty = ask_book.empty() ? 0 : ask_book.begin()->second.first;
-                        } else {
-                            fill.opposing_side_price = bid_book.empty() ? 0 : bid_book.rbegin()->first;
-                            fill.opposing_side_qty = bid_book.empty() ? 0 : bid_book.rbegin()->second.first;
-                        }
-                        
-                        // Update order quantity
-                        order.qty -= executeOrder.traded_qty;
-                        levelIt->second.first -= executeOrder.traded_qty;
-                        
-                        // Process the fill through our simulator
-                        processBookFill(fill);
-                        
-                        // If order is fully executed, remove it
-                        if (order.qty == 0) {
-                            levelIt->second.second.erase(ref.order_it);
-                            order_map.erase(orderIt);
-                            
-                            // If level is now empty, remove it
-                            if (levelIt->second.first == 0) {
-                                book.erase(levelIt);
-                            }
-                            
-                            // Check if top of book changed
-                            if ((ref.is_bid && ref.price == currentTop.top_level.bid_nanos) ||
-                                (!ref.is_bid && ref.price == currentTop.top_level.ask_nanos)) {
-                                topChanged = true;
-                            }
-                        }
-                    }
-                }
-                break;
-            }
-            
-            case book_event_type_e::execute_order_at_price: {
-                execute_order_at_price_t executeOrder;
-                bookEventsFile.read(reinterpret_cast<char*>(&executeOrder), sizeof(execute_order_at_price_t));
-                
-                auto orderIt = order_map.find(executeOrder.order_id);
-                if (orderIt != order_map.end()) {
-                    const auto& ref = orderIt->second;
-                    book_side_t& book = ref.is_bid ? bid_book : ask_book;
-                    auto levelIt = book.find(ref.price);
-                    
-                    if (levelIt != book.end()) {
-                        // Get the order
-                        auto& order = *(ref.order_it);
-                        
-                        // Create a fill notification using execution price
-                        book_fill_snapshot_t fill;
-                        fill.ts = eventHeader.ts;
-                        fill.seq_no = eventHeader.seq_no;
-                        fill.resting_order_id = executeOrder.order_id;
-                        fill.was_hidden = false;
-                        fill.trade_price = executeOrder.execution_price;
-                        fill.trade_qty = executeOrder.traded_qty;
-                        fill.execution_id = executeOrder.execution_id;
-                        fill.resting_original_qty = order.qty;
-                        fill.resting_order_remaining_qty = order.qty - executeOrder.traded_qty;
-                        fill.resting_order_last_update_ts = order.timestamp;
-                        fill.resting_side_is_bid = ref.is_bid;
-                        fill.resting_side_price = ref.price;
-                        fill.resting_side_qty = levelIt->second.first;
-                        
-                        // Set opposing side info
-                        if (ref.is_bid) {
-                            fill.opposing_side_price = ask_book.empty() ? INT64_MAX : ask_book.begin()->first;
-                            fill.opposing_side_qty = ask_book.empty() ? 0 : ask_book.begin()->second.first;
-                        } else {
-                            fill.opposing_side_price = bid_book.empty() ? 0 : bid_book.rbegin()->first;
-                            fill.opposing_side_qty = bid_book.empty() ? 0 : bid_book.rbegin()->second.first;
-                        }
-                        
-                        // Update order quantity
-                        order.qty -= executeOrder.traded_qty;
-                        levelIt->second.first -= executeOrder.traded_qty;
-                        
-                        // Process the fill through our simulator
-                        processBookFill(fill);
-                        
-                        // If order is fully executed, remove it
-                        if (order.qty == 0) {
-                            levelIt->second.second.erase(ref.order_it);
-                            order_map.erase(orderIt);
-                            
-                            // If level is now empty, remove it
-                            if (levelIt->second.first == 0) {
-                                book.erase(levelIt);
-                            }
-                            
-                            // Check if top of book changed
-                            if ((ref.is_bid && ref.price == currentTop.top_level.bid_nanos) ||
-                                (!ref.is_bid && ref.price == currentTop.top_level.ask_nanos)) {
-                                topChanged = true;
-                            }
-                        }
-                    }
-                }
-                break;
-            }
-                        
-            case book_event_type_e::clear_book: {
-                // Clear the entire book
-                bid_book.clear();
-                ask_book.clear();
-                order_map.clear();
-                topChanged = true;
-                break;
-            }
-            
-            default:
-                // Skip any other event types
-                break;
+        // Process the fill through our simulator
+        if (hasFill) {
+            processBookFill(fill);
         }
         
         // Update top of book if needed
         if (topChanged) {
-            updateTopLevels();
+            book.updateTopLevels();
         }
-
+        
         // Now process the updated book top through our strategy
+        const book_top_t& currentTop = book.top();
         processBookTop(currentTop);
         
         processedEvents++;
+        if (replayProfile_) replayProfile_->onEvent();
         
-        // Print progress
-        if (processedEvents % 100000 == 0) {
-            std::cout << "Processed " << processedEvents << " book events..." << std::endl;
-            std::cout << "Current book: Bid " << bid_book.size() << " levels, Ask " 
-                      << ask_book.size() << " levels, " << order_map.size() << " active orders" << std::endl;
-            std::cout << "Current fills: " << totalOrdersFilled_ << " of " 
-                      << totalOrdersPlaced_ << " orders" << std::endl;
-            
-            // Print current position and P&L if we have valid prices
-            if (currentTop.top_level.bid_nanos > 0 && currentTop.top_level.ask_nanos < INT64_MAX) {
-                int64_t midPrice = (currentTop.top_level.bid_nanos + currentTop.top_level.ask_nanos) / 2;
-                int64_t positionValue = position_ * midPrice;
-                std::cout << "Current position: " << position_ << " shares, value: $" 
-                          << static_cast<double>(positionValue) / 1e9 << std::endl;
-            }
+        if (meter.due()) {
+            flushBookTops();
+            sampleMemory(&book);
+            meter.update(progressSample(processedEvents, tape.bytesRead(), &book));
         }
     }
     
+    flushBookTops();
+    liveBook_ = nullptr;
+    sampleMemory(&book);
+    meter.finish(progressSample(processedEvents, eventsSize, &book));
+    
+    if (replayProfile_) replayProfile_->end();
+    
     std::cout << "Simulation complete. Processed " << processedEvents << " book events." << std::endl;
+}
+
+template <typename StrategyT>
+ProgressSample FillSimulatorT<StrategyT>::progressSample(uint64_t events, uint64_t bytesRead,
+                                                         const QueueBook* book) const {
+    ProgressSample sample;
+    sample.events = events;
+    sample.marketTs = marketState_.lastBookTop.ts;
+    sample.bytesRead = bytesRead;
+    if (book) {
+        sample.bookLevels = book->bidLevelCount() + book->askLevelCount();
+        sample.bookOrders = book->orderCount();
+    }
+    sample.ordersPlaced = totalOrdersPlaced_;
+    sample.ordersFilled = totalOrdersFilled_;
+    sample.position = position_;
+    return sample;
+}
+
+template <typename StrategyT>
+void FillSimulatorT<StrategyT>::sampleMemory(const QueueBook* book) {
+    // The book's own accounts are exact and keep their peaks
+    if (book != nullptr) {
+        memory_.bookLevels = book->levelMemory();
+        memory_.orderSlots = book->orderSlotMemory();
+        memory_.orderMap = book->orderMapMemory();
+    }
+    memory_.strategyState.sample(strategy_->memoryBytes());
+    memory_.timers.sample(timers_.memoryBytes());
+    memory_.batchBuffers.sample(vectorMemoryBytes(pendingTops_) + vectorMemoryBytes(pendingMarketTs_) +
+                                vectorMemoryBytes(pendingEventIndices_) + vectorMemoryBytes(batchActions_));
+    memory_.depthHistory.sample(marketState_.depthHistory.memoryBytes());
+    memory_.outputBuffer.sample(outputBuffer_.capacity());
+}
+
+// Current (end of run) and peak heap per subsystem. Allocator-counted
+// subsystems are exact; the others are estimates sampled at each progress
+// update and at the end of the run.
+template <typename StrategyT>
+void FillSimulatorT<StrategyT>::printMemoryReport() const {
+    struct Row {
+        const char* name;
+        const MemoryAccount& account;
+        bool queueOnly;
+    };
+    const Row rows[] = {
+        {"Book levels", memory_.bookLevels, true},
+        {"Order slots", memory_.orderSlots, true},
+        {"Order map", memory_.orderMap, true},
+        {"Active orders", memory_.activeOrders, false},
+        {"Strategy state", memory_.strategyState, false},
+        {"Timers", memory_.timers, false},
+        {"Batch buffers", memory_.batchBuffers, false},
+        {"Depth history", memory_.depthHistory, false},
+        {"Output buffer", memory_.outputBuffer, false},
+    };
+    
+    auto kb = [](size_t bytes) { return static_cast<double>(bytes) / 1024.0; };
     
-    // Close file
-    bookEventsFile.close();
+    std::cout << "\n=========== MEMORY USAGE (KB) ===========\n";
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << std::left << std::setw(20) << "Subsystem" << std::right
+              << std::setw(12) << "End" << std::setw(12) << "Peak" << std::endl;
+    size_t peakSum = 0;
+    for (const Row& row : rows) {
+        if (row.queueOnly && !useQueueSimulation_) {
+            continue;
+        }
+        std::cout << std::left << std::setw(20) << row.name << std::right
+                  << std::setw(12) << kb(row.account.bytes()) << std::setw(12) << kb(row.account.peak()) << std::endl;
+        peakSum += row.account.peak();
+    }
+    std::cout << std::left << std::setw(32) << "Sum of peaks" << std::right << std::setw(12) << kb(peakSum) << std::endl;
+    
+    // ru_maxrss is in KB on Linux
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        std::cout << std::left << std::setw(32) << "Process peak RSS" << std::right
+                  << std::setw(12) << usage.ru_maxrss << std::endl;
+    }
+    std::cout.copyfmt(std::ios(nullptr));
+    std::cout << "=========================================\n";
 }
 
 // Write an order record to the output file
-void FillSimulator::writeOrderRecord(const OrderRecord& record) {
+template <typename StrategyT>
+void FillSimulatorT<StrategyT>::writeOrderRecord(const OrderRecord& record) {
     if (outputFile_.is_open()) {
         outputFile_.write(reinterpret_cast<const char*>(&record), sizeof(OrderRecord));
     }
+    if (recordObserver_) {
+        recordObserver_->onRecord(recordStream_, eventIndex_, record, marketState_.lastBookTop);
+    }
 }
 
 // Calculate final P&L and statistics based on the simulation results
-void FillSimulator::calculateResults() {
+template <typename StrategyT>
+void FillSimulatorT<StrategyT>::calculateResults() {
     // Get final mid price
     int64_t finalMidPrice = marketState_.lastValidMidPrice;
 
@@ -1079,8 +932,7 @@ void FillSimulator::calculateResults() {
     int64_t closingValue = position_ * finalMidPrice;
     
     // Calculate P&L (cash flow + position value)
-    double totalPnL = static_cast<double>(cashFlow_) / 1e9 + 
-                     static_cast<double>(position_ * finalMidPrice) / 1e9;
+    double totalPnL = summary().pnl;
     
     std::cout << "\n========= LATENCY STATISTICS =========\n";
     // Calculate actual event counts for each type of latency
@@ -1112,14 +964,14 @@ void FillSimulator::calculateResults() {
     // Only calculate total if we have all three types of events
     if (mdEvents > 0 && strategyToExchangeEvents > 0 && exchangeToNotificationEvents > 0) {
         std::cout << "Average Total Round-Trip Latency: " 
-                << (strategyMdLatencyNs_ / 1000.0 + 
+                << ((latencyStats_.totalMdToStrategyLatencyNs / mdEvents) / 1000.0 + 
                     (strategyToExchangeEvents > 0 ? latencyStats_.totalStrategyToExchangeLatencyNs / strategyToExchangeEvents : 0) / 1000.0 + 
                     (exchangeToNotificationEvents > 0 ? latencyStats_.totalExchangeToNotificationLatencyNs / exchangeToNotificationEvents : 0) / 1000.0)
                 << " μs\n";
     }
 
     std::cout << "Expected Round-Trip Latency: " 
-            << (strategyMdLatencyNs_ + 2 * exchangeLatencyNs_) / 1000.0 
+            << (mdLatency_.meanNs() + orderLatency_.meanNs() + fillLatency_.meanNs()) / 1000.0 
             << " μs\n";
     std::cout << "======================================\n";
 
@@ -1159,4 +1011,60 @@ void FillSimulator::calculateResults() {
     }
     
     std::cout << "======================================\n";
-}
\ No newline at end of file
+    
+    printMemoryReport();
+}
+
+// Headline results, with the position marked at the last valid mid price
+template <typename StrategyT>
+SimulationSummary FillSimulatorT<StrategyT>::summary() const {
+    int64_t finalMidPrice = marketState_.lastValidMidPrice;
+    
+    SimulationSummary result;
+    result.ordersPlaced = totalOrdersPlaced_;
+    result.ordersFilled = totalOrdersFilled_;
+    result.position = position_;
+    result.pnl = static_cast<double>(cashFlow_) / 1e9 + 
+                 static_cast<double>(position_ * finalMidPrice) / 1e9;
+    return result;
+}
+
+// Built-in strategies get their own instantiation so that the per-event
+// strategy calls are bound at compile time; FillSimulatorT<Strategy> is the
+// virtual-dispatch path for any other strategy.
+template class FillSimulatorT<Strategy>;
+template class FillSimulatorT<BasicStrategy>;
+template class FillSimulatorT<TheoStrategy>;
+template class FillSimulatorT<CorrelationStrategy>;
+template class FillSimulatorT<TheoSweepLane>;
+
+template <typename StrategyT>
+static std::unique_ptr<SimulationRunner> bindSimulator(const std::shared_ptr<StrategyT>& strategy,
+                                                       const std::string& outputFilePath,
+                                                       uint64_t strategyMdLatencyNs,
+                                                       uint64_t exchangeLatencyNs,
+                                                       bool useQueueSimulation) {
+    auto simulator = std::make_unique<FillSimulatorT<StrategyT>>(
+        outputFilePath, strategyMdLatencyNs, exchangeLatencyNs, useQueueSimulation);
+    simulator->setStrategy(strategy);
+    return simulator;
+}
+
+// Create a simulator bound to the concrete type of a built-in strategy, or
+// the virtual-dispatch simulator for any other strategy
+std::unique_ptr<SimulationRunner> makeSimulationRunner(std::shared_ptr<Strategy> strategy,
+                                                       const std::string& outputFilePath,
+                                                       uint64_t strategyMdLatencyNs,
+                                                       uint64_t exchangeLatencyNs,
+                                                       bool useQueueSimulation) {
+    if (auto basic = std::dynamic_pointer_cast<BasicStrategy>(strategy)) {
+        return bindSimulator(basic, outputFilePath, strategyMdLatencyNs, exchangeLatencyNs, useQueueSimulation);
+    }
+    if (auto theo = std::dynamic_pointer_cast<TheoStrategy>(strategy)) {
+        return bindSimulator(theo, outputFilePath, strategyMdLatencyNs, exchangeLatencyNs, useQueueSimulation);
+    }
+    if (auto correlation = std::dynamic_pointer_cast<CorrelationStrategy>(strategy)) {
+        return bindSimulator(correlation, outputFilePath, strategyMdLatencyNs, exchangeLatencyNs, useQueueSimulation);
+    }
+    return bindSimulator(strategy, outputFilePath, strategyMdLatencyNs, exchangeLatencyNs, useQueueSimulation);
+}
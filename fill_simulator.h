@@ -2,34 +2,152 @@
 #define FILL_SIMULATOR_H
 
 #include <string>
-#include <map>
 #include <unordered_map>
 #include <memory>
 #include <vector>
-#include <list>
 #include <fstream>
 #include "types/market_data_types.h"
 #include "strategies/strategy.h"
+#include "engine/timer_wheel.h"
+#include "engine/replay_profile.h"
+#include "engine/memory_account.h"
+#include "engine/progress_meter.h"
+#include "engine/latency_model.h"
+#include "engine/depth_history.h"
 
-class FillSimulator {
+class QueueBook;
+
+// Headline results of a simulation run
+struct SimulationSummary {
+    uint64_t ordersPlaced = 0;
+    uint64_t ordersFilled = 0;
+    int64_t position = 0;
+    double pnl = 0;
+};
+
+// Record of an order event, as written to the output file
+struct OrderRecord {
+    uint64_t timestamp;
+    uint8_t event_type; // 1=add, 2=cancel, 3=fill, 4=replace
+    uint64_t order_id;
+    uint32_t symbol_id;
+    int64_t price;
+    int64_t old_price;
+    uint32_t quantity;
+    uint32_t old_quantity;
+    bool is_bid;
+
+    OrderRecord() : timestamp(0), event_type(0), order_id(0), symbol_id(0),
+                price(0), old_price(0), quantity(0), old_quantity(0), is_bid(false) {}
+};
+
+// Sees every order record a simulator writes, with the index of the input
+// event being processed and the book top the simulator last applied. A
+// runner with several output files (sweep lanes) reports each as its own
+// stream.
+class RecordObserver {
+public:
+    virtual ~RecordObserver() = default;
+    virtual void onRecord(size_t stream, uint64_t eventIndex, const OrderRecord& record,
+                          const book_top_t& bookTop) = 0;
+};
+
+// Type-erased handle for launching a simulation without knowing which
+// strategy type the simulator was instantiated for
+class SimulationRunner {
+public:
+    virtual ~SimulationRunner() = default;
+    
+    virtual void runSimulation(const std::string& topsFilePath, const std::string& fillsFilePath) = 0;
+    virtual void runQueueSimulation(const std::string& bookEventsFilePath) = 0;
+    
+    virtual void calculateResults() = 0;
+    
+    virtual std::string strategyName() const = 0;
+    
+    // Headline results, one per output stream
+    virtual std::vector<SimulationSummary> summaries() const = 0;
+    
+    // Time the replay loop into the given profile (nullptr to stop)
+    void setReplayProfile(ReplayProfile* profile) { replayProfile_ = profile; }
+    
+    // Report every order record to the observer (nullptr to stop); streams
+    // are numbered from firstStream
+    virtual void setRecordObserver(RecordObserver* observer, size_t firstStream = 0) {
+        recordObserver_ = observer;
+        recordStream_ = firstStream;
+    }
+    
+    // Interval and stats file of the live progress meter
+    virtual void setProgressOptions(const ProgressOptions& options) { progress_ = options; }
+    
+    // Tick size of the queue book's compact prices; 0 infers it from the
+    // book events
+    void setTickSize(int64_t tickNanos) { tickNanos_ = tickNanos; }
+    
+    // Draw every latency from model, which must outlive the runs; nullptr
+    // keeps the fixed latencies the runner was built with
+    virtual void setLatencyModel(const LatencyModel* model) = 0;
+    
+    // Keep the last quantity at up to prices book prices for the strategy
+    // to read; 0 keeps none
+    virtual void setDepthHistory(size_t prices) = 0;
+
+protected:
+    ReplayProfile* replayProfile_ = nullptr;
+    ProgressOptions progress_;
+    int64_t tickNanos_ = 0;
+    RecordObserver* recordObserver_ = nullptr;
+    size_t recordStream_ = 0;
+};
+
+// Fill simulator bound to a strategy type at compile time. With a final
+// strategy class every per-event strategy call is resolved statically;
+// FillSimulatorT<Strategy> keeps virtual dispatch for external strategies.
+template <typename StrategyT>
+class FillSimulatorT : public SimulationRunner {
 public:
-    FillSimulator(const std::string& outputFilePath, 
-                  uint64_t strategyMdLatencyNs = 1000,
-                  uint64_t exchangeLatencyNs = 10000,
-                  bool useQueueSimulation = false);
-    ~FillSimulator();
+    FillSimulatorT(const std::string& outputFilePath, 
+                   uint64_t strategyMdLatencyNs = 1000,
+                   uint64_t exchangeLatencyNs = 10000,
+                   bool useQueueSimulation = false);
+    ~FillSimulatorT() override;
     
-    void setStrategy(std::shared_ptr<Strategy> strategy);
+    void setStrategy(std::shared_ptr<StrategyT> strategy);
     
     void processBookTop(const book_top_t& bookTop);
     void processBookFill(const book_fill_snapshot_t& fill);
     
-    void runSimulation(const std::string& topsFilePath, const std::string& fillsFilePath);
-    void runQueueSimulation(const std::string& bookEventsFilePath);
+    // Deliver book tops buffered for a batching strategy; the run loops call
+    // this before reporting progress and at the end of the input
+    void flushBookTops();
+    
+    void runSimulation(const std::string& topsFilePath, const std::string& fillsFilePath) override;
+    void runQueueSimulation(const std::string& bookEventsFilePath) override;
 
-    void calculateResults();
+    void calculateResults() override;
+    SimulationSummary summary() const;
+    std::vector<SimulationSummary> summaries() const override { return {summary()}; }
+    
+    std::string strategyName() const override { return strategy_->getName(); }
+    
+    // Each leg draws from its own stream of the model's seed
+    void setLatencyModel(const LatencyModel* model) override;
+    
+    void setDepthHistory(size_t prices) override;
+    
+    // Index of the input event being processed, as reported to a record
+    // observer; set by the run loops, or by a driver that feeds events in
+    void setEventIndex(uint64_t eventIndex) { eventIndex_ = eventIndex; }
+    
+    // Queue book of a replay fed in by a driver, which crossing orders walk
+    // as runQueueSimulation's own book; nullptr once the replay is over
+    void setLiveBook(const QueueBook* book) { liveBook_ = book; }
     
 private:
+    // Microbenchmarks (bench/) time the private fill check and record writer
+    friend struct FillSimulatorBench;
+
     bool wouldOrderBeFilled(uint64_t orderId, bool isBid, int64_t price, uint32_t quantity);
 
     void processFill(uint64_t orderId, int64_t fillPrice, uint32_t fillQty, bool isBid, 
@@ -37,54 +155,107 @@ private:
     
     void processAction(const OrderAction& action, const book_top_t& bookTop);
     
+    void dispatchActions(const std::vector<OrderAction>& actions, uint64_t strategyTs,
+                         const book_top_t& bookTop);
+    
+    void applyBookTop(const book_top_t& bookTop, uint64_t mdLatencyNs);
+    void checkRestingOrders(const book_top_t& bookTop);
+    
+    // Fill a crossing order level by level against the opposite side of the
+    // book, from the best price out to the order's limit
+    void fillAgainstBook(uint64_t orderId, const book_top_t& bookTop, uint64_t fillNotificationTime);
+    
+    // Deliver strategy timers that expired by the given strategy time
+    void fireTimers(uint64_t strategyTs, const book_top_t& bookTop);
+    
+    // Take a memory sample of the subsystems without a counting allocator,
+    // and of the queue book when there is one
+    void sampleMemory(const QueueBook* book);
+    void printMemoryReport() const;
+    
+    // Progress meter sample of the run so far
+    ProgressSample progressSample(uint64_t events, uint64_t bytesRead, const QueueBook* book) const;
+    
+    // Levels of the last book top applied, best first, empty levels left
+    // out; replaced whole by every top
+    struct DepthView {
+        static constexpr size_t LEVELS = 3;
+        struct Level {
+            int64_t priceNanos;
+            uint32_t qty;
+        };
+        Level bids[LEVELS];
+        Level asks[LEVELS];
+        uint32_t bidCount;
+        uint32_t askCount;
+    };
+    
     // Track market state
     struct MarketState {
         book_top_t lastBookTop;
-        std::map<int64_t, uint32_t> bidLevels;
-        std::map<int64_t, uint32_t> askLevels;
+        DepthView depth;
+        DepthHistory depthHistory;      // sized by setDepthHistory(), empty by default
         int64_t lastValidMidPrice;
     };
 
-    // Track order information
+    // Track order information. Prices stay in nanos: strategies quote off
+    // the feed's tick grid.
     struct OrderInfo {
         uint64_t orderId;
-        uint32_t symbolId;
         uint64_t sent_ts;
         uint64_t md_ts;
         int64_t price;
+        uint32_t symbolId;
         uint32_t quantity;
         uint32_t filledQuantity;
+        uint64_t walkedTop;     // topVersion_ at which the order last walked the book
         bool isBid;
         bool isPostOnly;
         
-        OrderInfo() : orderId(0), symbolId(0), sent_ts(0), md_ts(0), price(0), 
-                    quantity(0), filledQuantity(0), isBid(false), isPostOnly(true) {}
+        OrderInfo() : orderId(0), sent_ts(0), md_ts(0), price(0), symbolId(0),
+                    quantity(0), filledQuantity(0), walkedTop(0), isBid(false), isPostOnly(true) {}
     };
 
-    struct OrderRecord {
-        uint64_t timestamp;
-        uint8_t event_type; // 1=add, 2=cancel, 3=fill, 4=replace
-        uint64_t order_id;
-        uint32_t symbol_id;
-        int64_t price;
-        int64_t old_price;
-        uint32_t quantity;
-        uint32_t old_quantity;
-        bool is_bid;
-    
-        OrderRecord() : timestamp(0), event_type(0), order_id(0), symbol_id(0),
-                    price(0), quantity(0), is_bid(false) {}
+    void writeOrderRecord(const OrderRecord& record);
+
+    // Heap held per subsystem, with high-water marks
+    struct MemoryReport {
+        MemoryAccount bookLevels;       // queue mode: price levels
+        MemoryAccount orderSlots;       // queue mode: orders queued at the levels
+        MemoryAccount orderMap;         // queue mode: order id index
+        MemoryAccount activeOrders;     // simulated orders, counted by their allocator
+        MemoryAccount strategyState;
+        MemoryAccount timers;
+        MemoryAccount batchBuffers;     // book tops and actions of a batching strategy
+        MemoryAccount depthHistory;
+        MemoryAccount outputBuffer;
     };
 
-    void writeOrderRecord(const OrderRecord& record);
+    using ActiveOrderMap = std::unordered_map<uint64_t, OrderInfo, std::hash<uint64_t>, std::equal_to<uint64_t>,
+                                              CountingAllocator<std::pair<const uint64_t, OrderInfo>>>;
 
     MarketState marketState_;
-    std::shared_ptr<Strategy> strategy_;
-    std::unordered_map<uint64_t, OrderInfo> activeOrders_;
+    uint64_t topVersion_;       // counts the book tops applied to the market state
+    MemoryReport memory_;
+    std::shared_ptr<StrategyT> strategy_;
+    uint64_t eventIndex_;
+    TimerWheel timers_;
+    uint64_t lastProcessedTopTs_;
+    
+    // Book tops (with strategy timestamps, and the market timestamps they
+    // were sent at) waiting for a batching strategy
+    static constexpr size_t MAX_PENDING_TOPS = 1024;
+    std::vector<book_top_t> pendingTops_;
+    std::vector<uint64_t> pendingMarketTs_;
+    std::vector<uint64_t> pendingEventIndices_;
+    std::vector<OrderAction> batchActions_;
+    ActiveOrderMap activeOrders_;
     
     int64_t position_;
     int64_t cashFlow_;
     std::string outputFilePath_;
+    static constexpr size_t OUTPUT_BUFFER_BYTES = 1 << 16;
+    std::vector<char> outputBuffer_;
     std::ofstream outputFile_;
     
     uint64_t totalOrdersPlaced_;
@@ -96,9 +267,16 @@ private:
 
     uint64_t strategyMdLatencyNs_;
     uint64_t exchangeLatencyNs_;
+    LatencySampler mdLatency_;
+    LatencySampler orderLatency_;
+    LatencySampler fillLatency_;
+    uint64_t lastFillLatencyNs_;
     
-    uint64_t applyMdLatency(uint64_t timestamp) const;
-    uint64_t applyExchangeLatency(uint64_t timestamp) const;
+    // Time at which market data reaches the strategy, an order the
+    // exchange, and a fill notification the strategy
+    uint64_t applyMdLatency(uint64_t timestamp);
+    uint64_t applyOrderLatency(uint64_t timestamp);
+    uint64_t applyFillLatency(uint64_t timestamp);
 
     struct LatencyStats {
         uint64_t totalMdEvents = 0;
@@ -109,28 +287,32 @@ private:
     
     LatencyStats latencyStats_;
 
+    // Book of the queue simulation while it runs, for the depth of fills
+    const QueueBook* liveBook_;
+
     bool useQueueSimulation_;
+};
 
-    using price_t = int64_t;
-    using qty_t = uint32_t;
+// Virtual-dispatch simulator for strategies not known at compile time
+using FillSimulator = FillSimulatorT<Strategy>;
 
-    struct order_t {
-        uint64_t order_id;
-        qty_t qty;
-        uint64_t timestamp;
-    };
+class BasicStrategy;
+class TheoStrategy;
+class CorrelationStrategy;
+class TheoSweepLane;
 
-    // Using a list for the queue of orders at each price level
-    using order_queue_t = std::list<order_t>;
-    using level_t = std::pair<qty_t, order_queue_t>;
-    using book_side_t = std::map<price_t, level_t>;
+extern template class FillSimulatorT<Strategy>;
+extern template class FillSimulatorT<BasicStrategy>;
+extern template class FillSimulatorT<TheoStrategy>;
+extern template class FillSimulatorT<CorrelationStrategy>;
+extern template class FillSimulatorT<TheoSweepLane>;
 
-    // Order reference to quickly locate orders in the book
-    struct order_ref_t {
-        price_t price;
-        bool is_bid;
-        order_queue_t::iterator order_it;
-    };
-};
+// Create a simulator for the given strategy, bound at compile time to its
+// concrete type when it is one of the built-in strategies
+std::unique_ptr<SimulationRunner> makeSimulationRunner(std::shared_ptr<Strategy> strategy,
+                                                       const std::string& outputFilePath,
+                                                       uint64_t strategyMdLatencyNs,
+                                                       uint64_t exchangeLatencyNs,
+                                                       bool useQueueSimulation);
 
 #endif
\ No newline at end of file
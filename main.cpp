@@ -2,21 +2,11 @@
 #include <string>
 #include <memory>
 #include <vector>
-#include <map>
 #include <sys/stat.h>
-#include <fstream>
-#include <sstream>
-#include <variant>
 #include "fill_simulator.h"
-#include "strategies/strategy.h"
-
-// Include TOML parser
-#include "externals/toml11/toml.hpp"
-
-// Include all strategy headers
-#include "strategies/basic_strategy.h"
-#include "strategies/theo_strategy.h"
-#include "strategies/correlation_strategy.h"
+#include "run_config.h"
+#include "run_verifier.h"
+#include "strategy_registry.h"
 
 // Helper function to check if file exists
 bool file_exists(const std::string& filename) {
@@ -24,278 +14,198 @@ bool file_exists(const std::string& filename) {
     return (stat(filename.c_str(), &buffer) == 0);
 }
 
-// Function to load configuration from TOML file
-std::map<std::string, std::variant<uint64_t, double, bool>> loadConfigFromToml(const std::string& configFilePath) {
-    std::map<std::string, std::variant<uint64_t, double, bool>> config;
-    
-    // Set default values
-    config["strategy_md_latency_ns"] = static_cast<uint64_t>(1000);  // 1µs
-    config["exchange_latency_ns"] = static_cast<uint64_t>(10000);  // 10µs
-    config["use_queue_simulation"] = false;
-    config["place_edge_percent"] = 0.1;
-    config["cancel_edge_percent"] = 0.05;
-    config["self_weight"] = 0.5;
+// Helper function to display available strategies
+void displayAvailableStrategies() {
+    std::cout << "\nAvailable Strategies:\n";
+    for (const auto& entry : strategyRegistry()) {
+        std::cout << entry.menuNumber << ". " << entry.description << "\n";
+    }
+}
 
-    if (!file_exists(configFilePath)) {
-        std::cerr << "Warning: Config file not found: " << configFilePath << std::endl;
-        std::cerr << "Using default values instead." << std::endl;
-        return config;
+void printUsage(const char* program) {
+    std::cerr << "Usage for tops/fills mode: " << program
+              << " [options] <book_tops_file> <book_fills_file> <output_file> <config_file>" << std::endl;
+    std::cerr << "Usage for queue simulation mode: " << program
+              << " [options] <book_events_file> <output_file> <config_file>" << std::endl;
+    std::cerr << "Options:" << std::endl;
+    std::cerr << "  --strategy <name>    Strategy to run instead of asking on stdin:";
+    for (const auto& entry : strategyRegistry()) {
+        std::cerr << " " << entry.name;
     }
+    std::cerr << std::endl;
+    std::cerr << "  --set <key>=<value>  Override a config key, e.g. --set place_edge_percent=0.02" << std::endl;
+    std::cerr << "  --verify             Also run the reference engine and stop at the first record or" << std::endl;
+    std::cerr << "                       final statistic where the optimized engine differs from it" << std::endl;
+}
+
+// Pick the strategy: by name from the config, or from the menu on stdin
+const StrategyEntry& chooseStrategy(const RunConfig& config) {
+    std::string choice = std::get<std::string>(config.at("strategy"));
     
-    try {
-        // Parse the TOML file
-        const auto data = toml::parse(configFilePath);
+    if (choice.empty()) {
+        // Display available strategies and get user choice
+        displayAvailableStrategies();
         
-        // Extract latency values
-        if (data.contains("latency")) {
-            const auto& latency = toml::find(data, "latency");
-            
-            if (latency.contains("strategy_md_latency_ns")) {
-                config["strategy_md_latency_ns"] = toml::find<uint64_t>(latency, "strategy_md_latency_ns");
-            }
-            
-            if (latency.contains("exchange_latency_ns")) {
-                config["exchange_latency_ns"] = toml::find<uint64_t>(latency, "exchange_latency_ns");
-            }
-        }
-
-        // Extract simulation settings
-        if (data.contains("simulation")) {
-            const auto& simulation = toml::find(data, "simulation");
-            
-            if (simulation.contains("use_queue_simulation")) {
-                config["use_queue_simulation"] = toml::find<bool>(simulation, "use_queue_simulation");
-            }
-        }
-
-        // Extract strategy parameters
-        if (data.contains("strategy")) {
-            const auto& strategy = toml::find(data, "strategy");
-            
-            if (strategy.contains("place_edge_percent")) {
-                config["place_edge_percent"] = toml::find<double>(strategy, "place_edge_percent");
-            }
-            
-            if (strategy.contains("cancel_edge_percent")) {
-                config["cancel_edge_percent"] = toml::find<double>(strategy, "cancel_edge_percent");
-            }
-            
-            if (strategy.contains("self_weight")) {
-                config["self_weight"] = toml::find<double>(strategy, "self_weight");
-            }
+        std::cout << "\nEnter the number of the strategy you want to use: ";
+        std::cin >> choice;
+        
+        // Validate input
+        if (std::cin.fail()) {
+            throw RunError(RUN_USAGE_ERROR, "No strategy given on stdin; set 'strategy' in the config or pass --strategy");
         }
-
-        std::cout << "Loaded configuration from: " << configFilePath << std::endl;
-        std::cout << "  Strategy MD Latency: " << std::get<uint64_t>(config["strategy_md_latency_ns"]) / 1000.0 << " µs" << std::endl;
-        std::cout << "  Exchange Latency: " << std::get<uint64_t>(config["exchange_latency_ns"]) / 1000.0 << " µs" << std::endl;
-        std::cout << "  Total round-trip latency: " 
-                  << (std::get<uint64_t>(config["strategy_md_latency_ns"]) + 2 * std::get<uint64_t>(config["exchange_latency_ns"])) / 1000.0 << " µs" << std::endl;
-        std::cout << "  Queue Simulation: " << (std::get<bool>(config["use_queue_simulation"]) ? "Enabled" : "Disabled") << std::endl;
-        std::cout << "  Place Edge Percent: " << std::get<double>(config["place_edge_percent"]) << "%" << std::endl;
-        std::cout << "  Cancel Edge Percent: " << std::get<double>(config["cancel_edge_percent"]) << "%" << std::endl;
-        std::cout << "  Self Weight: " << std::get<double>(config["self_weight"]) << std::endl;
-    }
-    catch (const std::exception& e) {
-        std::cerr << "Error loading TOML config file: " << e.what() << std::endl;
-        std::cerr << "Using default values instead." << std::endl;
     }
     
-    return config;
+    const StrategyEntry* entry = findStrategy(choice);
+    if (entry == nullptr) {
+        throw RunError(RUN_STRATEGY_ERROR, "Invalid strategy choice: " + choice);
+    }
+    return *entry;
 }
 
-// Function to create strategy based on user choice
-std::shared_ptr<Strategy> createStrategy(int choice, const std::map<std::string, std::variant<uint64_t, double, bool>>& config, int argc = 0, char* argv[] = nullptr) {
-    switch (choice) {
-        case 1:
-            return std::make_shared<BasicStrategy>();
-        case 2: {
-            // Extract TheoStrategy parameters from config
-            double placeEdgePercent = std::get<double>(config.at("place_edge_percent"));
-            double cancelEdgePercent = std::get<double>(config.at("cancel_edge_percent"));
-            
-            // Ensure cancel edge is less than place edge
-            if (cancelEdgePercent >= placeEdgePercent) {
-                std::cout << "Warning: Cancel edge must be less than place edge. Adjusting cancel edge to 80% of place edge." << std::endl;
-                cancelEdgePercent = placeEdgePercent * 0.8;
-            }
-            
-            std::cout << "Creating TheoStrategy with place_edge=" << placeEdgePercent 
-                      << "%, cancel_edge=" << cancelEdgePercent << "%" << std::endl;
-            
-            return std::make_shared<TheoStrategy>(placeEdgePercent, cancelEdgePercent);
-        }
-        case 3: {
-            // Extract CorrelationStrategy parameters from config
-            double placeEdgePercent = std::get<double>(config.at("place_edge_percent"));
-            double cancelEdgePercent = std::get<double>(config.at("cancel_edge_percent"));
-            double selfWeight = std::get<double>(config.at("self_weight"));
-            
-            // Ask for correlation CSV path
-            std::string correlationPath;
-            std::cout << "Enter path to correlation CSV file: ";
-            std::cin >> correlationPath;
-            
-            if (!file_exists(correlationPath)) {
-                std::cerr << "Warning: Correlation CSV file not found: " << correlationPath << std::endl;
-                std::cerr << "Using default path: /data/correlation_data/overall_correlations.csv" << std::endl;
-                correlationPath = "/data/correlation_data/overall_correlations.csv";
-            }
-            
-            // Use the topsFilePath or book_eventsFilePath from the main function
-            std::string dataPath = "";
-            if (argc >= 2 && argv != nullptr) {
-                dataPath = argv[1];
-            }
-            
-            std::cout << "Creating CorrelationStrategy with place_edge=" << placeEdgePercent
-                    << "%, cancel_edge=" << cancelEdgePercent 
-                    << "%, self_weight=" << selfWeight << std::endl;
-                    
-            return std::make_shared<CorrelationStrategy>(correlationPath, placeEdgePercent, 
-                                                    cancelEdgePercent, selfWeight, dataPath);
+int run(int argc, char* argv[]) {
+    // Split options from the positional arguments
+    std::vector<std::string> positional;
+    std::vector<std::string> overrides;
+    bool verify = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            printUsage(argv[0]);
+            return RUN_OK;
+        } else if (arg == "--verify") {
+            verify = true;
+        } else if ((arg == "--strategy" || arg == "--set") && i + 1 < argc) {
+            overrides.push_back(arg == "--strategy" ? "strategy=" + std::string(argv[++i]) : argv[++i]);
+        } else if (arg.rfind("--strategy=", 0) == 0) {
+            overrides.push_back(arg.substr(2));
+        } else if (arg.rfind("--set=", 0) == 0) {
+            overrides.push_back(arg.substr(6));
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cerr << "Error: Unknown option " << arg << std::endl;
+            printUsage(argv[0]);
+            return RUN_USAGE_ERROR;
+        } else {
+            positional.push_back(arg);
         }
-        default:
-            throw std::runtime_error("Invalid strategy choice");
     }
-}
-
-// Helper function to display available strategies
-void displayAvailableStrategies() {
-    std::cout << "\nAvailable Strategies:\n";
-    std::cout << "1. Basic Strategy - Simple strategy that places orders at the top of the book\n";
-    std::cout << "2. Theo Strategy - Advanced strategy that calculates theoretical value using a time-weighted EMA of trades and midpoints\n";
-    std::cout << "3. Correlation Strategy - Strategy that uses correlations between symbols to calculate theoretical prices\n";
-}
-
-int main(int argc, char* argv[]) {
-    // Load the config file first
-    std::string latencyConfigFilePath;
-    bool useQueueSimulation = false;
     
-    if (argc < 2) {
+    if (positional.empty()) {
         std::cerr << "Error: You must provide at least a config file path" << std::endl;
-        std::cerr << "Usage: " << argv[0] << " <config_file>" << std::endl;
-        return 1;
+        printUsage(argv[0]);
+        return RUN_USAGE_ERROR;
     }
     
-    latencyConfigFilePath = argv[argc-1];
-    
     // Load configuration and determine simulation mode
-    auto config = loadConfigFromToml(latencyConfigFilePath);
-    useQueueSimulation = std::get<bool>(config["use_queue_simulation"]);
-    uint64_t strategyMdLatencyNs = std::get<uint64_t>(config["strategy_md_latency_ns"]);
-    uint64_t exchangeLatencyNs = std::get<uint64_t>(config["exchange_latency_ns"]);
+    RunConfig config = loadConfigFromToml(positional.back());
+    for (const auto& assignment : overrides) {
+        applyConfigOverride(config, assignment);
+    }
+    printConfig(config);
+    
+    bool useQueueSimulation = std::get<bool>(config["use_queue_simulation"]);
     
     // Check if the correct number of arguments was provided
-    if ((useQueueSimulation && argc != 4) || (!useQueueSimulation && argc != 5)) {
-        if (useQueueSimulation) {
-            std::cerr << "Usage for queue simulation mode: " << argv[0] 
-                     << " <book_events_file> <output_file> <config_file>" << std::endl;
-        } else {
-            std::cerr << "Usage for tops/fills mode: " << argv[0] 
-                     << " <book_tops_file> <book_fills_file> <output_file> <config_file>" << std::endl;
-        }
-        return 1;
+    if ((useQueueSimulation && positional.size() != 3) || (!useQueueSimulation && positional.size() != 4)) {
+        printUsage(argv[0]);
+        return RUN_USAGE_ERROR;
     }
     
+    RunnerOptions options;
+    options.inputFilePath = positional[0];
+    options.outputFilePath = positional[positional.size() - 2];
+    options.strategyMdLatencyNs = std::get<uint64_t>(config["strategy_md_latency_ns"]);
+    options.exchangeLatencyNs = std::get<uint64_t>(config["exchange_latency_ns"]);
+    options.useQueueSimulation = useQueueSimulation;
+    options.interactive = std::get<std::string>(config["strategy"]).empty();
+    options.referenceEngine = false;
+    
+    // Check if input files exist
+    if (!file_exists(options.inputFilePath)) {
+        throw RunError(RUN_INPUT_ERROR, std::string(useQueueSimulation ? "Book events" : "Book tops") +
+                       " file does not exist: " + options.inputFilePath);
+    }
+    if (!useQueueSimulation && !file_exists(positional[1])) {
+        throw RunError(RUN_INPUT_ERROR, "Book fills file does not exist: " + positional[1]);
+    }
+    
+    // Create the fill simulator bound to the chosen strategy
+    const StrategyEntry& entry = chooseStrategy(config);
+    LatencyModel latency = latencyModelFromConfig(config);
+    std::unique_ptr<SimulationRunner> simulator;
+    std::unique_ptr<SimulationRunner> reference;
     try {
-        std::string outputFilePath;
-        
+        simulator = entry.createRunner(config, options);
+        if (verify) {
+            RunnerOptions referenceOptions = options;
+            referenceOptions.outputFilePath = referenceOutputPath(options.outputFilePath);
+            referenceOptions.referenceEngine = true;
+            reference = entry.createRunner(config, referenceOptions);
+        }
+    } catch (const RunError&) {
+        throw;
+    } catch (const std::exception& e) {
+        throw RunError(RUN_STRATEGY_ERROR, e.what());
+    }
+    
+    ProgressOptions progress;
+    progress.intervalMs = std::get<uint64_t>(config["progress_interval_ms"]);
+    progress.statsFilePath = std::get<std::string>(config["progress_stats_file"]);
+    int64_t tickNanos = static_cast<int64_t>(std::get<uint64_t>(config["tick_size_nanos"]));
+    size_t depthHistoryPrices = std::get<uint64_t>(config["depth_history_prices"]);
+    simulator->setProgressOptions(progress);
+    simulator->setTickSize(tickNanos);
+    simulator->setLatencyModel(&latency);
+    simulator->setDepthHistory(depthHistoryPrices);
+    if (reference) {
+        reference->setProgressOptions(progress);
+        reference->setTickSize(tickNanos);
+        reference->setLatencyModel(&latency);
+        reference->setDepthHistory(depthHistoryPrices);
+    }
+    
+    auto replay = [&](SimulationRunner& runner) {
         if (useQueueSimulation) {
-            std::string bookEventsFilePath = argv[1];
-            outputFilePath = argv[2];
-            
-            // Check if input file exists
-            if (!file_exists(bookEventsFilePath)) {
-                std::cerr << "Error: Book events file does not exist: " << bookEventsFilePath << std::endl;
-                return 1;
-            }
-            
-            // Create fill simulator with queue simulation
-            FillSimulator simulator(outputFilePath, strategyMdLatencyNs, exchangeLatencyNs, true);
-            
-            // Display available strategies and get user choice
-            displayAvailableStrategies();
-            
-            // Get user input for strategy choice
-            int strategyChoice;
-            std::cout << "\nEnter the number of the strategy you want to use: ";
-            std::cin >> strategyChoice;
-            
-            // Validate input
-            if (std::cin.fail()) {
-                std::cin.clear();
-                std::cin.ignore(10000, '\n');
-                throw std::runtime_error("Invalid input. Please enter a number.");
-            }
-            
-            // Create chosen strategy
-            auto strategy = createStrategy(strategyChoice, config, argc, argv);
-            
-            // Set strategy in simulator
-            simulator.setStrategy(strategy);
-            
             // Run simulation in queue mode
-            std::cout << "\nStarting simulation with '" << strategy->getName() << "' strategy in queue simulation mode..." << std::endl;
-            simulator.runQueueSimulation(bookEventsFilePath);
-
-            // Calculate results
-            simulator.calculateResults();
-            
+            std::cout << "\nStarting simulation with '" << runner.strategyName() << "' strategy in queue simulation mode..." << std::endl;
+            runner.runQueueSimulation(options.inputFilePath);
         } else {
-            std::string topsFilePath = argv[1];
-            std::string fillsFilePath = argv[2];
-            outputFilePath = argv[3];
-            
-            // Check if input files exist
-            if (!file_exists(topsFilePath)) {
-                std::cerr << "Error: Book tops file does not exist: " << topsFilePath << std::endl;
-                return 1;
-            }
-            
-            if (!file_exists(fillsFilePath)) {
-                std::cerr << "Error: Book fills file does not exist: " << fillsFilePath << std::endl;
-                return 1;
-            }
-            
-            // Create fill simulator without queue simulation
-            FillSimulator simulator(outputFilePath, strategyMdLatencyNs, exchangeLatencyNs, false);
-            
-            // Display available strategies and get user choice
-            displayAvailableStrategies();
-            
-            // Get user input for strategy choice
-            int strategyChoice;
-            std::cout << "\nEnter the number of the strategy you want to use: ";
-            std::cin >> strategyChoice;
-            
-            // Validate input
-            if (std::cin.fail()) {
-                std::cin.clear();
-                std::cin.ignore(10000, '\n');
-                throw std::runtime_error("Invalid input. Please enter a number.");
-            }
-            
-            // Create chosen strategy
-            auto strategy = createStrategy(strategyChoice, config);
-            
-            // Set strategy in simulator
-            simulator.setStrategy(strategy);
-            
             // Run simulation in standard mode
-            std::cout << "\nStarting simulation with '" << strategy->getName() << "' strategy..." << std::endl;
-            simulator.runSimulation(topsFilePath, fillsFilePath);
-            
-            // Calculate results
-            simulator.calculateResults();
+            std::cout << "\nStarting simulation with '" << runner.strategyName() << "' strategy..." << std::endl;
+            runner.runSimulation(options.inputFilePath, positional[1]);
+        }
+    };
+    
+    try {
+        if (verify) {
+            uint64_t records = verifyRuns(*reference, *simulator, replay);
+            std::cout << "\nVerification passed: " << records << " order records and the final statistics "
+                      << "match the reference engine" << std::endl;
+        } else {
+            replay(*simulator);
         }
         
-        std::cout << "\nSimulation completed successfully." << std::endl;
+        // Calculate results
+        simulator->calculateResults();
+    } catch (const VerifyDivergence& e) {
+        throw RunError(RUN_VERIFY_FAILED, std::string("Verification failed: ") + e.what());
+    } catch (const std::exception& e) {
+        throw RunError(RUN_SIMULATION_ERROR, e.what());
+    }
+    
+    std::cout << "\nSimulation completed successfully." << std::endl;
+    return RUN_OK;
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        return run(argc, argv);
+    }
+    catch (const RunError& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return e.status();
     }
     catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
-        return 1;
+        return RUN_SIMULATION_ERROR;
     }
-    
-    return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,769 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+#include "fill_simulator.h"
+#include "run_config.h"
+#include "strategy_registry.h"
+#include "engine/replay_profile.h"
+#include "tools/synthetic_market.h"
+
+// End-to-end throughput regression harness.
+//
+// Replays a fixed synthetic dataset through every strategy in tops/fills and
+// in queue mode, one child process per run, and records events/sec, ns/event
+// quantiles, peak RSS growth and output bytes in a JSON results file. Given a
+// baseline results file, every metric is checked against it with a relative
+// tolerance and any regression fails the run.
+//
+// The numbers are meant to travel between hosts. A round of a fixed
+// calibration workload is timed before every run, and the time metrics of a
+// baseline are scaled by how much faster or slower the session's best round
+// ran than the best round of the session that recorded it. The spread of the
+// rounds measures how noisy the host is; when the median round is more than
+// --max-noise slower than the best one, time metrics cannot be trusted to
+// the tolerances. They are then reported without being checked, and a
+// session that finds no regression in the rest ends inconclusive rather than
+// passing; a baseline is not recorded from such a session either.
+//
+// A run's memory is what its child process grew by beyond the pages it
+// shares with the harness at fork, so the harness's own footprint and
+// allocator do not count.
+//
+// When a change moves the numbers on purpose, re-record the baseline with
+// `make perf-baseline` on an otherwise idle machine and commit
+// perf/baseline.json together with the change.
+
+namespace {
+
+enum PerfStatus { PERF_OK = 0, PERF_REGRESSION = 1, PERF_ERROR = 2, PERF_INCONCLUSIVE = 3 };
+
+struct RunMetrics {
+    double events = 0;
+    double seconds = 0;
+    double eventsPerSec = 0;
+    double nsPerEventP50 = 0;
+    double nsPerEventP90 = 0;
+    double nsPerEventP99 = 0;
+    double peakRssGrowthKb = 0;
+    double outputBytes = 0;
+};
+
+// How a metric may move before it counts as a regression
+enum class Direction { HIGHER_IS_BETTER, LOWER_IS_BETTER, EXACT };
+
+// How a metric follows the speed of the host
+enum class Scaling { NONE, TIME, RATE };
+
+struct MetricInfo {
+    const char* name;
+    double RunMetrics::*field;
+    Direction direction;
+    Scaling scaling;
+    double defaultTolerance;    // relative
+    double slack;               // absolute change that never counts
+};
+
+const std::vector<MetricInfo>& metrics() {
+    static const std::vector<MetricInfo> list = {
+        {"events", &RunMetrics::events, Direction::EXACT, Scaling::NONE, 0.0, 0},
+        {"seconds", &RunMetrics::seconds, Direction::LOWER_IS_BETTER, Scaling::TIME, -1, 0},
+        {"events_per_sec", &RunMetrics::eventsPerSec, Direction::HIGHER_IS_BETTER, Scaling::RATE, 0.25, 0},
+        {"ns_per_event_p50", &RunMetrics::nsPerEventP50, Direction::LOWER_IS_BETTER, Scaling::TIME, 0.30, 0},
+        {"ns_per_event_p90", &RunMetrics::nsPerEventP90, Direction::LOWER_IS_BETTER, Scaling::TIME, 0.40, 0},
+        {"ns_per_event_p99", &RunMetrics::nsPerEventP99, Direction::LOWER_IS_BETTER, Scaling::TIME, -1, 0},
+        {"peak_rss_growth_kb", &RunMetrics::peakRssGrowthKb, Direction::LOWER_IS_BETTER, Scaling::NONE, 0.25, 1024},
+        {"output_bytes", &RunMetrics::outputBytes, Direction::EXACT, Scaling::NONE, 0.0, 0},
+    };
+    return list;
+}
+
+struct DatasetInfo {
+    uint32_t symbols = 5;
+    uint64_t eventsPerSymbol = 2000000;
+    uint64_t seed = 20240102;
+};
+
+struct Options {
+    std::string dataDir = "build/perf_data";
+    std::string resultsPath = "build/perf_results.json";
+    std::string baselinePath;
+    bool updateBaseline = false;
+    int repeat = 3;
+    std::string filter;
+    std::map<std::string, double> tolerances;   // overrides
+    double maxNoise = 0.15;
+    DatasetInfo dataset;
+};
+
+// Calibration rounds of a session
+struct Calibration {
+    std::vector<double> rounds;     // ns per operation
+
+    double best() const { return rounds.empty() ? 0 : *std::min_element(rounds.begin(), rounds.end()); }
+
+    // How much slower the median round ran than the best one
+    double noise() const {
+        if (rounds.empty()) return 0;
+        std::vector<double> sorted = rounds;
+        std::sort(sorted.begin(), sorted.end());
+        return sorted[sorted.size() / 2] / sorted.front() - 1;
+    }
+};
+
+// ---------------------------------------------------------------------------
+// Minimal JSON: objects, strings and numbers, which is all the results file
+// uses
+
+struct JsonValue {
+    double number = 0;
+    std::string string;
+    std::map<std::string, JsonValue> object;
+    bool isObject = false;
+
+    const JsonValue* find(const std::string& key) const {
+        auto it = object.find(key);
+        return it == object.end() ? nullptr : &it->second;
+    }
+};
+
+class JsonReader {
+public:
+    explicit JsonReader(const std::string& text) : text_(text), pos_(0) {}
+
+    JsonValue parse() {
+        JsonValue value = parseValue();
+        skipSpace();
+        if (pos_ != text_.size()) fail("trailing characters");
+        return value;
+    }
+
+private:
+    JsonValue parseValue() {
+        skipSpace();
+        JsonValue value;
+        if (pos_ >= text_.size()) fail("unexpected end");
+        if (text_[pos_] == '{') {
+            value.isObject = true;
+            pos_++;
+            skipSpace();
+            if (peek() == '}') {
+                pos_++;
+                return value;
+            }
+            while (true) {
+                skipSpace();
+                std::string key = parseString();
+                skipSpace();
+                expect(':');
+                value.object[key] = parseValue();
+                skipSpace();
+                if (peek() == ',') {
+                    pos_++;
+                    continue;
+                }
+                expect('}');
+                return value;
+            }
+        }
+        if (text_[pos_] == '"') {
+            value.string = parseString();
+            return value;
+        }
+        const char* start = text_.c_str() + pos_;
+        char* end = nullptr;
+        value.number = std::strtod(start, &end);
+        if (end == start) fail("expected a value");
+        pos_ += end - start;
+        return value;
+    }
+
+    std::string parseString() {
+        expect('"');
+        std::string result;
+        while (pos_ < text_.size() && text_[pos_] != '"') {
+            if (text_[pos_] == '\\' && pos_ + 1 < text_.size()) pos_++;
+            result += text_[pos_++];
+        }
+        expect('"');
+        return result;
+    }
+
+    void skipSpace() {
+        while (pos_ < text_.size() && std::isspace(static_cast<unsigned char>(text_[pos_]))) pos_++;
+    }
+    char peek() const { return pos_ < text_.size() ? text_[pos_] : '\0'; }
+    void expect(char c) {
+        if (peek() != c) fail(std::string("expected '") + c + "'");
+        pos_++;
+    }
+    [[noreturn]] void fail(const std::string& what) const {
+        throw std::runtime_error("JSON parse error at offset " + std::to_string(pos_) + ": " + what);
+    }
+
+    const std::string& text_;
+    size_t pos_;
+};
+
+std::string formatNumber(double value) {
+    char buffer[64];
+    if (value == std::floor(value) && std::fabs(value) < 1e15) {
+        std::snprintf(buffer, sizeof(buffer), "%.0f", value);
+    } else {
+        std::snprintf(buffer, sizeof(buffer), "%.6g", value);
+    }
+    return buffer;
+}
+
+// ---------------------------------------------------------------------------
+// Calibration
+
+// Time of a fixed workload mixing ordered-map level updates and hashed order
+// lookups, the replay's main costs, in ns per operation. Independent of the
+// simulator's code, so a regression there cannot hide in the scaling.
+double calibrationPassNsPerOp() {
+    constexpr uint64_t OPERATIONS = 200000;
+    std::map<uint32_t, uint64_t> levels;
+    std::unordered_map<uint64_t, uint32_t> orders;
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+    uint64_t checksum = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < OPERATIONS; ++i) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        uint32_t price = static_cast<uint32_t>(state % 4096);
+        levels[price] += i;
+        if (levels.size() > 512) {
+            levels.erase(levels.begin());
+        }
+        orders[state & 0xFFFF] = price;
+        checksum += orders.count((state >> 20) & 0xFFFF);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    // Keep the work observable
+    if (checksum == UINT64_MAX) {
+        std::printf("%llu\n", static_cast<unsigned long long>(checksum));
+    }
+    return std::chrono::duration<double, std::nano>(elapsed).count() / OPERATIONS;
+}
+
+// One calibration round: the fastest of a few short passes, as a run is the
+// fastest of its repeats, so a moment of preemption does not count as noise
+double calibrationNsPerOp() {
+    constexpr int PASSES = 5;
+    double best = calibrationPassNsPerOp();
+    for (int i = 1; i < PASSES; ++i) {
+        best = std::min(best, calibrationPassNsPerOp());
+    }
+    return best;
+}
+
+// ---------------------------------------------------------------------------
+// Dataset and runs
+
+SyntheticMarketConfig marketConfig(const Options& options) {
+    SyntheticMarketConfig market;
+    market.outputDir = options.dataDir;
+    market.exchange = "PERF";
+    market.symbols = options.dataset.symbols;
+    market.eventsPerSymbol = options.dataset.eventsPerSymbol;
+    market.seed = options.dataset.seed;
+    return market;
+}
+
+void generateDataset(const SyntheticMarketConfig& market) {
+    mkdir(market.outputDir.c_str(), 0755);
+    for (uint32_t symbol = 0; symbol < market.symbols; ++symbol) {
+        generateSymbol(market, symbol);
+    }
+
+    // The first symbol is correlated to all the others
+    std::ofstream csv(market.outputDir + "/correlations.csv");
+    csv << "symbol1,symbol2,overall_correlation\n";
+    for (uint32_t symbol = 1; symbol < market.symbols; ++symbol) {
+        csv << SyntheticMarketConfig::symbolName(0) << "," << SyntheticMarketConfig::symbolName(symbol) << ","
+            << (symbol % 2 ? 0.8 : -0.4) / symbol << "\n";
+    }
+    std::ofstream map(market.outputDir + "/symbols.csv");
+    map << "stock_locate,symbol\n";
+    for (uint32_t symbol = 0; symbol < market.symbols; ++symbol) {
+        map << symbol + 1 << "," << SyntheticMarketConfig::symbolName(symbol) << "\n";
+    }
+    if (!csv || !map) {
+        throw std::runtime_error("Failed to write correlation inputs to " + market.outputDir);
+    }
+}
+
+struct RunCase {
+    std::string name;       // <mode>/<strategy>
+    std::string strategy;
+    bool queue;
+};
+
+std::vector<RunCase> runCases() {
+    std::vector<RunCase> cases;
+    for (bool queue : {false, true}) {
+        for (const auto& entry : strategyRegistry()) {
+            cases.push_back({std::string(queue ? "queue/" : "tops/") + entry.name, entry.name, queue});
+        }
+    }
+    return cases;
+}
+
+// What a child process reports back through its pipe
+struct ChildResult {
+    int ok;
+    double startRssKb;
+    double peakRssKb;
+    double events;
+    double seconds;
+    double p50;
+    double p90;
+    double p99;
+    char error[256];
+};
+
+// Resident set of this process now, in KB
+double residentKb() {
+    long pages = 0;
+    long resident = 0;
+    FILE* statm = std::fopen("/proc/self/statm", "r");
+    if (statm != nullptr) {
+        if (std::fscanf(statm, "%ld %ld", &pages, &resident) != 2) {
+            resident = 0;
+        }
+        std::fclose(statm);
+    }
+    return static_cast<double>(resident) * sysconf(_SC_PAGESIZE) / 1024;
+}
+
+// Runs in the child: replay the first symbol with the given strategy
+ChildResult replay(const SyntheticMarketConfig& market, const RunCase& run, const std::string& outputDir) {
+    ChildResult result;
+    std::memset(&result, 0, sizeof(result));
+    result.startRssKb = residentKb();
+
+    try {
+        std::string input = market.filePath(run.queue ? "book_events" : "book_tops", 0);
+
+        RunConfig config = defaultConfig();
+        config["strategy"] = run.strategy;
+        config["use_queue_simulation"] = run.queue;
+        config["correlation_csv"] = market.outputDir + "/correlations.csv";
+        config["symbol_map_csv"] = market.outputDir + "/symbols.csv";
+        config["place_edge_sweep"] = std::vector<double>{0.05, 0.1};
+        config["cancel_edge_sweep"] = std::vector<double>{0.02, 0.04};
+
+        RunnerOptions runnerOptions;
+        runnerOptions.inputFilePath = input;
+        runnerOptions.outputFilePath = outputDir + "/output.bin";
+        runnerOptions.strategyMdLatencyNs = std::get<uint64_t>(config["strategy_md_latency_ns"]);
+        runnerOptions.exchangeLatencyNs = std::get<uint64_t>(config["exchange_latency_ns"]);
+        runnerOptions.useQueueSimulation = run.queue;
+        runnerOptions.interactive = false;
+        runnerOptions.referenceEngine = false;
+
+        ReplayProfile profile;
+        {
+            std::unique_ptr<SimulationRunner> runner = findStrategy(run.strategy)->createRunner(config, runnerOptions);
+            runner->setReplayProfile(&profile);
+            if (run.queue) {
+                runner->runQueueSimulation(input);
+            } else {
+                runner->runSimulation(input, market.filePath("book_fills", 0));
+            }
+        }
+
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        result.peakRssKb = usage.ru_maxrss;
+
+        result.ok = 1;
+        result.events = profile.events();
+        result.seconds = profile.elapsedSec();
+        result.p50 = profile.nsPerEventQuantile(0.50);
+        result.p90 = profile.nsPerEventQuantile(0.90);
+        result.p99 = profile.nsPerEventQuantile(0.99);
+    }
+    catch (const std::exception& e) {
+        std::snprintf(result.error, sizeof(result.error), "%s", e.what());
+    }
+    return result;
+}
+
+// Total size of the regular files in a directory, removing them when asked
+uint64_t directoryBytes(const std::string& dir, bool remove) {
+    uint64_t total = 0;
+    DIR* handle = opendir(dir.c_str());
+    if (handle == nullptr) {
+        return 0;
+    }
+    while (dirent* entry = readdir(handle)) {
+        std::string path = dir + "/" + entry->d_name;
+        struct stat info;
+        if (stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode)) {
+            total += info.st_size;
+            if (remove) {
+                unlink(path.c_str());
+            }
+        }
+    }
+    closedir(handle);
+    return total;
+}
+
+// One run in a child process. The child starts with the harness's pages
+// mapped, which ru_maxrss counts, so the run's memory is its peak less what
+// it had at fork.
+RunMetrics runInChild(const SyntheticMarketConfig& market, const RunCase& run) {
+    std::string outputDir = market.outputDir + "/out_" + run.name.substr(0, run.name.find('/')) + "_" + run.strategy;
+    mkdir(outputDir.c_str(), 0755);
+    directoryBytes(outputDir, true);
+
+    int fds[2];
+    if (pipe(fds) != 0) {
+        throw std::runtime_error("pipe failed");
+    }
+    std::cout.flush();
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        throw std::runtime_error("fork failed");
+    }
+    if (pid == 0) {
+        // The simulator's progress output is not part of the report
+        int devNull = open("/dev/null", O_WRONLY);
+        dup2(devNull, STDOUT_FILENO);
+        dup2(devNull, STDERR_FILENO);
+        close(fds[0]);
+
+        ChildResult result = replay(market, run, outputDir);
+        std::cout.flush();
+        ssize_t written = write(fds[1], &result, sizeof(result));
+        _exit(written == sizeof(result) ? 0 : 1);
+    }
+
+    close(fds[1]);
+    ChildResult result;
+    ssize_t got = read(fds[0], &result, sizeof(result));
+    close(fds[0]);
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+
+    if (got != sizeof(result) || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        throw std::runtime_error(run.name + ": replay process failed");
+    }
+    if (!result.ok) {
+        throw std::runtime_error(run.name + ": " + result.error);
+    }
+
+    RunMetrics metrics;
+    metrics.events = result.events;
+    metrics.seconds = result.seconds;
+    metrics.eventsPerSec = result.seconds > 0 ? result.events / result.seconds : 0;
+    metrics.nsPerEventP50 = result.p50;
+    metrics.nsPerEventP90 = result.p90;
+    metrics.nsPerEventP99 = result.p99;
+    metrics.peakRssGrowthKb = std::max(0.0, result.peakRssKb - result.startRssKb);
+    metrics.outputBytes = directoryBytes(outputDir, false);
+    return metrics;
+}
+
+// ---------------------------------------------------------------------------
+// Results and baseline
+
+double toleranceFor(const MetricInfo& metric, const Options& options, const JsonValue* baseline) {
+    auto it = options.tolerances.find(metric.name);
+    if (it != options.tolerances.end()) {
+        return it->second;
+    }
+    if (baseline != nullptr) {
+        if (const JsonValue* tolerances = baseline->find("tolerances")) {
+            if (const JsonValue* value = tolerances->find(metric.name)) {
+                return value->number;
+            }
+        }
+    }
+    return metric.defaultTolerance;
+}
+
+void writeResults(const std::string& path, const Options& options, const JsonValue* baseline,
+                  const Calibration& calibration, const std::vector<std::pair<std::string, RunMetrics>>& results) {
+    std::ofstream out(path);
+    out << "{\n";
+    out << "  \"dataset\": {\"symbols\": " << options.dataset.symbols
+        << ", \"events_per_symbol\": " << options.dataset.eventsPerSymbol
+        << ", \"seed\": " << options.dataset.seed << "},\n";
+    out << "  \"calibration\": {\"ns_per_op\": " << formatNumber(calibration.best())
+        << ", \"noise\": " << formatNumber(calibration.noise()) << "},\n";
+
+    // Negative tolerances mark metrics that are recorded but not checked
+    out << "  \"tolerances\": {";
+    bool first = true;
+    for (const auto& metric : metrics()) {
+        double tolerance = toleranceFor(metric, options, baseline);
+        if (tolerance < 0) continue;
+        out << (first ? "" : ", ") << "\"" << metric.name << "\": " << formatNumber(tolerance);
+        first = false;
+    }
+    out << "},\n";
+
+    out << "  \"runs\": {\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        out << "    \"" << results[i].first << "\": {";
+        for (size_t m = 0; m < metrics().size(); ++m) {
+            const MetricInfo& metric = metrics()[m];
+            out << (m ? ", " : "") << "\"" << metric.name << "\": " << formatNumber(results[i].second.*metric.field);
+        }
+        out << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  }\n}\n";
+
+    if (!out) {
+        throw std::runtime_error("Failed to write " + path);
+    }
+}
+
+JsonValue readJsonFile(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("Failed to read " + path);
+    }
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    std::string text = buffer.str();
+    return JsonReader(text).parse();
+}
+
+// Check every run of the baseline; returns the number of regressions. Time
+// metrics of the baseline are first scaled to this session's calibration,
+// and only checked if the session was quiet enough.
+int compareWithBaseline(const JsonValue& baseline, const Options& options, const Calibration& calibration,
+                        const std::vector<std::pair<std::string, RunMetrics>>& results) {
+    const JsonValue* runs = baseline.find("runs");
+    if (runs == nullptr || !runs->isObject) {
+        throw std::runtime_error("Baseline has no runs");
+    }
+
+    double hostSlowdown = 1.0;
+    const JsonValue* baselineCalibration = baseline.find("calibration");
+    const JsonValue* baselineNs = baselineCalibration != nullptr ? baselineCalibration->find("ns_per_op") : nullptr;
+    if (baselineNs != nullptr && baselineNs->number > 0 && calibration.best() > 0) {
+        hostSlowdown = calibration.best() / baselineNs->number;
+    }
+    bool checkTimes = calibration.noise() <= options.maxNoise;
+    std::printf("\nCalibration %.2f ns/op (noise %.0f%%) against the baseline's %s: baseline times scaled by %.3f\n",
+                calibration.best(), calibration.noise() * 100,
+                baselineNs != nullptr ? formatNumber(baselineNs->number).c_str() : "(none)", hostSlowdown);
+    if (!checkTimes) {
+        std::printf("Host too noisy for the time tolerances (limit %.0f%%): time metrics are not checked\n",
+                    options.maxNoise * 100);
+    }
+
+    int regressions = 0;
+    std::printf("\n%-24s %-18s %14s %14s %9s %9s  %s\n", "run", "metric", "baseline", "current", "change", "limit", "");
+    for (const auto& [name, current] : results) {
+        const JsonValue* expected = runs->find(name);
+        if (expected == nullptr) {
+            std::printf("%-24s not in baseline\n", name.c_str());
+            continue;
+        }
+
+        for (const auto& metric : metrics()) {
+            double tolerance = toleranceFor(metric, options, &baseline);
+            const JsonValue* value = expected->find(metric.name);
+            if (tolerance < 0 || value == nullptr) continue;
+
+            double base = value->number;
+            if (metric.scaling == Scaling::TIME) {
+                base *= hostSlowdown;
+            } else if (metric.scaling == Scaling::RATE) {
+                base /= hostSlowdown;
+            }
+            double now = current.*metric.field;
+            double change = base != 0 ? (now - base) / base : (now == 0 ? 0 : INFINITY);
+            if (std::fabs(now - base) <= metric.slack) {
+                change = 0;
+            }
+
+            bool regressed = false;
+            switch (metric.direction) {
+                case Direction::HIGHER_IS_BETTER: regressed = change < -tolerance; break;
+                case Direction::LOWER_IS_BETTER: regressed = change > tolerance; break;
+                case Direction::EXACT: regressed = std::fabs(change) > tolerance; break;
+            }
+            bool checked = checkTimes || metric.scaling == Scaling::NONE;
+            regressions += checked && regressed;
+
+            std::printf("%-24s %-18s %14s %14s %+8.1f%% %8.1f%%  %s\n", name.c_str(), metric.name,
+                        formatNumber(base).c_str(), formatNumber(now).c_str(), change * 100, tolerance * 100,
+                        !checked ? "not checked" : regressed ? "REGRESSION" : "ok");
+        }
+    }
+    return regressions;
+}
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [options]" << std::endl;
+    std::cerr << "Options:" << std::endl;
+    std::cerr << "  --baseline <file>         Compare against a baseline results file" << std::endl;
+    std::cerr << "  --update-baseline         Write the results to the baseline file instead of comparing;" << std::endl;
+    std::cerr << "                            this is how the baseline is re-recorded (make perf-baseline)" << std::endl;
+    std::cerr << "  --results <file>          Results file (default build/perf_results.json)" << std::endl;
+    std::cerr << "  --data-dir <dir>          Dataset and output directory (default build/perf_data)" << std::endl;
+    std::cerr << "  --events <n>              Events per symbol (default 2000000)" << std::endl;
+    std::cerr << "  --repeat <n>              Runs per case, the fastest is kept (default 3)" << std::endl;
+    std::cerr << "  --tolerance <metric>=<r>  Relative tolerance of a metric, e.g. events_per_sec=0.1;" << std::endl;
+    std::cerr << "                            a negative value records the metric without checking it" << std::endl;
+    std::cerr << "  --filter <substring>      Only the runs whose name contains the substring" << std::endl;
+    std::cerr << "  --max-noise <r>           Skip the time checks when the median calibration round is" << std::endl;
+    std::cerr << "                            more than r slower than the best one (default 0.15)" << std::endl;
+    std::cerr << "Exit status: 0 no regressions, 1 regressions, 2 error, 3 inconclusive (the host was" << std::endl;
+    std::cerr << "too noisy to check the time metrics, or to record a baseline)" << std::endl;
+}
+
+int runHarness(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            printUsage(argv[0]);
+            return PERF_OK;
+        }
+        if (arg == "--update-baseline") {
+            options.updateBaseline = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            printUsage(argv[0]);
+            return PERF_ERROR;
+        }
+        std::string value = argv[++i];
+        if (arg == "--baseline") options.baselinePath = value;
+        else if (arg == "--results") options.resultsPath = value;
+        else if (arg == "--data-dir") options.dataDir = value;
+        else if (arg == "--events") options.dataset.eventsPerSymbol = std::stoull(value);
+        else if (arg == "--repeat") options.repeat = std::max(1, std::stoi(value));
+        else if (arg == "--filter") options.filter = value;
+        else if (arg == "--max-noise") options.maxNoise = std::stod(value);
+        else if (arg == "--tolerance") {
+            size_t eq = value.find('=');
+            options.tolerances[value.substr(0, eq)] = eq == std::string::npos ? 0 : std::stod(value.substr(eq + 1));
+        }
+        else {
+            printUsage(argv[0]);
+            return PERF_ERROR;
+        }
+    }
+    if (options.updateBaseline && options.baselinePath.empty()) {
+        std::cerr << "Error: --update-baseline needs --baseline <file>" << std::endl;
+        return PERF_ERROR;
+    }
+
+    // The baseline decides the dataset, so results stay comparable
+    JsonValue baseline;
+    bool haveBaseline = !options.baselinePath.empty() && !options.updateBaseline;
+    if (haveBaseline) {
+        baseline = readJsonFile(options.baselinePath);
+        if (const JsonValue* dataset = baseline.find("dataset")) {
+            if (const JsonValue* v = dataset->find("symbols")) options.dataset.symbols = v->number;
+            if (const JsonValue* v = dataset->find("events_per_symbol")) options.dataset.eventsPerSymbol = v->number;
+            if (const JsonValue* v = dataset->find("seed")) options.dataset.seed = v->number;
+        }
+    }
+
+    SyntheticMarketConfig market = marketConfig(options);
+    std::cout << "Generating " << market.symbols << " symbols x " << market.eventsPerSymbol
+              << " events into " << market.outputDir << std::endl;
+    generateDataset(market);
+
+    std::vector<std::pair<std::string, RunMetrics>> results;
+    Calibration calibration;
+    std::printf("\n%-24s %12s %10s %10s %10s %10s %12s %14s\n", "run", "events", "events/s", "p50 ns",
+                "p90 ns", "p99 ns", "RSS grew KB", "output bytes");
+    for (const RunCase& run : runCases()) {
+        if (!options.filter.empty() && run.name.find(options.filter) == std::string::npos) {
+            continue;
+        }
+
+        RunMetrics best;
+        for (int i = 0; i < options.repeat; ++i) {
+            calibration.rounds.push_back(calibrationNsPerOp());
+            RunMetrics metrics = runInChild(market, run);
+            if (i == 0 || metrics.eventsPerSec > best.eventsPerSec) {
+                best = metrics;
+            }
+        }
+        results.emplace_back(run.name, best);
+        std::printf("%-24s %12.0f %10.3g %10.1f %10.1f %10.1f %12.0f %14.0f\n", run.name.c_str(), best.events,
+                    best.eventsPerSec, best.nsPerEventP50, best.nsPerEventP90, best.nsPerEventP99,
+                    best.peakRssGrowthKb, best.outputBytes);
+        std::fflush(stdout);
+    }
+
+    // A baseline's times have to come from a quiet host; a noisy session's
+    // results still go to the results file for a look
+    const bool quiet = calibration.noise() <= options.maxNoise;
+    const JsonValue* baselinePtr = haveBaseline ? &baseline : nullptr;
+    std::string resultsPath = options.updateBaseline && quiet ? options.baselinePath : options.resultsPath;
+    writeResults(resultsPath, options, baselinePtr, calibration, results);
+    std::cout << "\nResults written to " << resultsPath << std::endl;
+    if (!quiet) {
+        std::cout << "The host was noisy (calibration noise " << formatNumber(calibration.noise() * 100)
+                  << "%, limit " << formatNumber(options.maxNoise * 100)
+                  << "%), so the timings are less reliable than the tolerances assume" << std::endl;
+        if (options.updateBaseline) {
+            std::cout << "Not updating " << options.baselinePath << ": record the baseline on a quieter host"
+                      << std::endl;
+            return PERF_INCONCLUSIVE;
+        }
+    }
+
+    if (!haveBaseline) {
+        return PERF_OK;
+    }
+    int regressions = compareWithBaseline(baseline, options, calibration, results);
+    if (regressions > 0) {
+        std::cout << "\n" << regressions << " metric(s) regressed against " << options.baselinePath << std::endl;
+        return PERF_REGRESSION;
+    }
+    if (!quiet) {
+        std::cout << "\nInconclusive: no regressions against " << options.baselinePath
+                  << ", but the time metrics were not checked" << std::endl;
+        return PERF_INCONCLUSIVE;
+    }
+    std::cout << "\nNo regressions against " << options.baselinePath << std::endl;
+    return PERF_OK;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    try {
+        return runHarness(argc, argv);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return PERF_ERROR;
+    }
+}
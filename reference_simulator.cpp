@@ -0,0 +1,516 @@
+#include "reference_simulator.h"
+#include <iostream>
+#include <algorithm>
+#include "engine/event_tape.h"
+#include "engine/reference_book.h"
+
+ReferenceSimulator::ReferenceSimulator(const std::string& outputFilePath,
+                                       uint64_t strategyMdLatencyNs,
+                                       uint64_t exchangeLatencyNs,
+                                       bool useQueueSimulation)
+    : strategy_(nullptr),
+      eventIndex_(0),
+      lastBookTop_(),
+      lastValidMidPrice_(0),
+      topVersion_(0),
+      lastProcessedTopTs_(0),
+      liveBook_(nullptr),
+      position_(0),
+      cashFlow_(0),
+      outputFilePath_(outputFilePath),
+      totalOrdersPlaced_(0),
+      totalOrdersFilled_(0),
+      totalBuyVolume_(0),
+      totalSellVolume_(0),
+      totalBuyCost_(0),
+      totalSellProceeds_(0),
+      strategyMdLatencyNs_(strategyMdLatencyNs),
+      exchangeLatencyNs_(exchangeLatencyNs),
+      mdLatency_(strategyMdLatencyNs),
+      orderLatency_(exchangeLatencyNs),
+      fillLatency_(exchangeLatencyNs),
+      lastFillLatencyNs_(0),
+      totalMdEvents_(0),
+      totalMdToStrategyLatencyNs_(0),
+      totalStrategyToExchangeLatencyNs_(0),
+      totalExchangeToNotificationLatencyNs_(0),
+      useQueueSimulation_(useQueueSimulation) {
+    outputFile_.open(outputFilePath_, std::ios::binary | std::ios::trunc);
+    if (!outputFile_.is_open()) {
+        throw std::runtime_error("Failed to open output file: " + outputFilePath_);
+    }
+}
+
+ReferenceSimulator::~ReferenceSimulator() {
+    if (outputFile_.is_open()) {
+        outputFile_.close();
+    }
+}
+
+// No timer service: the strategy checks its orders' age on every top
+void ReferenceSimulator::setStrategy(std::shared_ptr<Strategy> strategy) {
+    strategy_ = strategy;
+    strategy_->setTimerService(nullptr);
+    strategy_->setDepthHistory(depthHistory_.capacity() > 0 ? &depthHistory_ : nullptr);
+}
+
+// Same streams of the same seed as FillSimulatorT, so both engines draw the
+// same latencies in the same order
+void ReferenceSimulator::setLatencyModel(const LatencyModel* model) {
+    if (model == nullptr) {
+        mdLatency_ = LatencySampler(strategyMdLatencyNs_);
+        orderLatency_ = LatencySampler(exchangeLatencyNs_);
+        fillLatency_ = LatencySampler(exchangeLatencyNs_);
+        return;
+    }
+    mdLatency_ = LatencySampler(model->marketData, model->seed, LatencySampler::MARKET_DATA_STREAM, true);
+    orderLatency_ = LatencySampler(model->orderEntry, model->seed, LatencySampler::ORDER_ENTRY_STREAM, false);
+    fillLatency_ = LatencySampler(model->fillNotification, model->seed, LatencySampler::FILL_NOTIFICATION_STREAM,
+                                  false);
+}
+
+void ReferenceSimulator::setDepthHistory(size_t prices) {
+    depthHistory_.reset(prices);
+    if (strategy_) {
+        strategy_->setDepthHistory(prices > 0 ? &depthHistory_ : nullptr);
+    }
+}
+
+// Process a book top update
+void ReferenceSimulator::processBookTop(const book_top_t& bookTop) {
+    static const uint64_t MIN_PROCESSING_INTERVAL = 100000;
+    const int64_t MAX_REASONABLE_PRICE = 10000LL * 1000000000LL; // $10,000 in nanos
+
+    if (lastProcessedTopTs_ > 0 && (bookTop.ts - lastProcessedTopTs_) < MIN_PROCESSING_INTERVAL) {
+        return;
+    }
+    if (bookTop.top_level.bid_nanos <= 0 ||
+        bookTop.top_level.ask_nanos <= 0 ||
+        bookTop.top_level.bid_nanos >= bookTop.top_level.ask_nanos ||
+        bookTop.top_level.bid_nanos > MAX_REASONABLE_PRICE ||
+        bookTop.top_level.ask_nanos > MAX_REASONABLE_PRICE) {
+        return;
+    }
+    lastProcessedTopTs_ = bookTop.ts;
+
+    book_top_t delayedBookTop = bookTop;
+    delayedBookTop.ts = mdLatency_.delay(bookTop.ts);
+
+    // Record the top in the market state
+    lastBookTop_ = bookTop;
+    topVersion_++;
+    lastValidMidPrice_ = (bookTop.top_level.bid_nanos + bookTop.top_level.ask_nanos) / 2;
+    if (depthHistory_.capacity() > 0) {
+        for (bool isBid : {true, false}) {
+            for (const book_top_level_t* level : {&bookTop.top_level, &bookTop.second_level, &bookTop.third_level}) {
+                int64_t price = isBid ? level->bid_nanos : level->ask_nanos;
+                if (price > 0 && price != INT64_MAX) {
+                    depthHistory_.record(isBid, price, isBid ? level->bid_qty : level->ask_qty, bookTop.ts);
+                }
+            }
+        }
+    }
+    totalMdEvents_++;
+    totalMdToStrategyLatencyNs_ += delayedBookTop.ts - bookTop.ts;
+
+    auto actions = strategy_->onBookTopUpdate(delayedBookTop);
+    dispatchActions(actions, delayedBookTop.ts, bookTop);
+
+    checkRestingOrders(bookTop);
+}
+
+// Process a book fill event
+void ReferenceSimulator::processBookFill(const book_fill_snapshot_t& fill) {
+    book_fill_snapshot_t delayedFill = fill;
+    delayedFill.ts = mdLatency_.delay(fill.ts);
+
+    totalMdEvents_++;
+    totalMdToStrategyLatencyNs_ += delayedFill.ts - fill.ts;
+
+    auto actions = strategy_->onFill(delayedFill);
+    dispatchActions(actions, delayedFill.ts, lastBookTop_);
+}
+
+// Check every working order against the new top
+void ReferenceSimulator::checkRestingOrders(const book_top_t& bookTop) {
+    for (auto it = activeOrders_.begin(); it != activeOrders_.end();) {
+        OrderInfo& order = it->second;
+        if (order.walkedTop == topVersion_ ||
+            !wouldOrderBeFilled(order.isBid, order.price, order.quantity - order.filledQuantity)) {
+            ++it;
+            continue;
+        }
+
+        uint64_t orderId = order.orderId;
+        auto nextIt = std::next(it);
+        fillAgainstBook(orderId, bookTop, fillLatency(order.md_ts));
+        it = activeOrders_.find(orderId) == activeOrders_.end() ? nextIt : std::next(it);
+    }
+}
+
+void ReferenceSimulator::fillAgainstBook(uint64_t orderId, const book_top_t& bookTop,
+                                         uint64_t fillNotificationTime) {
+    auto orderIt = activeOrders_.find(orderId);
+    if (orderIt == activeOrders_.end()) {
+        return;
+    }
+    orderIt->second.walkedTop = topVersion_;
+    const bool isBid = orderIt->second.isBid;
+    const int64_t limit = orderIt->second.price;
+    const uint32_t quantity = orderIt->second.quantity;
+
+    int64_t lastPrice = isBid ? 0 : INT64_MAX;
+    auto takeLevel = [&](int64_t price, uint32_t levelQty) {
+        if (price <= 0 || price == INT64_MAX || (isBid ? price > limit : price < limit) ||
+            (isBid ? price <= lastPrice : price >= lastPrice)) {
+            return false;
+        }
+        lastPrice = price;
+        auto it = activeOrders_.find(orderId);
+        if (it == activeOrders_.end() || it->second.price != limit || it->second.quantity != quantity ||
+            it->second.filledQuantity >= quantity) {
+            return false;
+        }
+        if (levelQty > 0) {
+            processFill(orderId, price, std::min(levelQty, quantity - it->second.filledQuantity), isBid,
+                        fillNotificationTime);
+        }
+        return true;
+    };
+
+    if (liveBook_ != nullptr && bookTop.seqno == liveBook_->top().seqno) {
+        liveBook_->forEachLevel(!isBid, takeLevel);
+        return;
+    }
+    for (const book_top_level_t* level : {&bookTop.top_level, &bookTop.second_level, &bookTop.third_level}) {
+        if (!(isBid ? takeLevel(level->ask_nanos, level->ask_qty) : takeLevel(level->bid_nanos, level->bid_qty))) {
+            return;
+        }
+    }
+}
+
+void ReferenceSimulator::dispatchActions(const std::vector<OrderAction>& actions, uint64_t strategyTs,
+                                         const book_top_t& bookTop) {
+    for (const auto& action : actions) {
+        uint64_t exchangeReceiveTime = orderLatency_.delay(strategyTs);
+        OrderAction delayedAction = action;
+        if (delayedAction.sent_ts == 0) {
+            delayedAction.sent_ts = strategyTs;
+        }
+        delayedAction.md_ts = exchangeReceiveTime;
+        totalStrategyToExchangeLatencyNs_ += exchangeReceiveTime - strategyTs;
+
+        processAction(delayedAction, bookTop);
+    }
+}
+
+bool ReferenceSimulator::wouldOrderBeFilled(bool isBid, int64_t price, uint32_t quantity) const {
+    if (price <= 0 || quantity == 0) {
+        return false;
+    }
+    if (isBid) {
+        int64_t bestAsk = lastBookTop_.top_level.ask_nanos;
+        return bestAsk > 0 && bestAsk != INT64_MAX && price >= bestAsk;
+    }
+    int64_t bestBid = lastBookTop_.top_level.bid_nanos;
+    return bestBid > 0 && bestBid != INT64_MAX && price <= bestBid;
+}
+
+uint64_t ReferenceSimulator::fillLatency(uint64_t timestamp) {
+    uint64_t notificationTime = fillLatency_.delay(timestamp);
+    lastFillLatencyNs_ = notificationTime - timestamp;
+    return notificationTime;
+}
+
+void ReferenceSimulator::processFill(uint64_t orderId, int64_t fillPrice, uint32_t fillQty, bool isBid,
+                                     uint64_t fillNotificationTime) {
+    auto orderIt = activeOrders_.find(orderId);
+    if (orderIt == activeOrders_.end()) {
+        std::cerr << "Warning: Attempted to fill non-existent order ID " << orderId << std::endl;
+        return;
+    }
+    if (fillPrice <= 0 || fillPrice == INT64_MAX || fillQty == 0) {
+        std::cout << "Warning: Skipping invalid fill with price: " << fillPrice << std::endl;
+        return;
+    }
+    if (fillNotificationTime == 0) {
+        fillNotificationTime = fillLatency(lastBookTop_.ts);
+    }
+    if (fillNotificationTime > 0) {
+        totalExchangeToNotificationLatencyNs_ += lastFillLatencyNs_;
+    }
+
+    OrderInfo& order = orderIt->second;
+    order.filledQuantity += fillQty;
+
+    OrderRecord record;
+    record.timestamp = fillNotificationTime;
+    record.event_type = 3;  // Fill order
+    record.order_id = orderId;
+    record.symbol_id = order.symbolId;
+    record.price = fillPrice;
+    record.quantity = fillQty;
+    record.is_bid = isBid;
+    writeOrderRecord(record);
+
+    int64_t value = fillPrice * static_cast<int64_t>(fillQty);
+    if (isBid) {
+        position_ += fillQty;
+        cashFlow_ -= value;
+        totalBuyVolume_ += fillQty;
+        totalBuyCost_ += static_cast<double>(value) / 1e9;
+    } else {
+        position_ -= fillQty;
+        cashFlow_ += value;
+        totalSellVolume_ += fillQty;
+        totalSellProceeds_ += static_cast<double>(value) / 1e9;
+    }
+    totalOrdersFilled_++;
+
+    if (order.filledQuantity >= order.quantity) {
+        activeOrders_.erase(orderIt);
+    }
+
+    book_top_t notificationBookTop = lastBookTop_;
+    notificationBookTop.ts = fillNotificationTime;
+
+    auto actions = strategy_->onOrderFilled(orderId, fillPrice, fillQty, isBid);
+    dispatchActions(actions, fillNotificationTime, notificationBookTop);
+}
+
+void ReferenceSimulator::processAction(const OrderAction& action, const book_top_t& bookTop) {
+    if ((action.type == OrderAction::Type::ADD || action.type == OrderAction::Type::REPLACE) &&
+        wouldOrderBeFilled(action.isBid, action.price, action.quantity)) {
+        totalExchangeToNotificationLatencyNs_ += static_cast<uint64_t>(fillLatency_.meanNs());
+    }
+
+    // A post-only order that would cross is cancelled; any other takes the
+    // liquidity up to its limit
+    auto cross = [&](const OrderInfo& order, int64_t price, uint32_t quantity, const char* what) {
+        if (!wouldOrderBeFilled(order.isBid, price, quantity)) {
+            return;
+        }
+        if (order.isPostOnly) {
+            std::cout << "Canceling post-only " << (order.isBid ? "buy" : "sell")
+                      << " order at $" << static_cast<double>(price)/1e9
+                      << what << std::endl;
+            OrderRecord cancelRecord;
+            cancelRecord.timestamp = action.md_ts;
+            cancelRecord.event_type = 2;  // Cancel order
+            cancelRecord.order_id = action.orderId;
+            cancelRecord.symbol_id = order.symbolId;
+            cancelRecord.price = price;
+            cancelRecord.quantity = quantity;
+            cancelRecord.is_bid = order.isBid;
+            activeOrders_.erase(action.orderId);
+            writeOrderRecord(cancelRecord);
+        } else {
+            fillAgainstBook(action.orderId, bookTop, fillLatency(action.md_ts));
+        }
+    };
+
+    switch (action.type) {
+        case OrderAction::Type::ADD: {
+            OrderInfo order;
+            order.orderId = action.orderId;
+            order.md_ts = action.md_ts;
+            order.price = action.price;
+            order.symbolId = action.symbolId;
+            order.quantity = action.quantity;
+            order.filledQuantity = 0;
+            order.walkedTop = 0;
+            order.isBid = action.isBid;
+            order.isPostOnly = action.isPostOnly;
+            activeOrders_[action.orderId] = order;
+            totalOrdersPlaced_++;
+
+            OrderRecord record;
+            record.timestamp = action.md_ts;
+            record.event_type = 1;  // Add order
+            record.order_id = action.orderId;
+            record.symbol_id = action.symbolId;
+            record.price = action.price;
+            record.quantity = action.quantity;
+            record.is_bid = action.isBid;
+            writeOrderRecord(record);
+
+            cross(order, action.price, action.quantity, " that would cross the market");
+            break;
+        }
+        case OrderAction::Type::CANCEL: {
+            auto it = activeOrders_.find(action.orderId);
+            if (it == activeOrders_.end()) {
+                std::cerr << "Warning: Attempted to cancel non-existent order ID "
+                          << action.orderId << std::endl;
+                break;
+            }
+            OrderRecord record;
+            record.timestamp = action.md_ts;
+            record.event_type = 2;  // Cancel order
+            record.order_id = action.orderId;
+            record.symbol_id = it->second.symbolId;
+            record.price = it->second.price;
+            record.quantity = it->second.quantity;
+            record.is_bid = it->second.isBid;
+            activeOrders_.erase(it);
+            writeOrderRecord(record);
+            break;
+        }
+        case OrderAction::Type::REPLACE: {
+            auto it = activeOrders_.find(action.orderId);
+            if (it == activeOrders_.end()) {
+                break;
+            }
+            OrderRecord record;
+            record.timestamp = action.md_ts;
+            record.event_type = 4;  // Replace order
+            record.order_id = action.orderId;
+            record.symbol_id = it->second.symbolId;
+            record.old_price = it->second.price;
+            record.price = action.price;
+            record.old_quantity = it->second.quantity;
+            record.quantity = action.quantity;
+            record.is_bid = it->second.isBid;
+
+            it->second.price = action.price;
+            it->second.quantity = action.quantity;
+            if (action.md_ts > 0) {
+                it->second.md_ts = action.md_ts;
+            }
+            writeOrderRecord(record);
+
+            OrderInfo order = it->second;
+            cross(order, action.price, action.quantity, " after modification that would cross the market");
+            break;
+        }
+    }
+}
+
+void ReferenceSimulator::runSimulation(const std::string& topsFilePath, const std::string& fillsFilePath) {
+    std::ifstream topsFile(topsFilePath, std::ios::binary);
+    std::ifstream fillsFile(fillsFilePath, std::ios::binary);
+    if (!topsFile.is_open() || !fillsFile.is_open()) {
+        throw std::runtime_error("Failed to open input files");
+    }
+
+    book_tops_file_hdr_t topsHeader;
+    book_fills_file_hdr_t fillsHeader;
+    topsFile.read(reinterpret_cast<char*>(&topsHeader), sizeof(book_tops_file_hdr_t));
+    fillsFile.read(reinterpret_cast<char*>(&fillsHeader), sizeof(book_fills_file_hdr_t));
+    strategy_->setSymbolId(topsHeader.symbol_idx);
+
+    book_top_t bookTop;
+    book_fill_snapshot_t bookFill;
+    bool hasMoreTops = static_cast<bool>(topsFile.read(reinterpret_cast<char*>(&bookTop), sizeof(book_top_t)));
+    bool hasMoreFills = static_cast<bool>(
+        fillsFile.read(reinterpret_cast<char*>(&bookFill), sizeof(book_fill_snapshot_t)));
+
+    uint64_t processedTops = 0;
+    uint64_t processedFills = 0;
+    if (replayProfile_) replayProfile_->begin();
+
+    while (hasMoreTops || hasMoreFills) {
+        eventIndex_ = processedTops + processedFills;
+        if (!hasMoreFills || (hasMoreTops && bookTop.ts <= bookFill.ts)) {
+            processBookTop(bookTop);
+            processedTops++;
+            hasMoreTops = static_cast<bool>(topsFile.read(reinterpret_cast<char*>(&bookTop), sizeof(book_top_t)));
+        } else {
+            processBookFill(bookFill);
+            processedFills++;
+            hasMoreFills = static_cast<bool>(
+                fillsFile.read(reinterpret_cast<char*>(&bookFill), sizeof(book_fill_snapshot_t)));
+        }
+        if (replayProfile_) replayProfile_->onEvent();
+    }
+
+    if (replayProfile_) replayProfile_->end();
+    std::cout << "Reference simulation complete. Processed " << processedTops << " tops and "
+              << processedFills << " fills." << std::endl;
+}
+
+void ReferenceSimulator::runQueueSimulation(const std::string& bookEventsFilePath) {
+    std::ifstream bookEventsFile(bookEventsFilePath, std::ios::binary);
+    if (!bookEventsFile.is_open()) {
+        throw std::runtime_error("Failed to open book events file: " + bookEventsFilePath);
+    }
+
+    book_events_file_hdr_t header;
+    if (!bookEventsFile.read(reinterpret_cast<char*>(&header), sizeof(book_events_file_hdr_t))) {
+        throw std::runtime_error("Failed to open book events file: " + bookEventsFilePath);
+    }
+    strategy_->setSymbolId(header.symbol_idx);
+
+    ReferenceBook book;
+    liveBook_ = &book;
+
+    book_event_hdr_t eventHeader;
+    char payload[256];      // larger than any event type's record
+    book_fill_snapshot_t fill;
+    bool hasFill;
+    uint64_t processedEvents = 0;
+
+    std::cout << "Starting reference queue simulation, processing book events from "
+              << bookEventsFilePath << std::endl;
+    if (replayProfile_) replayProfile_->begin();
+
+    // Events are framed by their type; a truncated or unknown one ends the
+    // replay, as it does for the event tape
+    while (bookEventsFile.read(reinterpret_cast<char*>(&eventHeader), sizeof(book_event_hdr_t))) {
+        size_t size = EventTape::payloadSize(eventHeader.type);
+        if (size > sizeof(payload) || !bookEventsFile.read(payload, size)) {
+            break;
+        }
+
+        eventIndex_ = processedEvents;
+        bool topChanged = book.apply(eventHeader, payload, fill, hasFill);
+        if (hasFill) {
+            processBookFill(fill);
+        }
+        if (topChanged) {
+            book.updateTopLevels();
+        }
+        processBookTop(book.top());
+
+        processedEvents++;
+        if (replayProfile_) replayProfile_->onEvent();
+    }
+
+    liveBook_ = nullptr;
+    if (replayProfile_) replayProfile_->end();
+    std::cout << "Reference simulation complete. Processed " << processedEvents << " book events." << std::endl;
+}
+
+void ReferenceSimulator::writeOrderRecord(const OrderRecord& record) {
+    outputFile_.write(reinterpret_cast<const char*>(&record), sizeof(OrderRecord));
+    if (recordObserver_) {
+        recordObserver_->onRecord(recordStream_, eventIndex_, record, lastBookTop_);
+    }
+}
+
+void ReferenceSimulator::calculateResults() {
+    SimulationSummary result = summary();
+    std::cout << "\n===== REFERENCE SIMULATION RESULTS =====\n";
+    std::cout << "Strategy: " << strategy_->getName() << std::endl;
+    std::cout << "Queue Simulation: " << (useQueueSimulation_ ? "Enabled" : "Disabled") << std::endl;
+    std::cout << "Total MD Events: " << totalMdEvents_ << std::endl;
+    std::cout << "Total Orders Placed: " << result.ordersPlaced << std::endl;
+    std::cout << "Total Orders Filled: " << result.ordersFilled << std::endl;
+    std::cout << "Total Buy Volume: " << totalBuyVolume_ << " shares for $" << totalBuyCost_ << std::endl;
+    std::cout << "Total Sell Volume: " << totalSellVolume_ << " shares for $" << totalSellProceeds_ << std::endl;
+    std::cout << "Final Position: " << result.position << " shares" << std::endl;
+    std::cout << "Final Mid Price: $" << static_cast<double>(lastValidMidPrice_) / 1e9 << std::endl;
+    std::cout << "Final P&L: $" << result.pnl << std::endl;
+    std::cout << "========================================\n";
+}
+
+// Headline results, with the position marked at the last valid mid price
+SimulationSummary ReferenceSimulator::summary() const {
+    SimulationSummary result;
+    result.ordersPlaced = totalOrdersPlaced_;
+    result.ordersFilled = totalOrdersFilled_;
+    result.position = position_;
+    result.pnl = static_cast<double>(cashFlow_) / 1e9 +
+                 static_cast<double>(position_ * lastValidMidPrice_) / 1e9;
+    return result;
+}
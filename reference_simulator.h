@@ -0,0 +1,122 @@
+#ifndef REFERENCE_SIMULATOR_H
+#define REFERENCE_SIMULATOR_H
+
+#include <string>
+#include <unordered_map>
+#include <memory>
+#include <vector>
+#include <fstream>
+#include "fill_simulator.h"
+
+class ReferenceBook;
+
+// Reference engine that --verify checks FillSimulatorT against. It runs the
+// same simulation model the straightforward way, sharing none of the
+// optimized engine's replay machinery:
+//  - the strategy is called through virtual dispatch, one book top at a time
+//    (no onBookTopBatch);
+//  - no timer service is offered, so strategies find their expired orders by
+//    scanning their working orders on every top;
+//  - tops, fills and book events are read record by record from ifstreams;
+//  - queue runs rebuild the book in a ReferenceBook (std::map levels of
+//    std::list queues keyed by nanos), not in QueueBook.
+// The output file and the order records are those of FillSimulatorT. Tick
+// size and progress options do not apply and are ignored.
+class ReferenceSimulator : public SimulationRunner {
+public:
+    ReferenceSimulator(const std::string& outputFilePath,
+                       uint64_t strategyMdLatencyNs = 1000,
+                       uint64_t exchangeLatencyNs = 10000,
+                       bool useQueueSimulation = false);
+    ~ReferenceSimulator() override;
+
+    void setStrategy(std::shared_ptr<Strategy> strategy);
+
+    void runSimulation(const std::string& topsFilePath, const std::string& fillsFilePath) override;
+    void runQueueSimulation(const std::string& bookEventsFilePath) override;
+
+    void calculateResults() override;
+    SimulationSummary summary() const;
+    std::vector<SimulationSummary> summaries() const override { return {summary()}; }
+
+    std::string strategyName() const override { return strategy_->getName(); }
+
+    void setLatencyModel(const LatencyModel* model) override;
+    void setDepthHistory(size_t prices) override;
+
+private:
+    struct OrderInfo {
+        uint64_t orderId;
+        uint64_t md_ts;
+        int64_t price;
+        uint32_t symbolId;
+        uint32_t quantity;
+        uint32_t filledQuantity;
+        uint64_t walkedTop;     // topVersion_ at which the order last walked the book
+        bool isBid;
+        bool isPostOnly;
+    };
+
+    void processBookTop(const book_top_t& bookTop);
+    void processBookFill(const book_fill_snapshot_t& fill);
+
+    bool wouldOrderBeFilled(bool isBid, int64_t price, uint32_t quantity) const;
+
+    // Time at which a fill notification for an execution at timestamp
+    // reaches the strategy
+    uint64_t fillLatency(uint64_t timestamp);
+
+    void processFill(uint64_t orderId, int64_t fillPrice, uint32_t fillQty, bool isBid,
+                     uint64_t fillNotificationTime);
+    void processAction(const OrderAction& action, const book_top_t& bookTop);
+    void dispatchActions(const std::vector<OrderAction>& actions, uint64_t strategyTs,
+                         const book_top_t& bookTop);
+    void checkRestingOrders(const book_top_t& bookTop);
+
+    // Fill a crossing order level by level against the opposite side, from
+    // the live book when it is at the top traded on, else from the top's
+    // three levels
+    void fillAgainstBook(uint64_t orderId, const book_top_t& bookTop, uint64_t fillNotificationTime);
+
+    void writeOrderRecord(const OrderRecord& record);
+
+    std::shared_ptr<Strategy> strategy_;
+    uint64_t eventIndex_;
+
+    book_top_t lastBookTop_;
+    int64_t lastValidMidPrice_;
+    DepthHistory depthHistory_;
+    uint64_t topVersion_;
+    uint64_t lastProcessedTopTs_;
+    const ReferenceBook* liveBook_;
+
+    std::unordered_map<uint64_t, OrderInfo> activeOrders_;
+
+    int64_t position_;
+    int64_t cashFlow_;
+    std::string outputFilePath_;
+    std::ofstream outputFile_;
+
+    uint64_t totalOrdersPlaced_;
+    uint64_t totalOrdersFilled_;
+    uint64_t totalBuyVolume_;
+    uint64_t totalSellVolume_;
+    double totalBuyCost_;
+    double totalSellProceeds_;
+
+    uint64_t strategyMdLatencyNs_;
+    uint64_t exchangeLatencyNs_;
+    LatencySampler mdLatency_;
+    LatencySampler orderLatency_;
+    LatencySampler fillLatency_;
+    uint64_t lastFillLatencyNs_;
+
+    uint64_t totalMdEvents_;
+    uint64_t totalMdToStrategyLatencyNs_;
+    uint64_t totalStrategyToExchangeLatencyNs_;
+    uint64_t totalExchangeToNotificationLatencyNs_;
+
+    bool useQueueSimulation_;
+};
+
+#endif
@@ -0,0 +1,225 @@
+#include "run_config.h"
+#include <charconv>
+#include <cstdlib>
+#include <iostream>
+#include <sys/stat.h>
+#include <type_traits>
+
+// Include TOML parser
+#include "externals/toml11/toml.hpp"
+
+namespace {
+
+// TOML section of every config key
+const std::map<std::string, std::string>& configSections() {
+    static const std::map<std::string, std::string> sections = {
+        {"strategy_md_latency_ns", "latency"},
+        {"exchange_latency_ns", "latency"},
+        {"strategy_md_latency_model", "latency"},
+        {"order_latency_model", "latency"},
+        {"fill_latency_model", "latency"},
+        {"latency_seed", "latency"},
+        {"latency_profile_file", "latency"},
+        {"use_queue_simulation", "simulation"},
+        {"strategy", "simulation"},
+        {"progress_interval_ms", "simulation"},
+        {"progress_stats_file", "simulation"},
+        {"tick_size_nanos", "simulation"},
+        {"depth_history_prices", "simulation"},
+        {"place_edge_percent", "strategy"},
+        {"cancel_edge_percent", "strategy"},
+        {"self_weight", "strategy"},
+        {"ema_half_life_ns", "strategy"},
+        {"place_edge_sweep", "strategy"},
+        {"cancel_edge_sweep", "strategy"},
+        {"correlation_csv", "strategy"},
+        {"symbol_map_csv", "strategy"},
+        {"correlation_data_path", "strategy"},
+    };
+    return sections;
+}
+
+bool fileExists(const std::string& filename) {
+    struct stat buffer;
+    return (stat(filename.c_str(), &buffer) == 0);
+}
+
+bool parseDouble(const std::string& text, double& value) {
+    char* end = nullptr;
+    value = std::strtod(text.c_str(), &end);
+    return !text.empty() && end == text.c_str() + text.size();
+}
+
+} // namespace
+
+RunConfig defaultConfig() {
+    RunConfig config;
+    config["strategy_md_latency_ns"] = static_cast<uint64_t>(1000);  // 1µs
+    config["exchange_latency_ns"] = static_cast<uint64_t>(10000);  // 10µs
+    config["strategy_md_latency_model"] = std::string();  // empty = fixed strategy_md_latency_ns
+    config["order_latency_model"] = std::string();  // empty = fixed exchange_latency_ns
+    config["fill_latency_model"] = std::string();  // empty = fixed exchange_latency_ns
+    config["latency_seed"] = static_cast<uint64_t>(1);
+    config["latency_profile_file"] = std::string();  // empty = no time-of-day profile
+    config["use_queue_simulation"] = false;
+    config["strategy"] = std::string();  // empty = ask on stdin
+    config["progress_interval_ms"] = static_cast<uint64_t>(1000);  // 0 = no progress
+    config["progress_stats_file"] = std::string();  // empty = status line only
+    config["tick_size_nanos"] = static_cast<uint64_t>(0);  // 0 = infer from the book events
+    config["depth_history_prices"] = static_cast<uint64_t>(0);  // 0 = no depth history
+    config["place_edge_percent"] = 0.1;
+    config["cancel_edge_percent"] = 0.05;
+    config["self_weight"] = 0.5;
+    config["ema_half_life_ns"] = static_cast<uint64_t>(0);  // 0 = decay per trade
+    config["place_edge_sweep"] = std::vector<double>();
+    config["cancel_edge_sweep"] = std::vector<double>();
+    config["correlation_csv"] = std::string();
+    config["symbol_map_csv"] = std::string();
+    config["correlation_data_path"] = std::string();  // empty = the main input file
+    return config;
+}
+
+RunConfig loadConfigFromToml(const std::string& configFilePath) {
+    RunConfig config = defaultConfig();
+
+    if (!fileExists(configFilePath)) {
+        std::cerr << "Warning: Config file not found: " << configFilePath << std::endl;
+        std::cerr << "Using default values instead." << std::endl;
+        return config;
+    }
+
+    try {
+        // Parse the TOML file
+        const auto data = toml::parse(configFilePath);
+
+        // Read every known key from its section, as the type of its default
+        for (const auto& [key, section] : configSections()) {
+            if (!data.contains(section)) continue;
+            const auto& table = toml::find(data, section);
+            if (!table.contains(key)) continue;
+
+            std::visit([&, key = key](auto& value) {
+                using T = std::decay_t<decltype(value)>;
+                value = toml::find<T>(table, key);
+            }, config[key]);
+        }
+    }
+    catch (const std::exception& e) {
+        throw RunError(RUN_CONFIG_ERROR, "Error loading TOML config file " + configFilePath + ": " + e.what());
+    }
+
+    std::cout << "Loaded configuration from: " << configFilePath << std::endl;
+    return config;
+}
+
+void applyConfigOverride(RunConfig& config, const std::string& assignment) {
+    size_t eq = assignment.find('=');
+    std::string key = assignment.substr(0, eq);
+    auto it = config.find(key);
+    if (eq == std::string::npos || it == config.end()) {
+        throw RunError(RUN_CONFIG_ERROR, "Invalid config override '" + assignment + "'; expected <key>=<value> with a known key");
+    }
+    std::string text = assignment.substr(eq + 1);
+
+    bool parsed = std::visit([&](auto& value) {
+        using T = std::decay_t<decltype(value)>;
+        if constexpr (std::is_same_v<T, uint64_t>) {
+            auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+            return result.ec == std::errc() && result.ptr == text.data() + text.size();
+        } else if constexpr (std::is_same_v<T, double>) {
+            return parseDouble(text, value);
+        } else if constexpr (std::is_same_v<T, bool>) {
+            if (text == "true" || text == "1") { value = true; return true; }
+            if (text == "false" || text == "0") { value = false; return true; }
+            return false;
+        } else if constexpr (std::is_same_v<T, std::vector<double>>) {
+            value.clear();
+            size_t start = 0;
+            while (start < text.size()) {
+                size_t comma = text.find(',', start);
+                if (comma == std::string::npos) comma = text.size();
+                double element;
+                if (!parseDouble(text.substr(start, comma - start), element)) return false;
+                value.push_back(element);
+                start = comma + 1;
+            }
+            return true;
+        } else {
+            value = text;
+            return true;
+        }
+    }, it->second);
+
+    if (!parsed) {
+        throw RunError(RUN_CONFIG_ERROR, "Invalid value in config override '" + assignment + "'");
+    }
+}
+
+LatencyModel latencyModelFromConfig(const RunConfig& config) {
+    auto leg = [&](const char* modelKey, const char* fixedKey) {
+        const std::string& spec = std::get<std::string>(config.at(modelKey));
+        if (spec.empty()) {
+            return LatencyDistribution(std::get<uint64_t>(config.at(fixedKey)));
+        }
+        try {
+            return LatencyDistribution::parse(spec);
+        } catch (const std::exception& e) {
+            throw RunError(RUN_CONFIG_ERROR, std::string(modelKey) + ": " + e.what());
+        }
+    };
+
+    LatencyModel model;
+    model.marketData.base = leg("strategy_md_latency_model", "strategy_md_latency_ns");
+    model.orderEntry.base = leg("order_latency_model", "exchange_latency_ns");
+    model.fillNotification.base = leg("fill_latency_model", "exchange_latency_ns");
+    model.seed = std::get<uint64_t>(config.at("latency_seed"));
+
+    const std::string& profile = std::get<std::string>(config.at("latency_profile_file"));
+    if (!profile.empty()) {
+        try {
+            loadLatencyProfile(profile, model);
+        } catch (const std::exception& e) {
+            throw RunError(RUN_CONFIG_ERROR, std::string("latency_profile_file: ") + e.what());
+        }
+    }
+    return model;
+}
+
+void printConfig(const RunConfig& config) {
+    auto str = [&](const char* key) { return std::get<std::string>(config.at(key)); };
+
+    std::cout << "  Strategy MD Latency: " << std::get<uint64_t>(config.at("strategy_md_latency_ns")) / 1000.0 << " µs" << std::endl;
+    std::cout << "  Exchange Latency: " << std::get<uint64_t>(config.at("exchange_latency_ns")) / 1000.0 << " µs" << std::endl;
+    std::cout << "  Total round-trip latency: "
+              << (std::get<uint64_t>(config.at("strategy_md_latency_ns")) + 2 * std::get<uint64_t>(config.at("exchange_latency_ns"))) / 1000.0 << " µs" << std::endl;
+    for (const char* key : {"strategy_md_latency_model", "order_latency_model", "fill_latency_model"}) {
+        if (!str(key).empty()) {
+            std::cout << "  " << key << ": " << str(key) << " (seed " << std::get<uint64_t>(config.at("latency_seed"))
+                      << ")" << std::endl;
+        }
+    }
+    if (!str("latency_profile_file").empty()) {
+        std::cout << "  Latency Profile: " << str("latency_profile_file") << " (seed "
+                  << std::get<uint64_t>(config.at("latency_seed")) << ")" << std::endl;
+    }
+    std::cout << "  Queue Simulation: " << (std::get<bool>(config.at("use_queue_simulation")) ? "Enabled" : "Disabled") << std::endl;
+    if (!str("strategy").empty()) {
+        std::cout << "  Strategy: " << str("strategy") << std::endl;
+    }
+    std::cout << "  Place Edge Percent: " << std::get<double>(config.at("place_edge_percent")) << "%" << std::endl;
+    std::cout << "  Cancel Edge Percent: " << std::get<double>(config.at("cancel_edge_percent")) << "%" << std::endl;
+    std::cout << "  Self Weight: " << std::get<double>(config.at("self_weight")) << std::endl;
+    std::cout << "  EMA Half-Life: " << std::get<uint64_t>(config.at("ema_half_life_ns")) << " ns" << std::endl;
+    if (!std::get<std::vector<double>>(config.at("place_edge_sweep")).empty() ||
+        !std::get<std::vector<double>>(config.at("cancel_edge_sweep")).empty()) {
+        std::cout << "  Edge Sweep: " << std::get<std::vector<double>>(config.at("place_edge_sweep")).size()
+                  << " place x " << std::get<std::vector<double>>(config.at("cancel_edge_sweep")).size()
+                  << " cancel values" << std::endl;
+    }
+    if (!str("correlation_csv").empty()) {
+        std::cout << "  Correlation CSV: " << str("correlation_csv") << std::endl;
+    }
+    if (!str("symbol_map_csv").empty()) {
+        std::cout << "  Symbol Map CSV: " << str("symbol_map_csv") << std::endl;
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef RUN_CONFIG_H
+#define RUN_CONFIG_H
+
+#include <cstdint>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <variant>
+#include <vector>
+#include "engine/latency_model.h"
+
+// Every input of a run, keyed by its TOML key. Values come from the defaults,
+// then the TOML file, then --set overrides on the command line.
+using ConfigValue = std::variant<uint64_t, double, bool, std::vector<double>, std::string>;
+using RunConfig = std::map<std::string, ConfigValue>;
+
+// Process exit codes, so a scheduler can tell failures apart without
+// reading the logs
+enum RunStatus : int {
+    RUN_OK = 0,
+    RUN_USAGE_ERROR = 1,        // bad command line
+    RUN_CONFIG_ERROR = 2,       // unreadable config or bad override
+    RUN_INPUT_ERROR = 3,        // missing market data file
+    RUN_STRATEGY_ERROR = 4,     // unknown strategy or strategy setup failed
+    RUN_SIMULATION_ERROR = 5,   // failure while replaying
+    RUN_VERIFY_FAILED = 6       // --verify found the engines disagree
+};
+
+// Error that ends the run with a specific status
+class RunError : public std::runtime_error {
+public:
+    RunError(RunStatus status, const std::string& message)
+        : std::runtime_error(message), status_(status) {}
+
+    RunStatus status() const { return status_; }
+
+private:
+    RunStatus status_;
+};
+
+// Defaults for every key
+RunConfig defaultConfig();
+
+// Defaults overlaid with the TOML file. A missing file keeps the defaults;
+// a file that cannot be parsed throws RunError(RUN_CONFIG_ERROR).
+RunConfig loadConfigFromToml(const std::string& configFilePath);
+
+// Apply a key=value override, parsing the value as the key's type (lists
+// are comma separated). Throws RunError(RUN_CONFIG_ERROR) for an unknown key
+// or a value that does not parse.
+void applyConfigOverride(RunConfig& config, const std::string& assignment);
+
+// Latency distribution of every leg: its *_latency_model spec, or the fixed
+// latency when the spec is empty, with the periods of latency_profile_file
+// if one is set. Throws RunError(RUN_CONFIG_ERROR) for a spec or profile
+// that does not parse.
+LatencyModel latencyModelFromConfig(const RunConfig& config);
+
+void printConfig(const RunConfig& config);
+
+#endif
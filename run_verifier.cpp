@@ -0,0 +1,242 @@
+#include "run_verifier.h"
+#include <algorithm>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+constexpr size_t CONTEXT_RECORDS = 3;   // matching records shown before a divergence
+
+struct CapturedRecord {
+    uint64_t eventIndex;
+    OrderRecord record;
+    book_top_t bookTop;
+};
+
+bool sameRecord(const OrderRecord& a, const OrderRecord& b) {
+    return a.timestamp == b.timestamp && a.event_type == b.event_type && a.order_id == b.order_id &&
+           a.symbol_id == b.symbol_id && a.price == b.price && a.old_price == b.old_price &&
+           a.quantity == b.quantity && a.old_quantity == b.old_quantity && a.is_bid == b.is_bid;
+}
+
+const char* eventName(uint8_t eventType) {
+    switch (eventType) {
+        case 1: return "add";
+        case 2: return "cancel";
+        case 3: return "fill";
+        case 4: return "replace";
+        default: return "unknown";
+    }
+}
+
+std::string describe(uint64_t eventIndex, const OrderRecord& record) {
+    std::ostringstream out;
+    out << "event " << eventIndex << ": " << eventName(record.event_type)
+        << " ts=" << record.timestamp << " order=" << record.order_id << " symbol=" << record.symbol_id
+        << " " << (record.is_bid ? "bid" : "ask") << " " << record.quantity << "@" << record.price;
+    if (record.event_type == 4) {
+        out << " (was " << record.old_quantity << "@" << record.old_price << ")";
+    }
+    return out.str();
+}
+
+std::string describe(const book_top_t& bookTop) {
+    std::ostringstream out;
+    out << "ts=" << bookTop.ts << " seqno=" << bookTop.seqno;
+    for (const book_top_level_t* level : {&bookTop.top_level, &bookTop.second_level, &bookTop.third_level}) {
+        out << " | " << level->bid_qty << "@" << level->bid_nanos << " x " << level->ask_qty << "@" << level->ask_nanos;
+    }
+    return out.str();
+}
+
+// Records of one stream of the reference run, spilled to a temporary file
+// as they are written and read back in order, so a long run costs disk
+// rather than memory
+class RecordSpill {
+public:
+    RecordSpill() : file_(std::tmpfile()) {
+        if (file_ == nullptr) {
+            throw std::runtime_error("Failed to create a temporary file for the reference records");
+        }
+    }
+    ~RecordSpill() { std::fclose(file_); }
+
+    RecordSpill(const RecordSpill&) = delete;
+    RecordSpill& operator=(const RecordSpill&) = delete;
+
+    void append(const CapturedRecord& record) {
+        if (std::fwrite(&record, sizeof(record), 1, file_) != 1) {
+            throw std::runtime_error("Failed to write the reference records");
+        }
+        count_++;
+    }
+
+    // Start reading from the first record
+    void rewind() { std::rewind(file_); }
+
+    bool next(CapturedRecord& record) { return std::fread(&record, sizeof(record), 1, file_) == 1; }
+
+    uint64_t count() const { return count_; }
+
+private:
+    std::FILE* file_;
+    uint64_t count_ = 0;
+};
+
+using RecordSpills = std::vector<std::unique_ptr<RecordSpill>>;
+
+// Spills every record of the reference run
+class RecordCapture : public RecordObserver {
+public:
+    void onRecord(size_t stream, uint64_t eventIndex, const OrderRecord& record,
+                  const book_top_t& bookTop) override {
+        while (stream >= streams_.size()) {
+            streams_.push_back(std::make_unique<RecordSpill>());
+        }
+        streams_[stream]->append(CapturedRecord{eventIndex, record, bookTop});
+    }
+
+    RecordSpills& streams() { return streams_; }
+
+private:
+    RecordSpills streams_;
+};
+
+// Checks each record of the optimized run against the spilled reference,
+// keeping the last few matching records of each stream for the report
+class RecordComparison : public RecordObserver {
+public:
+    explicit RecordComparison(RecordSpills& expected)
+        : expected_(expected), matched_(expected.size(), 0), recent_(expected.size()) {
+        for (auto& spill : expected_) {
+            spill->rewind();
+        }
+    }
+
+    void onRecord(size_t stream, uint64_t eventIndex, const OrderRecord& record,
+                  const book_top_t& bookTop) override {
+        uint64_t index = stream < matched_.size() ? matched_[stream] : 0;
+        CapturedRecord reference;
+        if (stream >= expected_.size() || !expected_[stream]->next(reference)) {
+            std::ostringstream out;
+            out << "stream " << stream << ", record " << index << ": the optimized engine wrote a record "
+                << "the reference did not\n"
+                << "  optimized: " << describe(eventIndex, record) << "\n"
+                << "  optimized book: " << describe(bookTop) << "\n";
+            throw VerifyDivergence(withContext(out.str(), stream));
+        }
+
+        if (reference.eventIndex != eventIndex || !sameRecord(reference.record, record)) {
+            std::ostringstream out;
+            out << "stream " << stream << ", record " << index << " differs at event "
+                << std::min(reference.eventIndex, eventIndex) << "\n"
+                << "  reference: " << describe(reference.eventIndex, reference.record) << "\n"
+                << "  optimized: " << describe(eventIndex, record) << "\n"
+                << "  reference book: " << describe(reference.bookTop) << "\n"
+                << "  optimized book: " << describe(bookTop) << "\n";
+            throw VerifyDivergence(withContext(out.str(), stream));
+        }
+
+        matched_[stream]++;
+        compared_++;
+        std::deque<CapturedRecord>& recent = recent_[stream];
+        if (recent.size() == CONTEXT_RECORDS) {
+            recent.pop_front();
+        }
+        recent.push_back(reference);
+    }
+
+    // Records of the reference that the optimized run never wrote
+    void checkComplete() {
+        for (size_t stream = 0; stream < expected_.size(); ++stream) {
+            CapturedRecord missing;
+            if (expected_[stream]->next(missing)) {
+                std::ostringstream out;
+                out << "stream " << stream << ", record " << matched_[stream]
+                    << ": the optimized engine ended without the reference's record\n"
+                    << "  reference: " << describe(missing.eventIndex, missing.record) << "\n"
+                    << "  reference book: " << describe(missing.bookTop) << "\n";
+                throw VerifyDivergence(withContext(out.str(), stream));
+            }
+        }
+    }
+
+    uint64_t compared() const { return compared_; }
+
+private:
+    std::string withContext(const std::string& message, size_t stream) const {
+        if (stream >= recent_.size() || recent_[stream].empty()) {
+            return message;
+        }
+        std::ostringstream out;
+        out << message << "  preceding matching records:\n";
+        for (const CapturedRecord& matched : recent_[stream]) {
+            out << "    " << describe(matched.eventIndex, matched.record) << "\n";
+        }
+        return out.str();
+    }
+
+    RecordSpills& expected_;
+    std::vector<uint64_t> matched_;
+    std::vector<std::deque<CapturedRecord>> recent_;
+    uint64_t compared_ = 0;
+};
+
+void compareSummaries(const std::vector<SimulationSummary>& reference,
+                      const std::vector<SimulationSummary>& optimized) {
+    if (reference.size() != optimized.size()) {
+        throw VerifyDivergence("final statistics: reference has " + std::to_string(reference.size()) +
+                               " streams, optimized has " + std::to_string(optimized.size()));
+    }
+    for (size_t stream = 0; stream < reference.size(); ++stream) {
+        const SimulationSummary& a = reference[stream];
+        const SimulationSummary& b = optimized[stream];
+        if (a.ordersPlaced != b.ordersPlaced || a.ordersFilled != b.ordersFilled ||
+            a.position != b.position || a.pnl != b.pnl) {
+            std::ostringstream out;
+            out.precision(17);
+            out << "stream " << stream << " final statistics differ\n"
+                << "  reference: placed=" << a.ordersPlaced << " filled=" << a.ordersFilled
+                << " position=" << a.position << " pnl=" << a.pnl << "\n"
+                << "  optimized: placed=" << b.ordersPlaced << " filled=" << b.ordersFilled
+                << " position=" << b.position << " pnl=" << b.pnl << "\n";
+            throw VerifyDivergence(out.str());
+        }
+    }
+}
+
+} // namespace
+
+uint64_t verifyRuns(SimulationRunner& reference, SimulationRunner& optimized,
+                    const std::function<void(SimulationRunner&)>& replay) {
+    RecordCapture capture;
+    reference.setRecordObserver(&capture);
+    replay(reference);
+    reference.setRecordObserver(nullptr);
+
+    RecordComparison comparison(capture.streams());
+    optimized.setRecordObserver(&comparison);
+    try {
+        replay(optimized);
+    } catch (...) {
+        optimized.setRecordObserver(nullptr);
+        throw;
+    }
+    optimized.setRecordObserver(nullptr);
+
+    comparison.checkComplete();
+    compareSummaries(reference.summaries(), optimized.summaries());
+    return comparison.compared();
+}
+
+std::string referenceOutputPath(const std::string& outputFilePath) {
+    size_t dot = outputFilePath.find_last_of('.');
+    size_t slash = outputFilePath.find_last_of('/');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        return outputFilePath + ".reference";
+    }
+    return outputFilePath.substr(0, dot) + ".reference" + outputFilePath.substr(dot);
+}
@@ -0,0 +1,29 @@
+#ifndef RUN_VERIFIER_H
+#define RUN_VERIFIER_H
+
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include "fill_simulator.h"
+
+// First difference between the reference and the optimized engine, with its
+// context (event index, book tops, the records around it) in the message
+class VerifyDivergence : public std::runtime_error {
+public:
+    explicit VerifyDivergence(const std::string& message) : std::runtime_error(message) {}
+};
+
+// Replays the same input through a reference runner (the straightforward
+// engine, ReferenceSimulator) and then through the optimized runner,
+// comparing every order record stream by stream as the optimized run writes
+// it, and the final statistics at the end. The optimized run stops at
+// the first record that differs. Returns the number of records compared;
+// throws VerifyDivergence on any difference.
+uint64_t verifyRuns(SimulationRunner& reference, SimulationRunner& optimized,
+                    const std::function<void(SimulationRunner&)>& replay);
+
+// Output file of the reference run: ".reference" inserted before the extension
+std::string referenceOutputPath(const std::string& outputFilePath);
+
+#endif
@@ -8,17 +8,30 @@ BasicStrategy::BasicStrategy() :
     currentBidOrderId_(0),
     currentAskOrderId_(0),
     currentBidPrice_(0),
-    currentAskPrice_(0) {}
+    currentAskPrice_(0),
+    lastOrderTime_(0),
+    lastBidPrice_(0),
+    lastAskPrice_(0) {}
 
 std::string BasicStrategy::getName() const {
     return "Basic Strategy";
 }
 
+size_t BasicStrategy::memoryBytes() const {
+    return sizeof(*this) + activeOrders_.memoryBytes();
+}
+
 // Set the symbol ID for this strategy
 void BasicStrategy::setSymbolId(uint64_t symbolId) {
     symbolId_ = symbolId;
 }
 
+// Use the simulator's timers for the 10-minute order expiry
+void BasicStrategy::setTimerService(TimerService* timerService) {
+    Strategy::setTimerService(timerService);
+    activeOrders_.setTimerService(timerService);
+}
+
 // Handle book top updates
 std::vector<OrderAction> BasicStrategy::onBookTopUpdate(const book_top_t& bookTop) {
     if (bookTop.top_level.bid_nanos <= 0 || bookTop.top_level.ask_nanos <= 0 ||
@@ -26,8 +39,11 @@ std::vector<OrderAction> BasicStrategy::onBookTopUpdate(const book_top_t& bookTo
         return {};
     }
 
-    // Check for orders that need to be canceled
-    std::vector<OrderAction> cancelActions = checkForStaleOrders(bookTop.ts);
+    // Without a timer service, check for orders that need to be canceled
+    std::vector<OrderAction> cancelActions;
+    if (timerService_ == nullptr) {
+        cancelActions = checkForStaleOrders(bookTop.ts);
+    }
     
     // Get new order actions
     std::vector<OrderAction> newOrderActions = updateOrdersForBookTop(bookTop);
@@ -37,11 +53,6 @@ std::vector<OrderAction> BasicStrategy::onBookTopUpdate(const book_top_t& bookTo
     return cancelActions;
 }
 
-// Handle book fills
-std::vector<OrderAction> BasicStrategy::onFill(const book_fill_snapshot_t& /* fill */) {
-    return {};
-}
-
 // Handle filled orders
 std::vector<OrderAction> BasicStrategy::onOrderFilled(uint64_t orderId, int64_t /* fillPrice */,
                                                       uint32_t /* fillQty */, bool isBid) {
@@ -57,18 +68,27 @@ std::vector<OrderAction> BasicStrategy::onOrderFilled(uint64_t orderId, int64_t
         currentAskOrderId_ = 0;
     }
 
-    // Find the order in active orders first
-    auto it = std::find_if(activeOrders_.begin(), activeOrders_.end(), 
-                           [orderId](const OrderInfo& order) { return order.orderId == orderId; });
-    
-    // Remove if the order exists
-    if (it != activeOrders_.end()) {
-        removeOrder(orderId);
-    }
+    // Remove the order if it is still tracked
+    removeOrder(orderId);
 
     return {};
 }
 
+// Cancel an order whose 10-minute expiry timer fired
+std::vector<OrderAction> BasicStrategy::onTimer(uint64_t orderId, uint64_t /* timestamp */) {
+    if (!activeOrders_.contains(orderId)) {
+        return {};
+    }
+    
+    OrderAction cancelAction;
+    cancelAction.type = OrderAction::Type::CANCEL;
+    cancelAction.orderId = orderId;
+    cancelAction.symbolId = symbolId_;
+    
+    removeOrder(orderId);
+    return {cancelAction};
+}
+
 // Helper function to remove an order from active orders list
 void BasicStrategy::removeOrder(uint64_t orderId) {
     // Check for invalid order ID
@@ -76,11 +96,7 @@ void BasicStrategy::removeOrder(uint64_t orderId) {
         return;
     }
 
-    activeOrders_.erase(
-        std::remove_if(activeOrders_.begin(), activeOrders_.end(),
-            [orderId](const OrderInfo& order) { return order.orderId == orderId; }),
-        activeOrders_.end()
-    );
+    activeOrders_.remove(orderId);
     
     // Clear any tracking variables
     if (orderId == currentBidOrderId_) {
@@ -94,42 +110,34 @@ void BasicStrategy::removeOrder(uint64_t orderId) {
 // Helper function to check for orders that need to be canceled
 std::vector<OrderAction> BasicStrategy::checkForStaleOrders(uint64_t currentTimestamp) {
     std::vector<OrderAction> actions;
-    std::vector<uint64_t> orderIdsToRemove;
 
     // Check for active orders
     if (activeOrders_.empty()) {
         return actions;
     }
 
-    for (const auto& order : activeOrders_) {
-        if (currentTimestamp < order.creationTime) {
-            continue;
+    // Orders are kept oldest first, so only the expired ones are visited
+    activeOrders_.removeOldestWhile([&](const OrderInfo& order) {
+        if (currentTimestamp < order.creationTime ||
+            currentTimestamp - order.creationTime < TEN_MINUTES_NS) {
+            return false;
         }
         
-        if (currentTimestamp - order.creationTime >= TEN_MINUTES_NS) {
-            // Order is older than 10 minutes, cancel it
-            OrderAction cancelAction;
-            cancelAction.type = OrderAction::Type::CANCEL;
-            cancelAction.orderId = order.orderId;
-            cancelAction.symbolId = symbolId_;
-            actions.push_back(cancelAction);
-            
-            // Track which orders to remove
-            orderIdsToRemove.push_back(order.orderId);
-            
-            // Update tracking variables if needed
-            if (order.isBid && order.orderId == currentBidOrderId_) {
-                currentBidOrderId_ = 0;
-            } else if (!order.isBid && order.orderId == currentAskOrderId_) {
-                currentAskOrderId_ = 0;
-            }
+        // Order is older than 10 minutes, cancel it
+        OrderAction cancelAction;
+        cancelAction.type = OrderAction::Type::CANCEL;
+        cancelAction.orderId = order.orderId;
+        cancelAction.symbolId = symbolId_;
+        actions.push_back(cancelAction);
+        
+        // Update tracking variables if needed
+        if (order.isBid && order.orderId == currentBidOrderId_) {
+            currentBidOrderId_ = 0;
+        } else if (!order.isBid && order.orderId == currentAskOrderId_) {
+            currentAskOrderId_ = 0;
         }
-    }
-    
-    // Remove canceled orders from active orders list
-    for (uint64_t orderId : orderIdsToRemove) {
-        removeOrder(orderId);
-    }
+        return true;
+    });
     
     return actions;
 }
@@ -146,25 +154,21 @@ std::vector<OrderAction> BasicStrategy::updateOrdersForBookTop(const book_top_t&
         return actions;
     }
     
-    static uint64_t lastOrderTime = 0;
-    static int64_t lastBidPrice = 0;
-    static int64_t lastAskPrice = 0;
-    
-    if (lastOrderTime > 0 && bookTop.ts - lastOrderTime < TEN_MINUTES_NS) {
+    if (lastOrderTime_ > 0 && bookTop.ts - lastOrderTime_ < TEN_MINUTES_NS) {
         return actions;
     }
     
     // Check if top of book has changed
-    bool topChanged = (bookTop.top_level.bid_nanos != lastBidPrice || 
-                       bookTop.top_level.ask_nanos != lastAskPrice);
+    bool topChanged = (bookTop.top_level.bid_nanos != lastBidPrice_ || 
+                       bookTop.top_level.ask_nanos != lastAskPrice_);
     
     if (!topChanged) {
         return actions;
     }
     
     // Update the last known prices
-    lastBidPrice = bookTop.top_level.bid_nanos;
-    lastAskPrice = bookTop.top_level.ask_nanos;
+    lastBidPrice_ = bookTop.top_level.bid_nanos;
+    lastAskPrice_ = bookTop.top_level.ask_nanos;
 
     // Place buy order at the bid price
     int64_t bidPrice = bookTop.top_level.bid_nanos;
@@ -193,9 +197,9 @@ std::vector<OrderAction> BasicStrategy::updateOrdersForBookTop(const book_top_t&
     bidOrderInfo.price = bidPrice;
     bidOrderInfo.quantity = bidQty;
     bidOrderInfo.isBid = true;
-    activeOrders_.push_back(bidOrderInfo);
+    activeOrders_.add(bidOrderInfo, bookTop.ts + TEN_MINUTES_NS);
 
-    lastOrderTime = bookTop.ts;
+    lastOrderTime_ = bookTop.ts;
     // Place sell order at the ask price
     int64_t askPrice = bookTop.top_level.ask_nanos;
     uint32_t askQty = 1;
@@ -223,9 +227,9 @@ std::vector<OrderAction> BasicStrategy::updateOrdersForBookTop(const book_top_t&
     askOrderInfo.price = askPrice;
     askOrderInfo.quantity = askQty;
     askOrderInfo.isBid = false;
-    activeOrders_.push_back(askOrderInfo);
+    activeOrders_.add(askOrderInfo, bookTop.ts + TEN_MINUTES_NS);
 
-    lastOrderTime = bookTop.ts;
+    lastOrderTime_ = bookTop.ts;
     
     return actions;
 }
\ No newline at end of file
@@ -2,43 +2,48 @@
 #define BASIC_MARKET_MAKER_H
 
 #include "strategy.h"
+#include "order_tracker.h"
 #include <map>
 #include <string>
 #include <vector>
 #include <utility>
 
-class BasicStrategy : public Strategy {
+class BasicStrategy final : public Strategy {
 public:
     BasicStrategy();
     
     std::vector<OrderAction> onBookTopUpdate(const book_top_t& bookTop) override;
-    std::vector<OrderAction> onFill(const book_fill_snapshot_t& fill) override;
+    // Market fills do not affect this strategy; defined inline so the
+    // statically bound simulator can drop the call entirely
+    std::vector<OrderAction> onFill(const book_fill_snapshot_t& /* fill */) override { return {}; }
     std::vector<OrderAction> onOrderFilled(uint64_t orderId, int64_t fillPrice, 
                                          uint32_t fillQty, bool isBid) override;
+    std::vector<OrderAction> onTimer(uint64_t orderId, uint64_t timestamp) override;
     
     void setSymbolId(uint64_t symbolId) override;
+    void setTimerService(TimerService* timerService) override;
     std::string getName() const override;
+    size_t memoryBytes() const override;
     
 private:
-    struct OrderInfo {
-        uint64_t orderId;
-        uint64_t creationTime;
-        int64_t price;
-        uint32_t quantity;
-        bool isBid;
-    };
+    using OrderInfo = OrderTracker::OrderInfo;
 
     uint64_t symbolId_;
     uint64_t nextOrderId_;
     
     // Track all active orders
-    std::vector<OrderInfo> activeOrders_;
+    OrderTracker activeOrders_;
 
     uint64_t currentBidOrderId_;
     uint64_t currentAskOrderId_;
     int64_t currentBidPrice_;
     int64_t currentAskPrice_;
     
+    // Quoting throttle: time and top of book of the last quote placed
+    uint64_t lastOrderTime_;
+    int64_t lastBidPrice_;
+    int64_t lastAskPrice_;
+    
     // Helper function to update orders based on the book top
     std::vector<OrderAction> updateOrdersForBookTop(const book_top_t& bookTop);
 
@@ -1,18 +1,25 @@
 #include "correlation_strategy.h"
+#include "../engine/memory_account.h"
 #include <iostream>
+#include <stdexcept>
 #include <fstream>
-#include <sstream>
+#include <charconv>
+#include <string_view>
 #include <algorithm>
 #include <cmath>
 #include <filesystem>
+#include <cstring>
+#include <cstddef>
 
 CorrelationStrategy::CorrelationStrategy(const std::string& correlation_csv_path,
+                                       const std::string& symbol_map_path,
                                        double place_edge_percent,
                                        double cancel_edge_percent,
                                        double self_weight,
                                        const std::string& data_path)
     : symbolId_(0),
       symbol_name_(""),
+      own_mid_price_(0),
       place_edge_percent_(place_edge_percent),
       cancel_edge_percent_(cancel_edge_percent),
       self_weight_(self_weight),
@@ -22,26 +29,43 @@ CorrelationStrategy::CorrelationStrategy(const std::string& correlation_csv_path
       currentAskOrderId_(0),
       currentBidPrice_(0),
       currentAskPrice_(0),
-      lastTheoPrice_(0) {
+      lastTheoPrice_(0),
+      price_window_(MAX_HISTORY_POINTS, MAX_HISTORY_TIME_NS) {
     
     // Load correlation data
     loadCorrelationData(correlation_csv_path);
     
     // Initialize symbol ID to name mapping
-    initializeSymbolMapping();
+    initializeSymbolMapping(symbol_map_path);
     
     std::cout << "Correlation Strategy initialized with:" << std::endl;
     std::cout << "  - Place edge: " << place_edge_percent_ << "%" << std::endl;
     std::cout << "  - Cancel edge: " << cancel_edge_percent_ << "%" << std::endl;
     std::cout << "  - Self weight: " << self_weight_ << std::endl;
     std::cout << "  - Data path: " << (data_path_.empty() ? "Not specified" : data_path_) << std::endl;
-    std::cout << "  - Loaded data for " << correlations_.size() << " symbols" << std::endl;
+    std::cout << "  - Loaded data for " << correlations_.symbolCount() << " symbols" << std::endl;
 }
 
 std::string CorrelationStrategy::getName() const {
     return "Correlation Strategy";
 }
 
+// Correlated symbols' tapes and tops are mapped files and not counted; the
+// books rebuilt from their events are
+size_t CorrelationStrategy::memoryBytes() const {
+    size_t bytes = sizeof(*this) + activeOrders_.memoryBytes() + correlations_.memoryBytes() +
+                   hashTableMemoryBytes(symbol_id_to_name_) + hashTableMemoryBytes(symbol_name_to_id_) +
+                   vectorMemoryBytes(top_correlations_) + vectorMemoryBytes(corr_mid_prices_) +
+                   vectorMemoryBytes(corr_weights_) + vectorMemoryBytes(corr_negative_) +
+                   vectorMemoryBytes(correlated_symbols_data_);
+    for (const auto& data : correlated_symbols_data_) {
+        if (data.book) {
+            bytes += data.book->memoryBytes();
+        }
+    }
+    return bytes;
+}
+
 // Helper function to convert string to lowercase
 std::string CorrelationStrategy::lowercase(const std::string& s) {
     std::string result = s;
@@ -59,9 +83,13 @@ void CorrelationStrategy::setSymbolId(uint64_t symbolId) {
         symbol_name_ = it->second;
         
         // Get top correlations for this symbol
-        auto corr_it = correlations_.find(symbol_name_);
-        if (corr_it != correlations_.end()) {
-            top_correlations_ = corr_it->second;
+        int64_t corr_symbol = correlations_.find(symbol_name_);
+        if (corr_symbol >= 0) {
+            top_correlations_.clear();
+            for (auto entry = correlations_.begin(corr_symbol); entry != correlations_.end(corr_symbol); ++entry) {
+                top_correlations_.emplace_back(std::string(correlations_.name(entry->symbol)), entry->correlation);
+            }
+            initializeCorrelationSlots();
             std::cout << "Found " << top_correlations_.size() << " correlated symbols for " << symbol_name_ << std::endl;
             
             // Print top correlations
@@ -70,18 +98,12 @@ void CorrelationStrategy::setSymbolId(uint64_t symbolId) {
             }
             
             // Use the data path from constructor
-            std::string main_symbol_path;
-            
             if (!data_path_.empty()) {
-                main_symbol_path = data_path_;
+                std::cout << "Using data file: " << data_path_ << std::endl;
+                loadCorrelatedSymbolsData(data_path_);
             } else {
-                // Ask user for the path as a fallback
-                std::cout << "Enter path to the main symbol's data file: ";
-                std::cin >> main_symbol_path;
+                std::cout << "No data path given; correlated symbols will have no market data" << std::endl;
             }
-            
-            std::cout << "Using data file: " << main_symbol_path << std::endl;
-            loadCorrelatedSymbolsData(main_symbol_path);
         } else {
             std::cout << "No correlation data found for symbol " << symbol_name_ << std::endl;
         }
@@ -91,106 +113,78 @@ void CorrelationStrategy::setSymbolId(uint64_t symbolId) {
     }
 }
 
-void CorrelationStrategy::loadCorrelationData(const std::string& csv_path) {
-    std::ifstream file(csv_path);
-    if (!file.is_open()) {
-        std::cerr << "Error: Could not open correlation CSV file: " << csv_path << std::endl;
-        exit(1);
-    }
-    
-    // Read header
-    std::string header;
-    std::getline(file, header);
-    
-    // Verify header format
-    std::stringstream header_ss(header);
-    std::string col1, col2, col3;
-    std::getline(header_ss, col1, ',');
-    std::getline(header_ss, col2, ',');
-    std::getline(header_ss, col3, ',');
-    
-    if (col1 != "symbol1" || col2 != "symbol2" || col3 != "overall_correlation") {
-        std::cerr << "Warning: CSV header doesn't match expected format 'symbol1,symbol2,overall_correlation'" << std::endl;
-        std::cerr << "Actual header: " << header << std::endl;
-        std::cerr << "Attempting to continue with best effort parsing..." << std::endl;
-    }
-    
-    // Read data
-    std::string line;
-    int line_count = 0;
-    while (std::getline(file, line)) {
-        line_count++;
-        std::stringstream ss(line);
-        std::string symbol1, symbol2;
-        double correlation;
-        
-        // Parse line
-        if (!std::getline(ss, symbol1, ',') || 
-            !std::getline(ss, symbol2, ',') || 
-            !(ss >> correlation)) {
-            
-            std::cerr << "Warning: Could not parse line " << line_count << ": " << line << std::endl;
-            continue;
-        }
-        
-        // Store correlation in both directions
-        correlations_[symbol1].push_back(CorrelatedSymbol(symbol2, correlation));
-        correlations_[symbol2].push_back(CorrelatedSymbol(symbol1, correlation));
+void CorrelationStrategy::setTimerService(TimerService* timerService) {
+    Strategy::setTimerService(timerService);
+    activeOrders_.setTimerService(timerService);
+}
+
+// Lay out the correlated symbols' per-tick state in dense slots
+void CorrelationStrategy::initializeCorrelationSlots() {
+    size_t count = top_correlations_.size();
+    corr_mid_prices_.assign(count, 0);
+    corr_weights_.assign(count, 0.0);
+    corr_negative_.assign(count, 0);
+    
+    for (size_t slot = 0; slot < count; ++slot) {
+        double correlation = top_correlations_[slot].correlation;
+        corr_weights_[slot] = (1.0 - self_weight_) * getCorrelationFactor(correlation);
+        corr_negative_[slot] = correlation < 0;
     }
-    
-    // Sort and limit to top N correlations
-    for (auto& [symbol, corrs] : correlations_) {
-        std::sort(corrs.begin(), corrs.end(), 
-                 [](const CorrelatedSymbol& a, const CorrelatedSymbol& b) {
-                     return std::abs(a.correlation) > std::abs(b.correlation);
-                 });
-        
-        // Trim to top MAX_CORRELATED_SYMBOLS
-        if (corrs.size() > MAX_CORRELATED_SYMBOLS) {
-            corrs.resize(MAX_CORRELATED_SYMBOLS);
-        }
+}
+
+void CorrelationStrategy::loadCorrelationData(const std::string& csv_path) {
+    if (!correlations_.load(csv_path, MAX_CORRELATED_SYMBOLS)) {
+        throw std::runtime_error("Could not open correlation CSV file: " + csv_path);
     }
     
-    std::cout << "Loaded correlations for " << correlations_.size() << " symbols from " 
-              << line_count << " correlation pairs" << std::endl;
+    std::cout << "Loaded correlations for " << correlations_.symbolCount() << " symbols from " 
+              << correlations_.pairCount() << " correlation pairs"
+              << (correlations_.fromCache() ? " (cached)" : "") << std::endl;
 }
 
-void CorrelationStrategy::initializeSymbolMapping() {
-    std::string symbol_map_file;
-    std::cout << "Enter path to symbol mapping CSV file: ";
-    std::cin >> symbol_map_file;
-    
-    std::ifstream file(symbol_map_file);
-    if (!file.is_open()) {
-        std::cerr << "Error: Could not open symbol mapping file: " << symbol_map_file << std::endl;
-        exit(1);
+// Trim spaces, tabs and line endings from both ends
+static std::string_view trim(std::string_view s) {
+    size_t first = s.find_first_not_of(" \t\r\n");
+    if (first == std::string_view::npos) {
+        return {};
     }
+    return s.substr(first, s.find_last_not_of(" \t\r\n") - first + 1);
+}
+
+void CorrelationStrategy::initializeSymbolMapping(const std::string& symbol_map_file) {
+    MappedFile file;
+    if (!file.open(symbol_map_file)) {
+        throw std::runtime_error("Could not open symbol mapping file: " + symbol_map_file);
+    }
+    
+    std::string_view text(file.data(), file.size());
+    size_t pos = 0;
+    auto nextLine = [&]() {
+        size_t end = text.find('\n', pos);
+        if (end == std::string_view::npos) end = text.size();
+        std::string_view line = text.substr(pos, end - pos);
+        pos = end + 1;
+        return line;
+    };
     
     // Read header
-    std::string header;
-    std::getline(file, header);
+    std::string_view header = nextLine();
     
     // Determine delimiter based on header content
     char delimiter = ' ';
-    if (header.find(',') != std::string::npos) {
+    if (header.find(',') != std::string_view::npos) {
         delimiter = ',';
         std::cout << "Detected comma-separated format" << std::endl;
-    } else if (header.find('\t') != std::string::npos) {
+    } else if (header.find('\t') != std::string_view::npos) {
         delimiter = '\t';
         std::cout << "Detected tab-separated format" << std::endl;
     }
     
     // Verify header format
-    std::stringstream header_ss(header);
-    std::string col1, col2;
-    std::getline(header_ss, col1, delimiter);
-    std::getline(header_ss, col2, delimiter);
-    
-    // Trim whitespace
-    col1.erase(0, col1.find_first_not_of(" \t\r\n"));
-    col1.erase(col1.find_last_not_of(" \t\r\n") + 1);
-    col2.erase(0, col2.find_first_not_of(" \t\r\n"));
-    col2.erase(col2.find_last_not_of(" \t\r\n") + 1);
+    size_t header_split = header.find(delimiter);
+    std::string_view col1 = trim(header.substr(0, header_split));
+    std::string_view col2 = header_split == std::string_view::npos ? std::string_view() :
+        trim(header.substr(header_split + 1, header.find(delimiter, header_split + 1) - header_split - 1));
     
     if (col1 != "stock_locate" || col2 != "symbol") {
         std::cerr << "Warning: CSV header doesn't match expected format 'stock_locate,symbol'" << std::endl;
@@ -199,39 +193,30 @@ void CorrelationStrategy::initializeSymbolMapping() {
     }
     
     // Read data
-    std::string line;
     int loaded_count = 0;
-    while (std::getline(file, line)) {
-        std::stringstream ss(line);
-        std::string locate_str, symbol;
+    while (pos < text.size()) {
+        std::string_view line = nextLine();
         
         // Parse line using delimiter
-        if (!std::getline(ss, locate_str, delimiter) || 
-            !std::getline(ss, symbol)) {
-            
+        size_t split = line.find(delimiter);
+        if (split == std::string_view::npos) {
             std::cerr << "Warning: Could not parse line: " << line << std::endl;
             continue;
         }
         
-        // Trim whitespace
-        locate_str.erase(0, locate_str.find_first_not_of(" \t\r\n"));
-        locate_str.erase(locate_str.find_last_not_of(" \t\r\n") + 1);
-        
-        symbol.erase(0, symbol.find_first_not_of(" \t\r\n"));
-        symbol.erase(symbol.find_last_not_of(" \t\r\n") + 1);
+        std::string_view locate_str = trim(line.substr(0, split));
+        std::string_view symbol = trim(line.substr(split + 1));
         
         // Convert locate to uint64_t
         uint64_t locate = 0;
-        try {
-            locate = std::stoull(locate_str);
-        } catch (const std::exception& e) {
+        if (std::from_chars(locate_str.data(), locate_str.data() + locate_str.size(), locate).ec != std::errc()) {
             std::cerr << "Warning: Could not convert stock_locate to number: " << locate_str << std::endl;
             continue;
         }
         
         // Store the mapping both ways
-        symbol_id_to_name_[locate] = symbol;
-        symbol_name_to_id_[symbol] = locate;
+        symbol_id_to_name_[locate] = std::string(symbol);
+        symbol_name_to_id_[std::string(symbol)] = locate;
         loaded_count++;
     }
     
@@ -269,9 +254,11 @@ void CorrelationStrategy::loadCorrelatedSymbolsData(const std::string& main_symb
               << "." << file_type << ".SYMBOL.bin" << std::endl;
     
     // Load data for each correlated symbol
-    for (const auto& corr : top_correlations_) {
+    for (size_t slot = 0; slot < top_correlations_.size(); ++slot) {
+        const auto& corr = top_correlations_[slot];
         SymbolData symbol_data;
         symbol_data.symbol = corr.symbol;
+        symbol_data.slot = slot;
         symbol_data.is_valid = true;
         
         if (using_book_events_) {
@@ -279,21 +266,13 @@ void CorrelationStrategy::loadCorrelatedSymbolsData(const std::string& main_symb
             std::string events_path = base_path_ + exchange + ".book_events." + corr.symbol + ".bin";
             std::cout << "  Opening " << events_path << " for " << corr.symbol << std::endl;
             
-            symbol_data.book_events_file.open(events_path, std::ios::binary);
-            if (!symbol_data.book_events_file.is_open()) {
+            if (!symbol_data.book_events.open(events_path)) {
                 std::cerr << "    Failed to open book events file for " << corr.symbol << std::endl;
                 symbol_data.is_valid = false;
             } else {
-                // Skip the header
-                book_events_file_hdr_t header;
-                symbol_data.book_events_file.read(reinterpret_cast<char*>(&header), sizeof(book_events_file_hdr_t));
-                if (!symbol_data.book_events_file) {
-                    std::cerr << "    Failed to read header from book events file for " << corr.symbol << std::endl;
-                    symbol_data.is_valid = false;
-                } else {
-                    std::cout << "    Successfully opened book events file for " << corr.symbol 
-                              << " (symbol_idx: " << header.symbol_idx << ")" << std::endl;
-                }
+                symbol_data.book = std::make_unique<QueueBook>();
+                std::cout << "    Successfully opened book events file for " << corr.symbol 
+                          << " (symbol_idx: " << symbol_data.book_events.header().symbol_idx << ")" << std::endl;
             }
         } else {
             // Construct paths for book_tops and book_fills
@@ -301,20 +280,18 @@ void CorrelationStrategy::loadCorrelatedSymbolsData(const std::string& main_symb
             std::string fills_path = base_path_ + exchange + ".book_fills." + corr.symbol + ".bin";
             
             std::cout << "  Opening " << tops_path << " for " << corr.symbol << std::endl;
-            symbol_data.book_tops_file.open(tops_path, std::ios::binary);
-            if (!symbol_data.book_tops_file.is_open()) {
+            if (!symbol_data.book_tops.open(tops_path)) {
                 std::cerr << "    Failed to open book tops file for " << corr.symbol << std::endl;
                 symbol_data.is_valid = false;
+            } else if (symbol_data.book_tops.size() < sizeof(book_tops_file_hdr_t)) {
+                std::cerr << "    Failed to read header from book tops file for " << corr.symbol << std::endl;
+                symbol_data.is_valid = false;
             } else {
                 book_tops_file_hdr_t header;
-                symbol_data.book_tops_file.read(reinterpret_cast<char*>(&header), sizeof(book_tops_file_hdr_t));
-                if (!symbol_data.book_tops_file) {
-                    std::cerr << "    Failed to read header from book tops file for " << corr.symbol << std::endl;
-                    symbol_data.is_valid = false;
-                } else {
-                    std::cout << "    Successfully opened book tops file for " << corr.symbol 
-                              << " (symbol_idx: " << header.symbol_idx << ")" << std::endl;
-                }
+                std::memcpy(&header, symbol_data.book_tops.data(), sizeof(book_tops_file_hdr_t));
+                symbol_data.next_top_offset = sizeof(book_tops_file_hdr_t);
+                std::cout << "    Successfully opened book tops file for " << corr.symbol 
+                          << " (symbol_idx: " << header.symbol_idx << ")" << std::endl;
             }
             
             std::cout << "  Opening " << fills_path << " for " << corr.symbol << std::endl;
@@ -337,13 +314,11 @@ void CorrelationStrategy::loadCorrelatedSymbolsData(const std::string& main_symb
             // Read the first book top to initialize
             if (symbol_data.is_valid) {
                 book_top_t bookTop;
-                symbol_data.book_tops_file.read(reinterpret_cast<char*>(&bookTop), sizeof(book_top_t));
-                if (symbol_data.book_tops_file.gcount() == sizeof(book_top_t)) {
+                if (readNextTop(symbol_data, bookTop)) {
                     symbol_data.last_book_top = bookTop;
                     
                     // Store the initial mid price
-                    uint64_t symbol_id = symbol_name_to_id_[corr.symbol];
-                    symbol_mid_prices_[symbol_id] = (bookTop.top_level.bid_nanos + bookTop.top_level.ask_nanos) / 2;
+                    corr_mid_prices_[slot] = (bookTop.top_level.bid_nanos + bookTop.top_level.ask_nanos) / 2;
                 } else {
                     std::cerr << "    Failed to read initial book top for " << corr.symbol << std::endl;
                     symbol_data.is_valid = false;
@@ -352,7 +327,7 @@ void CorrelationStrategy::loadCorrelatedSymbolsData(const std::string& main_symb
         }
         
         if (symbol_data.is_valid) {
-            correlated_symbols_data_[corr.symbol] = std::move(symbol_data);
+            correlated_symbols_data_.push_back(std::move(symbol_data));
         }
     }
     
@@ -362,172 +337,36 @@ void CorrelationStrategy::loadCorrelatedSymbolsData(const std::string& main_symb
 // Process market data for correlated symbols up to the current timestamp
 void CorrelationStrategy::processCorrelatedSymbolsData(uint64_t current_ts) {
     if (using_book_events_) {
-        // Process book events files
-        for (auto& [symbol, data] : correlated_symbols_data_) {
+        // Rebuild each correlated book up to current_ts
+        for (auto& data : correlated_symbols_data_) {
             if (!data.is_valid) continue;
             
-            // Read book events until we reach current_ts
-            book_event_hdr_t eventHeader;
-            bool has_update = false;
-            bool topChanged = false;
-            
-            // Maintain a simplified top-of-book for each symbol
-            int64_t best_bid = 0;
-            int64_t best_ask = INT64_MAX;
+            if (!advanceBook(data, current_ts)) continue;
             
-            while (data.book_events_file.peek() != EOF) {
-                // Read event header
-                data.book_events_file.read(reinterpret_cast<char*>(&eventHeader), sizeof(book_event_hdr_t));
-                
-                if (!data.book_events_file) {
-                    data.is_valid = false;
-                    break;
-                }
-                
-                if (eventHeader.ts > current_ts) {
-                    data.book_events_file.seekg(-static_cast<int>(sizeof(book_event_hdr_t)), std::ios::cur);
-                    break;
-                }
-                
-                has_update = true;
-                
-                // Process based on event type
-                switch (eventHeader.type) {
-                    case book_event_type_e::add_order: {
-                        add_order_t addOrder;
-                        data.book_events_file.read(reinterpret_cast<char*>(&addOrder), sizeof(add_order_t));
-                        
-                        if (!data.book_events_file) {
-                            data.is_valid = false;
-                            break;
-                        }
-                        
-                        // Update best bid/ask
-                        if (addOrder.is_bid) {
-                            if (addOrder.price > best_bid) {
-                                best_bid = addOrder.price;
-                                topChanged = true;
-                            }
-                        } else {
-                            if (addOrder.price < best_ask) {
-                                best_ask = addOrder.price;
-                                topChanged = true;
-                            }
-                        }
-                        break;
-                    }
-                    
-                    case book_event_type_e::delete_order: {
-                        delete_order_t deleteOrder;
-                        data.book_events_file.read(reinterpret_cast<char*>(&deleteOrder), sizeof(delete_order_t));
-                        break;
-                    }
-                    
-                    case book_event_type_e::replace_order: {
-                        replace_order_t replaceOrder;
-                        data.book_events_file.read(reinterpret_cast<char*>(&replaceOrder), sizeof(replace_order_t));
-                        topChanged = true;
-                        break;
-                    }
-                    
-                    case book_event_type_e::amend_order: {
-                        amend_order_t amendOrder;
-                        data.book_events_file.read(reinterpret_cast<char*>(&amendOrder), sizeof(amend_order_t));
-                        break;
-                    }
-                    
-                    case book_event_type_e::reduce_order: {
-                        reduce_order_t reduceOrder;
-                        data.book_events_file.read(reinterpret_cast<char*>(&reduceOrder), sizeof(reduce_order_t));
-                        break;
-                    }
-                    
-                    case book_event_type_e::execute_order: {
-                        execute_order_t executeOrder;
-                        data.book_events_file.read(reinterpret_cast<char*>(&executeOrder), sizeof(execute_order_t));
-                        topChanged = true;
-                        break;
-                    }
-                    
-                    case book_event_type_e::execute_order_at_price: {
-                        execute_order_at_price_t executeOrderAtPrice;
-                        data.book_events_file.read(reinterpret_cast<char*>(&executeOrderAtPrice), sizeof(execute_order_at_price_t));
-                        topChanged = true;
-                        break;
-                    }
-                    
-                    case book_event_type_e::clear_book: {
-                        // Clear the book
-                        best_bid = 0;
-                        best_ask = INT64_MAX;
-                        topChanged = true;
-                        break;
-                    }
-                    
-                    case book_event_type_e::session_event: {
-                        session_event_t sessionEvent;
-                        data.book_events_file.read(reinterpret_cast<char*>(&sessionEvent), sizeof(session_event_t));
-                        break;
-                    }
-                    
-                    case book_event_type_e::hidden_trade: {
-                        hidden_trade_t hiddenTrade;
-                        data.book_events_file.read(reinterpret_cast<char*>(&hiddenTrade), sizeof(hidden_trade_t));
-                        break;
-                    }
-                    
-                    default:
-                        // Skip any unknown event types
-                        break;
-                }
-            }
-            
-            if (has_update && topChanged && best_bid > 0 && best_ask < INT64_MAX && best_bid < best_ask) {
-                // Update the mid price
-                uint64_t symbol_id = symbol_name_to_id_[symbol];
-                int64_t mid_price = (best_bid + best_ask) / 2;
-                symbol_mid_prices_[symbol_id] = mid_price;
-                
-                // Update the stored book top
-                data.last_book_top.ts = eventHeader.ts;
-                data.last_book_top.seqno = eventHeader.seq_no;
-                data.last_book_top.top_level.bid_nanos = best_bid;
-                data.last_book_top.top_level.ask_nanos = best_ask;
+            // Empty sides are 0 / INT64_MAX, which fail the crossed check
+            const book_top_t& top = data.book->top();
+            if (top.top_level.bid_nanos > 0 && top.top_level.bid_nanos < top.top_level.ask_nanos) {
+                corr_mid_prices_[data.slot] = (top.top_level.bid_nanos + top.top_level.ask_nanos) / 2;
+                data.last_book_top = top;
             }
         }
         return;
     }
     
     // Process book tops files
-    for (auto& [symbol, data] : correlated_symbols_data_) {
+    for (auto& data : correlated_symbols_data_) {
         if (!data.is_valid) continue;
         
         // Read book tops until we reach current_ts
         book_top_t bookTop;
         bool has_update = false;
         
-        while (data.book_tops_file.peek() != EOF) {
-            // Peek at the next book top's timestamp without consuming it
-            data.book_tops_file.read(reinterpret_cast<char*>(&bookTop), sizeof(book_top_t));
-            
-            if (!data.book_tops_file) {
-                data.is_valid = false;
-                break;
-            }
-            
-            if (bookTop.ts > current_ts) {
-                data.book_tops_file.seekg(-static_cast<int>(sizeof(book_top_t)), std::ios::cur);
-                break;
-            }
-            
+        while (peekNextTopTs(data) <= current_ts && readNextTop(data, bookTop)) {
             data.last_book_top = bookTop;
             has_update = true;
         }
         
         if (has_update) {
-            // Update mid price for this symbol
-            uint64_t symbol_id = symbol_name_to_id_[symbol];
-            
             // Validate book top
             if (data.last_book_top.top_level.bid_nanos > 0 && 
                 data.last_book_top.top_level.ask_nanos > 0 &&
@@ -535,12 +374,60 @@ void CorrelationStrategy::processCorrelatedSymbolsData(uint64_t current_ts) {
                 
                 int64_t mid_price = (data.last_book_top.top_level.bid_nanos + 
                                     data.last_book_top.top_level.ask_nanos) / 2;
-                symbol_mid_prices_[symbol_id] = mid_price;
+                corr_mid_prices_[data.slot] = mid_price;
             }
         }
     }
 }
 
+// Apply every event of the tape with a timestamp <= ts to the symbol's book,
+// publishing its top if any of them may have moved it. Returns true if the
+// top was republished. Executions are part of the book; their fills are not
+// needed here.
+bool CorrelationStrategy::advanceBook(SymbolData& data, uint64_t ts) {
+    bool topChanged = false;
+    book_event_hdr_t eventHeader;
+    const char* payload;
+    book_fill_snapshot_t fill;
+    bool hasFill;
+
+    while (!data.book_events.atEnd() && data.book_events.peekTs() <= ts) {
+        if (!data.book_events.next(eventHeader, payload)) {
+            break;
+        }
+        topChanged |= data.book->apply(eventHeader, payload, fill, hasFill);
+    }
+    if (topChanged) {
+        data.book->updateTopLevels();
+    }
+    return topChanged;
+}
+
+// Timestamp of the next mapped book top, UINT64_MAX once the file is done
+uint64_t CorrelationStrategy::peekNextTopTs(const SymbolData& data) {
+    if (data.book_tops.size() - data.next_top_offset < sizeof(book_top_t)) {
+        return UINT64_MAX;
+    }
+    uint64_t ts;
+    std::memcpy(&ts, data.book_tops.data() + data.next_top_offset + offsetof(book_top_t, ts), sizeof(ts));
+    return ts;
+}
+
+bool CorrelationStrategy::readNextTop(SymbolData& data, book_top_t& bookTop) {
+    if (data.book_tops.size() - data.next_top_offset < sizeof(book_top_t)) {
+        return false;
+    }
+    std::memcpy(&bookTop, data.book_tops.data() + data.next_top_offset, sizeof(book_top_t));
+    data.next_top_offset += sizeof(book_top_t);
+
+    // Tops are copied out, so everything read can go
+    if (data.next_top_offset - data.released_top_offset >= TOPS_RELEASE_BYTES) {
+        data.book_tops.release(data.released_top_offset, data.next_top_offset - data.released_top_offset);
+        data.released_top_offset = data.next_top_offset;
+    }
+    return true;
+}
+
 std::vector<OrderAction> CorrelationStrategy::onBookTopUpdate(const book_top_t& bookTop) {
     // Skip invalid book tops
     if (bookTop.top_level.bid_nanos <= 0 || bookTop.top_level.ask_nanos <= 0 ||
@@ -553,10 +440,13 @@ std::vector<OrderAction> CorrelationStrategy::onBookTopUpdate(const book_top_t&
     
     // Calculate mid price for this symbol
     int64_t mid_price = (bookTop.top_level.bid_nanos + bookTop.top_level.ask_nanos) / 2;
-    symbol_mid_prices_[symbolId_] = mid_price;
+    own_mid_price_ = mid_price;
     
-    // Check for stale orders
-    std::vector<OrderAction> actions = checkForStaleOrders(bookTop.ts);
+    // Check for stale orders, unless expiry timers take care of them
+    std::vector<OrderAction> actions;
+    if (timerService_ == nullptr) {
+        actions = checkForStaleOrders(bookTop.ts);
+    }
     
     // Update orders based on new theoretical price
     std::vector<OrderAction> newActions = updateOrdersForBookTop(bookTop);
@@ -572,7 +462,7 @@ std::vector<OrderAction> CorrelationStrategy::onFill(const book_fill_snapshot_t&
         int64_t bid = fill.resting_side_price;
         int64_t ask = fill.opposing_side_price;
         if (bid > 0 && ask > 0 && bid < ask) {
-            symbol_mid_prices_[symbolId_] = (bid + ask) / 2;
+            own_mid_price_ = (bid + ask) / 2;
         }
     }
     return {};
@@ -593,63 +483,61 @@ std::vector<OrderAction> CorrelationStrategy::onOrderFilled(uint64_t orderId, in
     return {};
 }
 
+std::vector<OrderAction> CorrelationStrategy::onTimer(uint64_t orderId, uint64_t /* timestamp */) {
+    // The order reached its 10-minute expiry
+    if (!activeOrders_.contains(orderId)) {
+        return {};
+    }
+    
+    OrderAction cancelAction;
+    cancelAction.type = OrderAction::Type::CANCEL;
+    cancelAction.orderId = orderId;
+    cancelAction.symbolId = symbolId_;
+    
+    removeOrder(orderId);
+    if (orderId == currentBidOrderId_) {
+        currentBidOrderId_ = 0;
+    } else if (orderId == currentAskOrderId_) {
+        currentAskOrderId_ = 0;
+    }
+    return {cancelAction};
+}
+
 int64_t CorrelationStrategy::calculateTheoreticalPrice(const book_top_t& bookTop) {
     // Start with this symbol's mid price
     int64_t mid_price = (bookTop.top_level.bid_nanos + bookTop.top_level.ask_nanos) / 2;
     uint64_t current_ts = bookTop.ts;
 
-    // Store price in history
-    auto& history = symbol_price_history_[symbolId_];
-    history.push_back({current_ts, mid_price});
-
-    // Trim old data
-    while (!history.empty() && (history.size() > MAX_HISTORY_POINTS || 
-        current_ts - history.front().first > MAX_HISTORY_TIME_NS)) {
-        history.pop_front();
-    }
+    // Store price in history and trim old data
+    price_window_.push(current_ts, mid_price);
+    price_window_.expire(current_ts);
 
     // Calculate time-weighted average
-    double total_weight = 0;
-    double weighted_price_sum = 0;
-
-    for (const auto& [ts, price] : history) {
-        double time_weight = 1.0 - std::min(1.0, (current_ts - ts) / static_cast<double>(MAX_HISTORY_TIME_NS));
-        weighted_price_sum += price * time_weight;
-        total_weight += time_weight;
-    }
+    RollingWindow::DecaySums decay = price_window_.linearDecay(current_ts);
+    double total_weight = decay.weightSum;
+    double weighted_price_sum = decay.weightedSum;
 
     // Use time-weighted average as the base price
     if (total_weight > 0) {
         mid_price = static_cast<int64_t>(weighted_price_sum / total_weight);
     }
 
-    for (auto& corr : top_correlations_) {
+    for (size_t slot = 0; slot < corr_mid_prices_.size(); ++slot) {
         // Skip if we don't have a price for this symbol
-        uint64_t corr_symbol_id = 0;
-        auto it = symbol_name_to_id_.find(corr.symbol);
-        if (it != symbol_name_to_id_.end()) {
-            corr_symbol_id = it->second;
-        }
-        
-        auto price_it = symbol_mid_prices_.find(corr_symbol_id);
-        if (price_it == symbol_mid_prices_.end() || price_it->second <= 0) {
+        int64_t corr_mid_price = corr_mid_prices_[slot];
+        if (corr_mid_price <= 0) {
             continue;
         }
         
-        // Store the mid price
-        corr.last_mid_price = price_it->second;
-        
-        // Calculate correlation factor and weight
-        double corr_factor = getCorrelationFactor(corr.correlation);
-        double weight = (1.0 - self_weight_) * corr_factor;
+        double weight = corr_weights_[slot];
         
         double contribution;
-        if (corr.correlation >= 0) {
+        if (!corr_negative_[slot]) {
             // Positive correlation
-            contribution = weight * corr.last_mid_price;
+            contribution = weight * corr_mid_price;
         } else {
             // Negative correlation
-            contribution = weight * (2 * mid_price - corr.last_mid_price);
+            contribution = weight * (2 * mid_price - corr_mid_price);
         }
         
         weighted_price_sum += contribution;
@@ -671,34 +559,28 @@ double CorrelationStrategy::getCorrelationFactor(double correlation) {
 
 std::vector<OrderAction> CorrelationStrategy::checkForStaleOrders(uint64_t currentTimestamp) {
     std::vector<OrderAction> actions;
-    std::vector<uint64_t> orderIdsToRemove;
-    
-    // Check for active orders
-    for (const auto& order : activeOrders_) {
-        if (currentTimestamp - order.creationTime >= TEN_MINUTES_NS) {
-            // Order is older than 10 minutes, cancel it
-            OrderAction cancelAction;
-            cancelAction.type = OrderAction::Type::CANCEL;
-            cancelAction.orderId = order.orderId;
-            cancelAction.symbolId = symbolId_;
-            actions.push_back(cancelAction);
-            
-            // Track which orders to remove
-            orderIdsToRemove.push_back(order.orderId);
-            
-            // Update tracking variables if needed
-            if (order.isBid && order.orderId == currentBidOrderId_) {
-                currentBidOrderId_ = 0;
-            } else if (!order.isBid && order.orderId == currentAskOrderId_) {
-                currentAskOrderId_ = 0;
-            }
+    
+    // Check for active orders, oldest first, so only the expired ones are visited
+    activeOrders_.removeOldestWhile([&](const OrderInfo& order) {
+        if (currentTimestamp - order.creationTime < TEN_MINUTES_NS) {
+            return false;
         }
-    }
-
-    // Remove canceled orders from active orders list
-    for (uint64_t orderId : orderIdsToRemove) {
-        removeOrder(orderId);
-    }
+        
+        // Order is older than 10 minutes, cancel it
+        OrderAction cancelAction;
+        cancelAction.type = OrderAction::Type::CANCEL;
+        cancelAction.orderId = order.orderId;
+        cancelAction.symbolId = symbolId_;
+        actions.push_back(cancelAction);
+        
+        // Update tracking variables if needed
+        if (order.isBid && order.orderId == currentBidOrderId_) {
+            currentBidOrderId_ = 0;
+        } else if (!order.isBid && order.orderId == currentAskOrderId_) {
+            currentAskOrderId_ = 0;
+        }
+        return true;
+    });
     
     return actions;
 }
@@ -739,9 +621,7 @@ std::vector<OrderAction> CorrelationStrategy::updateOrdersForBookTop(const book_
     // Check if we need to cancel existing orders
     if (currentBidOrderId_ > 0 && (currentBidPrice_ > bidCancelEdge || currentBidPrice_ < bookTop.top_level.bid_nanos)) {
         // Verify order exists before canceling
-        auto it = std::find_if(activeOrders_.begin(), activeOrders_.end(),
-                            [this](const OrderInfo& order) { return order.orderId == currentBidOrderId_; });
-        if (it != activeOrders_.end()) {
+        if (activeOrders_.contains(currentBidOrderId_)) {
             OrderAction cancelBid;
             cancelBid.type = OrderAction::Type::CANCEL;
             cancelBid.orderId = currentBidOrderId_;
@@ -758,9 +638,7 @@ std::vector<OrderAction> CorrelationStrategy::updateOrdersForBookTop(const book_
 
     if (currentAskOrderId_ > 0 && (currentAskPrice_ < askCancelEdge || currentAskPrice_ > bookTop.top_level.ask_nanos)) {
         // Verify order exists before canceling
-        auto it = std::find_if(activeOrders_.begin(), activeOrders_.end(),
-                            [this](const OrderInfo& order) { return order.orderId == currentAskOrderId_; });
-        if (it != activeOrders_.end()) {
+        if (activeOrders_.contains(currentAskOrderId_)) {
             OrderAction cancelAsk;
             cancelAsk.type = OrderAction::Type::CANCEL;
             cancelAsk.orderId = currentAskOrderId_;
@@ -800,7 +678,7 @@ std::vector<OrderAction> CorrelationStrategy::updateOrdersForBookTop(const book_
         bidOrderInfo.price = bidPlaceEdge;
         bidOrderInfo.quantity = 1;
         bidOrderInfo.isBid = true;
-        activeOrders_.push_back(bidOrderInfo);
+        activeOrders_.add(bidOrderInfo, bookTop.ts + TEN_MINUTES_NS);
     }
     
     if (currentAskOrderId_ == 0 && askPlaceEdge > bookTop.top_level.bid_nanos) {
@@ -827,18 +705,13 @@ std::vector<OrderAction> CorrelationStrategy::updateOrdersForBookTop(const book_
         askOrderInfo.price = askPlaceEdge;
         askOrderInfo.quantity = 1;
         askOrderInfo.isBid = false;
-        activeOrders_.push_back(askOrderInfo);
+        activeOrders_.add(askOrderInfo, bookTop.ts + TEN_MINUTES_NS);
     }
     
     return actions;
 }
 
 void CorrelationStrategy::removeOrder(uint64_t orderId) {
-    // Find and remove the order from active orders
-    auto it = std::find_if(activeOrders_.begin(), activeOrders_.end(),
-                          [orderId](const OrderInfo& order) { return order.orderId == orderId; });
-    
-    if (it != activeOrders_.end()) {
-        activeOrders_.erase(it);
-    }
-}
\ No newline at end of file
+    // Remove the order from active orders if it is still tracked
+    activeOrders_.remove(orderId);
+}
@@ -2,18 +2,26 @@
 #define CORRELATION_STRATEGY_H
 
 #include "strategy.h"
+#include "order_tracker.h"
+#include "rolling_window.h"
+#include "correlation_table.h"
+#include "../engine/event_tape.h"
+#include "../engine/queue_book.h"
 #include "../types/market_data_types.h"
 #include <string>
 #include <vector>
 #include <unordered_map>
 #include <map>
-#include <queue>
 #include <memory>
 #include <fstream>
 
-class CorrelationStrategy : public Strategy {
+class CorrelationStrategy final : public Strategy {
 public:
+    // Throws std::runtime_error if the correlation or symbol map file cannot
+    // be read. data_path is the main symbol's market data file; correlated
+    // symbols' files are looked up next to it.
     CorrelationStrategy(const std::string& correlation_csv_path,
+                        const std::string& symbol_map_path,
                         double place_edge_percent = 0.01,
                         double cancel_edge_percent = 0.005,
                         double self_weight = 0.5,
@@ -23,9 +31,12 @@ public:
     std::vector<OrderAction> onFill(const book_fill_snapshot_t& fill) override;
     std::vector<OrderAction> onOrderFilled(uint64_t orderId, int64_t fillPrice, 
                                            uint32_t fillQty, bool isBid) override;
+    std::vector<OrderAction> onTimer(uint64_t orderId, uint64_t timestamp) override;
     
     void setSymbolId(uint64_t symbolId) override;
+    void setTimerService(TimerService* timerService) override;
     std::string getName() const override;
+    size_t memoryBytes() const override;
 
 private:
     // Structure to track correlated symbols
@@ -44,20 +55,24 @@ private:
         }
     };
     
-    // Maps from symbolId to name and back
+    // Maps from symbolId to name and back, only used during setup
     std::unordered_map<uint64_t, std::string> symbol_id_to_name_;
     std::unordered_map<std::string, uint64_t> symbol_name_to_id_;
     
-    // Map of correlated symbols for each symbol
-    std::unordered_map<std::string, std::vector<CorrelatedSymbol>> correlations_;
-    
-    // Track the latest mid prices for all symbols
-    std::unordered_map<uint64_t, int64_t> symbol_mid_prices_;
+    // Top correlated symbols of each symbol
+    CorrelationTable correlations_;
     
     // Current symbol info
     uint64_t symbolId_;
     std::string symbol_name_;
     std::vector<CorrelatedSymbol> top_correlations_;
+    int64_t own_mid_price_;
+    
+    // Per-tick state of the correlated symbols, indexed by dense slot (the
+    // symbol's position in top_correlations_) so the theo never hashes a name
+    std::vector<int64_t> corr_mid_prices_;   // latest mid, 0 until one is seen
+    std::vector<double> corr_weights_;       // (1 - self_weight) * |correlation|
+    std::vector<uint8_t> corr_negative_;     // mirror the price around our mid
     
     // Strategy parameters
     double place_edge_percent_;
@@ -74,18 +89,13 @@ private:
     int64_t lastTheoPrice_;
     
     // Active order tracking
-    struct OrderInfo {
-        uint64_t orderId;
-        uint64_t creationTime;
-        int64_t price;
-        uint32_t quantity;
-        bool isBid;
-    };
-    std::vector<OrderInfo> activeOrders_;
+    using OrderInfo = OrderTracker::OrderInfo;
+    OrderTracker activeOrders_;
     
     // Helper methods
     void loadCorrelationData(const std::string& csv_path);
-    void initializeSymbolMapping();
+    void initializeSymbolMapping(const std::string& symbol_map_file);
+    void initializeCorrelationSlots();
     int64_t calculateTheoreticalPrice(const book_top_t& bookTop);
     double getCorrelationFactor(double correlation);
     std::vector<OrderAction> checkForStaleOrders(uint64_t currentTimestamp);
@@ -94,28 +104,42 @@ private:
     
     static constexpr uint64_t TEN_MINUTES_NS = 600000000000ULL; // 10 minutes in nanoseconds
     static constexpr int MAX_CORRELATED_SYMBOLS = 10;
+    static constexpr size_t TOPS_RELEASE_BYTES = 1 << 20;
 
-        struct SymbolData {
+    // Market data of one correlated symbol. Events mode rebuilds its book
+    // from a mapped event tape on the queue simulation's book engine; tops
+    // mode steps through its mapped tops, dropping the pages it has read
+    // in TOPS_RELEASE_BYTES steps as the event tape does.
+    struct SymbolData {
         std::string symbol;
-        std::ifstream book_events_file;
-        std::ifstream book_tops_file;
+        size_t slot;
+        EventTape book_events;
+        std::unique_ptr<QueueBook> book;
+        MappedFile book_tops;
+        size_t next_top_offset = 0;
+        size_t released_top_offset = 0;     // tops before this are dropped
         std::ifstream book_fills_file;
         book_top_t last_book_top;
         bool is_valid;
     };
 
     std::string base_path_;
-    bool using_book_events_;
-    std::unordered_map<std::string, SymbolData> correlated_symbols_data_;
+    bool using_book_events_ = false;
+    std::vector<SymbolData> correlated_symbols_data_;
 
     void loadCorrelatedSymbolsData(const std::string& main_symbol_path);
     void processCorrelatedSymbolsData(uint64_t current_ts);
+    static bool advanceBook(SymbolData& data, uint64_t ts);
+    static uint64_t peekNextTopTs(const SymbolData& data);
+    static bool readNextTop(SymbolData& data, book_top_t& bookTop);
 
     std::string lowercase(const std::string& s);
 
-    std::unordered_map<uint64_t, std::deque<std::pair<uint64_t, int64_t>>> symbol_price_history_;
-    const size_t MAX_HISTORY_POINTS = 20;
-    const uint64_t MAX_HISTORY_TIME_NS = 60'000'000'000; // 60 seconds in nanoseconds
+    static constexpr size_t MAX_HISTORY_POINTS = 20;
+    static constexpr uint64_t MAX_HISTORY_TIME_NS = 60'000'000'000; // 60 seconds in nanoseconds
+    
+    // Our own recent mids, for the time-weighted base price
+    RollingWindow price_window_;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,327 @@
+#include "correlation_table.h"
+#include "../engine/mapped_file.h"
+#include "../engine/memory_account.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+constexpr char CACHE_MAGIC[8] = {'C', 'O', 'R', 'R', 'T', 'O', 'P', 'N'};
+constexpr uint32_t CACHE_VERSION = 1;
+
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t topN;
+    uint64_t csvSize;
+    uint64_t csvHash;
+    uint64_t pairCount;
+    uint32_t symbolCount;
+    uint32_t entryCount;
+    uint64_t poolSize;
+};
+
+// A pair seen while parsing; seq is the pair's position in the file
+struct Candidate {
+    uint32_t symbol;
+    uint32_t seq;
+    double correlation;
+};
+
+// Larger |correlation| first, then earlier in the file
+bool stronger(const Candidate& a, const Candidate& b) {
+    double absA = std::abs(a.correlation);
+    double absB = std::abs(b.correlation);
+    if (absA != absB) return absA > absB;
+    return a.seq < b.seq;
+}
+
+// Keep the topN strongest candidates of one symbol
+void offer(std::vector<Candidate>& kept, const Candidate& candidate, size_t topN) {
+    if (kept.size() < topN) {
+        kept.push_back(candidate);
+        return;
+    }
+
+    size_t weakest = 0;
+    for (size_t i = 1; i < kept.size(); ++i) {
+        if (stronger(kept[weakest], kept[i])) {
+            weakest = i;
+        }
+    }
+    if (stronger(candidate, kept[weakest])) {
+        kept[weakest] = candidate;
+    }
+}
+
+std::string_view stripCr(std::string_view s) {
+    if (!s.empty() && s.back() == '\r') {
+        s.remove_suffix(1);
+    }
+    return s;
+}
+
+} // namespace
+
+bool CorrelationTable::load(const std::string& csvPath, size_t topN) {
+    pool_.clear();
+    names_.clear();
+    firstEntry_.clear();
+    entries_.clear();
+    index_.clear();
+    pairCount_ = 0;
+    fromCache_ = false;
+
+    MappedFile csv;
+    if (!csv.open(csvPath)) {
+        return false;
+    }
+
+    uint64_t csvHash = hashBytes(csv.data(), csv.size());
+    std::string cachePath = csvPath + ".top" + std::to_string(topN) + ".cache";
+
+    if (readCache(cachePath, csv.size(), csvHash, topN)) {
+        fromCache_ = true;
+    } else {
+        parseCsv(csv.data(), csv.size(), topN);
+        writeCache(cachePath, csv.size(), csvHash, topN);
+    }
+
+    buildIndex();
+    return true;
+}
+
+int64_t CorrelationTable::find(std::string_view symbol) const {
+    auto it = index_.find(symbol);
+    return it == index_.end() ? -1 : static_cast<int64_t>(it->second);
+}
+
+std::string_view CorrelationTable::name(uint32_t symbol) const {
+    return std::string_view(pool_.data() + names_[symbol].offset, names_[symbol].length);
+}
+
+void CorrelationTable::parseCsv(const char* data, size_t size, size_t topN) {
+    std::string_view text(data, size);
+    size_t pos = 0;
+
+    auto nextLine = [&]() {
+        size_t end = text.find('\n', pos);
+        if (end == std::string_view::npos) end = text.size();
+        std::string_view line = text.substr(pos, end - pos);
+        pos = end + 1;
+        return stripCr(line);
+    };
+
+    // Verify header format
+    std::string_view header = nextLine();
+    size_t comma1 = header.find(',');
+    size_t comma2 = comma1 == std::string_view::npos ? comma1 : header.find(',', comma1 + 1);
+    std::string_view col1 = header.substr(0, comma1);
+    std::string_view col2 = comma1 == std::string_view::npos ? "" : header.substr(comma1 + 1, comma2 - comma1 - 1);
+    std::string_view col3 = comma2 == std::string_view::npos ? "" : header.substr(comma2 + 1, header.find(',', comma2 + 1) - comma2 - 1);
+    
+    if (col1 != "symbol1" || col2 != "symbol2" || col3 != "overall_correlation") {
+        std::cerr << "Warning: CSV header doesn't match expected format 'symbol1,symbol2,overall_correlation'" << std::endl;
+        std::cerr << "Actual header: " << header << std::endl;
+        std::cerr << "Attempting to continue with best effort parsing..." << std::endl;
+    }
+
+    // Interned while parsing; the views point into the mapped CSV
+    std::unordered_map<std::string_view, uint32_t> interned;
+    std::vector<std::vector<Candidate>> kept;
+    auto intern = [&](std::string_view symbol) {
+        auto [it, inserted] = interned.try_emplace(symbol, static_cast<uint32_t>(names_.size()));
+        if (inserted) {
+            names_.push_back({static_cast<uint32_t>(pool_.size()), static_cast<uint32_t>(symbol.size())});
+            pool_.append(symbol);
+            kept.emplace_back();
+        }
+        return it->second;
+    };
+
+    uint64_t lineCount = 0;
+    while (pos < text.size()) {
+        std::string_view line = nextLine();
+        lineCount++;
+
+        size_t comma1 = line.find(',');
+        size_t comma2 = comma1 == std::string_view::npos ? comma1 : line.find(',', comma1 + 1);
+        double correlation = 0;
+        bool parsed = comma2 != std::string_view::npos;
+        if (parsed) {
+            size_t start = line.find_first_not_of(" \t", comma2 + 1);
+            const char* first = line.data() + (start == std::string_view::npos ? line.size() : start);
+            parsed = std::from_chars(first, line.data() + line.size(), correlation).ec == std::errc();
+        }
+        if (!parsed) {
+            std::cerr << "Warning: Could not parse line " << lineCount << ": " << line << std::endl;
+            continue;
+        }
+
+        uint32_t symbol1 = intern(line.substr(0, comma1));
+        uint32_t symbol2 = intern(line.substr(comma1 + 1, comma2 - comma1 - 1));
+        uint32_t seq = static_cast<uint32_t>(pairCount_++);
+
+        // Store correlation in both directions
+        offer(kept[symbol1], Candidate{symbol2, seq, correlation}, topN);
+        offer(kept[symbol2], Candidate{symbol1, seq, correlation}, topN);
+    }
+
+    firstEntry_.reserve(names_.size() + 1);
+    for (auto& candidates : kept) {
+        std::sort(candidates.begin(), candidates.end(), stronger);
+        firstEntry_.push_back(static_cast<uint32_t>(entries_.size()));
+        for (const auto& candidate : candidates) {
+            entries_.push_back(Entry{candidate.symbol, candidate.correlation});
+        }
+    }
+    firstEntry_.push_back(static_cast<uint32_t>(entries_.size()));
+}
+
+bool CorrelationTable::readCache(const std::string& cachePath, uint64_t csvSize, uint64_t csvHash, size_t topN) {
+    MappedFile cache;
+    if (!cache.open(cachePath) || cache.size() < sizeof(CacheHeader)) {
+        return false;
+    }
+
+    CacheHeader header;
+    std::memcpy(&header, cache.data(), sizeof(header));
+    if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+        header.version != CACHE_VERSION || header.topN != topN ||
+        header.csvSize != csvSize || header.csvHash != csvHash) {
+        return false;
+    }
+
+    size_t expected = sizeof(CacheHeader)
+                    + static_cast<size_t>(header.symbolCount) * sizeof(Name)
+                    + (static_cast<size_t>(header.symbolCount) + 1) * sizeof(uint32_t)
+                    + static_cast<size_t>(header.entryCount) * (sizeof(uint32_t) + sizeof(double))
+                    + header.poolSize;
+    if (cache.size() != expected) {
+        return false;
+    }
+
+    const char* cursor = cache.data() + sizeof(CacheHeader);
+    auto take = [&](void* out, size_t bytes) {
+        std::memcpy(out, cursor, bytes);
+        cursor += bytes;
+    };
+
+    names_.resize(header.symbolCount);
+    firstEntry_.resize(header.symbolCount + 1);
+    std::vector<uint32_t> symbols(header.entryCount);
+    std::vector<double> correlations(header.entryCount);
+    take(names_.data(), names_.size() * sizeof(Name));
+    take(firstEntry_.data(), firstEntry_.size() * sizeof(uint32_t));
+    take(symbols.data(), symbols.size() * sizeof(uint32_t));
+    take(correlations.data(), correlations.size() * sizeof(double));
+    pool_.assign(cursor, header.poolSize);
+
+    // Reject a cache that does not hang together
+    bool consistent = firstEntry_.front() == 0 && firstEntry_.back() == header.entryCount;
+    for (size_t i = 0; consistent && i < header.symbolCount; ++i) {
+        consistent = firstEntry_[i] <= firstEntry_[i + 1] &&
+                     static_cast<uint64_t>(names_[i].offset) + names_[i].length <= header.poolSize;
+    }
+    for (size_t i = 0; consistent && i < header.entryCount; ++i) {
+        consistent = symbols[i] < header.symbolCount;
+    }
+    if (!consistent) {
+        names_.clear();
+        firstEntry_.clear();
+        pool_.clear();
+        return false;
+    }
+
+    entries_.resize(header.entryCount);
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        entries_[i] = Entry{symbols[i], correlations[i]};
+    }
+    pairCount_ = header.pairCount;
+    return true;
+}
+
+void CorrelationTable::writeCache(const std::string& cachePath, uint64_t csvSize, uint64_t csvHash, size_t topN) const {
+    // Written under a temporary name so a reader never sees a partial cache
+    std::string tmpPath = cachePath + ".tmp";
+    std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Warning: Could not write correlation cache " << cachePath << std::endl;
+        return;
+    }
+
+    CacheHeader header{};
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.topN = static_cast<uint32_t>(topN);
+    header.csvSize = csvSize;
+    header.csvHash = csvHash;
+    header.pairCount = pairCount_;
+    header.symbolCount = static_cast<uint32_t>(names_.size());
+    header.entryCount = static_cast<uint32_t>(entries_.size());
+    header.poolSize = pool_.size();
+
+    std::vector<uint32_t> symbols(entries_.size());
+    std::vector<double> correlations(entries_.size());
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        symbols[i] = entries_[i].symbol;
+        correlations[i] = entries_[i].correlation;
+    }
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(names_.data()), names_.size() * sizeof(Name));
+    out.write(reinterpret_cast<const char*>(firstEntry_.data()), firstEntry_.size() * sizeof(uint32_t));
+    out.write(reinterpret_cast<const char*>(symbols.data()), symbols.size() * sizeof(uint32_t));
+    out.write(reinterpret_cast<const char*>(correlations.data()), correlations.size() * sizeof(double));
+    out.write(pool_.data(), pool_.size());
+    out.close();
+
+    if (!out || std::rename(tmpPath.c_str(), cachePath.c_str()) != 0) {
+        std::remove(tmpPath.c_str());
+        std::cerr << "Warning: Could not write correlation cache " << cachePath << std::endl;
+    }
+}
+
+void CorrelationTable::buildIndex() {
+    index_.clear();
+    index_.reserve(names_.size());
+    for (uint32_t symbol = 0; symbol < names_.size(); ++symbol) {
+        index_.emplace(name(symbol), symbol);
+    }
+}
+
+// 64-bit multiply-rotate hash, a word at a time so hashing keeps up with
+// reading the file
+uint64_t CorrelationTable::hashBytes(const char* data, size_t size) {
+    constexpr uint64_t K1 = 0x9E3779B97F4A7C15ULL;
+    constexpr uint64_t K2 = 0xC2B2AE3D27D4EB4FULL;
+
+    uint64_t hash = K1 ^ size;
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        hash ^= word * K2;
+        hash = ((hash << 31) | (hash >> 33)) * K1;
+    }
+
+    uint64_t tail = 0;
+    if (size > i) {
+        std::memcpy(&tail, data + i, size - i);
+    }
+    hash ^= tail * K2;
+    hash ^= hash >> 29;
+    hash *= K1;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+size_t CorrelationTable::memoryBytes() const {
+    return pool_.capacity() + vectorMemoryBytes(names_) + vectorMemoryBytes(firstEntry_) +
+           vectorMemoryBytes(entries_) + hashTableMemoryBytes(index_);
+}
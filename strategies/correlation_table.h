@@ -0,0 +1,67 @@
+#ifndef CORRELATION_TABLE_H
+#define CORRELATION_TABLE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Top-N correlated symbols of every symbol in a correlation CSV
+// (symbol1,symbol2,overall_correlation).
+//
+// Each pair counts for both of its symbols, and a symbol keeps its N pairs
+// with the largest |correlation|; on ties the pair that comes first in the
+// file wins. Symbol names are interned once into a shared pool.
+//
+// The CSV is mapped and parsed in place. The resulting table is saved next
+// to it as <csv>.top<N>.cache, keyed by the CSV's size and content hash, and
+// later loads of an unchanged CSV read the cache instead of parsing.
+class CorrelationTable {
+public:
+    struct Entry {
+        uint32_t symbol;      // index of the correlated symbol
+        double correlation;
+    };
+
+    // Returns false if the CSV cannot be read
+    bool load(const std::string& csvPath, size_t topN);
+
+    size_t symbolCount() const { return names_.size(); }
+    size_t pairCount() const { return pairCount_; }
+    bool fromCache() const { return fromCache_; }
+    size_t memoryBytes() const;
+
+    // Index of a symbol, or -1 if it has no correlations
+    int64_t find(std::string_view symbol) const;
+
+    std::string_view name(uint32_t symbol) const;
+
+    // Top correlations of a symbol, strongest first
+    const Entry* begin(uint32_t symbol) const { return entries_.data() + firstEntry_[symbol]; }
+    const Entry* end(uint32_t symbol) const { return entries_.data() + firstEntry_[symbol + 1]; }
+
+private:
+    struct Name {
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    void parseCsv(const char* data, size_t size, size_t topN);
+    bool readCache(const std::string& cachePath, uint64_t csvSize, uint64_t csvHash, size_t topN);
+    void writeCache(const std::string& cachePath, uint64_t csvSize, uint64_t csvHash, size_t topN) const;
+    void buildIndex();
+
+    static uint64_t hashBytes(const char* data, size_t size);
+
+    std::string pool_;
+    std::vector<Name> names_;
+    std::vector<uint32_t> firstEntry_;    // symbolCount + 1 offsets into entries_
+    std::vector<Entry> entries_;
+    std::unordered_map<std::string_view, uint32_t> index_;
+    uint64_t pairCount_ = 0;
+    bool fromCache_ = false;
+};
+
+#endif
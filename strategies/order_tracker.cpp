@@ -0,0 +1,190 @@
+#include "order_tracker.h"
+
+OrderTracker::OrderTracker(size_t initialCapacity)
+    : timerService_(nullptr),
+      indexMask_(0),
+      freeHead_(NIL),
+      head_{NIL, NIL},
+      tail_{NIL, NIL},
+      size_(0),
+      nextSeq_(0) {
+
+    // Round the capacity up to a power of two so the index stays at half load
+    size_t capacity = 4;
+    while (capacity < initialCapacity) {
+        capacity *= 2;
+    }
+
+    slots_.resize(capacity);
+    for (size_t i = 0; i < capacity; ++i) {
+        slots_[i].next = (i + 1 < capacity) ? static_cast<uint32_t>(i + 1) : NIL;
+    }
+    freeHead_ = 0;
+    rebuildIndex();
+}
+
+size_t OrderTracker::bucketFor(uint64_t orderId) const {
+    // Fibonacci hashing spreads sequential strategy ids across the table
+    return static_cast<size_t>((orderId * 0x9E3779B97F4A7C15ULL) >> 32) & indexMask_;
+}
+
+uint32_t OrderTracker::findSlot(uint64_t orderId) const {
+    for (size_t bucket = bucketFor(orderId);; bucket = (bucket + 1) & indexMask_) {
+        uint32_t slot = index_[bucket];
+        if (slot == NIL) {
+            return NIL;
+        }
+        if (slots_[slot].order.orderId == orderId) {
+            return slot;
+        }
+    }
+}
+
+bool OrderTracker::add(const OrderInfo& order, uint64_t expiryNs) {
+    if (findSlot(order.orderId) != NIL) {
+        return false;
+    }
+
+    if (freeHead_ == NIL) {
+        grow();
+    }
+
+    uint32_t slot = freeHead_;
+    freeHead_ = slots_[slot].next;
+
+    // Link at the tail of its side so each list stays in placement order
+    size_t side = sideOf(order.isBid);
+    Slot& entry = slots_[slot];
+    entry.order = order;
+    entry.order.timerId = (timerService_ != nullptr && expiryNs != 0)
+        ? timerService_->scheduleTimer(expiryNs, order.orderId) : 0;
+    entry.seq = nextSeq_++;
+    entry.prev = tail_[side];
+    entry.next = NIL;
+    if (tail_[side] != NIL) {
+        slots_[tail_[side]].next = slot;
+    } else {
+        head_[side] = slot;
+    }
+    tail_[side] = slot;
+
+    size_t bucket = bucketFor(order.orderId);
+    while (index_[bucket] != NIL) {
+        bucket = (bucket + 1) & indexMask_;
+    }
+    index_[bucket] = slot;
+
+    size_++;
+    return true;
+}
+
+bool OrderTracker::remove(uint64_t orderId) {
+    uint32_t slot = findSlot(orderId);
+    if (slot == NIL) {
+        return false;
+    }
+    eraseSlot(slot);
+    return true;
+}
+
+const OrderTracker::OrderInfo* OrderTracker::find(uint64_t orderId) const {
+    uint32_t slot = findSlot(orderId);
+    return slot == NIL ? nullptr : &slots_[slot].order;
+}
+
+const OrderTracker::OrderInfo* OrderTracker::oldest(bool isBid) const {
+    uint32_t slot = head_[sideOf(isBid)];
+    return slot == NIL ? nullptr : &slots_[slot].order;
+}
+
+void OrderTracker::clear() {
+    for (uint32_t side = 0; side < 2; ++side) {
+        for (uint32_t slot = head_[side]; slot != NIL; slot = slots_[slot].next) {
+            if (timerService_ != nullptr && slots_[slot].order.timerId != 0) {
+                timerService_->cancelTimer(slots_[slot].order.timerId);
+            }
+        }
+    }
+    for (size_t i = 0; i < slots_.size(); ++i) {
+        slots_[i].next = (i + 1 < slots_.size()) ? static_cast<uint32_t>(i + 1) : NIL;
+    }
+    freeHead_ = 0;
+    head_[0] = head_[1] = NIL;
+    tail_[0] = tail_[1] = NIL;
+    size_ = 0;
+    rebuildIndex();
+}
+
+void OrderTracker::eraseSlot(uint32_t slot) {
+    Slot& entry = slots_[slot];
+
+    // A fired timer has already been released, so cancelling it is a no-op
+    if (timerService_ != nullptr && entry.order.timerId != 0) {
+        timerService_->cancelTimer(entry.order.timerId);
+    }
+
+    // Remove from the id index with backward-shift deletion, which keeps
+    // linear probing chains intact without tombstones
+    size_t hole = bucketFor(entry.order.orderId);
+    while (index_[hole] != slot) {
+        hole = (hole + 1) & indexMask_;
+    }
+    for (size_t next = (hole + 1) & indexMask_; index_[next] != NIL; next = (next + 1) & indexMask_) {
+        size_t home = bucketFor(slots_[index_[next]].order.orderId);
+        // Move the entry back if its home bucket is not within (hole, next]
+        if (((next - home) & indexMask_) >= ((next - hole) & indexMask_)) {
+            index_[hole] = index_[next];
+            hole = next;
+        }
+    }
+    index_[hole] = NIL;
+
+    // Unlink from the side list
+    size_t side = sideOf(entry.order.isBid);
+    if (entry.prev != NIL) {
+        slots_[entry.prev].next = entry.next;
+    } else {
+        head_[side] = entry.next;
+    }
+    if (entry.next != NIL) {
+        slots_[entry.next].prev = entry.prev;
+    } else {
+        tail_[side] = entry.prev;
+    }
+
+    entry.next = freeHead_;
+    freeHead_ = slot;
+    size_--;
+}
+
+void OrderTracker::grow() {
+    size_t oldCapacity = slots_.size();
+    size_t newCapacity = oldCapacity * 2;
+
+    // Slot indices stay valid, so the side lists need no fix-up
+    slots_.resize(newCapacity);
+    for (size_t i = oldCapacity; i < newCapacity; ++i) {
+        slots_[i].next = (i + 1 < newCapacity) ? static_cast<uint32_t>(i + 1) : NIL;
+    }
+    freeHead_ = static_cast<uint32_t>(oldCapacity);
+    rebuildIndex();
+}
+
+void OrderTracker::rebuildIndex() {
+    index_.assign(slots_.size() * 2, NIL);
+    indexMask_ = index_.size() - 1;
+
+    for (uint32_t side = 0; side < 2; ++side) {
+        for (uint32_t slot = head_[side]; slot != NIL; slot = slots_[slot].next) {
+            size_t bucket = bucketFor(slots_[slot].order.orderId);
+            while (index_[bucket] != NIL) {
+                bucket = (bucket + 1) & indexMask_;
+            }
+            index_[bucket] = slot;
+        }
+    }
+}
+
+size_t OrderTracker::memoryBytes() const {
+    return slots_.capacity() * sizeof(Slot) + index_.capacity() * sizeof(uint32_t);
+}
@@ -0,0 +1,145 @@
+#ifndef ORDER_TRACKER_H
+#define ORDER_TRACKER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "strategy.h"
+
+// Strategy-side registry of working orders.
+//
+// Orders live in slot-indexed storage, are located through an open-addressed
+// id -> slot table and are threaded on intrusive per-side lists in placement
+// order. Add, find and remove are O(1) and only allocate when the capacity
+// has to grow. With a timer service attached, an order can carry an expiry
+// timer (token = order id) that is cancelled whenever the order is removed.
+class OrderTracker {
+public:
+    struct OrderInfo {
+        uint64_t orderId;
+        uint64_t creationTime;
+        int64_t price;
+        uint32_t quantity;
+        bool isBid;
+        uint64_t timerId = 0;
+    };
+
+    explicit OrderTracker(size_t initialCapacity = 16);
+
+    void setTimerService(TimerService* timerService) { timerService_ = timerService; }
+
+    // Returns false if an order with the same id is already tracked. A
+    // non-zero expiryNs schedules an expiry timer when a service is attached.
+    bool add(const OrderInfo& order, uint64_t expiryNs = 0);
+
+    // Returns false if the order is not tracked
+    bool remove(uint64_t orderId);
+
+    const OrderInfo* find(uint64_t orderId) const;
+    bool contains(uint64_t orderId) const { return find(orderId) != nullptr; }
+
+    size_t size() const { return size_; }
+    size_t memoryBytes() const;
+    bool empty() const { return size_ == 0; }
+    void clear();
+
+    // Oldest working order on one side, or nullptr if the side is empty
+    const OrderInfo* oldest(bool isBid) const;
+
+    // Visit every order in placement order; orders for which the visitor
+    // returns true are removed. The visitor must not modify the tracker.
+    template <typename Visitor>
+    void removeIf(Visitor&& visitor);
+
+    // Visit orders from the oldest and remove them while the predicate holds.
+    // A side stops at the first order the predicate rejects, so an age check
+    // only touches the expired orders plus one per side.
+    template <typename Predicate>
+    void removeOldestWhile(Predicate&& predicate);
+
+    template <typename Visitor>
+    void forEach(Visitor&& visitor) const;
+
+private:
+    static constexpr uint32_t NIL = UINT32_MAX;
+
+    struct Slot {
+        OrderInfo order;
+        uint64_t seq;     // placement sequence, orders both sides
+        uint32_t prev;
+        uint32_t next;    // also links the free list
+    };
+
+    static size_t sideOf(bool isBid) { return isBid ? 0 : 1; }
+
+    size_t bucketFor(uint64_t orderId) const;
+    uint32_t findSlot(uint64_t orderId) const;
+    void eraseSlot(uint32_t slot);
+    void grow();
+    void rebuildIndex();
+
+    TimerService* timerService_;
+    std::vector<Slot> slots_;
+    std::vector<uint32_t> index_;   // bucket -> slot, NIL when empty
+    size_t indexMask_;
+    uint32_t freeHead_;
+    uint32_t head_[2];
+    uint32_t tail_[2];
+    size_t size_;
+    uint64_t nextSeq_;
+};
+
+template <typename Visitor>
+void OrderTracker::removeIf(Visitor&& visitor) {
+    uint32_t bid = head_[0];
+    uint32_t ask = head_[1];
+    while (bid != NIL || ask != NIL) {
+        uint32_t slot;
+        if (ask == NIL || (bid != NIL && slots_[bid].seq < slots_[ask].seq)) {
+            slot = bid;
+            bid = slots_[bid].next;
+        } else {
+            slot = ask;
+            ask = slots_[ask].next;
+        }
+        if (visitor(static_cast<const OrderInfo&>(slots_[slot].order))) {
+            eraseSlot(slot);
+        }
+    }
+}
+
+template <typename Predicate>
+void OrderTracker::removeOldestWhile(Predicate&& predicate) {
+    uint32_t bid = head_[0];
+    uint32_t ask = head_[1];
+    while (bid != NIL || ask != NIL) {
+        bool takeBid = ask == NIL || (bid != NIL && slots_[bid].seq < slots_[ask].seq);
+        uint32_t& cursor = takeBid ? bid : ask;
+        uint32_t slot = cursor;
+        if (!predicate(static_cast<const OrderInfo&>(slots_[slot].order))) {
+            cursor = NIL;
+            continue;
+        }
+        cursor = slots_[slot].next;
+        eraseSlot(slot);
+    }
+}
+
+template <typename Visitor>
+void OrderTracker::forEach(Visitor&& visitor) const {
+    uint32_t bid = head_[0];
+    uint32_t ask = head_[1];
+    while (bid != NIL || ask != NIL) {
+        uint32_t slot;
+        if (ask == NIL || (bid != NIL && slots_[bid].seq < slots_[ask].seq)) {
+            slot = bid;
+            bid = slots_[bid].next;
+        } else {
+            slot = ask;
+            ask = slots_[ask].next;
+        }
+        visitor(slots_[slot].order);
+    }
+}
+
+#endif
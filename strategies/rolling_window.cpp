@@ -0,0 +1,119 @@
+#include "rolling_window.h"
+#include <stdexcept>
+
+RollingWindow::RollingWindow(size_t maxSamples, uint64_t maxAgeNs)
+    : samples_(maxSamples),
+      maxAgeNs_(maxAgeNs),
+      head_(0),
+      size_(0) {
+    if (maxSamples == 0 || maxAgeNs == 0) {
+        throw std::runtime_error("Rolling window needs a positive sample count and age");
+    }
+    clear();
+}
+
+void RollingWindow::clear() {
+    head_ = 0;
+    size_ = 0;
+    tsBase_ = 0;
+    xBase_ = 0;
+    yBase_ = 0;
+    sumX_ = sumY_ = sumXX_ = sumYY_ = sumXY_ = sumT_ = sumTX_ = 0;
+}
+
+void RollingWindow::push(uint64_t ts, int64_t x, int64_t y) {
+    if (size_ == samples_.size()) {
+        evictOldest();
+    }
+    if (size_ == 0) {
+        // Rebase so the offsets stay small
+        tsBase_ = ts;
+        xBase_ = x;
+        yBase_ = y;
+    }
+
+    Sample sample{ts, x, y};
+    samples_[(head_ + size_) % samples_.size()] = sample;
+    size_++;
+    add(sample, 1);
+}
+
+void RollingWindow::expire(uint64_t now) {
+    while (size_ > 0 && now - samples_[head_].ts > maxAgeNs_) {
+        evictOldest();
+    }
+}
+
+void RollingWindow::evictOldest() {
+    add(samples_[head_], -1);
+    head_ = (head_ + 1) % samples_.size();
+    size_--;
+}
+
+void RollingWindow::add(const Sample& sample, int sign) {
+    Wide t = static_cast<Wide>(sample.ts - tsBase_);
+    Wide x = static_cast<Wide>(sample.x) - xBase_;
+    Wide y = static_cast<Wide>(sample.y) - yBase_;
+
+    sumX_ += sign * x;
+    sumY_ += sign * y;
+    sumXX_ += sign * x * x;
+    sumYY_ += sign * y * y;
+    sumXY_ += sign * x * y;
+    sumT_ += sign * t;
+    sumTX_ += sign * t * x;
+}
+
+double RollingWindow::mean() const {
+    if (size_ == 0) return 0;
+    return xBase_ + static_cast<double>(sumX_) / size_;
+}
+
+double RollingWindow::meanY() const {
+    if (size_ == 0) return 0;
+    return yBase_ + static_cast<double>(sumY_) / size_;
+}
+
+// n^2 * var = n * sum(d^2) - sum(d)^2, exact on the offsets
+double RollingWindow::variance() const {
+    if (size_ == 0) return 0;
+    Wide n = size_;
+    return static_cast<double>(n * sumXX_ - sumX_ * sumX_) / static_cast<double>(n * n);
+}
+
+double RollingWindow::varianceY() const {
+    if (size_ == 0) return 0;
+    Wide n = size_;
+    return static_cast<double>(n * sumYY_ - sumY_ * sumY_) / static_cast<double>(n * n);
+}
+
+double RollingWindow::covariance() const {
+    if (size_ == 0) return 0;
+    Wide n = size_;
+    return static_cast<double>(n * sumXY_ - sumX_ * sumY_) / static_cast<double>(n * n);
+}
+
+double RollingWindow::beta() const {
+    Wide n = size_;
+    Wide scaledVarY = n * sumYY_ - sumY_ * sumY_;
+    if (scaledVarY == 0) return 0;
+    return static_cast<double>(n * sumXY_ - sumX_ * sumY_) / static_cast<double>(scaledVarY);
+}
+
+// With t = ts - tsBase and a = maxAge - (now - tsBase), a sample's weight is
+// (a + t) / maxAge, so
+//   maxAge * sum(w)     = n * a + sum(t)
+//   maxAge * sum(w * x) = xBase * maxAge * sum(w) + a * sum(dx) + sum(t * dx)
+RollingWindow::DecaySums RollingWindow::linearDecay(uint64_t now) const {
+    DecaySums sums;
+    if (size_ == 0) return sums;
+
+    Wide maxAge = maxAgeNs_;
+    Wide a = maxAge - static_cast<Wide>(now - tsBase_);
+    Wide scaledWeight = static_cast<Wide>(size_) * a + sumT_;
+    Wide scaledWeighted = xBase_ * scaledWeight + a * sumX_ + sumTX_;
+
+    sums.weightSum = static_cast<double>(scaledWeight) / maxAgeNs_;
+    sums.weightedSum = static_cast<double>(scaledWeighted) / maxAgeNs_;
+    return sums;
+}
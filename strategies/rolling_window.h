@@ -0,0 +1,88 @@
+#ifndef ROLLING_WINDOW_H
+#define ROLLING_WINDOW_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Time- and count-bounded window over a pair of integer series (prices in
+// nanos, quantities, ...). A sample is (ts, x, y); single-series users leave
+// y at 0.
+//
+// Sums of the values, squares, cross products and timestamp products are
+// maintained as samples enter and leave the window, so every statistic is
+// O(1) regardless of window length. Sums are exact 128-bit integers taken
+// relative to the first sample after the window was last empty, which keeps
+// them free of floating point drift however long the window runs.
+class RollingWindow {
+public:
+    // Weighted sums of x where a sample's weight decays linearly with age,
+    // 1 - age / maxAgeNs, evaluated at some time "now"
+    struct DecaySums {
+        double weightSum = 0;
+        double weightedSum = 0;
+    };
+
+    RollingWindow(size_t maxSamples, uint64_t maxAgeNs);
+
+    // Append a sample, evicting the oldest one when the window is full.
+    // Timestamps must not decrease.
+    void push(uint64_t ts, int64_t x, int64_t y = 0);
+
+    // Evict samples older than maxAgeNs at time now
+    void expire(uint64_t now);
+
+    void clear();
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    size_t maxSamples() const { return samples_.size(); }
+    uint64_t maxAgeNs() const { return maxAgeNs_; }
+
+    // Statistics over the samples in the window; all are 0 when it is empty.
+    // Variances and covariance are population statistics.
+    double mean() const;
+    double meanY() const;
+    double variance() const;
+    double varianceY() const;
+    double covariance() const;
+
+    // Regression slope of x on y (cov(x, y) / var(y)), 0 if y is constant
+    double beta() const;
+
+    // Linear age decay of x at time now, which must not precede the newest
+    // sample. Samples older than maxAgeNs should be expired first.
+    DecaySums linearDecay(uint64_t now) const;
+
+private:
+    using Wide = __int128;
+
+    struct Sample {
+        uint64_t ts;
+        int64_t x;
+        int64_t y;
+    };
+
+    void add(const Sample& sample, int sign);
+    void evictOldest();
+
+    std::vector<Sample> samples_;
+    uint64_t maxAgeNs_;
+    size_t head_;
+    size_t size_;
+
+    // Offsets the sums are relative to
+    uint64_t tsBase_;
+    int64_t xBase_;
+    int64_t yBase_;
+
+    Wide sumX_;
+    Wide sumY_;
+    Wide sumXX_;
+    Wide sumYY_;
+    Wide sumXY_;
+    Wide sumT_;
+    Wide sumTX_;
+};
+
+#endif
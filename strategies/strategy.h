@@ -4,6 +4,9 @@
 #include <vector>
 #include <string>
 #include "../types/market_data_types.h"
+#include "../types/span.h"
+
+class DepthHistory;
 
 // Orders that can be generated by the strategy
 struct OrderAction {
@@ -27,6 +30,20 @@ struct OrderAction {
                    price(0), quantity(0), isBid(false), isPostOnly(true) {}
 };
 
+// Timer service offered to strategies by the simulator. Deadlines are in
+// strategy market-data time; once the replay clock passes a deadline the
+// simulator calls Strategy::onTimer with the token it was scheduled with.
+class TimerService {
+public:
+    virtual ~TimerService() = default;
+    
+    // Returns a handle for cancelTimer; 0 is never a valid handle
+    virtual uint64_t scheduleTimer(uint64_t deadlineNs, uint64_t token) = 0;
+    
+    // Returns false if the timer already fired or was cancelled
+    virtual bool cancelTimer(uint64_t timerId) = 0;
+};
+
 // Strategy interface
 class Strategy {
 public:
@@ -35,12 +52,55 @@ public:
     virtual std::vector<OrderAction> onBookTopUpdate(const book_top_t& bookTop) = 0;
     virtual std::vector<OrderAction> onFill(const book_fill_snapshot_t& fill) = 0;
     
+    // Strategies that return true get book tops through onBookTopBatch in
+    // tops/fills runs; queue runs deliver every top through onBookTopUpdate
+    virtual bool batchesBookTops() const { return false; }
+    
+    // Consume tops from the front of the span and return how many were used,
+    // stopping after the first top that produces actions (appended to
+    // actions). The simulator only passes runs in which no timer is due and
+    // no resting order fills, so a strategy must also stop after any top at
+    // which it schedules a timer.
+    virtual size_t onBookTopBatch(Span<const book_top_t> tops, std::vector<OrderAction>& actions) {
+        for (size_t i = 0; i < tops.size(); ++i) {
+            std::vector<OrderAction> topActions = onBookTopUpdate(tops[i]);
+            if (!topActions.empty()) {
+                actions.insert(actions.end(), topActions.begin(), topActions.end());
+                return i + 1;
+            }
+        }
+        return tops.size();
+    }
+    
     virtual std::vector<OrderAction> onOrderFilled(uint64_t orderId, int64_t fillPrice, 
                                                   uint32_t fillQty, bool isBid) = 0;
     
+    // Called when a timer scheduled through the timer service expires
+    virtual std::vector<OrderAction> onTimer(uint64_t /* token */, uint64_t /* timestamp */) {
+        return {};
+    }
+    
     virtual void setSymbolId(uint64_t symbolId) = 0;
     
+    virtual void setTimerService(TimerService* timerService) {
+        timerService_ = timerService;
+    }
+    
+    // Recent depth kept by the simulator as the tops reach the strategy;
+    // nullptr unless the run keeps a depth history
+    virtual void setDepthHistory(const DepthHistory* depthHistory) {
+        depthHistory_ = depthHistory;
+    }
+    
     virtual std::string getName() const = 0;
+    
+    // Bytes held by the strategy's state, the object included, for the
+    // simulator's memory report
+    virtual size_t memoryBytes() const { return 0; }
+
+protected:
+    TimerService* timerService_ = nullptr;
+    const DepthHistory* depthHistory_ = nullptr;
 };
 
 #endif
\ No newline at end of file
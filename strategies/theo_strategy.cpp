@@ -4,7 +4,7 @@
 #include <cmath>
 
 TheoStrategy::TheoStrategy(double placeEdgePercent, double cancelEdgePercent, 
-                           double tradeWeight, double emaDecay) 
+                           double tradeWeight, double emaDecay, uint64_t emaHalfLifeNs) 
     : symbolId_(0), 
       nextOrderId_(1), 
       currentBidOrderId_(0),
@@ -15,44 +15,71 @@ TheoStrategy::TheoStrategy(double placeEdgePercent, double cancelEdgePercent,
       placeEdgePercent_(placeEdgePercent),
       cancelEdgePercent_(cancelEdgePercent),
       tradeWeight_(tradeWeight),
-      emaDecay_(emaDecay) {}
+      tradeEma_(emaDecay, emaHalfLifeNs),
+      lastMarketTs_(0) {}
 
 std::string TheoStrategy::getName() const {
     return "Theoretical Value Strategy";
 }
 
+size_t TheoStrategy::memoryBytes() const {
+    return sizeof(*this) + activeOrders_.memoryBytes();
+}
+
 void TheoStrategy::setSymbolId(uint64_t symbolId) {
     symbolId_ = symbolId;
 }
 
+void TheoStrategy::setTimerService(TimerService* timerService) {
+    Strategy::setTimerService(timerService);
+    activeOrders_.setTimerService(timerService);
+}
+
 std::vector<OrderAction> TheoStrategy::onBookTopUpdate(const book_top_t& bookTop) {
+    std::vector<OrderAction> actions;
+    handleBookTop(bookTop, actions);
+    return actions;
+}
+
+size_t TheoStrategy::onBookTopBatch(Span<const book_top_t> tops, std::vector<OrderAction>& actions) {
+    for (size_t i = 0; i < tops.size(); ++i) {
+        handleBookTop(tops[i], actions);
+        if (!actions.empty()) {
+            return i + 1;
+        }
+    }
+    return tops.size();
+}
+
+void TheoStrategy::handleBookTop(const book_top_t& bookTop, std::vector<OrderAction>& actions) {
     if (bookTop.top_level.bid_nanos <= 0 || bookTop.top_level.ask_nanos <= 0 ||
         bookTop.top_level.bid_nanos >= bookTop.top_level.ask_nanos) {
-        return {};
+        return;
     }
 
+    lastMarketTs_ = bookTop.ts;
+
     // Calculate theoretical value from this book top
     int64_t theoValue = calculateTheoValue(bookTop);
     currentTheoValue_ = theoValue;
     
     // First, check if any existing orders need to be canceled
-    std::vector<OrderAction> cancelActions = checkOrdersAgainstTheo();
-    
-    // Then check for stale orders
-    std::vector<OrderAction> staleOrderActions = checkForStaleOrders(bookTop.ts);
-    cancelActions.insert(cancelActions.end(), staleOrderActions.begin(), staleOrderActions.end());
+    checkOrdersAgainstTheo(actions);
     
-    // Get new order actions
-    std::vector<OrderAction> newOrderActions = updateOrdersForBookTop(bookTop);
+    // Then check for stale orders, unless expiry timers take care of them
+    if (timerService_ == nullptr) {
+        checkForStaleOrders(bookTop.ts, actions);
+    }
     
-    // Combine all actions
-    cancelActions.insert(cancelActions.end(), newOrderActions.begin(), newOrderActions.end());
-    return cancelActions;
+    // Finally place new orders
+    updateOrdersForBookTop(bookTop, actions);
 }
 
 std::vector<OrderAction> TheoStrategy::onFill(const book_fill_snapshot_t& fill) {
+    lastMarketTs_ = fill.ts;
+
     // Update trade history
-    updateTradeHistory(fill.trade_price, fill.ts);
+    tradeEma_.add(fill.trade_price, fill.ts);
     
     return {};
 }
@@ -71,31 +98,37 @@ std::vector<OrderAction> TheoStrategy::onOrderFilled(uint64_t orderId, int64_t f
         currentAskOrderId_ = 0;
     }
 
-    // Update trade history
-    updateTradeHistory(fillPrice, 0);
+    // Update trade history, stamping our own fill with the latest market time
+    tradeEma_.add(fillPrice, lastMarketTs_);
     
-    // Find and remove the order
-    auto it = std::find_if(activeOrders_.begin(), activeOrders_.end(), 
-                         [orderId](const OrderInfo& order) { return order.orderId == orderId; });
-    
-    if (it != activeOrders_.end()) {
-        removeOrder(orderId);
-    }
+    // Remove the order if it is still tracked
+    removeOrder(orderId);
 
     return {};
 }
 
+std::vector<OrderAction> TheoStrategy::onTimer(uint64_t orderId, uint64_t /* timestamp */) {
+    // The order reached its 10-minute expiry
+    if (!activeOrders_.contains(orderId)) {
+        return {};
+    }
+    
+    OrderAction cancelAction;
+    cancelAction.type = OrderAction::Type::CANCEL;
+    cancelAction.orderId = orderId;
+    cancelAction.symbolId = symbolId_;
+    
+    removeOrder(orderId);
+    return {cancelAction};
+}
+
 void TheoStrategy::removeOrder(uint64_t orderId) {
     // Check for invalid order ID
     if (orderId == 0) {
         return;
     }
 
-    activeOrders_.erase(
-        std::remove_if(activeOrders_.begin(), activeOrders_.end(),
-            [orderId](const OrderInfo& order) { return order.orderId == orderId; }),
-        activeOrders_.end()
-    );
+    activeOrders_.remove(orderId);
     
     // Clear any tracking variables
     if (orderId == currentBidOrderId_) {
@@ -106,100 +139,67 @@ void TheoStrategy::removeOrder(uint64_t orderId) {
     }
 }
 
-std::vector<OrderAction> TheoStrategy::checkOrdersAgainstTheo() {
-    std::vector<OrderAction> actions;
-    std::vector<uint64_t> orderIdsToRemove;
-
+void TheoStrategy::checkOrdersAgainstTheo(std::vector<OrderAction>& actions) {
     if (currentTheoValue_ <= 0) {
-        return actions;
+        return;
     }
 
     // Check each active order against the current theo value
-    for (const auto& order : activeOrders_) {
-        if (order.isBid) {
-            // For bids, cancel if the price is too high relative to theo
-            if (shouldCancelBid(order.price, currentTheoValue_)) {
-                OrderAction cancelAction;
-                cancelAction.type = OrderAction::Type::CANCEL;
-                cancelAction.orderId = order.orderId;
-                cancelAction.symbolId = symbolId_;
-                actions.push_back(cancelAction);
-                
-                orderIdsToRemove.push_back(order.orderId);
-                
-                if (order.orderId == currentBidOrderId_) {
-                    currentBidOrderId_ = 0;
-                }
-            }
-        } else {
-            // For asks, cancel if the price is too low relative to theo
-            if (shouldCancelAsk(order.price, currentTheoValue_)) {
-                OrderAction cancelAction;
-                cancelAction.type = OrderAction::Type::CANCEL;
-                cancelAction.orderId = order.orderId;
-                cancelAction.symbolId = symbolId_;
-                actions.push_back(cancelAction);
-                
-                orderIdsToRemove.push_back(order.orderId);
-                
-                if (order.orderId == currentAskOrderId_) {
-                    currentAskOrderId_ = 0;
-                }
-            }
+    activeOrders_.removeIf([&](const OrderInfo& order) {
+        // For bids, cancel if the price is too high relative to theo;
+        // for asks, cancel if the price is too low relative to theo
+        bool cancel = order.isBid ? shouldCancelBid(order.price, currentTheoValue_)
+                                  : shouldCancelAsk(order.price, currentTheoValue_);
+        if (!cancel) {
+            return false;
         }
-    }
-    
-    // Remove canceled orders
-    for (uint64_t orderId : orderIdsToRemove) {
-        removeOrder(orderId);
-    }
-    
-    return actions;
+        
+        OrderAction cancelAction;
+        cancelAction.type = OrderAction::Type::CANCEL;
+        cancelAction.orderId = order.orderId;
+        cancelAction.symbolId = symbolId_;
+        actions.push_back(cancelAction);
+        
+        if (order.isBid && order.orderId == currentBidOrderId_) {
+            currentBidOrderId_ = 0;
+        } else if (!order.isBid && order.orderId == currentAskOrderId_) {
+            currentAskOrderId_ = 0;
+        }
+        return true;
+    });
 }
 
-std::vector<OrderAction> TheoStrategy::checkForStaleOrders(uint64_t currentTimestamp) {
-    std::vector<OrderAction> actions;
-    std::vector<uint64_t> orderIdsToRemove;
-
+void TheoStrategy::checkForStaleOrders(uint64_t currentTimestamp, std::vector<OrderAction>& actions) {
     if (activeOrders_.empty()) {
-        return actions;
+        return;
     }
 
-    for (const auto& order : activeOrders_) {
-        if (currentTimestamp < order.creationTime) {
-            continue;
+    // Orders are kept oldest first, so only the expired ones are visited
+    activeOrders_.removeOldestWhile([&](const OrderInfo& order) {
+        if (currentTimestamp < order.creationTime ||
+            currentTimestamp - order.creationTime < TEN_MINUTES_NS) {
+            return false;
         }
         
-        if (currentTimestamp - order.creationTime >= TEN_MINUTES_NS) {
-            // Order is older than 10 minutes, cancel it
-            OrderAction cancelAction;
-            cancelAction.type = OrderAction::Type::CANCEL;
-            cancelAction.orderId = order.orderId;
-            cancelAction.symbolId = symbolId_;
-            actions.push_back(cancelAction);
-            
-            orderIdsToRemove.push_back(order.orderId);
-            
-            if (order.isBid && order.orderId == currentBidOrderId_) {
-                currentBidOrderId_ = 0;
-            } else if (!order.isBid && order.orderId == currentAskOrderId_) {
-                currentAskOrderId_ = 0;
-            }
+        // Order is older than 10 minutes, cancel it
+        OrderAction cancelAction;
+        cancelAction.type = OrderAction::Type::CANCEL;
+        cancelAction.orderId = order.orderId;
+        cancelAction.symbolId = symbolId_;
+        actions.push_back(cancelAction);
+        
+        if (order.isBid && order.orderId == currentBidOrderId_) {
+            currentBidOrderId_ = 0;
+        } else if (!order.isBid && order.orderId == currentAskOrderId_) {
+            currentAskOrderId_ = 0;
         }
-    }
-    
-    for (uint64_t orderId : orderIdsToRemove) {
-        removeOrder(orderId);
-    }
-    
-    return actions;
+        return true;
+    });
 }
 
-std::vector<OrderAction> TheoStrategy::updateOrdersForBookTop(const book_top_t& bookTop) {
-    std::vector<OrderAction> actions;
-    
+void TheoStrategy::updateOrdersForBookTop(const book_top_t& bookTop, std::vector<OrderAction>& actions) {
     if (currentTheoValue_ <= 0) {
-        return actions;
+        return;
     }
     
     const int64_t MAX_REASONABLE_PRICE = 10000LL * 1000000000LL; // $10,000 in nanos
@@ -207,7 +207,7 @@ std::vector<OrderAction> TheoStrategy::updateOrdersForBookTop(const book_top_t&
     if (bookTop.top_level.bid_nanos <= 0 || bookTop.top_level.ask_nanos <= 0 || 
         bookTop.top_level.bid_nanos >= bookTop.top_level.ask_nanos ||
         bookTop.top_level.bid_nanos > MAX_REASONABLE_PRICE || bookTop.top_level.ask_nanos > MAX_REASONABLE_PRICE) {
-        return actions;
+        return;
     }
     
     // Calculate the optimal bid and ask prices
@@ -253,7 +253,7 @@ std::vector<OrderAction> TheoStrategy::updateOrdersForBookTop(const book_top_t&
             bidOrderInfo.price = optimalBidPrice;
             bidOrderInfo.quantity = bidQty;
             bidOrderInfo.isBid = true;
-            activeOrders_.push_back(bidOrderInfo);
+            activeOrders_.add(bidOrderInfo, bookTop.ts + TEN_MINUTES_NS);
             
             std::cout << "Placing bid at $" << static_cast<double>(optimalBidPrice) / 1e9 
                       << " (theo: $" << static_cast<double>(currentTheoValue_) / 1e9 << ")" << std::endl;
@@ -299,14 +299,12 @@ std::vector<OrderAction> TheoStrategy::updateOrdersForBookTop(const book_top_t&
             askOrderInfo.price = optimalAskPrice;
             askOrderInfo.quantity = askQty;
             askOrderInfo.isBid = false;
-            activeOrders_.push_back(askOrderInfo);
+            activeOrders_.add(askOrderInfo, bookTop.ts + TEN_MINUTES_NS);
             
             std::cout << "Placing ask at $" << static_cast<double>(optimalAskPrice) / 1e9 
                       << " (theo: $" << static_cast<double>(currentTheoValue_) / 1e9 << ")" << std::endl;
         }
     }
-    
-    return actions;
 }
 
 int64_t TheoStrategy::calculateTheoValue(const book_top_t& bookTop) {
@@ -327,42 +325,8 @@ int64_t TheoStrategy::calculateTheoValue(const book_top_t& bookTop) {
     return theoValue;
 }
 
-void TheoStrategy::updateTradeHistory(int64_t tradePrice, uint64_t timestamp) {
-    if (tradePrice <= 0) return;
-    
-    // Add new trade to history
-    TradeInfo trade;
-    trade.price = tradePrice;
-    trade.timestamp = timestamp;
-    recentTrades_.push_back(trade);
-    
-    // Limit the size of trade history
-    if (recentTrades_.size() > MAX_TRADE_HISTORY) {
-        recentTrades_.pop_front();
-    }
-}
-
 int64_t TheoStrategy::getTimeWeightedAvgPrice() const {
-    if (recentTrades_.empty()) {
-        return 0;
-    }
-    
-    if (recentTrades_.size() == 1) {
-        return recentTrades_.front().price;
-    }
-    
-    // Calculate exponentially weighted average
-    double weightSum = 0;
-    double priceSum = 0;
-    double weight = 1.0;
-    
-    for (auto it = recentTrades_.rbegin(); it != recentTrades_.rend(); ++it) {
-        priceSum += weight * static_cast<double>(it->price);
-        weightSum += weight;
-        weight *= (1.0 - emaDecay_);
-    }
-    
-    return static_cast<int64_t>(priceSum / weightSum);
+    return tradeEma_.average();
 }
 
 bool TheoStrategy::shouldCancelBid(int64_t bidPrice, int64_t theoValue) {
@@ -2,44 +2,53 @@
 #define THEO_STRATEGY_H
 
 #include "strategy.h"
+#include "order_tracker.h"
+#include "trade_ema.h"
 #include <map>
 #include <string>
 #include <vector>
-#include <deque>
 #include <utility>
 
-class TheoStrategy : public Strategy {
+class TheoStrategy final : public Strategy {
 public:
+    // Weight of the trade EMA against the mid in the theo, and the EMA's
+    // per-trade decay
+    static constexpr double DEFAULT_TRADE_WEIGHT = 0.7;
+    static constexpr double DEFAULT_EMA_DECAY = 0.05;
+
     TheoStrategy(double placeEdgePercent = 0.01, double cancelEdgePercent = 0.005, 
-                 double tradeWeight = 0.7, double emaDecay = 0.05);
+                 double tradeWeight = DEFAULT_TRADE_WEIGHT, double emaDecay = DEFAULT_EMA_DECAY,
+                 uint64_t emaHalfLifeNs = 0);
     
     std::vector<OrderAction> onBookTopUpdate(const book_top_t& bookTop) override;
+    
+    // Tops that only move the theo are handled without building action lists
+    bool batchesBookTops() const override { return true; }
+    size_t onBookTopBatch(Span<const book_top_t> tops, std::vector<OrderAction>& actions) override;
     std::vector<OrderAction> onFill(const book_fill_snapshot_t& fill) override;
     std::vector<OrderAction> onOrderFilled(uint64_t orderId, int64_t fillPrice, 
                                           uint32_t fillQty, bool isBid) override;
+    std::vector<OrderAction> onTimer(uint64_t orderId, uint64_t timestamp) override;
     
     void setSymbolId(uint64_t symbolId) override;
+    void setTimerService(TimerService* timerService) override;
     std::string getName() const override;
+    size_t memoryBytes() const override;
     
 private:
-    struct OrderInfo {
-        uint64_t orderId;
-        uint64_t creationTime;
-        int64_t price;
-        uint32_t quantity;
-        bool isBid;
-    };
+    static constexpr uint64_t TEN_MINUTES_NS = 10ULL * 60ULL * 1000000000ULL;  // 10 minutes
+
+    using OrderInfo = OrderTracker::OrderInfo;
 
     // Theo value calculation
     int64_t calculateTheoValue(const book_top_t& bookTop);
-    void updateTradeHistory(int64_t tradePrice, uint64_t timestamp);
     int64_t getTimeWeightedAvgPrice() const;
     
     uint64_t symbolId_;
     uint64_t nextOrderId_;
     
     // Track all active orders
-    std::vector<OrderInfo> activeOrders_;
+    OrderTracker activeOrders_;
 
     uint64_t currentBidOrderId_;
     uint64_t currentAskOrderId_;
@@ -51,33 +60,29 @@ private:
     double placeEdgePercent_;
     double cancelEdgePercent_;
     
-    // Trade history and EMA calculation
-    struct TradeInfo {
-        int64_t price;
-        uint64_t timestamp;
-    };
-    std::deque<TradeInfo> recentTrades_;
+    // Theo blends the trade EMA with the mid by tradeWeight_
     double tradeWeight_;
-    double emaDecay_;
+    TradeEma tradeEma_;
+    uint64_t lastMarketTs_;
+    
+    // Append the actions for one book top
+    void handleBookTop(const book_top_t& bookTop, std::vector<OrderAction>& actions);
     
     // Helper function to update orders based on the book top and theo
-    std::vector<OrderAction> updateOrdersForBookTop(const book_top_t& bookTop);
+    void updateOrdersForBookTop(const book_top_t& bookTop, std::vector<OrderAction>& actions);
 
     // Helper function to remove an order from active orders
     void removeOrder(uint64_t orderId);
     
     // Helper to check for orders that need to be canceled
-    std::vector<OrderAction> checkOrdersAgainstTheo();
-    std::vector<OrderAction> checkForStaleOrders(uint64_t currentTimestamp);
+    void checkOrdersAgainstTheo(std::vector<OrderAction>& actions);
+    void checkForStaleOrders(uint64_t currentTimestamp, std::vector<OrderAction>& actions);
     
     // Order management helpers
     bool shouldCancelBid(int64_t bidPrice, int64_t theoValue);
     bool shouldCancelAsk(int64_t askPrice, int64_t theoValue);
     int64_t calculateBidPrice(int64_t theoValue);
     int64_t calculateAskPrice(int64_t theoValue);
-    
-    static constexpr uint64_t TEN_MINUTES_NS = 10ULL * 60ULL * 1000000000ULL;  // 10 minutes
-    static constexpr int MAX_TRADE_HISTORY = 100;
 };
 
 #endif
\ No newline at end of file
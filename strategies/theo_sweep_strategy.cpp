@@ -0,0 +1,393 @@
+#include "theo_sweep_strategy.h"
+#include "../engine/memory_account.h"
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+// static_cast<int64_t> of a whole-nanosecond double, kept as a double and
+// written without branches or calls so the lane loop still vectorises.
+// Adding and removing 2^52 rounds the magnitude to the nearest integer; the
+// second rounding is 1 exactly when the first one went up. Valid for
+// magnitudes below 2^52 nanos, far above any price the simulator accepts.
+inline double truncateNanos(double value) {
+    const double roundingShift = 4503599627370496.0;  // 2^52
+    double magnitude = std::fabs(value);
+    double nearest = (magnitude + roundingShift) - roundingShift;
+    double roundedUp = ((nearest - magnitude + 0.5) + roundingShift) - roundingShift;
+    return std::copysign(nearest - roundedUp, value);
+}
+
+// Same arithmetic as TheoStrategy on exact whole-nanosecond doubles. The body
+// has no branches and the lane arrays cannot alias, so with a trip count that
+// is a multiple of LANE_BLOCK GCC vectorises the loop at -O2 (check with
+// -fopt-info-vec). Lanes with a zero theo never read their cancel flags, so
+// the division needs no guard.
+void evaluateLaneRange(size_t begin, size_t end, double midPrice,
+                       const double* __restrict tradeAvg, const double* __restrict tradeWeight,
+                       const double* __restrict midWeight, const double* __restrict bidFactor,
+                       const double* __restrict askFactor, const double* __restrict cancelEdge,
+                       const double* __restrict workingBid, const double* __restrict workingAsk,
+                       double* __restrict theo, double* __restrict bidPrice, double* __restrict askPrice,
+                       double* __restrict cancelBid, double* __restrict cancelAsk) {
+    for (size_t i = begin; i < end; ++i) {
+        double value = truncateNanos(tradeWeight[i] * tradeAvg[i] + midWeight[i] * midPrice);
+
+        theo[i] = value;
+        bidPrice[i] = truncateNanos(value * bidFactor[i]);
+        askPrice[i] = truncateNanos(value * askFactor[i]);
+        cancelBid[i] = ((value - workingBid[i]) / value) * 100.0 < cancelEdge[i];
+        cancelAsk[i] = ((workingAsk[i] - value) / value) * 100.0 < cancelEdge[i];
+    }
+}
+
+}  // namespace
+
+TheoSweepCore::TheoSweepCore(const std::vector<double>& placeEdgePercents,
+                             const std::vector<double>& cancelEdgePercents,
+                             double tradeWeight, double emaDecay, uint64_t emaHalfLifeNs)
+    : laneCount_(placeEdgePercents.size()),
+      paddedLaneCount_((placeEdgePercents.size() + LANE_BLOCK - 1) / LANE_BLOCK * LANE_BLOCK),
+      epoch_(0),
+      tradeEpoch_(0),
+      topEpoch_(0),
+      tradeWeight_(tradeWeight),
+      placeEdgePercent_(placeEdgePercents),
+      cancelEdgePercent_(cancelEdgePercents) {
+
+    if (laneCount_ == 0 || cancelEdgePercents.size() != laneCount_) {
+        throw std::invalid_argument("Theo sweep needs one place and one cancel edge per lane");
+    }
+
+    // Padding lanes quote at the mid and are never read
+    cancelEdgePercent_.resize(paddedLaneCount_, 0.0);
+    bidFactor_.assign(paddedLaneCount_, 1.0);
+    askFactor_.assign(paddedLaneCount_, 1.0);
+    for (size_t lane = 0; lane < laneCount_; ++lane) {
+        bidFactor_[lane] = 1.0 - (placeEdgePercent_[lane] / 100.0);
+        askFactor_[lane] = 1.0 + (placeEdgePercent_[lane] / 100.0);
+    }
+
+    tradeEma_.assign(laneCount_, TradeEma(emaDecay, emaHalfLifeNs));
+    lastMarketTs_.assign(laneCount_, 0);
+    tradeAvgPrice_.assign(paddedLaneCount_, 0.0);
+    laneTradeWeight_.assign(paddedLaneCount_, 0.0);
+    laneMidWeight_.assign(paddedLaneCount_, 1.0);
+
+    workingBid_.assign(paddedLaneCount_, 0.0);
+    workingAsk_.assign(paddedLaneCount_, 0.0);
+    theo_.assign(paddedLaneCount_, 0.0);
+    bidPrice_.assign(paddedLaneCount_, 0.0);
+    askPrice_.assign(paddedLaneCount_, 0.0);
+    cancelBid_.assign(paddedLaneCount_, 0.0);
+    cancelAsk_.assign(paddedLaneCount_, 0.0);
+}
+
+size_t TheoSweepCore::memoryBytes() const {
+    return sizeof(*this) +
+           vectorMemoryBytes(placeEdgePercent_) + vectorMemoryBytes(cancelEdgePercent_) +
+           vectorMemoryBytes(bidFactor_) + vectorMemoryBytes(askFactor_) +
+           vectorMemoryBytes(tradeEma_) + vectorMemoryBytes(lastMarketTs_) + vectorMemoryBytes(tradeAvgPrice_) +
+           vectorMemoryBytes(laneTradeWeight_) + vectorMemoryBytes(laneMidWeight_) +
+           vectorMemoryBytes(workingBid_) + vectorMemoryBytes(workingAsk_) + vectorMemoryBytes(theo_) +
+           vectorMemoryBytes(bidPrice_) + vectorMemoryBytes(askPrice_) +
+           vectorMemoryBytes(cancelBid_) + vectorMemoryBytes(cancelAsk_);
+}
+
+void TheoSweepCore::onMarketTrade(size_t lane, int64_t tradePrice, uint64_t timestamp) {
+    if (epoch_ == 0) {
+        lastMarketTs_[lane] = timestamp;
+        addTrade(lane, tradePrice, timestamp);
+        return;
+    }
+    if (tradeEpoch_ == epoch_) {
+        return;
+    }
+    tradeEpoch_ = epoch_;
+
+    for (size_t i = 0; i < laneCount_; ++i) {
+        lastMarketTs_[i] = timestamp;
+        addTrade(i, tradePrice, timestamp);
+    }
+}
+
+void TheoSweepCore::onLaneFill(size_t lane, int64_t fillPrice) {
+    addTrade(lane, fillPrice, lastMarketTs_[lane]);
+}
+
+void TheoSweepCore::evaluateTop(size_t lane, const book_top_t& bookTop) {
+    int64_t midPrice = (bookTop.top_level.bid_nanos + bookTop.top_level.ask_nanos) / 2;
+
+    // Evaluating a lane's whole block is as cheap as the lane alone, and the
+    // other lanes overwrite those results before reading them
+    if (epoch_ == 0) {
+        lastMarketTs_[lane] = bookTop.ts;
+        evaluateBlocks(lane / LANE_BLOCK, lane / LANE_BLOCK + 1, static_cast<double>(midPrice));
+        return;
+    }
+    if (topEpoch_ == epoch_) {
+        return;
+    }
+    topEpoch_ = epoch_;
+
+    for (size_t i = 0; i < laneCount_; ++i) {
+        lastMarketTs_[i] = bookTop.ts;
+    }
+    evaluateBlocks(0, paddedLaneCount_ / LANE_BLOCK, static_cast<double>(midPrice));
+}
+
+void TheoSweepCore::evaluateBlocks(size_t beginBlock, size_t endBlock, double midPrice) {
+    evaluateLaneRange(beginBlock * LANE_BLOCK, endBlock * LANE_BLOCK, midPrice,
+                      tradeAvgPrice_.data(), laneTradeWeight_.data(), laneMidWeight_.data(),
+                      bidFactor_.data(), askFactor_.data(), cancelEdgePercent_.data(),
+                      workingBid_.data(), workingAsk_.data(),
+                      theo_.data(), bidPrice_.data(), askPrice_.data(),
+                      cancelBid_.data(), cancelAsk_.data());
+}
+
+void TheoSweepCore::addTrade(size_t lane, int64_t tradePrice, uint64_t timestamp) {
+    tradeEma_[lane].add(tradePrice, timestamp);
+
+    int64_t average = tradeEma_[lane].average();
+    bool hasAverage = average > 0;
+    tradeAvgPrice_[lane] = static_cast<double>(average);
+    laneTradeWeight_[lane] = hasAverage ? tradeWeight_ : 0.0;
+    laneMidWeight_[lane] = hasAverage ? 1 - tradeWeight_ : 1.0;
+}
+
+TheoSweepLane::TheoSweepLane(std::shared_ptr<TheoSweepCore> core, size_t lane)
+    : core_(std::move(core)),
+      lane_(lane),
+      symbolId_(0),
+      nextOrderId_(1),
+      currentBidOrderId_(0),
+      currentAskOrderId_(0),
+      currentBidPrice_(0),
+      currentAskPrice_(0),
+      currentTheoValue_(0) {}
+
+std::string TheoSweepLane::getName() const {
+    return "Theo Strategy Sweep (lane " + std::to_string(lane_) + ")";
+}
+
+size_t TheoSweepLane::memoryBytes() const {
+    return sizeof(*this) + activeOrders_.memoryBytes() + (lane_ == 0 ? core_->memoryBytes() : 0);
+}
+
+void TheoSweepLane::setSymbolId(uint64_t symbolId) {
+    symbolId_ = symbolId;
+}
+
+void TheoSweepLane::setTimerService(TimerService* timerService) {
+    Strategy::setTimerService(timerService);
+    activeOrders_.setTimerService(timerService);
+}
+
+std::vector<OrderAction> TheoSweepLane::onBookTopUpdate(const book_top_t& bookTop) {
+    if (bookTop.top_level.bid_nanos <= 0 || bookTop.top_level.ask_nanos <= 0 ||
+        bookTop.top_level.bid_nanos >= bookTop.top_level.ask_nanos) {
+        return {};
+    }
+
+    core_->evaluateTop(lane_, bookTop);
+    currentTheoValue_ = core_->theo(lane_);
+
+    std::vector<OrderAction> cancelActions = checkOrdersAgainstTheo();
+
+    if (timerService_ == nullptr) {
+        std::vector<OrderAction> staleOrderActions = checkForStaleOrders(bookTop.ts);
+        cancelActions.insert(cancelActions.end(), staleOrderActions.begin(), staleOrderActions.end());
+    }
+
+    std::vector<OrderAction> newOrderActions = updateOrdersForBookTop(bookTop);
+    cancelActions.insert(cancelActions.end(), newOrderActions.begin(), newOrderActions.end());
+    return cancelActions;
+}
+
+std::vector<OrderAction> TheoSweepLane::onFill(const book_fill_snapshot_t& fill) {
+    core_->onMarketTrade(lane_, fill.trade_price, fill.ts);
+    return {};
+}
+
+std::vector<OrderAction> TheoSweepLane::onOrderFilled(uint64_t orderId, int64_t fillPrice,
+                                                    uint32_t /* fillQty */, bool isBid) {
+    if (orderId == 0) {
+        return {};
+    }
+
+    if (isBid && orderId == currentBidOrderId_) {
+        currentBidOrderId_ = 0;
+    } else if (!isBid && orderId == currentAskOrderId_) {
+        currentAskOrderId_ = 0;
+    }
+
+    core_->onLaneFill(lane_, fillPrice);
+    removeOrder(orderId);
+
+    return {};
+}
+
+std::vector<OrderAction> TheoSweepLane::onTimer(uint64_t orderId, uint64_t /* timestamp */) {
+    if (!activeOrders_.contains(orderId)) {
+        return {};
+    }
+
+    OrderAction cancelAction;
+    cancelAction.type = OrderAction::Type::CANCEL;
+    cancelAction.orderId = orderId;
+    cancelAction.symbolId = symbolId_;
+
+    removeOrder(orderId);
+    return {cancelAction};
+}
+
+void TheoSweepLane::removeOrder(uint64_t orderId) {
+    if (orderId == 0) {
+        return;
+    }
+
+    activeOrders_.remove(orderId);
+
+    if (orderId == currentBidOrderId_) {
+        currentBidOrderId_ = 0;
+    }
+    if (orderId == currentAskOrderId_) {
+        currentAskOrderId_ = 0;
+    }
+}
+
+std::vector<OrderAction> TheoSweepLane::checkOrdersAgainstTheo() {
+    std::vector<OrderAction> actions;
+
+    if (currentTheoValue_ <= 0) {
+        return actions;
+    }
+
+    // The working orders are the lane's current quotes, whose cancel checks
+    // were evaluated with the rest of the sweep
+    activeOrders_.removeIf([&](const OrderInfo& order) {
+        bool cancel = order.isBid ? core_->cancelBid(lane_) : core_->cancelAsk(lane_);
+        if (!cancel) {
+            return false;
+        }
+
+        OrderAction cancelAction;
+        cancelAction.type = OrderAction::Type::CANCEL;
+        cancelAction.orderId = order.orderId;
+        cancelAction.symbolId = symbolId_;
+        actions.push_back(cancelAction);
+
+        if (order.isBid && order.orderId == currentBidOrderId_) {
+            currentBidOrderId_ = 0;
+        } else if (!order.isBid && order.orderId == currentAskOrderId_) {
+            currentAskOrderId_ = 0;
+        }
+        return true;
+    });
+
+    return actions;
+}
+
+std::vector<OrderAction> TheoSweepLane::checkForStaleOrders(uint64_t currentTimestamp) {
+    std::vector<OrderAction> actions;
+
+    activeOrders_.removeOldestWhile([&](const OrderInfo& order) {
+        if (currentTimestamp < order.creationTime ||
+            currentTimestamp - order.creationTime < TEN_MINUTES_NS) {
+            return false;
+        }
+
+        OrderAction cancelAction;
+        cancelAction.type = OrderAction::Type::CANCEL;
+        cancelAction.orderId = order.orderId;
+        cancelAction.symbolId = symbolId_;
+        actions.push_back(cancelAction);
+
+        if (order.isBid && order.orderId == currentBidOrderId_) {
+            currentBidOrderId_ = 0;
+        } else if (!order.isBid && order.orderId == currentAskOrderId_) {
+            currentAskOrderId_ = 0;
+        }
+        return true;
+    });
+
+    return actions;
+}
+
+std::vector<OrderAction> TheoSweepLane::updateOrdersForBookTop(const book_top_t& bookTop) {
+    std::vector<OrderAction> actions;
+
+    if (currentTheoValue_ <= 0) {
+        return actions;
+    }
+
+    const int64_t MAX_REASONABLE_PRICE = 10000LL * 1000000000LL; // $10,000 in nanos
+
+    if (bookTop.top_level.bid_nanos > MAX_REASONABLE_PRICE || bookTop.top_level.ask_nanos > MAX_REASONABLE_PRICE) {
+        return actions;
+    }
+
+    int64_t optimalBidPrice = core_->bidPrice(lane_);
+    int64_t optimalAskPrice = core_->askPrice(lane_);
+
+    if (optimalBidPrice > 0 && optimalBidPrice < bookTop.top_level.ask_nanos) {
+        if (currentBidOrderId_ == 0 || std::abs(optimalBidPrice - currentBidPrice_) > currentTheoValue_ * 0.001) {
+            requote(true, optimalBidPrice, bookTop, actions);
+        }
+    }
+
+    if (optimalAskPrice > 0 && optimalAskPrice > bookTop.top_level.bid_nanos) {
+        if (currentAskOrderId_ == 0 || std::abs(optimalAskPrice - currentAskPrice_) > currentTheoValue_ * 0.001) {
+            requote(false, optimalAskPrice, bookTop, actions);
+        }
+    }
+
+    return actions;
+}
+
+void TheoSweepLane::requote(bool isBid, int64_t price, const book_top_t& bookTop,
+                            std::vector<OrderAction>& actions) {
+    uint64_t& currentOrderId = isBid ? currentBidOrderId_ : currentAskOrderId_;
+
+    if (currentOrderId != 0) {
+        OrderAction cancelAction;
+        cancelAction.type = OrderAction::Type::CANCEL;
+        cancelAction.orderId = currentOrderId;
+        cancelAction.symbolId = symbolId_;
+        actions.push_back(cancelAction);
+
+        removeOrder(currentOrderId);
+        currentOrderId = 0;
+    }
+
+    OrderAction newOrder;
+    newOrder.type = OrderAction::Type::ADD;
+    newOrder.orderId = nextOrderId_++;
+    newOrder.symbolId = symbolId_;
+    newOrder.sent_ts = bookTop.ts;
+    newOrder.md_ts = bookTop.ts;
+    newOrder.price = price;
+    newOrder.quantity = 1;
+    newOrder.isBid = isBid;
+    newOrder.isPostOnly = true;
+    actions.push_back(newOrder);
+
+    currentOrderId = newOrder.orderId;
+    if (isBid) {
+        currentBidPrice_ = price;
+        core_->setWorkingBid(lane_, price);
+    } else {
+        currentAskPrice_ = price;
+        core_->setWorkingAsk(lane_, price);
+    }
+
+    OrderInfo info;
+    info.orderId = newOrder.orderId;
+    info.creationTime = bookTop.ts;
+    info.price = price;
+    info.quantity = 1;
+    info.isBid = isBid;
+    activeOrders_.add(info, bookTop.ts + TEN_MINUTES_NS);
+}
@@ -0,0 +1,151 @@
+#ifndef THEO_SWEEP_STRATEGY_H
+#define THEO_SWEEP_STRATEGY_H
+
+#include "strategy.h"
+#include "order_tracker.h"
+#include "theo_strategy.h"
+#include "trade_ema.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+// Shared state of a TheoStrategy parameter sweep.
+//
+// Every lane is a TheoStrategy with its own place/cancel edge. Lane state is
+// kept in structure-of-arrays form so the per-lane work of a market event -
+// blending the theo, pricing the quotes and checking the working quotes
+// against the cancel edge - runs as one loop over lanes. Lanes still own
+// their trade EMA because each one folds in its own fills.
+//
+// The evaluation arrays hold prices as whole-nanosecond doubles and are
+// padded to a multiple of LANE_BLOCK lanes, which lets that loop vectorise
+// at -O2. Prices are converted back to int64 nanos only when read.
+//
+// A driver that replays an event to all lanes calls beginEvent() first; the
+// first lane to see the event evaluates every lane and the rest reuse the
+// results. Without a driver (epoch 0) each lane is evaluated on its own.
+class TheoSweepCore {
+public:
+    static constexpr size_t LANE_BLOCK = 4;
+
+    TheoSweepCore(const std::vector<double>& placeEdgePercents,
+                  const std::vector<double>& cancelEdgePercents,
+                  double tradeWeight = TheoStrategy::DEFAULT_TRADE_WEIGHT,
+                  double emaDecay = TheoStrategy::DEFAULT_EMA_DECAY,
+                  uint64_t emaHalfLifeNs = 0);
+
+    size_t laneCount() const { return laneCount_; }
+    size_t memoryBytes() const;
+    double placeEdgePercent(size_t lane) const { return placeEdgePercent_[lane]; }
+    double cancelEdgePercent(size_t lane) const { return cancelEdgePercent_[lane]; }
+
+    // Start a new market event shared by all lanes
+    void beginEvent() { epoch_++; }
+
+    // Market trade seen by every lane
+    void onMarketTrade(size_t lane, int64_t tradePrice, uint64_t timestamp);
+
+    // A lane's own fill, stamped with that lane's latest market time
+    void onLaneFill(size_t lane, int64_t fillPrice);
+
+    // Evaluate theo, quote prices and cancel checks for a valid book top
+    void evaluateTop(size_t lane, const book_top_t& bookTop);
+
+    // Results of the last evaluateTop for a lane
+    int64_t theo(size_t lane) const { return static_cast<int64_t>(theo_[lane]); }
+    int64_t bidPrice(size_t lane) const { return static_cast<int64_t>(bidPrice_[lane]); }
+    int64_t askPrice(size_t lane) const { return static_cast<int64_t>(askPrice_[lane]); }
+    bool cancelBid(size_t lane) const { return cancelBid_[lane] != 0.0; }
+    bool cancelAsk(size_t lane) const { return cancelAsk_[lane] != 0.0; }
+
+    // Price of the lane's current quote on each side, used by the cancel checks
+    void setWorkingBid(size_t lane, int64_t price) { workingBid_[lane] = static_cast<double>(price); }
+    void setWorkingAsk(size_t lane, int64_t price) { workingAsk_[lane] = static_cast<double>(price); }
+
+private:
+    void addTrade(size_t lane, int64_t tradePrice, uint64_t timestamp);
+    void evaluateBlocks(size_t beginBlock, size_t endBlock, double midPrice);
+
+    size_t laneCount_;
+    size_t paddedLaneCount_;
+    uint64_t epoch_;
+    uint64_t tradeEpoch_;
+    uint64_t topEpoch_;
+
+    double tradeWeight_;
+
+    // Edge parameters, with the quote multipliers precomputed per lane. The
+    // cancel edges and multipliers are padded to paddedLaneCount_.
+    std::vector<double> placeEdgePercent_;
+    std::vector<double> cancelEdgePercent_;
+    std::vector<double> bidFactor_;
+    std::vector<double> askFactor_;
+
+    // Trade EMA per lane, as in TheoStrategy, with its average copied out
+    // for the evaluation loop. A lane without trades blends with weights
+    // (0, 1), which yields the plain mid the way TheoStrategy does.
+    std::vector<TradeEma> tradeEma_;
+    std::vector<uint64_t> lastMarketTs_;
+    std::vector<double> tradeAvgPrice_;
+    std::vector<double> laneTradeWeight_;
+    std::vector<double> laneMidWeight_;
+
+    // Working quotes and evaluation results; cancel flags are 1.0 or 0.0
+    std::vector<double> workingBid_;
+    std::vector<double> workingAsk_;
+    std::vector<double> theo_;
+    std::vector<double> bidPrice_;
+    std::vector<double> askPrice_;
+    std::vector<double> cancelBid_;
+    std::vector<double> cancelAsk_;
+};
+
+// One lane of a sweep. Behaves like TheoStrategy with the lane's edges, but
+// takes its theo and quote decisions from the shared core. Lanes do not log
+// individual quotes.
+class TheoSweepLane final : public Strategy {
+public:
+    TheoSweepLane(std::shared_ptr<TheoSweepCore> core, size_t lane);
+
+    std::vector<OrderAction> onBookTopUpdate(const book_top_t& bookTop) override;
+    std::vector<OrderAction> onFill(const book_fill_snapshot_t& fill) override;
+    std::vector<OrderAction> onOrderFilled(uint64_t orderId, int64_t fillPrice,
+                                          uint32_t fillQty, bool isBid) override;
+    std::vector<OrderAction> onTimer(uint64_t orderId, uint64_t timestamp) override;
+
+    void setSymbolId(uint64_t symbolId) override;
+    void setTimerService(TimerService* timerService) override;
+    std::string getName() const override;
+
+    // The shared core is counted with lane 0
+    size_t memoryBytes() const override;
+
+private:
+    static constexpr uint64_t TEN_MINUTES_NS = 10ULL * 60ULL * 1000000000ULL;  // 10 minutes
+
+    using OrderInfo = OrderTracker::OrderInfo;
+
+    std::vector<OrderAction> checkOrdersAgainstTheo();
+    std::vector<OrderAction> checkForStaleOrders(uint64_t currentTimestamp);
+    std::vector<OrderAction> updateOrdersForBookTop(const book_top_t& bookTop);
+    void removeOrder(uint64_t orderId);
+
+    // Cancel the current quote on one side (if any) and place a new one
+    void requote(bool isBid, int64_t price, const book_top_t& bookTop,
+                 std::vector<OrderAction>& actions);
+
+    std::shared_ptr<TheoSweepCore> core_;
+    size_t lane_;
+    uint64_t symbolId_;
+    uint64_t nextOrderId_;
+
+    OrderTracker activeOrders_;
+
+    uint64_t currentBidOrderId_;
+    uint64_t currentAskOrderId_;
+    int64_t currentBidPrice_;
+    int64_t currentAskPrice_;
+    int64_t currentTheoValue_;
+};
+
+#endif
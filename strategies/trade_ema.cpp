@@ -0,0 +1,77 @@
+#include "trade_ema.h"
+#include <cmath>
+
+TradeEma::TradeEma(double decay, uint64_t halfLifeNs)
+    : decay_(decay),
+      halfLifeNs_(halfLifeNs),
+      evictedWeight_(std::pow(1.0 - decay, static_cast<double>(MAX_TRADE_HISTORY))),
+      ring_(),
+      ringNext_(0),
+      count_(0),
+      priceSum_(0),
+      weightSum_(0),
+      updatesSinceResync_(0),
+      lastTradeTs_(0),
+      average_(0) {}
+
+void TradeEma::add(int64_t tradePrice, uint64_t timestamp) {
+    if (tradePrice <= 0) return;
+
+    const double price = static_cast<double>(tradePrice);
+
+    if (halfLifeNs_ > 0) {
+        // Time-based decay: age the existing sums by the time since the last trade
+        const double LN2 = 0.69314718055994530942;
+        uint64_t elapsedNs = (count_ > 0 && timestamp > lastTradeTs_) ? timestamp - lastTradeTs_ : 0;
+        double decay = std::exp(-LN2 * static_cast<double>(elapsedNs) / static_cast<double>(halfLifeNs_));
+        priceSum_ = priceSum_ * decay + price;
+        weightSum_ = weightSum_ * decay + 1.0;
+        if (timestamp > lastTradeTs_) {
+            lastTradeTs_ = timestamp;
+        }
+        count_++;
+    } else {
+        // Count-based decay over the last MAX_TRADE_HISTORY trades
+        const double decay = 1.0 - decay_;
+        priceSum_ = priceSum_ * decay + price;
+        weightSum_ = weightSum_ * decay + 1.0;
+
+        if (count_ == MAX_TRADE_HISTORY) {
+            // The slot about to be overwritten holds the oldest trade
+            priceSum_ -= evictedWeight_ * static_cast<double>(ring_[ringNext_]);
+            weightSum_ -= evictedWeight_;
+        } else {
+            count_++;
+        }
+        ring_[ringNext_] = tradePrice;
+        ringNext_ = (ringNext_ + 1) % MAX_TRADE_HISTORY;
+
+        if (++updatesSinceResync_ >= RESYNC_INTERVAL) {
+            resync();
+        }
+    }
+
+    if (count_ == 1) {
+        average_ = tradePrice;
+    } else {
+        average_ = static_cast<int64_t>(priceSum_ / weightSum_);
+    }
+}
+
+void TradeEma::resync() {
+    double weightSum = 0;
+    double priceSum = 0;
+    double weight = 1.0;
+
+    // Walk the ring from the newest trade to the oldest
+    for (size_t i = 0; i < count_; ++i) {
+        size_t idx = (ringNext_ + MAX_TRADE_HISTORY - 1 - i) % MAX_TRADE_HISTORY;
+        priceSum += weight * static_cast<double>(ring_[idx]);
+        weightSum += weight;
+        weight *= (1.0 - decay_);
+    }
+
+    priceSum_ = priceSum;
+    weightSum_ = weightSum;
+    updatesSinceResync_ = 0;
+}
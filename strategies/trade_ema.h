@@ -0,0 +1,43 @@
+#ifndef TRADE_EMA_H
+#define TRADE_EMA_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Exponential moving average of trade prices behind TheoStrategy's theo,
+// kept as incrementally decayed sums so that adding a trade and reading the
+// average are both O(1). With halfLifeNs == 0 each trade decays the previous
+// ones by (1 - decay) over a window of MAX_TRADE_HISTORY trades; otherwise
+// weights decay with the time elapsed between trade timestamps.
+class TradeEma {
+public:
+    static constexpr size_t MAX_TRADE_HISTORY = 100;
+
+    TradeEma(double decay, uint64_t halfLifeNs);
+
+    void add(int64_t tradePrice, uint64_t timestamp);
+
+    // 0 until the first trade is seen
+    int64_t average() const { return average_; }
+
+private:
+    static constexpr uint32_t RESYNC_INTERVAL = 4096;
+
+    // Rebuild the sums from the ring so rounding error cannot accumulate
+    void resync();
+
+    double decay_;
+    uint64_t halfLifeNs_;
+    double evictedWeight_;   // (1 - decay_)^MAX_TRADE_HISTORY
+    std::array<int64_t, MAX_TRADE_HISTORY> ring_;
+    size_t ringNext_;
+    size_t count_;
+    double priceSum_;
+    double weightSum_;
+    uint32_t updatesSinceResync_;
+    uint64_t lastTradeTs_;
+    int64_t average_;
+};
+
+#endif
@@ -0,0 +1,170 @@
+#include "strategy_registry.h"
+#include <iostream>
+#include <sys/stat.h>
+#include "theo_sweep_runner.h"
+#include "reference_simulator.h"
+
+// Include all strategy headers
+#include "strategies/basic_strategy.h"
+#include "strategies/theo_strategy.h"
+#include "strategies/correlation_strategy.h"
+
+namespace {
+
+// Helper function to check if file exists
+bool file_exists(const std::string& filename) {
+    struct stat buffer;
+    return (stat(filename.c_str(), &buffer) == 0);
+}
+
+// A path from the config, asked for on stdin when it is unset and the run is
+// interactive
+std::string configPath(const RunConfig& config, const RunnerOptions& options,
+                       const std::string& key, const std::string& prompt) {
+    std::string path = std::get<std::string>(config.at(key));
+    if (path.empty()) {
+        if (!options.interactive) {
+            throw RunError(RUN_STRATEGY_ERROR, "Config key '" + key + "' must be set for a non-interactive run");
+        }
+        std::cout << prompt;
+        std::cin >> path;
+    }
+    return path;
+}
+
+std::unique_ptr<SimulationRunner> bindRunner(std::shared_ptr<Strategy> strategy, const RunnerOptions& options) {
+    if (options.referenceEngine) {
+        auto simulator = std::make_unique<ReferenceSimulator>(options.outputFilePath, options.strategyMdLatencyNs,
+                                                              options.exchangeLatencyNs, options.useQueueSimulation);
+        simulator->setStrategy(std::move(strategy));
+        return simulator;
+    }
+    return makeSimulationRunner(std::move(strategy), options.outputFilePath, options.strategyMdLatencyNs,
+                                options.exchangeLatencyNs, options.useQueueSimulation);
+}
+
+std::unique_ptr<SimulationRunner> createBasic(const RunConfig& /* config */, const RunnerOptions& options) {
+    return bindRunner(std::make_shared<BasicStrategy>(), options);
+}
+
+std::unique_ptr<SimulationRunner> createTheo(const RunConfig& config, const RunnerOptions& options) {
+    // Extract TheoStrategy parameters from config
+    double placeEdgePercent = std::get<double>(config.at("place_edge_percent"));
+    double cancelEdgePercent = std::get<double>(config.at("cancel_edge_percent"));
+    uint64_t emaHalfLifeNs = std::get<uint64_t>(config.at("ema_half_life_ns"));
+
+    // Ensure cancel edge is less than place edge
+    if (cancelEdgePercent >= placeEdgePercent) {
+        std::cout << "Warning: Cancel edge must be less than place edge. Adjusting cancel edge to 80% of place edge." << std::endl;
+        cancelEdgePercent = placeEdgePercent * 0.8;
+    }
+
+    std::cout << "Creating TheoStrategy with place_edge=" << placeEdgePercent
+              << "%, cancel_edge=" << cancelEdgePercent << "%";
+    if (emaHalfLifeNs > 0) {
+        std::cout << ", ema_half_life=" << emaHalfLifeNs << "ns";
+    }
+    std::cout << std::endl;
+
+    return bindRunner(std::make_shared<TheoStrategy>(placeEdgePercent, cancelEdgePercent,
+                                                     TheoStrategy::DEFAULT_TRADE_WEIGHT, TheoStrategy::DEFAULT_EMA_DECAY,
+                                                     emaHalfLifeNs), options);
+}
+
+std::unique_ptr<SimulationRunner> createCorrelation(const RunConfig& config, const RunnerOptions& options) {
+    // Extract CorrelationStrategy parameters from config
+    double placeEdgePercent = std::get<double>(config.at("place_edge_percent"));
+    double cancelEdgePercent = std::get<double>(config.at("cancel_edge_percent"));
+    double selfWeight = std::get<double>(config.at("self_weight"));
+
+    std::string correlationPath = configPath(config, options, "correlation_csv", "Enter path to correlation CSV file: ");
+    if (!file_exists(correlationPath)) {
+        if (!options.interactive) {
+            throw RunError(RUN_STRATEGY_ERROR, "Correlation CSV file not found: " + correlationPath);
+        }
+        std::cerr << "Warning: Correlation CSV file not found: " << correlationPath << std::endl;
+        std::cerr << "Using default path: /data/correlation_data/overall_correlations.csv" << std::endl;
+        correlationPath = "/data/correlation_data/overall_correlations.csv";
+    }
+
+    std::string symbolMapPath = configPath(config, options, "symbol_map_csv", "Enter path to symbol mapping CSV file: ");
+
+    // Correlated symbols' files are found next to the main input file
+    std::string dataPath = std::get<std::string>(config.at("correlation_data_path"));
+    if (dataPath.empty()) {
+        dataPath = options.inputFilePath;
+    }
+
+    std::cout << "Creating CorrelationStrategy with place_edge=" << placeEdgePercent
+              << "%, cancel_edge=" << cancelEdgePercent
+              << "%, self_weight=" << selfWeight << std::endl;
+
+    return bindRunner(std::make_shared<CorrelationStrategy>(correlationPath, symbolMapPath, placeEdgePercent,
+                                                            cancelEdgePercent, selfWeight, dataPath), options);
+}
+
+// Create the TheoStrategy edge sweep: one lane per (place, cancel) pair of the
+// configured sweep values, falling back to the single edge for an empty list
+std::unique_ptr<SimulationRunner> createTheoSweep(const RunConfig& config, const RunnerOptions& options) {
+    std::vector<double> placeValues = std::get<std::vector<double>>(config.at("place_edge_sweep"));
+    std::vector<double> cancelValues = std::get<std::vector<double>>(config.at("cancel_edge_sweep"));
+    uint64_t emaHalfLifeNs = std::get<uint64_t>(config.at("ema_half_life_ns"));
+
+    if (placeValues.empty()) {
+        placeValues.push_back(std::get<double>(config.at("place_edge_percent")));
+    }
+    if (cancelValues.empty()) {
+        cancelValues.push_back(std::get<double>(config.at("cancel_edge_percent")));
+    }
+
+    std::vector<double> placeEdges;
+    std::vector<double> cancelEdges;
+    for (double placeEdgePercent : placeValues) {
+        for (double cancelEdgePercent : cancelValues) {
+            // Same adjustment as the single TheoStrategy
+            if (cancelEdgePercent >= placeEdgePercent) {
+                cancelEdgePercent = placeEdgePercent * 0.8;
+            }
+            placeEdges.push_back(placeEdgePercent);
+            cancelEdges.push_back(cancelEdgePercent);
+        }
+    }
+
+    std::cout << "Creating TheoStrategy sweep with " << placeEdges.size() << " lanes";
+    if (emaHalfLifeNs > 0) {
+        std::cout << ", ema_half_life=" << emaHalfLifeNs << "ns";
+    }
+    std::cout << std::endl;
+
+    if (options.referenceEngine) {
+        return std::make_unique<TheoSweepReferenceRunner>(placeEdges, cancelEdges, emaHalfLifeNs,
+                                                          options.outputFilePath, options.strategyMdLatencyNs,
+                                                          options.exchangeLatencyNs, options.useQueueSimulation);
+    }
+
+    auto core = std::make_shared<TheoSweepCore>(placeEdges, cancelEdges, TheoStrategy::DEFAULT_TRADE_WEIGHT,
+                                                TheoStrategy::DEFAULT_EMA_DECAY, emaHalfLifeNs);
+    return std::make_unique<TheoSweepRunner>(core, options.outputFilePath, options.strategyMdLatencyNs,
+                                             options.exchangeLatencyNs, options.useQueueSimulation);
+}
+
+} // namespace
+
+const std::vector<StrategyEntry>& strategyRegistry() {
+    static const std::vector<StrategyEntry> registry = {
+        {"basic", 1, "Basic Strategy - Simple strategy that places orders at the top of the book", createBasic},
+        {"theo", 2, "Theo Strategy - Advanced strategy that calculates theoretical value using a time-weighted EMA of trades and midpoints", createTheo},
+        {"correlation", 3, "Correlation Strategy - Strategy that uses correlations between symbols to calculate theoretical prices", createCorrelation},
+        {"theo_sweep", 4, "Theo Strategy Sweep - Theo Strategy over a grid of place/cancel edges, one simulator per lane", createTheoSweep},
+    };
+    return registry;
+}
+
+const StrategyEntry* findStrategy(const std::string& nameOrNumber) {
+    for (const auto& entry : strategyRegistry()) {
+        if (entry.name == nameOrNumber || std::to_string(entry.menuNumber) == nameOrNumber) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
@@ -0,0 +1,39 @@
+#ifndef STRATEGY_REGISTRY_H
+#define STRATEGY_REGISTRY_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "fill_simulator.h"
+#include "run_config.h"
+
+// Everything a strategy factory needs besides the config
+struct RunnerOptions {
+    std::string inputFilePath;      // book tops or book events file
+    std::string outputFilePath;
+    uint64_t strategyMdLatencyNs;
+    uint64_t exchangeLatencyNs;
+    bool useQueueSimulation;
+    bool interactive;               // missing inputs may be asked for on stdin
+    bool referenceEngine;           // ReferenceSimulator, which --verify checks the optimized engine against
+};
+
+using RunnerFactory = std::function<std::unique_ptr<SimulationRunner>(const RunConfig&, const RunnerOptions&)>;
+
+// A strategy selectable by name (config key "strategy", --strategy) or by its
+// number in the interactive menu
+struct StrategyEntry {
+    std::string name;
+    int menuNumber;
+    std::string description;
+    RunnerFactory createRunner;
+};
+
+const std::vector<StrategyEntry>& strategyRegistry();
+
+// Look up a strategy by name or menu number; nullptr if there is none
+const StrategyEntry* findStrategy(const std::string& nameOrNumber);
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef TESTS_CHECK_H
+#define TESTS_CHECK_H
+
+#include <cstdio>
+
+// Checks that failed so far; each test's main exits non-zero if any did
+inline int failures = 0;
+
+// Report a failed condition with its location and carry on, so one run
+// shows every failure
+#define CHECK(condition)                                                       \
+    do {                                                                       \
+        if (!(condition)) {                                                    \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__,        \
+                         __LINE__, #condition);                                \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+#endif
@@ -0,0 +1,121 @@
+#include <cstdint>
+#include <cstdio>
+#include <list>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+#include "engine/depth_history.h"
+#include "check.h"
+
+namespace {
+
+const int64_t MID = 100000000000LL;     // $100
+const int64_t TICK = 10000000LL;        // 1 cent
+
+// The history as a map of the levels held and a list of their keys, the
+// most recently updated first
+struct Model {
+    using Key = std::pair<bool, int64_t>;
+
+    size_t capacity = 0;
+    std::map<Key, DepthHistory::Level> levels;
+    std::list<Key> recent;
+
+    void record(bool isBid, int64_t priceNanos, uint32_t qty, uint64_t ts) {
+        if (capacity == 0) return;
+        Key key{isBid, priceNanos};
+        if (levels.count(key) > 0) {
+            recent.remove(key);
+        } else if (levels.size() == capacity) {
+            levels.erase(recent.back());
+            recent.pop_back();
+        }
+        levels[key] = DepthHistory::Level{priceNanos, ts, qty, isBid};
+        recent.push_front(key);
+    }
+};
+
+bool sameLevel(const DepthHistory::Level& a, const DepthHistory::Level& b) {
+    return a.priceNanos == b.priceNanos && a.ts == b.ts && a.qty == b.qty && a.isBid == b.isBid;
+}
+
+void checkAgainst(const DepthHistory& history, const Model& model, int priceRange) {
+    CHECK(history.capacity() == model.capacity);
+    CHECK(history.size() == model.levels.size());
+
+    std::vector<Model::Key> visited;
+    history.forEachRecent([&](const DepthHistory::Level& level) {
+        visited.emplace_back(level.isBid, level.priceNanos);
+    });
+    CHECK(visited == std::vector<Model::Key>(model.recent.begin(), model.recent.end()));
+
+    for (bool isBid : {true, false}) {
+        for (int tick = -priceRange; tick <= priceRange; ++tick) {
+            int64_t price = MID + tick * TICK;
+            const DepthHistory::Level* found = history.find(isBid, price);
+            auto it = model.levels.find(Model::Key{isBid, price});
+            CHECK((found != nullptr) == (it != model.levels.end()));
+            if (found != nullptr && it != model.levels.end()) {
+                CHECK(sameLevel(*found, it->second));
+            }
+        }
+    }
+}
+
+// Random records over a few times more prices than the history holds, so
+// that most records of a new price evict one and the index's probe chains
+// see a steady stream of backward-shift deletions; now and then the history
+// is reset to another capacity
+void testAgainstModel(uint64_t seed, size_t capacity, int priceRange) {
+    std::mt19937_64 rng(seed);
+    const int failuresBefore = failures;
+    DepthHistory history;
+    Model model;
+    history.reset(capacity);
+    model.capacity = capacity;
+    uint64_t ts = 0;
+
+    for (int step = 0; step < 100000; ++step) {
+        ts += rng() % 1000;
+        bool isBid = (rng() & 1) != 0;
+        int64_t price = MID + (static_cast<int64_t>(rng() % (2 * priceRange + 1)) - priceRange) * TICK;
+        uint32_t qty = static_cast<uint32_t>(rng() % 1000);
+        history.record(isBid, price, qty, ts);
+        model.record(isBid, price, qty, ts);
+
+        if (rng() % 20000 == 0) {
+            size_t newCapacity = rng() % (2 * capacity + 1);
+            history.reset(newCapacity);
+            model = Model();
+            model.capacity = newCapacity;
+        }
+
+        if (step % 3 == 0) {
+            checkAgainst(history, model, priceRange);
+        }
+        if (failures > failuresBefore) {
+            std::fprintf(stderr, "seed %llu, capacity %zu: step %d\n", static_cast<unsigned long long>(seed),
+                         capacity, step);
+            return;
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    for (uint64_t seed = 1; seed <= 3; ++seed) {
+        testAgainstModel(seed, 0, 4);
+        testAgainstModel(seed, 1, 4);
+        testAgainstModel(seed, 3, 6);
+        testAgainstModel(seed, 8, 12);
+        testAgainstModel(seed, 13, 40);
+    }
+    if (failures > 0) {
+        std::fprintf(stderr, "depth_history_test: %d failures\n", failures);
+        return 1;
+    }
+    std::printf("depth_history_test: ok\n");
+    return 0;
+}
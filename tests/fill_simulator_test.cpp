@@ -0,0 +1,281 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include "fill_simulator.h"
+#include "engine/queue_book.h"
+#include "check.h"
+
+namespace {
+
+const int64_t MID = 100000000000LL;     // $100
+const int64_t TICK = 10000000LL;        // 1 cent
+const uint64_t MS = 1000000;
+const char* OUTPUT_PATH = "build/fill_simulator_test.out";
+
+struct Fill {
+    uint64_t orderId;
+    int64_t price;
+    uint32_t qty;
+    bool isBid;
+};
+
+// Sends the orders it is given at the next book top and records the fills
+// it hears of; cancels an order at its first fill when asked to, and takes
+// tops in batches when asked to
+class ScriptedStrategy final : public Strategy {
+public:
+    explicit ScriptedStrategy(bool batches = false) : batches_(batches) {}
+
+    bool batchesBookTops() const override { return batches_; }
+
+    std::vector<OrderAction> onBookTopUpdate(const book_top_t& /* bookTop */) override {
+        std::vector<OrderAction> actions;
+        actions.swap(pending_);
+        return actions;
+    }
+
+    std::vector<OrderAction> onFill(const book_fill_snapshot_t& /* fill */) override { return {}; }
+
+    std::vector<OrderAction> onOrderFilled(uint64_t orderId, int64_t fillPrice,
+                                          uint32_t fillQty, bool isBid) override {
+        fills.push_back(Fill{orderId, fillPrice, fillQty, isBid});
+        if (orderId != cancelAtFirstFill) {
+            return {};
+        }
+        OrderAction cancel;
+        cancel.type = OrderAction::Type::CANCEL;
+        cancel.orderId = orderId;
+        return {cancel};
+    }
+
+    void setSymbolId(uint64_t /* symbolId */) override {}
+    std::string getName() const override { return "scripted"; }
+
+    // A limit order that takes liquidity when it crosses
+    void send(uint64_t orderId, bool isBid, int64_t price, uint32_t quantity) {
+        OrderAction action;
+        action.type = OrderAction::Type::ADD;
+        action.orderId = orderId;
+        action.price = price;
+        action.quantity = quantity;
+        action.isBid = isBid;
+        action.isPostOnly = false;
+        pending_.push_back(action);
+    }
+
+    std::vector<Fill> fills;
+    uint64_t cancelAtFirstFill = 0;
+
+private:
+    bool batches_;
+    std::vector<OrderAction> pending_;
+};
+
+// Three levels a tick apart on each side, with the given quantities from
+// the best level out
+book_top_t makeTop(uint64_t ts, uint32_t q1, uint32_t q2, uint32_t q3) {
+    book_top_t top;
+    std::memset(&top, 0, sizeof(top));
+    top.ts = ts;
+    top.seqno = ts;
+    top.top_level = book_top_level_t{MID - TICK, MID + TICK, q1, q1};
+    top.second_level = book_top_level_t{MID - 2 * TICK, MID + 2 * TICK, q2, q2};
+    top.third_level = book_top_level_t{MID - 3 * TICK, MID + 3 * TICK, q3, q3};
+    return top;
+}
+
+bool fillIs(const Fill& fill, uint64_t orderId, int64_t price, uint32_t qty, bool isBid) {
+    return fill.orderId == orderId && fill.price == price && fill.qty == qty && fill.isBid == isBid;
+}
+
+// A buy through all three ask levels fills each level at its own price
+// for what it shows, the last one for what is left
+void testCrossingBuyWalksLevels() {
+    FillSimulator simulator(OUTPUT_PATH);
+    auto strategy = std::make_shared<ScriptedStrategy>();
+    simulator.setStrategy(strategy);
+
+    strategy->send(1, true, MID + 3 * TICK, 1200);
+    simulator.processBookTop(makeTop(1 * MS, 500, 500, 500));
+
+    const std::vector<Fill>& fills = strategy->fills;
+    CHECK(fills.size() == 3);
+    if (fills.size() == 3) {
+        CHECK(fillIs(fills[0], 1, MID + TICK, 500, true));
+        CHECK(fillIs(fills[1], 1, MID + 2 * TICK, 500, true));
+        CHECK(fillIs(fills[2], 1, MID + 3 * TICK, 200, true));
+    }
+    CHECK(simulator.summary().position == 1200);
+}
+
+// A sell limited to the second bid level fills the two levels within its
+// limit and rests the remainder; at the next top the remainder takes what
+// the book then shows within the limit and no more
+void testCrossingSellRestsAndRefills() {
+    FillSimulator simulator(OUTPUT_PATH);
+    auto strategy = std::make_shared<ScriptedStrategy>();
+    simulator.setStrategy(strategy);
+
+    strategy->send(7, false, MID - 2 * TICK, 1200);
+    simulator.processBookTop(makeTop(1 * MS, 300, 400, 500));
+
+    const std::vector<Fill>& fills = strategy->fills;
+    CHECK(fills.size() == 2);
+    if (fills.size() == 2) {
+        CHECK(fillIs(fills[0], 7, MID - TICK, 300, false));
+        CHECK(fillIs(fills[1], 7, MID - 2 * TICK, 400, false));
+    }
+
+    simulator.processBookTop(makeTop(2 * MS, 100, 250, 500));
+    CHECK(fills.size() == 4);
+    if (fills.size() == 4) {
+        CHECK(fillIs(fills[2], 7, MID - TICK, 100, false));
+        CHECK(fillIs(fills[3], 7, MID - 2 * TICK, 250, false));
+    }
+    CHECK(simulator.summary().position == -1050);
+}
+
+// A strategy that cancels at the first fill ends the walk there
+void testCancelEndsWalk() {
+    FillSimulator simulator(OUTPUT_PATH);
+    auto strategy = std::make_shared<ScriptedStrategy>();
+    simulator.setStrategy(strategy);
+
+    strategy->cancelAtFirstFill = 3;
+    strategy->send(3, true, MID + 3 * TICK, 1200);
+    simulator.processBookTop(makeTop(1 * MS, 500, 500, 500));
+
+    const std::vector<Fill>& fills = strategy->fills;
+    CHECK(fills.size() == 1);
+    if (fills.size() == 1) {
+        CHECK(fillIs(fills[0], 3, MID + TICK, 500, true));
+    }
+    CHECK(simulator.summary().position == 500);
+}
+
+// A queue run's book: one bid, and five ask levels a tick apart with
+// 100, 200 (two orders), 300, 400 and 500 shown, deeper than the three
+// levels a top publishes
+std::vector<std::pair<book_event_hdr_t, add_order_t>> deepBookEvents() {
+    std::vector<std::pair<book_event_hdr_t, add_order_t>> events;
+    uint64_t seqno = 1;
+    auto add = [&](int64_t price, uint32_t qty, bool isBid) {
+        book_event_hdr_t header{seqno * MS, seqno, book_event_type_e::add_order};
+        events.emplace_back(header, add_order_t{price, seqno, qty, isBid});
+        seqno++;
+    };
+    add(MID - TICK, 1000, true);
+    add(MID + TICK, 100, false);
+    add(MID + 2 * TICK, 150, false);
+    add(MID + 2 * TICK, 50, false);
+    add(MID + 3 * TICK, 300, false);
+    add(MID + 4 * TICK, 400, false);
+    add(MID + 5 * TICK, 500, false);
+    return events;
+}
+
+// Every record a simulator writes, with the event it came from
+class RecordLog final : public RecordObserver {
+public:
+    void onRecord(size_t /* stream */, uint64_t eventIndex, const OrderRecord& record,
+                  const book_top_t& /* bookTop */) override {
+        records.emplace_back(eventIndex, record);
+    }
+
+    std::vector<std::pair<uint64_t, OrderRecord>> records;
+};
+
+bool sameRecords(const RecordLog& a, const RecordLog& b) {
+    if (a.records.size() != b.records.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.records.size(); ++i) {
+        const OrderRecord& x = a.records[i].second;
+        const OrderRecord& y = b.records[i].second;
+        if (a.records[i].first != b.records[i].first || x.timestamp != y.timestamp ||
+            x.event_type != y.event_type || x.order_id != y.order_id || x.symbol_id != y.symbol_id ||
+            x.price != y.price || x.old_price != y.old_price || x.quantity != y.quantity ||
+            x.old_quantity != y.old_quantity || x.is_bid != y.is_bid) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Replay the deep book with the simulator walking it live, as a queue run
+// does, and send a buy through the fifth level at the last event
+void runDeepCross(bool batches, std::vector<Fill>& fills, RecordLog& log) {
+    auto strategy = std::make_shared<ScriptedStrategy>(batches);
+    {
+        FillSimulator simulator(OUTPUT_PATH);
+        simulator.setStrategy(strategy);
+        simulator.setRecordObserver(&log);
+        QueueBook book;
+        simulator.setLiveBook(&book);
+
+        std::vector<std::pair<book_event_hdr_t, add_order_t>> events = deepBookEvents();
+        for (size_t i = 0; i < events.size(); ++i) {
+            book_fill_snapshot_t fill;
+            bool hasFill;
+            if (book.apply(events[i].first, reinterpret_cast<const char*>(&events[i].second), fill, hasFill)) {
+                book.updateTopLevels();
+            }
+            if (i + 1 == events.size()) {
+                strategy->send(1, true, MID + 5 * TICK, 1300);
+            }
+            simulator.setEventIndex(i);
+            simulator.processBookTop(book.top());
+        }
+        simulator.setLiveBook(nullptr);
+        CHECK(simulator.summary().position == 1300);
+    }
+    fills = strategy->fills;
+}
+
+// With a live book a crossing order walks its levels beyond the published
+// three, each at its own price for what it shows, the last for what is
+// left; a batching strategy gets every top as it comes and writes the same
+// records
+void testCrossingWalksLiveBook() {
+    std::vector<Fill> fills;
+    RecordLog log;
+    runDeepCross(false, fills, log);
+    CHECK(fills.size() == 5);
+    if (fills.size() == 5) {
+        CHECK(fillIs(fills[0], 1, MID + TICK, 100, true));
+        CHECK(fillIs(fills[1], 1, MID + 2 * TICK, 200, true));
+        CHECK(fillIs(fills[2], 1, MID + 3 * TICK, 300, true));
+        CHECK(fillIs(fills[3], 1, MID + 4 * TICK, 400, true));
+        CHECK(fillIs(fills[4], 1, MID + 5 * TICK, 300, true));
+    }
+    // The add and the five fills, all at the last event
+    CHECK(log.records.size() == 6);
+    for (const auto& [eventIndex, record] : log.records) {
+        CHECK(eventIndex == 6);
+    }
+
+    std::vector<Fill> batchedFills;
+    RecordLog batchedLog;
+    runDeepCross(true, batchedFills, batchedLog);
+    CHECK(batchedFills.size() == fills.size());
+    CHECK(sameRecords(batchedLog, log));
+}
+
+} // namespace
+
+int main() {
+    testCrossingBuyWalksLevels();
+    testCrossingSellRestsAndRefills();
+    testCancelEndsWalk();
+    testCrossingWalksLiveBook();
+    std::remove(OUTPUT_PATH);
+    if (failures > 0) {
+        std::fprintf(stderr, "fill_simulator_test: %d failures\n", failures);
+        return 1;
+    }
+    std::printf("fill_simulator_test: ok\n");
+    return 0;
+}
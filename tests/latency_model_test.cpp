@@ -0,0 +1,292 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "engine/latency_model.h"
+#include "check.h"
+
+namespace {
+
+const size_t DRAWS = 1000000;
+const uint64_t SECOND = 1000000000ULL;
+const uint64_t HOUR = 3600 * SECOND;
+const char* PROFILE_PATH = "build/latency_model_test.profile";
+
+// Sorted draws of a distribution from one counter stream
+std::vector<uint64_t> draw(const LatencyDistribution& distribution, uint64_t seed) {
+    CounterRng rng(seed, 0);
+    std::vector<uint64_t> draws(DRAWS);
+    for (uint64_t& latency : draws) {
+        latency = distribution.sample(rng.next());
+    }
+    std::sort(draws.begin(), draws.end());
+    return draws;
+}
+
+double fractionIn(const std::vector<uint64_t>& draws, uint64_t low, uint64_t high) {
+    auto begin = std::lower_bound(draws.begin(), draws.end(), low);
+    auto end = std::lower_bound(draws.begin(), draws.end(), high);
+    return static_cast<double>(end - begin) / draws.size();
+}
+
+double quantile(const std::vector<uint64_t>& draws, double p) {
+    return static_cast<double>(draws[static_cast<size_t>(p * (draws.size() - 1))]);
+}
+
+double mean(const std::vector<uint64_t>& draws) {
+    double sum = 0;
+    for (uint64_t latency : draws) sum += latency;
+    return sum / draws.size();
+}
+
+bool within(double actual, double expected, double relative) {
+    return std::fabs(actual - expected) <= relative * expected;
+}
+
+bool rejects(const std::string& spec) {
+    try {
+        LatencyDistribution::parse(spec);
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+void testFixed() {
+    LatencyDistribution distribution = LatencyDistribution::parse(" fixed( 10000 ) ");
+    CHECK(distribution.isFixed());
+    CHECK(distribution.fixedNs() == 10000);
+    CHECK(distribution.meanNs() == 10000);
+    std::vector<uint64_t> draws = draw(distribution, 1);
+    CHECK(draws.front() == 10000 && draws.back() == 10000);
+}
+
+// Each bin draws its weight's share, uniformly across its range
+void testHistogram() {
+    LatencyDistribution distribution = LatencyDistribution::parse("histogram(5000-8000:60, 8000-20000:35, 90000:5)");
+    CHECK(!distribution.isFixed());
+    CHECK(within(distribution.meanNs(), 0.60 * 6500 + 0.35 * 14000 + 0.05 * 90000, 1e-9));
+
+    std::vector<uint64_t> draws = draw(distribution, 2);
+    CHECK(draws.front() >= 5000 && draws.back() == 90000);
+    CHECK(std::fabs(fractionIn(draws, 5000, 8000) - 0.60) < 0.003);
+    CHECK(std::fabs(fractionIn(draws, 8000, 20000) - 0.35) < 0.003);
+    CHECK(std::fabs(fractionIn(draws, 90000, 90001) - 0.05) < 0.003);
+    CHECK(fractionIn(draws, 20000, 90000) == 0);
+    CHECK(within(quantile(draws, 0.30), 6500, 0.01));
+    CHECK(within(quantile(draws, 0.775), 14000, 0.01));
+    CHECK(within(mean(draws), distribution.meanNs(), 0.01));
+
+    // Zero-weight bins are never drawn
+    draws = draw(LatencyDistribution::parse("histogram(100-200:0, 300:1, 400-500:0)"), 3);
+    CHECK(draws.front() == 300 && draws.back() == 300);
+}
+
+// Quantiles of exp(N(log median, sigma)) at -1, 0 and +1 sigma
+void testLognormal() {
+    LatencyDistribution distribution = LatencyDistribution::parse("lognormal(8000, 0.5)");
+    std::vector<uint64_t> draws = draw(distribution, 4);
+    CHECK(within(quantile(draws, 0.5), 8000, 0.01));
+    CHECK(within(quantile(draws, 0.158655), 8000 * std::exp(-0.5), 0.02));
+    CHECK(within(quantile(draws, 0.841345), 8000 * std::exp(0.5), 0.02));
+    CHECK(within(mean(draws), 8000 * std::exp(0.125), 0.02));
+    CHECK(within(distribution.meanNs(), 8000 * std::exp(0.125), 0.02));
+
+    // A sigma of 0 is the median every time
+    draws = draw(LatencyDistribution::parse("lognormal(8000, 0)"), 5);
+    CHECK(draws.front() == 8000 && draws.back() == 8000);
+}
+
+// A mixture's parts draw their weight's share, each shaped as on its own
+void testMixture() {
+    LatencyDistribution distribution =
+        LatencyDistribution::parse("mixture(0.95*lognormal(8000, 0.3), 0.05*histogram(50000-200000:1))");
+    std::vector<uint64_t> draws = draw(distribution, 6);
+    CHECK(std::fabs(fractionIn(draws, 50000, 200000) - 0.05) < 0.002);
+    CHECK(fractionIn(draws, 200000, UINT64_MAX) == 0);
+    // The lognormal's median sits at 0.5 * 0.95 of the mixture
+    CHECK(within(quantile(draws, 0.475), 8000, 0.01));
+    CHECK(within(quantile(draws, 0.975), 125000, 0.02));
+
+    // Weights are relative, within a mixture and within a part
+    LatencyDistribution scaled = LatencyDistribution::parse("mixture(3*fixed(100), 1*histogram(200:7, 300:7))");
+    draws = draw(scaled, 7);
+    CHECK(std::fabs(fractionIn(draws, 100, 101) - 0.75) < 0.003);
+    CHECK(std::fabs(fractionIn(draws, 200, 201) - 0.125) < 0.003);
+    CHECK(std::fabs(fractionIn(draws, 300, 301) - 0.125) < 0.003);
+}
+
+void testRejectsBadSpecs() {
+    CHECK(rejects(""));
+    CHECK(rejects("gamma(2, 3)"));
+    CHECK(rejects("fixed"));
+    CHECK(rejects("fixed()"));
+    CHECK(rejects("fixed(10000"));
+    CHECK(rejects("fixed(10000) fixed(1)"));
+    CHECK(rejects("fixed(-5)"));
+    CHECK(rejects("fixed(1e20)"));
+    CHECK(rejects("fixed(nan)"));
+    CHECK(rejects("lognormal(8000)"));
+    CHECK(rejects("lognormal(0, 0.5)"));
+    CHECK(rejects("lognormal(8000, -0.5)"));
+    CHECK(rejects("histogram()"));
+    CHECK(rejects("histogram(5000-8000)"));
+    CHECK(rejects("histogram(8000-5000:1)"));
+    CHECK(rejects("histogram(5000:-1, 6000:2)"));
+    CHECK(rejects("histogram(5000:0, 6000:0)"));
+    CHECK(rejects("histogram(5000:1,)"));
+    CHECK(rejects("mixture()"));
+    CHECK(rejects("mixture(fixed(1))"));
+    CHECK(rejects("mixture(-0.5*fixed(1), 1*fixed(2))"));
+    CHECK(rejects("mixture(0*fixed(1))"));
+    CHECK(rejects("mixture(1*histogram(5:0))"));
+}
+
+// Load a profile written from the given text into a fresh model
+LatencyModel loadProfile(const std::string& text) {
+    {
+        std::ofstream file(PROFILE_PATH);
+        file << text;
+    }
+    LatencyModel model;
+    loadLatencyProfile(PROFILE_PATH, model);
+    return model;
+}
+
+// The message a profile is rejected with, empty if it loads
+std::string profileError(const std::string& text) {
+    try {
+        loadProfile(text);
+    } catch (const std::runtime_error& e) {
+        return e.what();
+    }
+    return std::string();
+}
+
+bool rejectsAtLine(const std::string& text, int line) {
+    std::string error = profileError(text);
+    return error.find(std::string(PROFILE_PATH) + ":" + std::to_string(line) + ": ") == 0;
+}
+
+bool periodIs(const LatencyPeriod& period, uint64_t startNs, uint64_t fixedNs) {
+    return period.startNs == startNs && period.distribution.isFixed() && period.distribution.fixedNs() == fixedNs;
+}
+
+// Every start format, comments and blank lines, periods listed out of
+// order, and legs kept apart
+void testProfileParsing() {
+    LatencyModel model = loadProfile("# start, leg, spec\n"
+                                     "\n"
+                                     "   # indented comment\n"
+                                     "12:00, md, fixed(3000)\n"
+                                     " 09:30 ,  md , histogram(5000-8000:60, 8000-20000:40)\n"
+                                     "10:15:30.25, md, fixed(2000)\n"
+                                     "36000000000000, order, lognormal(8000, 0.5)\n"
+                                     "12:00, fill, fixed(7)\r\n");
+    const std::vector<LatencyPeriod>& md = model.marketData.periods;
+    CHECK(md.size() == 3);
+    if (md.size() == 3) {
+        CHECK(md[0].startNs == 9 * HOUR + 30 * 60 * SECOND && !md[0].distribution.isFixed());
+        CHECK(periodIs(md[1], 10 * HOUR + 15 * 60 * SECOND + 30 * SECOND + SECOND / 4, 2000));
+        CHECK(periodIs(md[2], 12 * HOUR, 3000));
+    }
+    CHECK(model.orderEntry.periods.size() == 1);
+    if (model.orderEntry.periods.size() == 1) {
+        CHECK(model.orderEntry.periods[0].startNs == 10 * HOUR);
+    }
+    // The same start on another leg is not a duplicate
+    CHECK(model.fillNotification.periods.size() == 1);
+    if (model.fillNotification.periods.size() == 1) {
+        CHECK(periodIs(model.fillNotification.periods[0], 12 * HOUR, 7));
+    }
+
+    // Fractions down to the nanosecond
+    model = loadProfile("00:00:01.000000001, md, fixed(1)\n23:59:59.999999999, md, fixed(2)\n");
+    CHECK(model.marketData.periods.size() == 2);
+    if (model.marketData.periods.size() == 2) {
+        CHECK(model.marketData.periods[0].startNs == SECOND + 1);
+        CHECK(model.marketData.periods[1].startNs == 24 * HOUR - 1);
+    }
+
+    CHECK(loadProfile("").marketData.periods.empty());
+}
+
+// Malformed lines are rejected with the file and line at fault
+void testProfileRejectsBadLines() {
+    const std::string good = "# header\n09:30, md, fixed(1)\n";
+    CHECK(rejectsAtLine(good + "10:00, md\n", 3));
+    CHECK(rejectsAtLine(good + "10:00 md fixed(1)\n", 3));
+    CHECK(rejectsAtLine(good + "10:00, quotes, fixed(1)\n", 3));
+    CHECK(rejectsAtLine(good + "10:00, , fixed(1)\n", 3));
+    CHECK(rejectsAtLine(good + "10:00, md, gamma(2, 3)\n", 3));
+    CHECK(rejectsAtLine(good + "10:00, md, histogram(5:-1)\n", 3));
+    CHECK(rejectsAtLine(good + "10:00, md,\n", 3));
+    for (const char* start : {"24:00", "9:60", "09:30:60", "09:30:00.", "09:30:00.1234567891", "09:30.5", "09:",
+                              "123:00", "abc", "-5", "", "09:30 am", "1e9"}) {
+        CHECK(rejectsAtLine(good + start + ", md, fixed(1)\n", 3));
+    }
+    // A leg cannot have two periods from the same time, however written
+    CHECK(rejectsAtLine(good + "09:30:00.000, md, fixed(2)\n", 3));
+    CHECK(rejectsAtLine(good + "34200000000000, md, fixed(2)\n", 3));
+
+    std::string missing = "build/latency_model_test.missing";
+    std::remove(missing.c_str());
+    LatencyModel model;
+    bool threw = false;
+    try {
+        loadLatencyProfile(missing, model);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+// The sampler uses the base before the first period and each period from
+// its start up to the next one's, whichever way the clock moves
+void testPeriodLookup() {
+    LatencyModel model = loadProfile("12:00, order, fixed(3000)\n10:00, order, fixed(2000)\n");
+    model.orderEntry.base = LatencyDistribution::parse("fixed(1000)");
+    LatencySampler sampler(model.orderEntry, 1, LatencySampler::ORDER_ENTRY_STREAM, false);
+
+    auto latency = [&](uint64_t ts) { return sampler.delay(ts) - ts; };
+    CHECK(latency(0) == 1000);
+    CHECK(latency(10 * HOUR - 1) == 1000);
+    CHECK(latency(10 * HOUR) == 2000);
+    CHECK(latency(12 * HOUR - 1) == 2000);
+    CHECK(latency(12 * HOUR) == 3000);
+    CHECK(latency(24 * HOUR) == 3000);
+    // Back across both boundaries, then forward across both at once
+    CHECK(latency(10 * HOUR + 1) == 2000);
+    CHECK(latency(9 * HOUR) == 1000);
+    CHECK(latency(13 * HOUR) == 3000);
+    CHECK(latency(10 * HOUR - 1) == 1000);
+    CHECK(sampler.meanNs() == 1000);
+
+    // A leg without periods is its base all day
+    LatencySampler flat(model.marketData, 1, LatencySampler::MARKET_DATA_STREAM, true);
+    CHECK(flat.delay(12 * HOUR) == 12 * HOUR);
+}
+
+} // namespace
+
+int main() {
+    testFixed();
+    testHistogram();
+    testLognormal();
+    testMixture();
+    testRejectsBadSpecs();
+    testProfileParsing();
+    testProfileRejectsBadLines();
+    testPeriodLookup();
+    std::remove(PROFILE_PATH);
+    if (failures > 0) {
+        std::fprintf(stderr, "latency_model_test: %d failures\n", failures);
+        return 1;
+    }
+    std::printf("latency_model_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <list>
+#include <random>
+#include <set>
+#include <unordered_map>
+#include <vector>
+#include "strategies/order_tracker.h"
+#include "check.h"
+
+namespace {
+
+// Timer service that only keeps the set of live timers
+class FakeTimers : public TimerService {
+public:
+    uint64_t scheduleTimer(uint64_t /* deadlineNs */, uint64_t /* token */) override {
+        live.insert(nextId);
+        return nextId++;
+    }
+
+    bool cancelTimer(uint64_t timerId) override { return live.erase(timerId) > 0; }
+
+    std::set<uint64_t> live;
+    uint64_t nextId = 1;
+};
+
+// The tracker as a hash map of the orders and a list of their ids in
+// placement order
+struct Model {
+    std::unordered_map<uint64_t, OrderTracker::OrderInfo> orders;
+    std::list<uint64_t> placed;
+
+    void remove(uint64_t orderId) {
+        orders.erase(orderId);
+        placed.remove(orderId);
+    }
+
+    const OrderTracker::OrderInfo* oldest(bool isBid) const {
+        for (uint64_t id : placed) {
+            if (orders.at(id).isBid == isBid) return &orders.at(id);
+        }
+        return nullptr;
+    }
+};
+
+bool sameOrder(const OrderTracker::OrderInfo& a, const OrderTracker::OrderInfo& b) {
+    return a.orderId == b.orderId && a.creationTime == b.creationTime && a.price == b.price &&
+           a.quantity == b.quantity && a.isBid == b.isBid;
+}
+
+void checkAgainst(const OrderTracker& tracker, const Model& model, const FakeTimers& timers,
+                  uint64_t idRange) {
+    CHECK(tracker.size() == model.orders.size());
+    CHECK(tracker.empty() == model.orders.empty());
+
+    // Placement order across both sides, and every order findable by id
+    std::vector<uint64_t> visited;
+    std::set<uint64_t> timerIds;
+    tracker.forEach([&](const OrderTracker::OrderInfo& order) {
+        visited.push_back(order.orderId);
+        if (order.timerId != 0) timerIds.insert(order.timerId);
+    });
+    CHECK(visited == std::vector<uint64_t>(model.placed.begin(), model.placed.end()));
+    CHECK(timerIds == timers.live);
+    for (uint64_t id = 1; id <= std::min<uint64_t>(idRange, 2000); ++id) {
+        const OrderTracker::OrderInfo* found = tracker.find(id);
+        auto it = model.orders.find(id);
+        CHECK((found != nullptr) == (it != model.orders.end()));
+        if (found != nullptr && it != model.orders.end()) {
+            CHECK(sameOrder(*found, it->second));
+        }
+    }
+    for (const auto& [id, order] : model.orders) {
+        const OrderTracker::OrderInfo* found = tracker.find(id);
+        CHECK(found != nullptr && sameOrder(*found, order));
+    }
+
+    for (bool isBid : {true, false}) {
+        const OrderTracker::OrderInfo* got = tracker.oldest(isBid);
+        const OrderTracker::OrderInfo* expected = model.oldest(isBid);
+        CHECK((got == nullptr) == (expected == nullptr));
+        if (got != nullptr && expected != nullptr) {
+            CHECK(sameOrder(*got, *expected));
+        }
+    }
+}
+
+// Random adds (some of tracked ids), removes (some of unknown ids), bulk
+// removals and clears. Ids come from a range a few times the live count, so
+// ids are reused and probe chains collide and wrap around the small table;
+// the live count drifts up far enough to grow the tracker now and then.
+void testAgainstModel(uint64_t seed, size_t initialCapacity, uint64_t idRange, size_t targetLive) {
+    std::mt19937_64 rng(seed);
+    const int failuresBefore = failures;
+    FakeTimers timers;
+    OrderTracker tracker(initialCapacity);
+    tracker.setTimerService(&timers);
+    Model model;
+    uint64_t now = 0;
+
+    for (int step = 0; step < 100000; ++step) {
+        now += rng() % 1000;
+        uint64_t id = rng() % idRange + 1;
+        uint64_t action = rng() % 100;
+
+        if (action < 55 && model.orders.size() < 2 * targetLive) {
+            OrderTracker::OrderInfo order;
+            order.orderId = id;
+            order.creationTime = now;
+            order.price = static_cast<int64_t>(rng() % 1000);
+            order.quantity = static_cast<uint32_t>(rng() % 100 + 1);
+            order.isBid = (rng() & 1) != 0;
+            bool fresh = model.orders.count(id) == 0;
+            CHECK(tracker.add(order, rng() % 2 == 0 ? now + 5000 : 0) == fresh);
+            if (fresh) {
+                model.orders[id] = order;
+                model.placed.push_back(id);
+            }
+        } else if (action < 95) {
+            bool tracked = model.orders.count(id) > 0;
+            CHECK(tracker.remove(id) == tracked);
+            model.remove(id);
+        } else if (action < 97) {
+            // Drop the orders of an arbitrary subset of ids
+            uint64_t modulus = rng() % 3 + 2;
+            tracker.removeIf([&](const OrderTracker::OrderInfo& order) { return order.orderId % modulus == 0; });
+            for (auto it = model.placed.begin(); it != model.placed.end();) {
+                if (*it % modulus == 0) {
+                    model.orders.erase(*it);
+                    it = model.placed.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        } else if (action < 99) {
+            // Age out each side from its oldest order
+            uint64_t cutoff = now - std::min<uint64_t>(now, rng() % 20000);
+            tracker.removeOldestWhile([&](const OrderTracker::OrderInfo& order) { return order.creationTime < cutoff; });
+            for (bool isBid : {true, false}) {
+                const OrderTracker::OrderInfo* oldest;
+                while ((oldest = model.oldest(isBid)) != nullptr && oldest->creationTime < cutoff) {
+                    model.remove(oldest->orderId);
+                }
+            }
+        } else {
+            tracker.clear();
+            model.orders.clear();
+            model.placed.clear();
+        }
+
+        if (step % 5 == 0) {
+            checkAgainst(tracker, model, timers, idRange);
+        }
+        if (failures > failuresBefore) {
+            std::fprintf(stderr, "seed %llu, capacity %zu: step %d\n", static_cast<unsigned long long>(seed),
+                         initialCapacity, step);
+            return;
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    for (uint64_t seed = 1; seed <= 3; ++seed) {
+        testAgainstModel(seed, 4, 64, 6);
+        testAgainstModel(seed, 16, 1000, 12);
+        testAgainstModel(seed, 16, 100000, 200);
+    }
+    if (failures > 0) {
+        std::fprintf(stderr, "order_tracker_test: %d failures\n", failures);
+        return 1;
+    }
+    std::printf("order_tracker_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,215 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "engine/event_tape.h"
+#include "engine/prefetching_decoder.h"
+#include "engine/queue_book.h"
+#include "engine/reference_book.h"
+#include "check.h"
+
+namespace {
+
+const int64_t MID = 100000000000LL;     // $100
+const int64_t TICK = 10000000LL;        // 1 cent
+const char* EVENTS_PATH = "build/queue_book_test.events";
+
+// A book events file of random events: adds around the mid, now and then
+// far away, off the tick grid, negative or absurdly large; deletes,
+// replaces, amends, reduces and executions of live and of unknown orders;
+// session events and the odd book clear
+std::vector<char> makeEvents(uint64_t seed, size_t count, bool offGrid) {
+    std::mt19937_64 rng(seed);
+    std::vector<char> file(sizeof(book_events_file_hdr_t), 0);
+    std::vector<uint64_t> ids;
+    std::unordered_map<uint64_t, uint32_t> live;    // order id -> qty left
+    uint64_t nextId = 1;
+
+    auto price = [&]() -> int64_t {
+        uint64_t r = rng() % 1000;
+        if (r < 3) return static_cast<int64_t>(rng() >> 1);
+        if (r < 5) return -static_cast<int64_t>(rng() >> 2);
+        if (r < 10 && offGrid) return MID + static_cast<int64_t>(rng() % 2000000) - 1000000;
+        if (r < 12) return MID + static_cast<int64_t>(rng() % 1000) * 1000000000LL;
+        return MID + (static_cast<int64_t>(rng() % 200) - 100) * TICK;
+    };
+    auto append = [&](const book_event_hdr_t& header, const void* payload, size_t size) {
+        const char* bytes = reinterpret_cast<const char*>(&header);
+        file.insert(file.end(), bytes, bytes + sizeof(header));
+        file.insert(file.end(), static_cast<const char*>(payload), static_cast<const char*>(payload) + size);
+    };
+
+    for (size_t i = 0; i < count; ++i) {
+        book_event_hdr_t header{};
+        header.ts = 1000 * i;
+        header.seq_no = i;
+        uint64_t id = ids.empty() ? nextId + 1 : ids[rng() % ids.size()];
+        if (rng() % 20 == 0) {
+            id = nextId + 5;
+        }
+        uint32_t left = live.count(id) ? live[id] : 1;
+        auto part = [&]() { return static_cast<uint32_t>(rng() % left + 1); };
+        auto takeFrom = [&](uint32_t qty) {
+            auto it = live.find(id);
+            if (it != live.end() && (it->second -= qty) == 0) {
+                live.erase(it);
+            }
+        };
+
+        uint64_t r = rng() % 100;
+        if (r < 40 || ids.empty()) {
+            header.type = book_event_type_e::add_order;
+            add_order_t e{price(), nextId, static_cast<uint32_t>(rng() % 100 + 1), (rng() & 1) != 0};
+            live[nextId] = e.qty;
+            ids.push_back(nextId++);
+            append(header, &e, sizeof(e));
+        } else if (r < 55) {
+            header.type = book_event_type_e::delete_order;
+            delete_order_t e{id};
+            live.erase(id);
+            append(header, &e, sizeof(e));
+        } else if (r < 63) {
+            header.type = book_event_type_e::replace_order;
+            replace_order_t e{price(), id, nextId, static_cast<uint32_t>(rng() % 100 + 1)};
+            live.erase(id);
+            live[nextId] = e.qty;
+            ids.push_back(nextId++);
+            append(header, &e, sizeof(e));
+        } else if (r < 70) {
+            header.type = book_event_type_e::amend_order;
+            amend_order_t e{id, static_cast<uint32_t>(rng() % 100 + 1)};
+            if (live.count(id)) {
+                live[id] = e.new_qty;
+            }
+            append(header, &e, sizeof(e));
+        } else if (r < 80) {
+            header.type = book_event_type_e::reduce_order;
+            reduce_order_t e{id, part()};
+            takeFrom(e.cxled_qty);
+            append(header, &e, sizeof(e));
+        } else if (r < 88) {
+            header.type = book_event_type_e::execute_order;
+            execute_order_t e{id, part(), i};
+            takeFrom(e.traded_qty);
+            append(header, &e, sizeof(e));
+        } else if (r < 96) {
+            header.type = book_event_type_e::execute_order_at_price;
+            execute_order_at_price_t e{id, part(), i, price()};
+            takeFrom(e.traded_qty);
+            append(header, &e, sizeof(e));
+        } else if (r < 97 && rng() % 50 == 0) {
+            header.type = book_event_type_e::clear_book;
+            live.clear();
+            append(header, nullptr, 0);
+        } else {
+            header.type = book_event_type_e::session_event;
+            session_event_t e{false};
+            append(header, &e, sizeof(e));
+        }
+
+        // Keep picking among recent ids
+        if (ids.size() > 5000) {
+            ids.erase(ids.begin(), ids.begin() + 1000);
+        }
+    }
+    return file;
+}
+
+// Levels of one side, best first, as forEachLevel() reports them
+template <typename Book>
+std::vector<std::pair<int64_t, uint32_t>> levels(const Book& book, bool isBid, size_t limit) {
+    std::vector<std::pair<int64_t, uint32_t>> result;
+    book.forEachLevel(isBid, [&](int64_t price, uint32_t qty) {
+        result.emplace_back(price, qty);
+        return result.size() < limit;
+    });
+    return result;
+}
+
+// Replay the file through QueueBook the way runQueueSimulation does (event
+// tape, prefetching decoder) and through ReferenceBook decoding the same
+// bytes directly; every event must move both books alike
+void compareReplay(const std::vector<char>& file, int64_t tickNanos, size_t lookahead) {
+    {
+        std::ofstream out(EVENTS_PATH, std::ios::binary | std::ios::trunc);
+        out.write(file.data(), static_cast<std::streamsize>(file.size()));
+    }
+    EventTape tape;
+    CHECK(tape.open(EVENTS_PATH));
+
+    QueueBook book(tickNanos);
+    ReferenceBook reference;
+    PrefetchingDecoder decoder(tape, book, lookahead);
+
+    size_t offset = sizeof(book_events_file_hdr_t);
+    book_event_hdr_t header;
+    const char* payload;
+    uint64_t events = 0;
+    const int failuresBefore = failures;
+    while (decoder.next(header, payload)) {
+        book_event_hdr_t expectedHeader;
+        std::memcpy(&expectedHeader, file.data() + offset, sizeof(expectedHeader));
+        const char* expectedPayload = file.data() + offset + sizeof(expectedHeader);
+        offset += sizeof(expectedHeader) + EventTape::payloadSize(expectedHeader.type);
+        CHECK(std::memcmp(&header, &expectedHeader, sizeof(header)) == 0);
+
+        book_fill_snapshot_t fill{};
+        book_fill_snapshot_t expectedFill{};
+        bool hasFill;
+        bool expectedHasFill;
+        bool topChanged = book.apply(header, payload, fill, hasFill);
+        bool expectedTopChanged = reference.apply(expectedHeader, expectedPayload, expectedFill, expectedHasFill);
+        CHECK(topChanged == expectedTopChanged);
+        CHECK(hasFill == expectedHasFill);
+        CHECK(!hasFill || std::memcmp(&fill, &expectedFill, sizeof(fill)) == 0);
+
+        if (topChanged) {
+            book.updateTopLevels();
+            reference.updateTopLevels();
+        }
+        CHECK(std::memcmp(&book.top(), &reference.top(), sizeof(book_top_t)) == 0);
+        CHECK(book.orderCount() == reference.orderCount());
+
+        // The depth a crossing order walks
+        if (events % 64 == 0) {
+            for (bool isBid : {true, false}) {
+                CHECK(levels(book, isBid, 10) == levels(reference, isBid, 10));
+            }
+        }
+
+        events++;
+        if (failures > failuresBefore) {
+            std::fprintf(stderr, "first difference at event %llu (tick %lld, lookahead %zu)\n",
+                         static_cast<unsigned long long>(events - 1), static_cast<long long>(tickNanos),
+                         lookahead);
+            return;
+        }
+    }
+    CHECK(offset == file.size());
+    std::remove(EVENTS_PATH);
+}
+
+} // namespace
+
+int main() {
+    for (uint64_t seed = 1; seed <= 3; ++seed) {
+        std::vector<char> onGrid = makeEvents(seed, 200000, false);
+        std::vector<char> offGrid = makeEvents(seed, 200000, true);
+
+        // Tick inferred from the events, given, and too coarse for them
+        compareReplay(onGrid, 0, PrefetchingDecoder::DEFAULT_LOOKAHEAD);
+        compareReplay(onGrid, TICK, PrefetchingDecoder::DEFAULT_LOOKAHEAD);
+        compareReplay(offGrid, TICK, PrefetchingDecoder::DEFAULT_LOOKAHEAD);
+        compareReplay(offGrid, 0, 0);
+    }
+    if (failures > 0) {
+        std::fprintf(stderr, "queue_book_test: %d failures\n", failures);
+        return 1;
+    }
+    std::printf("queue_book_test: ok\n");
+    return 0;
+}
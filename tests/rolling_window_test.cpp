@@ -0,0 +1,144 @@
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <random>
+#include "strategies/rolling_window.h"
+#include "check.h"
+
+namespace {
+
+const int64_t MID = 100000000000LL;     // $100
+const int64_t TICK = 10000000LL;        // 1 cent
+const uint64_t US = 1000;
+
+struct Sample {
+    uint64_t ts;
+    int64_t x;
+    int64_t y;
+};
+
+// Statistics recomputed from every sample in the window, two-pass in long
+// double
+struct BruteForce {
+    std::deque<Sample> samples;
+
+    long double mean(bool ofY) const {
+        long double sum = 0;
+        for (const Sample& s : samples) sum += ofY ? s.y : s.x;
+        return samples.empty() ? 0 : sum / samples.size();
+    }
+
+    long double covariance(bool xFirst, bool ySecond) const {
+        if (samples.empty()) return 0;
+        long double meanA = mean(!xFirst);
+        long double meanB = mean(ySecond);
+        long double sum = 0;
+        for (const Sample& s : samples) {
+            sum += ((xFirst ? s.x : s.y) - meanA) * ((ySecond ? s.y : s.x) - meanB);
+        }
+        return sum / samples.size();
+    }
+
+    bool constantY() const {
+        for (const Sample& s : samples) {
+            if (s.y != samples.front().y) return false;
+        }
+        return true;
+    }
+};
+
+// Relative agreement, with an absolute floor for values near zero
+bool near(double actual, long double expected, long double floor) {
+    long double error = std::fabs(static_cast<long double>(actual) - expected);
+    return error <= 1e-9L * std::fabs(expected) + floor;
+}
+
+void checkAgainst(const RollingWindow& window, const BruteForce& model, uint64_t now) {
+    CHECK(window.size() == model.samples.size());
+    CHECK(near(window.mean(), model.mean(false), 1e-3L));
+    CHECK(near(window.meanY(), model.mean(true), 1e-3L));
+    CHECK(near(window.variance(), model.covariance(true, false), 1.0L));
+    CHECK(near(window.varianceY(), model.covariance(false, true), 1.0L));
+    CHECK(near(window.covariance(), model.covariance(true, true), 1.0L));
+
+    long double varY = model.covariance(false, true);
+    long double beta = model.samples.empty() || model.constantY() ? 0 : model.covariance(true, true) / varY;
+    CHECK(near(window.beta(), beta, 1e-9L));
+
+    long double weightSum = 0;
+    long double weightedSum = 0;
+    for (const Sample& s : model.samples) {
+        long double weight = 1 - static_cast<long double>(now - s.ts) / window.maxAgeNs();
+        weightSum += weight;
+        weightedSum += weight * s.x;
+    }
+    RollingWindow::DecaySums sums = window.linearDecay(now);
+    CHECK(near(sums.weightSum, weightSum, 1e-9L));
+    CHECK(near(sums.weightedSum, weightedSum, 1e-3L));
+}
+
+// Random walks of a price pair pushed through the window, evicted by count
+// (ageEvicts false: an age no sample reaches) or by age at every step; now
+// and then a gap empties the window, so the sums rebase
+void testAgainstBruteForce(uint64_t seed, size_t maxSamples, bool ageEvicts) {
+    std::mt19937_64 rng(seed);
+    const int failuresBefore = failures;
+    const uint64_t maxAge = ageEvicts ? 2000 * US : UINT64_MAX / 2;
+    RollingWindow window(maxSamples, maxAge);
+    BruteForce model;
+    checkAgainst(window, model, 0);
+
+    uint64_t now = 1000 * US;
+    int64_t x = MID;
+    int64_t y = MID / 2;
+    for (int step = 0; step < 50000; ++step) {
+        now += rng() % 100 == 0 ? 5000 * US : rng() % (100 * US);
+        x += (static_cast<int64_t>(rng() % 21) - 10) * TICK;
+        if (rng() % 4 != 0) {
+            y += (static_cast<int64_t>(rng() % 11) - 5) * TICK;
+        }
+
+        if (ageEvicts) {
+            window.expire(now);
+            while (!model.samples.empty() && now - model.samples.front().ts > maxAge) {
+                model.samples.pop_front();
+            }
+        }
+        window.push(now, x, y);
+        model.samples.push_back(Sample{now, x, y});
+        if (model.samples.size() > maxSamples) {
+            model.samples.pop_front();
+        }
+
+        if (step % 7 == 0) {
+            checkAgainst(window, model, ageEvicts ? now + rng() % (500 * US) : now);
+        }
+        if (failures > failuresBefore) {
+            std::fprintf(stderr, "seed %llu, window %zu, %s eviction: step %d\n",
+                         static_cast<unsigned long long>(seed), maxSamples, ageEvicts ? "age" : "count", step);
+            return;
+        }
+    }
+
+    window.clear();
+    model.samples.clear();
+    checkAgainst(window, model, now);
+}
+
+} // namespace
+
+int main() {
+    for (uint64_t seed = 1; seed <= 3; ++seed) {
+        testAgainstBruteForce(seed, 1, false);
+        testAgainstBruteForce(seed, 64, false);
+        testAgainstBruteForce(seed, 64, true);
+        testAgainstBruteForce(seed, 100000, true);
+    }
+    if (failures > 0) {
+        std::fprintf(stderr, "rolling_window_test: %d failures\n", failures);
+        return 1;
+    }
+    std::printf("rolling_window_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,97 @@
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <vector>
+#include "engine/timer_wheel.h"
+#include "check.h"
+
+namespace {
+
+const uint64_t MS = 1000000;
+
+// A deadline in the last tick before a coarser wheel's slot boundary fires
+// once the clock passes it, not once the clock crosses the boundary
+void testDeadlineBeforeSlotBoundary() {
+    for (uint64_t deadline : {255 * MS + MS / 2, 511 * MS + MS / 2, 65535 * MS + MS / 2}) {
+        TimerWheel wheel;
+        std::vector<uint64_t> fired;
+        wheel.scheduleTimer(deadline, 1);
+        CHECK(wheel.nextDeadline() == deadline);
+
+        wheel.advance(deadline - 1, [&](uint64_t token) { fired.push_back(token); });
+        CHECK(fired.empty());
+        CHECK(wheel.pending() == 1);
+
+        wheel.advance(deadline + MS / 5, [&](uint64_t token) { fired.push_back(token); });
+        CHECK(fired.size() == 1);
+        CHECK(wheel.pending() == 0);
+        CHECK(wheel.nextDeadline() == UINT64_MAX);
+    }
+}
+
+// Random schedules, cancels and clock steps against a plain map of deadlines
+void testAgainstMap() {
+    std::mt19937_64 rng(1);
+    TimerWheel wheel;
+    std::map<uint64_t, uint64_t> expected;   // token -> deadline
+    std::map<uint64_t, uint64_t> ids;        // token -> timer id
+    uint64_t now = 0;
+    uint64_t nextToken = 1;
+
+    for (int step = 0; step < 200000; ++step) {
+        uint64_t action = rng() % 10;
+        if (action < 5) {
+            // Spread deadlines over every wheel
+            uint64_t range = MS << (8 * (rng() % 4));
+            uint64_t deadline = now + rng() % (range * 256);
+            ids[nextToken] = wheel.scheduleTimer(deadline, nextToken);
+            expected[nextToken] = deadline;
+            nextToken++;
+        } else if (action < 7 && !expected.empty()) {
+            auto it = expected.lower_bound(rng() % nextToken);
+            if (it == expected.end()) {
+                it = expected.begin();
+            }
+            CHECK(wheel.cancelTimer(ids[it->first]));
+            ids.erase(it->first);
+            expected.erase(it);
+        } else {
+            now += rng() % (MS << (8 * (rng() % 3)));
+            wheel.advance(now, [&](uint64_t token) {
+                auto it = expected.find(token);
+                CHECK(it != expected.end() && it->second <= now);
+                if (it != expected.end()) {
+                    expected.erase(it);
+                    ids.erase(token);
+                }
+            });
+            for (const auto& entry : expected) {
+                CHECK(entry.second > now);
+            }
+        }
+
+        uint64_t earliest = UINT64_MAX;
+        for (const auto& entry : expected) {
+            earliest = std::min(earliest, entry.second);
+        }
+        CHECK(wheel.pending() == expected.size());
+        CHECK(wheel.nextDeadline() == earliest);
+        if (failures > 0) {
+            return;
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    testDeadlineBeforeSlotBoundary();
+    testAgainstMap();
+    if (failures > 0) {
+        std::fprintf(stderr, "timer_wheel_test: %d failures\n", failures);
+        return 1;
+    }
+    std::printf("timer_wheel_test: ok\n");
+    return 0;
+}
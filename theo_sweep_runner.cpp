@@ -0,0 +1,328 @@
+#include "theo_sweep_runner.h"
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+#include <utility>
+#include "strategies/theo_strategy.h"
+#include "engine/event_tape.h"
+#include "engine/prefetching_decoder.h"
+#include "engine/queue_book.h"
+
+TheoSweepRunner::TheoSweepRunner(std::shared_ptr<TheoSweepCore> core,
+                                 const std::string& outputFilePath,
+                                 uint64_t strategyMdLatencyNs,
+                                 uint64_t exchangeLatencyNs,
+                                 bool useQueueSimulation)
+    : core_(std::move(core)) {
+
+    for (size_t lane = 0; lane < core_->laneCount(); ++lane) {
+        auto strategy = std::make_shared<TheoSweepLane>(core_, lane);
+        auto simulator = std::make_unique<FillSimulatorT<TheoSweepLane>>(
+            laneOutputPath(outputFilePath, lane), strategyMdLatencyNs, exchangeLatencyNs, useQueueSimulation);
+        simulator->setStrategy(strategy);
+
+        lanes_.push_back(strategy);
+        simulators_.push_back(std::move(simulator));
+    }
+}
+
+std::string TheoSweepRunner::laneOutputPath(const std::string& outputFilePath, size_t lane) {
+    std::string suffix = ".lane" + std::to_string(lane);
+
+    size_t dot = outputFilePath.find_last_of('.');
+    size_t slash = outputFilePath.find_last_of('/');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        return outputFilePath + suffix;
+    }
+    return outputFilePath.substr(0, dot) + suffix + outputFilePath.substr(dot);
+}
+
+std::string TheoSweepRunner::strategyName() const {
+    return "Theo Strategy Sweep (" + std::to_string(core_->laneCount()) + " lanes)";
+}
+
+std::vector<SimulationSummary> TheoSweepRunner::summaries() const {
+    std::vector<SimulationSummary> results;
+    for (const auto& simulator : simulators_) {
+        results.push_back(simulator->summary());
+    }
+    return results;
+}
+
+void TheoSweepRunner::setRecordObserver(RecordObserver* observer, size_t firstStream) {
+    SimulationRunner::setRecordObserver(observer, firstStream);
+    for (size_t lane = 0; lane < simulators_.size(); ++lane) {
+        simulators_[lane]->setRecordObserver(observer, firstStream + lane);
+    }
+}
+
+void TheoSweepRunner::setLatencyModel(const LatencyModel* model) {
+    for (auto& simulator : simulators_) {
+        simulator->setLatencyModel(model);
+    }
+}
+
+void TheoSweepRunner::setDepthHistory(size_t prices) {
+    for (auto& simulator : simulators_) {
+        simulator->setDepthHistory(prices);
+    }
+}
+
+void TheoSweepRunner::runSimulation(const std::string& topsFilePath, const std::string& fillsFilePath) {
+    std::ifstream topsFile(topsFilePath, std::ios::binary);
+    std::ifstream fillsFile(fillsFilePath, std::ios::binary);
+
+    if (!topsFile.is_open() || !fillsFile.is_open()) {
+        throw std::runtime_error("Failed to open input files");
+    }
+
+    book_tops_file_hdr_t topsHeader;
+    book_fills_file_hdr_t fillsHeader;
+
+    topsFile.read(reinterpret_cast<char*>(&topsHeader), sizeof(book_tops_file_hdr_t));
+    fillsFile.read(reinterpret_cast<char*>(&fillsHeader), sizeof(book_fills_file_hdr_t));
+
+    for (auto& lane : lanes_) {
+        lane->setSymbolId(topsHeader.symbol_idx);
+    }
+
+    book_top_t bookTop;
+    book_fill_snapshot_t bookFill;
+
+    topsFile.read(reinterpret_cast<char*>(&bookTop), sizeof(book_top_t));
+    bool hasMoreTops = topsFile.gcount() == sizeof(book_top_t);
+    fillsFile.read(reinterpret_cast<char*>(&bookFill), sizeof(book_fill_snapshot_t));
+    bool hasMoreFills = fillsFile.gcount() == sizeof(book_fill_snapshot_t);
+
+    uint64_t processedTops = 0;
+    uint64_t processedFills = 0;
+
+    uint64_t topsSize = inputFileSize(topsFilePath);
+    uint64_t fillsSize = inputFileSize(fillsFilePath);
+    ProgressMeter meter;
+    meter.start(progress_, strategyName(), topsSize + fillsSize,
+                hasMoreFills && (!hasMoreTops || bookFill.ts < bookTop.ts) ? bookFill.ts : bookTop.ts);
+    uint64_t lastTs = 0;
+
+    if (replayProfile_) replayProfile_->begin();
+
+    // Same event order as FillSimulatorT::runSimulation; every lane sees an
+    // event before the next one is read
+    while (hasMoreTops || hasMoreFills) {
+        core_->beginEvent();
+        for (auto& simulator : simulators_) {
+            simulator->setEventIndex(processedTops + processedFills);
+        }
+
+        if (!hasMoreFills || (hasMoreTops && bookTop.ts <= bookFill.ts)) {
+            for (auto& simulator : simulators_) {
+                simulator->processBookTop(bookTop);
+            }
+            lastTs = bookTop.ts;
+            processedTops++;
+
+            topsFile.read(reinterpret_cast<char*>(&bookTop), sizeof(book_top_t));
+            hasMoreTops = topsFile.gcount() == sizeof(book_top_t);
+        } else {
+            for (auto& simulator : simulators_) {
+                simulator->processBookFill(bookFill);
+            }
+            processedFills++;
+
+            fillsFile.read(reinterpret_cast<char*>(&bookFill), sizeof(book_fill_snapshot_t));
+            hasMoreFills = fillsFile.gcount() == sizeof(book_fill_snapshot_t);
+        }
+
+        if (replayProfile_) replayProfile_->onEvent();
+
+        if (meter.due()) {
+            meter.update(progressSample(processedTops + processedFills, lastTs,
+                                        inputBytesRead(topsFile, topsSize) + inputBytesRead(fillsFile, fillsSize)));
+        }
+    }
+
+    meter.finish(progressSample(processedTops + processedFills, lastTs, topsSize + fillsSize));
+
+    if (replayProfile_) replayProfile_->end();
+
+    std::cout << "Simulation complete. Processed " << processedTops << " tops and "
+              << processedFills << " fills." << std::endl;
+}
+
+ProgressSample TheoSweepRunner::progressSample(uint64_t events, uint64_t marketTs, uint64_t bytesRead) const {
+    ProgressSample sample;
+    sample.events = events;
+    sample.marketTs = marketTs;
+    sample.bytesRead = bytesRead;
+    for (const auto& simulator : simulators_) {
+        SimulationSummary result = simulator->summary();
+        sample.ordersPlaced += result.ordersPlaced;
+        sample.ordersFilled += result.ordersFilled;
+        sample.position += result.position;
+    }
+    return sample;
+}
+
+void TheoSweepRunner::runQueueSimulation(const std::string& bookEventsFilePath) {
+    EventTape tape;
+    if (!tape.open(bookEventsFilePath)) {
+        throw std::runtime_error("Failed to open book events file: " + bookEventsFilePath);
+    }
+
+    for (auto& lane : lanes_) {
+        lane->setSymbolId(tape.header().symbol_idx);
+    }
+
+    // One book for all lanes, which only read it
+    QueueBook book(tickNanos_);
+    for (auto& simulator : simulators_) {
+        simulator->setLiveBook(&book);
+    }
+    PrefetchingDecoder decoder(tape, book);
+
+    book_event_hdr_t eventHeader;
+    const char* payload;
+    book_fill_snapshot_t fill;
+    bool hasFill;
+    uint64_t processedEvents = 0;
+
+    std::cout << "Starting queue simulation, processing book events from " << bookEventsFilePath << std::endl;
+
+    uint64_t eventsSize = inputFileSize(bookEventsFilePath);
+    ProgressMeter meter;
+    meter.start(progress_, strategyName(), eventsSize, tape.atEnd() ? 0 : tape.peekTs());
+
+    if (replayProfile_) replayProfile_->begin();
+
+    // Same steps as FillSimulatorT::runQueueSimulation; every lane sees the
+    // event's fill before the book moves to its top
+    while (decoder.next(eventHeader, payload)) {
+        core_->beginEvent();
+        for (auto& simulator : simulators_) {
+            simulator->setEventIndex(processedEvents);
+        }
+
+        bool topChanged = book.apply(eventHeader, payload, fill, hasFill);
+        if (hasFill) {
+            for (auto& simulator : simulators_) {
+                simulator->processBookFill(fill);
+            }
+        }
+        if (topChanged) {
+            book.updateTopLevels();
+        }
+        for (auto& simulator : simulators_) {
+            simulator->processBookTop(book.top());
+        }
+
+        processedEvents++;
+        if (replayProfile_) replayProfile_->onEvent();
+
+        if (meter.due()) {
+            meter.update(progressSample(processedEvents, book.top().ts, tape.bytesRead()));
+        }
+    }
+
+    for (auto& simulator : simulators_) {
+        simulator->flushBookTops();
+        simulator->setLiveBook(nullptr);
+    }
+    meter.finish(progressSample(processedEvents, book.top().ts, eventsSize));
+
+    if (replayProfile_) replayProfile_->end();
+
+    std::cout << "Simulation complete. Processed " << processedEvents << " book events." << std::endl;
+}
+
+void TheoSweepRunner::calculateResults() {
+    std::cout << "\n========= SWEEP RESULTS =========\n";
+    std::cout << "Strategy: " << strategyName() << std::endl;
+    std::cout << std::setw(6) << "Lane" << std::setw(12) << "Place %" << std::setw(12) << "Cancel %"
+              << std::setw(10) << "Placed" << std::setw(10) << "Filled" << std::setw(10) << "Position"
+              << std::setw(14) << "P&L" << std::endl;
+
+    for (size_t lane = 0; lane < simulators_.size(); ++lane) {
+        SimulationSummary result = simulators_[lane]->summary();
+        std::cout << std::setw(6) << lane
+                  << std::setw(12) << core_->placeEdgePercent(lane)
+                  << std::setw(12) << core_->cancelEdgePercent(lane)
+                  << std::setw(10) << result.ordersPlaced
+                  << std::setw(10) << result.ordersFilled
+                  << std::setw(10) << result.position
+                  << std::setw(14) << result.pnl << std::endl;
+    }
+
+    std::cout << "=================================\n";
+}
+
+TheoSweepReferenceRunner::TheoSweepReferenceRunner(const std::vector<double>& placeEdgePercents,
+                                                   const std::vector<double>& cancelEdgePercents,
+                                                   uint64_t emaHalfLifeNs,
+                                                   const std::string& outputFilePath,
+                                                   uint64_t strategyMdLatencyNs,
+                                                   uint64_t exchangeLatencyNs,
+                                                   bool useQueueSimulation) {
+    for (size_t lane = 0; lane < placeEdgePercents.size(); ++lane) {
+        auto simulator = std::make_unique<ReferenceSimulator>(
+            TheoSweepRunner::laneOutputPath(outputFilePath, lane), strategyMdLatencyNs, exchangeLatencyNs,
+            useQueueSimulation);
+        simulator->setStrategy(std::make_shared<TheoStrategy>(placeEdgePercents[lane], cancelEdgePercents[lane],
+                                                              TheoStrategy::DEFAULT_TRADE_WEIGHT, TheoStrategy::DEFAULT_EMA_DECAY,
+                                                              emaHalfLifeNs));
+        simulators_.push_back(std::move(simulator));
+    }
+}
+
+std::string TheoSweepReferenceRunner::strategyName() const {
+    return "Theo Strategy Sweep reference (" + std::to_string(simulators_.size()) + " lanes)";
+}
+
+void TheoSweepReferenceRunner::runSimulation(const std::string& topsFilePath, const std::string& fillsFilePath) {
+    for (size_t lane = 0; lane < simulators_.size(); ++lane) {
+        std::cout << "Running reference lane " << lane << " of " << simulators_.size() << "..." << std::endl;
+        simulators_[lane]->setReplayProfile(replayProfile_);
+        simulators_[lane]->runSimulation(topsFilePath, fillsFilePath);
+    }
+}
+
+void TheoSweepReferenceRunner::runQueueSimulation(const std::string& bookEventsFilePath) {
+    for (size_t lane = 0; lane < simulators_.size(); ++lane) {
+        std::cout << "Running reference lane " << lane << " of " << simulators_.size() << "..." << std::endl;
+        simulators_[lane]->setReplayProfile(replayProfile_);
+        simulators_[lane]->runQueueSimulation(bookEventsFilePath);
+    }
+}
+
+void TheoSweepReferenceRunner::calculateResults() {
+    for (auto& simulator : simulators_) {
+        simulator->calculateResults();
+    }
+}
+
+std::vector<SimulationSummary> TheoSweepReferenceRunner::summaries() const {
+    std::vector<SimulationSummary> results;
+    for (const auto& simulator : simulators_) {
+        results.push_back(simulator->summary());
+    }
+    return results;
+}
+
+void TheoSweepReferenceRunner::setRecordObserver(RecordObserver* observer, size_t firstStream) {
+    SimulationRunner::setRecordObserver(observer, firstStream);
+    for (size_t lane = 0; lane < simulators_.size(); ++lane) {
+        simulators_[lane]->setRecordObserver(observer, firstStream + lane);
+    }
+}
+
+void TheoSweepReferenceRunner::setLatencyModel(const LatencyModel* model) {
+    for (auto& simulator : simulators_) {
+        simulator->setLatencyModel(model);
+    }
+}
+
+void TheoSweepReferenceRunner::setDepthHistory(size_t prices) {
+    for (auto& simulator : simulators_) {
+        simulator->setDepthHistory(prices);
+    }
+}
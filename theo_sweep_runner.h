@@ -0,0 +1,80 @@
+#ifndef THEO_SWEEP_RUNNER_H
+#define THEO_SWEEP_RUNNER_H
+
+#include <string>
+#include <memory>
+#include <vector>
+#include "fill_simulator.h"
+#include "reference_simulator.h"
+#include "strategies/theo_sweep_strategy.h"
+
+// Runs every lane of a TheoStrategy edge sweep against its own fill
+// simulator. The input is read once and each event is handed to all lanes
+// in turn, so the lanes share a single theo evaluation per event. In queue
+// mode the lanes also share one book, rebuilt once from the events.
+class TheoSweepRunner : public SimulationRunner {
+public:
+    TheoSweepRunner(std::shared_ptr<TheoSweepCore> core,
+                    const std::string& outputFilePath,
+                    uint64_t strategyMdLatencyNs,
+                    uint64_t exchangeLatencyNs,
+                    bool useQueueSimulation);
+
+    void runSimulation(const std::string& topsFilePath, const std::string& fillsFilePath) override;
+    void runQueueSimulation(const std::string& bookEventsFilePath) override;
+
+    // One line per lane instead of the full report of a single run
+    void calculateResults() override;
+
+    std::string strategyName() const override;
+    std::vector<SimulationSummary> summaries() const override;
+
+    // Each lane reports its records as its own stream
+    void setRecordObserver(RecordObserver* observer, size_t firstStream = 0) override;
+
+    // Lanes draw the same latencies for the same events, so they differ only
+    // by their edges
+    void setLatencyModel(const LatencyModel* model) override;
+    void setDepthHistory(size_t prices) override;
+
+    // Output file of a lane: the lane number is inserted before the extension
+    static std::string laneOutputPath(const std::string& outputFilePath, size_t lane);
+
+private:
+    // Progress of the shared event loops, with the orders of all lanes summed
+    ProgressSample progressSample(uint64_t events, uint64_t marketTs, uint64_t bytesRead) const;
+
+    std::shared_ptr<TheoSweepCore> core_;
+    std::vector<std::shared_ptr<TheoSweepLane>> lanes_;
+    std::vector<std::unique_ptr<FillSimulatorT<TheoSweepLane>>> simulators_;
+};
+
+// Reference engine for the sweep (--verify): every lane is a plain
+// TheoStrategy on its own ReferenceSimulator, and each lane replays the
+// whole input by itself. Output files and streams are laid out as for
+// TheoSweepRunner.
+class TheoSweepReferenceRunner : public SimulationRunner {
+public:
+    TheoSweepReferenceRunner(const std::vector<double>& placeEdgePercents,
+                             const std::vector<double>& cancelEdgePercents,
+                             uint64_t emaHalfLifeNs,
+                             const std::string& outputFilePath,
+                             uint64_t strategyMdLatencyNs,
+                             uint64_t exchangeLatencyNs,
+                             bool useQueueSimulation);
+
+    void runSimulation(const std::string& topsFilePath, const std::string& fillsFilePath) override;
+    void runQueueSimulation(const std::string& bookEventsFilePath) override;
+    void calculateResults() override;
+
+    std::string strategyName() const override;
+    std::vector<SimulationSummary> summaries() const override;
+    void setRecordObserver(RecordObserver* observer, size_t firstStream = 0) override;
+    void setLatencyModel(const LatencyModel* model) override;
+    void setDepthHistory(size_t prices) override;
+
+private:
+    std::vector<std::unique_ptr<ReferenceSimulator>> simulators_;
+};
+
+#endif
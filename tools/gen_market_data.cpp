@@ -0,0 +1,188 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "synthetic_market.h"
+
+namespace {
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [options]" << std::endl;
+    std::cerr << "Writes <out-dir>/<exchange>.{book_events,book_tops,book_fills}.<symbol>.bin per symbol." << std::endl;
+    std::cerr << "Options:" << std::endl;
+    std::cerr << "  --out-dir <dir>             Output directory (default .)" << std::endl;
+    std::cerr << "  --exchange <name>           File name prefix (default SYN)" << std::endl;
+    std::cerr << "  --symbols <n>               Number of symbols (default 1)" << std::endl;
+    std::cerr << "  --events <n>                Events per symbol (default 1000000)" << std::endl;
+    std::cerr << "  --seed <n>                  Random seed (default 1)" << std::endl;
+    std::cerr << "  --date <yyyymmdd>           Date written to the file headers" << std::endl;
+    std::cerr << "  --rate <events/s>           Mean event rate per symbol (default 100000)" << std::endl;
+    std::cerr << "  --tick <nanos>              Tick size in price nanos (default 10000000)" << std::endl;
+    std::cerr << "  --start-price <nanos>       Initial mid (default 100000000000)" << std::endl;
+    std::cerr << "  --volatility <ticks>        Mid std dev per sqrt(second) (default 20)" << std::endl;
+    std::cerr << "  --depth <ticks>             Mean depth of new orders behind the touch (default 3)" << std::endl;
+    std::cerr << "  --lifetime-ns <ns>          Mean order lifetime (default 20000000)" << std::endl;
+    std::cerr << "  --lifetime-dist <exp|lognormal>" << std::endl;
+    std::cerr << "  --lifetime-sigma <s>        Sigma of the lognormal lifetime (default 1)" << std::endl;
+    std::cerr << "  --mix <type>=<w>,...        Event weights; types: add, delete, replace, amend, reduce," << std::endl;
+    std::cerr << "                              execute, execute_at_price, clear, session, hidden" << std::endl;
+    std::cerr << "  --threads <n>               Symbols generated in parallel (default: hardware threads)" << std::endl;
+    std::cerr << "  --symbols-csv <file>        Also write a stock_locate,symbol CSV of the generated symbols" << std::endl;
+}
+
+void parseMix(const std::string& text, SyntheticMarketConfig::EventMix& mix) {
+    static const std::vector<std::pair<std::string, book_event_type_e::Enum>> names = {
+        {"add", book_event_type_e::add_order},
+        {"delete", book_event_type_e::delete_order},
+        {"replace", book_event_type_e::replace_order},
+        {"amend", book_event_type_e::amend_order},
+        {"reduce", book_event_type_e::reduce_order},
+        {"execute", book_event_type_e::execute_order},
+        {"execute_at_price", book_event_type_e::execute_order_at_price},
+        {"clear", book_event_type_e::clear_book},
+        {"session", book_event_type_e::session_event},
+        {"hidden", book_event_type_e::hidden_trade},
+    };
+
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t comma = text.find(',', start);
+        if (comma == std::string::npos) comma = text.size();
+        std::string item = text.substr(start, comma - start);
+        size_t eq = item.find('=');
+
+        bool known = false;
+        for (const auto& [name, type] : names) {
+            if (eq != std::string::npos && item.substr(0, eq) == name) {
+                mix[type] = std::stod(item.substr(eq + 1));
+                known = true;
+            }
+        }
+        if (!known) {
+            throw std::invalid_argument("Invalid mix entry '" + item + "'");
+        }
+        start = comma + 1;
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    SyntheticMarketConfig config;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    std::string symbolsCsv;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--help" || arg == "-h") {
+                printUsage(argv[0]);
+                return 0;
+            }
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Missing value for " + arg);
+            }
+            std::string value = argv[++i];
+
+            if (arg == "--out-dir") config.outputDir = value;
+            else if (arg == "--exchange") config.exchange = value;
+            else if (arg == "--symbols") config.symbols = std::stoul(value);
+            else if (arg == "--events") config.eventsPerSymbol = std::stoull(value);
+            else if (arg == "--seed") config.seed = std::stoull(value);
+            else if (arg == "--date") config.dateint = std::stoul(value);
+            else if (arg == "--rate") config.eventsPerSecond = std::stod(value);
+            else if (arg == "--tick") config.tickNanos = std::stoll(value);
+            else if (arg == "--start-price") config.startPriceNanos = std::stoll(value);
+            else if (arg == "--volatility") config.volatilityTicks = std::stod(value);
+            else if (arg == "--depth") config.depthTicks = std::stod(value);
+            else if (arg == "--lifetime-ns") config.lifetimeMeanNs = std::stod(value);
+            else if (arg == "--lifetime-sigma") config.lifetimeSigma = std::stod(value);
+            else if (arg == "--lifetime-dist") {
+                if (value != "exp" && value != "lognormal") {
+                    throw std::invalid_argument("Unknown lifetime distribution '" + value + "'");
+                }
+                config.lognormalLifetime = value == "lognormal";
+            }
+            else if (arg == "--mix") parseMix(value, config.mix);
+            else if (arg == "--threads") threads = std::max(1ul, std::stoul(value));
+            else if (arg == "--symbols-csv") symbolsCsv = value;
+            else throw std::invalid_argument("Unknown option " + arg);
+        }
+        if (config.eventsPerSecond <= 0 || config.tickNanos <= 0 || config.startPriceNanos <= 0 ||
+            config.lotSize == 0 || config.maxLots == 0) {
+            throw std::invalid_argument("Rate, tick, start price and lot sizes must be positive");
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::cout << "Generating " << config.symbols << " symbol(s) x " << config.eventsPerSymbol
+              << " events into " << config.outputDir << " with " << threads << " thread(s)" << std::endl;
+
+    auto start = std::chrono::steady_clock::now();
+
+    // Symbols are handed out one at a time; each one's output depends only on
+    // the config and its index
+    std::atomic<uint32_t> nextSymbol(0);
+    std::mutex mutex;
+    SyntheticMarketStats total;
+    std::string error;
+
+    auto worker = [&]() {
+        for (uint32_t symbol = nextSymbol++; symbol < config.symbols; symbol = nextSymbol++) {
+            try {
+                SyntheticMarketStats stats = generateSymbol(config, symbol);
+                std::lock_guard<std::mutex> lock(mutex);
+                total.events += stats.events;
+                total.tops += stats.tops;
+                total.fills += stats.fills;
+            }
+            catch (const std::exception& e) {
+                std::lock_guard<std::mutex> lock(mutex);
+                error = e.what();
+                nextSymbol = config.symbols;
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned i = 1; i < std::min<unsigned>(threads, config.symbols); ++i) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : pool) {
+        thread.join();
+    }
+
+    if (!error.empty()) {
+        std::cerr << "Error: " << error << std::endl;
+        return 1;
+    }
+
+    if (!symbolsCsv.empty()) {
+        std::ofstream csv(symbolsCsv);
+        csv << "stock_locate,symbol\n";
+        for (uint32_t symbol = 0; symbol < config.symbols; ++symbol) {
+            csv << symbol + 1 << "," << SyntheticMarketConfig::symbolName(symbol) << "\n";
+        }
+        if (!csv) {
+            std::cerr << "Error: Failed to write " << symbolsCsv << std::endl;
+            return 1;
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Events: " << total.events << ", tops: " << total.tops << ", fills: " << total.fills << std::endl;
+    std::cout << "Elapsed: " << seconds << " s (" << total.events / seconds * 60.0 / 1e6
+              << " M events/min)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,628 @@
+#include "synthetic_market.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <queue>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+// xoshiro256** seeded through splitmix64
+class Rng {
+public:
+    explicit Rng(uint64_t seed) {
+        for (auto& word : state_) {
+            seed += 0x9E3779B97F4A7C15ULL;
+            uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            word = z ^ (z >> 31);
+        }
+    }
+
+    uint64_t next() {
+        uint64_t result = rotl(state_[1] * 5, 7) * 9;
+        uint64_t t = state_[1] << 17;
+        state_[2] ^= state_[0];
+        state_[3] ^= state_[1];
+        state_[1] ^= state_[2];
+        state_[0] ^= state_[3];
+        state_[2] ^= t;
+        state_[3] = rotl(state_[3], 45);
+        return result;
+    }
+
+    // Uniform in [0, 1)
+    double uniform() { return (next() >> 11) * 0x1.0p-53; }
+
+    // Uniform in [0, n)
+    uint64_t below(uint64_t n) { return static_cast<uint64_t>((static_cast<unsigned __int128>(next()) * n) >> 64); }
+
+    double exponential(double mean) { return -std::log1p(-uniform()) * mean; }
+
+    double normal() {
+        double u1 = 1.0 - uniform();
+        double u2 = uniform();
+        return std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586 * u2);
+    }
+
+private:
+    static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+    uint64_t state_[4];
+};
+
+// Buffered writer of fixed-layout records
+class RecordWriter {
+public:
+    explicit RecordWriter(const std::string& path) : path_(path), buffer_(1 << 20), used_(0) {
+        file_ = std::fopen(path.c_str(), "wb");
+        if (file_ == nullptr) {
+            throw std::runtime_error("Failed to open output file: " + path);
+        }
+    }
+
+    ~RecordWriter() {
+        if (file_ != nullptr) {
+            std::fclose(file_);
+        }
+    }
+
+    template <typename T>
+    void write(const T& record) {
+        if (used_ + sizeof(T) > buffer_.size()) {
+            flush();
+        }
+        std::memcpy(buffer_.data() + used_, &record, sizeof(T));
+        used_ += sizeof(T);
+    }
+
+    // Flush, rewrite the file header with its final counts and close
+    template <typename Header>
+    void finish(const Header& header) {
+        flush();
+        if (std::fseek(file_, 0, SEEK_SET) != 0 ||
+            std::fwrite(&header, sizeof(Header), 1, file_) != 1 ||
+            std::fclose(file_) != 0) {
+            file_ = nullptr;
+            throw std::runtime_error("Failed to write output file: " + path_);
+        }
+        file_ = nullptr;
+    }
+
+private:
+    void flush() {
+        if (used_ > 0 && std::fwrite(buffer_.data(), 1, used_, file_) != used_) {
+            throw std::runtime_error("Failed to write output file: " + path_);
+        }
+        used_ = 0;
+    }
+
+    std::string path_;
+    std::FILE* file_;
+    std::vector<char> buffer_;
+    size_t used_;
+};
+
+void setCount(book_events_file_hdr_t& header, uint32_t count) { header.number_of_events = count; }
+void setCount(book_tops_file_hdr_t& header, uint32_t count) { header.number_of_tops = count; }
+void setCount(book_fills_file_hdr_t& header, uint32_t count) { header.number_of_fills = count; }
+
+// Header of a symbol's file; counts past 32 bits saturate
+template <typename Header>
+Header fileHeader(const SyntheticMarketConfig& config, uint32_t symbol, uint64_t count) {
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    header.feed_id = 1;
+    header.dateint = config.dateint;
+    header.symbol_idx = symbol + 1;
+    setCount(header, static_cast<uint32_t>(std::min<uint64_t>(count, UINT32_MAX)));
+    return header;
+}
+
+// The simulated book of one symbol and the writers of its three files
+class SyntheticBook {
+public:
+    SyntheticBook(const SyntheticMarketConfig& config, uint32_t symbol)
+        : config_(config),
+          symbol_(symbol),
+          rng_(config.seed * 0x2545F4914F6CDD1DULL + symbol),
+          events_(config.filePath("book_events", symbol)),
+          tops_(config.filePath("book_tops", symbol)),
+          fills_(config.filePath("book_fills", symbol)),
+          ts_(config.startTsNs),
+          seqNo_(0),
+          nextOrderId_(1),
+          nextExecutionId_(1),
+          midTicks_(config.startPriceNanos / config.tickNanos) {
+        std::memset(&lastTop_, 0, sizeof(lastTop_));
+        orders_.reserve(1 << 16);
+
+        double total = 0;
+        for (size_t type = 0; type < config.mix.size(); ++type) {
+            total += std::max(0.0, config.mix[type]);
+            mixCdf_[type] = total;
+        }
+        if (total <= 0) {
+            throw std::runtime_error("Event mix has no positive weight");
+        }
+        for (auto& bound : mixCdf_) {
+            bound /= total;
+        }
+
+        // A random walk of n one-tick steps has variance n
+        double meanIntervalSec = 1.0 / config.eventsPerSecond;
+        moveProbability_ = std::min(1.0, config.volatilityTicks * config.volatilityTicks * meanIntervalSec);
+
+        // Placeholder headers; the counts are filled in by finish()
+        events_.write(fileHeader<book_events_file_hdr_t>(config, symbol, 0));
+        tops_.write(fileHeader<book_tops_file_hdr_t>(config, symbol, 0));
+        fills_.write(fileHeader<book_fills_file_hdr_t>(config, symbol, 0));
+    }
+
+    SyntheticMarketStats run() {
+        double meanIntervalNs = 1e9 / config_.eventsPerSecond;
+
+        for (uint64_t i = 0; i < config_.eventsPerSymbol; ++i) {
+            ts_ += std::max<uint64_t>(1, static_cast<uint64_t>(rng_.exponential(meanIntervalNs)));
+            seqNo_++;
+
+            if (rng_.uniform() < moveProbability_) {
+                midTicks_ += (rng_.next() & 1) ? 1 : -1;
+                midTicks_ = std::max<int64_t>(midTicks_, 2);
+            }
+
+            // Orders whose lifetime ran out are cancelled before anything else
+            // happens; the mix drives every other event
+            uint64_t expiredId = nextExpired();
+            if (expiredId != 0) {
+                writeEvent(book_event_type_e::delete_order, delete_order_t{expiredId});
+                removeOrder(expiredId);
+            } else {
+                generateEvent(pickType());
+            }
+            stats_.events++;
+            writeTopIfChanged();
+        }
+
+        events_.finish(fileHeader<book_events_file_hdr_t>(config_, symbol_, stats_.events));
+        tops_.finish(fileHeader<book_tops_file_hdr_t>(config_, symbol_, stats_.tops));
+        fills_.finish(fileHeader<book_fills_file_hdr_t>(config_, symbol_, stats_.fills));
+        return stats_;
+    }
+
+private:
+    struct Order {
+        int64_t price;
+        uint32_t qty;
+        bool isBid;
+        uint64_t lastUpdateTs;
+    };
+
+    // Orders at a price in arrival order; ids of orders that have left are
+    // skipped lazily
+    struct Level {
+        uint64_t qty = 0;
+        uint32_t orders = 0;
+        std::vector<uint64_t> queue;
+        size_t head = 0;
+    };
+
+    using BidLevels = std::map<int64_t, Level, std::greater<int64_t>>;
+    using AskLevels = std::map<int64_t, Level>;
+    using Deadline = std::pair<uint64_t, uint64_t>;   // (deadline, order id)
+
+    book_event_type_e::Enum pickType() {
+        double u = rng_.uniform();
+        for (size_t type = 0; type < mixCdf_.size(); ++type) {
+            if (u < mixCdf_[type]) {
+                return static_cast<book_event_type_e::Enum>(type);
+            }
+        }
+        return book_event_type_e::add_order;
+    }
+
+    void generateEvent(book_event_type_e::Enum type) {
+        switch (type) {
+            case book_event_type_e::delete_order: {
+                uint64_t orderId = nextToExpire();
+                if (orderId == 0) break;
+                writeEvent(type, delete_order_t{orderId});
+                removeOrder(orderId);
+                return;
+            }
+
+            case book_event_type_e::replace_order: {
+                uint64_t orderId = nextToExpire();
+                if (orderId == 0) break;
+                bool isBid = orders_[orderId].isBid;
+                removeOrder(orderId);
+
+                uint64_t newOrderId = nextOrderId_++;
+                int64_t price = passivePrice(isBid);
+                uint32_t qty = drawQty();
+                writeEvent(type, replace_order_t{price, orderId, newOrderId, qty});
+                addOrder(newOrderId, price, qty, isBid);
+                return;
+            }
+
+            case book_event_type_e::amend_order: {
+                uint64_t orderId = nextToExpire();
+                if (orderId == 0) break;
+                Order& order = orders_[orderId];
+                uint32_t newQty = drawQty();
+                writeEvent(type, amend_order_t{orderId, newQty});
+                level(order).qty += static_cast<int64_t>(newQty) - static_cast<int64_t>(order.qty);
+                order.qty = newQty;
+                order.lastUpdateTs = ts_;
+                return;
+            }
+
+            case book_event_type_e::reduce_order: {
+                uint64_t orderId = nextToExpire();
+                if (orderId == 0) break;
+                uint32_t cxledQty = partialQty(orders_[orderId].qty);
+                writeEvent(type, reduce_order_t{orderId, cxledQty});
+                takeQty(orderId, cxledQty);
+                return;
+            }
+
+            case book_event_type_e::execute_order:
+            case book_event_type_e::execute_order_at_price: {
+                uint64_t orderId = nextAtTouch(rng_.next() & 1);
+                if (orderId == 0) break;
+                const Order& order = orders_[orderId];
+                uint32_t tradedQty = partialQty(order.qty);
+                uint64_t executionId = nextExecutionId_++;
+                if (type == book_event_type_e::execute_order) {
+                    writeEvent(type, execute_order_t{orderId, tradedQty, executionId});
+                } else {
+                    writeEvent(type, execute_order_at_price_t{orderId, tradedQty, executionId, order.price});
+                }
+                writeFill(orderId, order.price, tradedQty, executionId, false);
+                takeQty(orderId, tradedQty);
+                return;
+            }
+
+            case book_event_type_e::hidden_trade: {
+                bool isBid = rng_.next() & 1;
+                int64_t price = isBid ? bestBid() : bestAsk();
+                if (price == 0) price = midTicks_ * config_.tickNanos;
+                uint32_t qty = config_.lotSize;
+                uint64_t executionId = nextExecutionId_++;
+                writeEvent(type, hidden_trade_t{price, 0, qty, isBid, executionId});
+                writeHiddenFill(price, qty, isBid, executionId);
+                return;
+            }
+
+            case book_event_type_e::clear_book: {
+                writeEvent(type);
+                orders_.clear();
+                bids_.clear();
+                asks_.clear();
+                expiries_ = decltype(expiries_)();
+                return;
+            }
+
+            case book_event_type_e::session_event:
+                writeEvent(type, session_event_t{false});
+                return;
+
+            default:
+                break;
+        }
+
+        // Adds, and anything that needs a resting order when the book is empty
+        bool isBid = rng_.next() & 1;
+        uint64_t orderId = nextOrderId_++;
+        int64_t price = passivePrice(isBid);
+        uint32_t qty = drawQty();
+        writeEvent(book_event_type_e::add_order, add_order_t{price, orderId, qty, isBid});
+        addOrder(orderId, price, qty, isBid);
+    }
+
+    template <typename Payload>
+    void writeEvent(book_event_type_e::Enum type, const Payload& payload) {
+        writeEvent(type);
+        events_.write(payload);
+    }
+
+    void writeEvent(book_event_type_e::Enum type) {
+        book_event_hdr_t header{ts_, seqNo_, type};
+        events_.write(header);
+    }
+
+    // New order price: behind the touch on its own side by a geometric number
+    // of ticks around the mid, never crossing the other side
+    int64_t passivePrice(bool isBid) {
+        double continueProbability = config_.depthTicks / (1.0 + config_.depthTicks);
+        int64_t offset = 1;
+        while (rng_.uniform() < continueProbability) {
+            offset++;
+        }
+
+        int64_t tick = config_.tickNanos;
+        if (isBid) {
+            int64_t price = (midTicks_ - offset) * tick;
+            if (!asks_.empty()) price = std::min(price, asks_.begin()->first - tick);
+            return std::max(price, tick);
+        }
+        int64_t price = (midTicks_ + offset) * tick;
+        if (!bids_.empty()) price = std::max(price, bids_.begin()->first + tick);
+        return price;
+    }
+
+    uint32_t drawQty() {
+        return config_.lotSize * static_cast<uint32_t>(1 + rng_.below(config_.maxLots));
+    }
+
+    // Whole lots strictly below qty, or all of it for a single lot
+    uint32_t partialQty(uint32_t qty) {
+        uint32_t lots = qty / config_.lotSize;
+        if (lots <= 1) return qty;
+        return config_.lotSize * static_cast<uint32_t>(1 + rng_.below(lots - 1));
+    }
+
+    uint64_t drawDeadline() {
+        double lifetime;
+        if (config_.lognormalLifetime) {
+            double sigma = config_.lifetimeSigma;
+            double mu = std::log(config_.lifetimeMeanNs) - 0.5 * sigma * sigma;
+            lifetime = std::exp(mu + sigma * rng_.normal());
+        } else {
+            lifetime = rng_.exponential(config_.lifetimeMeanNs);
+        }
+        return ts_ + static_cast<uint64_t>(lifetime);
+    }
+
+    void addOrder(uint64_t orderId, int64_t price, uint32_t qty, bool isBid) {
+        orders_[orderId] = Order{price, qty, isBid, ts_};
+        Level& lvl = isBid ? bids_[price] : asks_[price];
+        lvl.qty += qty;
+        lvl.orders++;
+        lvl.queue.push_back(orderId);
+        expiries_.push(Deadline{drawDeadline(), orderId});
+    }
+
+    Level& level(const Order& order) {
+        return order.isBid ? bids_[order.price] : asks_[order.price];
+    }
+
+    void removeOrder(uint64_t orderId) {
+        auto it = orders_.find(orderId);
+        const Order& order = it->second;
+        Level& lvl = level(order);
+        lvl.qty -= order.qty;
+        lvl.orders--;
+        if (lvl.orders == 0) {
+            if (order.isBid) bids_.erase(order.price); else asks_.erase(order.price);
+        }
+        orders_.erase(it);
+    }
+
+    void takeQty(uint64_t orderId, uint32_t qty) {
+        Order& order = orders_[orderId];
+        if (qty >= order.qty) {
+            removeOrder(orderId);
+            return;
+        }
+        order.qty -= qty;
+        order.lastUpdateTs = ts_;
+        level(order).qty -= qty;
+    }
+
+    // Live order whose lifetime has run out by now, 0 if there is none
+    uint64_t nextExpired() {
+        while (!expiries_.empty()) {
+            const Deadline& next = expiries_.top();
+            if (!orders_.count(next.second)) {
+                expiries_.pop();
+                continue;
+            }
+            if (next.first > ts_) {
+                return 0;
+            }
+            uint64_t orderId = next.second;
+            expiries_.pop();
+            return orderId;
+        }
+        return 0;
+    }
+
+    // Live order with the earliest drawn expiry, 0 if the book is empty
+    uint64_t nextToExpire() {
+        while (!expiries_.empty()) {
+            uint64_t orderId = expiries_.top().second;
+            if (orders_.count(orderId)) {
+                // Pop it; replace and delete remove it and the others keep
+                // it alive with a fresh deadline
+                expiries_.pop();
+                expiries_.push(Deadline{drawDeadline(), orderId});
+                return orderId;
+            }
+            expiries_.pop();
+        }
+        return 0;
+    }
+
+    // Oldest live order at the best price of a side (the other side if that
+    // one is empty), 0 if the book is empty
+    uint64_t nextAtTouch(bool preferBid) {
+        for (int attempt = 0; attempt < 2; ++attempt) {
+            bool isBid = attempt == 0 ? preferBid : !preferBid;
+            Level* lvl = nullptr;
+            if (isBid && !bids_.empty()) lvl = &bids_.begin()->second;
+            if (!isBid && !asks_.empty()) lvl = &asks_.begin()->second;
+            if (lvl == nullptr) continue;
+
+            while (lvl->head < lvl->queue.size()) {
+                uint64_t orderId = lvl->queue[lvl->head];
+                if (orders_.count(orderId)) {
+                    // Drop the skipped ids once they dominate the queue
+                    if (lvl->head > 64 && 2 * lvl->head > lvl->queue.size()) {
+                        lvl->queue.erase(lvl->queue.begin(), lvl->queue.begin() + lvl->head);
+                        lvl->head = 0;
+                    }
+                    return orderId;
+                }
+                lvl->head++;
+            }
+        }
+        return 0;
+    }
+
+    int64_t bestBid() const { return bids_.empty() ? 0 : bids_.begin()->first; }
+    int64_t bestAsk() const { return asks_.empty() ? 0 : asks_.begin()->first; }
+
+    void writeFill(uint64_t orderId, int64_t tradePrice, uint32_t tradeQty, uint64_t executionId, bool hidden) {
+        const Order& order = orders_[orderId];
+        const Level& lvl = order.isBid ? bids_.at(order.price) : asks_.at(order.price);
+
+        book_fill_snapshot_t fill;
+        std::memset(&fill, 0, sizeof(fill));
+        fill.ts = ts_;
+        fill.seq_no = seqNo_;
+        fill.resting_order_id = orderId;
+        fill.was_hidden = hidden;
+        fill.trade_price = tradePrice;
+        fill.trade_qty = tradeQty;
+        fill.execution_id = executionId;
+        fill.resting_original_qty = order.qty;
+        fill.resting_order_remaining_qty = order.qty - tradeQty;
+        fill.resting_order_last_update_ts = order.lastUpdateTs;
+        fill.resting_side_is_bid = order.isBid;
+        fill.resting_side_price = order.price;
+        fill.resting_side_qty = static_cast<uint32_t>(lvl.qty);
+        fill.resting_side_number_of_orders = lvl.orders;
+        setOpposingSide(fill, order.isBid);
+        fills_.write(fill);
+        stats_.fills++;
+    }
+
+    void writeHiddenFill(int64_t price, uint32_t qty, bool isBid, uint64_t executionId) {
+        book_fill_snapshot_t fill;
+        std::memset(&fill, 0, sizeof(fill));
+        fill.ts = ts_;
+        fill.seq_no = seqNo_;
+        fill.was_hidden = true;
+        fill.trade_price = price;
+        fill.trade_qty = qty;
+        fill.execution_id = executionId;
+        fill.resting_original_qty = qty;
+        fill.resting_order_last_update_ts = ts_;
+        fill.resting_side_is_bid = isBid;
+        fill.resting_side_price = price;
+        fill.resting_side_qty = qty;
+        setOpposingSide(fill, isBid);
+        fills_.write(fill);
+        stats_.fills++;
+    }
+
+    void setOpposingSide(book_fill_snapshot_t& fill, bool restingIsBid) {
+        if (restingIsBid) {
+            fill.opposing_side_price = asks_.empty() ? INT64_MAX : asks_.begin()->first;
+            fill.opposing_side_qty = asks_.empty() ? 0 : static_cast<uint32_t>(asks_.begin()->second.qty);
+        } else {
+            fill.opposing_side_price = bids_.empty() ? 0 : bids_.begin()->first;
+            fill.opposing_side_qty = bids_.empty() ? 0 : static_cast<uint32_t>(bids_.begin()->second.qty);
+        }
+    }
+
+    template <typename Levels>
+    static void fillLevels(const Levels& levels, book_top_level_t* out[3], bool isBid) {
+        auto it = levels.begin();
+        for (int i = 0; i < 3; ++i) {
+            int64_t price = 0;
+            uint32_t qty = 0;
+            if (it != levels.end()) {
+                price = it->first;
+                qty = static_cast<uint32_t>(it->second.qty);
+                ++it;
+            }
+            if (isBid) {
+                out[i]->bid_nanos = price;
+                out[i]->bid_qty = qty;
+            } else {
+                out[i]->ask_nanos = price;
+                out[i]->ask_qty = qty;
+            }
+        }
+    }
+
+    // A top is written whenever any of the three levels changed
+    void writeTopIfChanged() {
+        book_top_t top;
+        std::memset(&top, 0, sizeof(top));
+        book_top_level_t* levels[3] = {&top.top_level, &top.second_level, &top.third_level};
+        fillLevels(bids_, levels, true);
+        fillLevels(asks_, levels, false);
+
+        if (std::memcmp(&top.top_level, &lastTop_.top_level, 3 * sizeof(book_top_level_t)) == 0) {
+            return;
+        }
+        top.ts = ts_;
+        top.seqno = seqNo_;
+        tops_.write(top);
+        lastTop_ = top;
+        stats_.tops++;
+    }
+
+    const SyntheticMarketConfig& config_;
+    uint32_t symbol_;
+    Rng rng_;
+    RecordWriter events_;
+    RecordWriter tops_;
+    RecordWriter fills_;
+
+    uint64_t ts_;
+    uint64_t seqNo_;
+    uint64_t nextOrderId_;
+    uint64_t nextExecutionId_;
+    int64_t midTicks_;
+    double moveProbability_;
+    SyntheticMarketConfig::EventMix mixCdf_;
+
+    std::unordered_map<uint64_t, Order> orders_;
+    BidLevels bids_;
+    AskLevels asks_;
+    std::priority_queue<Deadline, std::vector<Deadline>, std::greater<Deadline>> expiries_;
+
+    book_top_t lastTop_;
+    SyntheticMarketStats stats_;
+};
+
+} // namespace
+
+SyntheticMarketConfig::EventMix SyntheticMarketConfig::defaultMix() {
+    EventMix mix{};
+    // Most cancels come from expiring orders rather than from the mix
+    mix[book_event_type_e::add_order] = 60;
+    mix[book_event_type_e::delete_order] = 10;
+    mix[book_event_type_e::replace_order] = 8;
+    mix[book_event_type_e::amend_order] = 3;
+    mix[book_event_type_e::reduce_order] = 6;
+    mix[book_event_type_e::execute_order] = 10;
+    mix[book_event_type_e::execute_order_at_price] = 1.5;
+    mix[book_event_type_e::hidden_trade] = 1.5;
+    return mix;
+}
+
+std::string SyntheticMarketConfig::filePath(const std::string& kind, uint32_t symbol) const {
+    return outputDir + "/" + exchange + "." + kind + "." + symbolName(symbol) + ".bin";
+}
+
+std::string SyntheticMarketConfig::symbolName(uint32_t symbol) {
+    char name[16];
+    std::snprintf(name, sizeof(name), "S%04u", symbol);
+    return name;
+}
+
+SyntheticMarketStats generateSymbol(const SyntheticMarketConfig& config, uint32_t symbol) {
+    SyntheticBook book(config, symbol);
+    return book.run();
+}
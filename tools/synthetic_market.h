@@ -0,0 +1,63 @@
+#ifndef SYNTHETIC_MARKET_H
+#define SYNTHETIC_MARKET_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include "../types/market_data_types.h"
+
+// Synthetic order-book market data in the layouts of market_data_types.h.
+//
+// Each symbol runs its own simulated limit order book. Orders arrive around
+// a mid price that follows a random walk and are cancelled when their drawn
+// lifetime runs out; in between, the event mix decides which orders arrive,
+// are cancelled early, reduced, amended, replaced or executed. The book's event stream is written as book_events, every change of
+// the top three levels as book_tops and every execution as book_fills, so the
+// three files of a symbol describe the same market. Output depends only on
+// the config and the symbol index, never on thread scheduling.
+struct SyntheticMarketConfig {
+    // Event mix, as relative weights indexed by book_event_type_e
+    using EventMix = std::array<double, book_event_type_e::hidden_trade + 1>;
+
+    std::string outputDir = ".";
+    std::string exchange = "SYN";
+    uint32_t symbols = 1;
+    uint64_t eventsPerSymbol = 1000000;
+    uint64_t seed = 1;
+    uint32_t dateint = 20240102;
+    uint64_t startTsNs = 34200000000000ULL;       // 09:30 in ns since midnight
+
+    double eventsPerSecond = 100000;              // mean arrival rate per symbol
+    int64_t tickNanos = 10000000;                 // $0.01
+    int64_t startPriceNanos = 100000000000LL;     // $100
+    double volatilityTicks = 20;                  // mid std dev per sqrt(second), in ticks
+    double depthTicks = 3;                        // mean distance of new orders behind the touch
+    uint32_t lotSize = 100;
+    uint32_t maxLots = 10;
+
+    // Order lifetime: exponential with the given mean, or lognormal with
+    // that mean and sigma
+    bool lognormalLifetime = false;
+    double lifetimeMeanNs = 20000000;
+    double lifetimeSigma = 1.0;
+
+    EventMix mix = defaultMix();
+
+    static EventMix defaultMix();
+
+    // File of one symbol, <outputDir>/<exchange>.<kind>.<symbol>.bin
+    std::string filePath(const std::string& kind, uint32_t symbol) const;
+    static std::string symbolName(uint32_t symbol);
+};
+
+struct SyntheticMarketStats {
+    uint64_t events = 0;
+    uint64_t tops = 0;
+    uint64_t fills = 0;
+};
+
+// Generate the book_events, book_tops and book_fills files of one symbol.
+// Throws std::runtime_error if a file cannot be written.
+SyntheticMarketStats generateSymbol(const SyntheticMarketConfig& config, uint32_t symbol);
+
+#endif